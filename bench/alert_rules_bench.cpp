@@ -0,0 +1,141 @@
+// Custo das regras de alerta por lista de processos: o AlertEngine seguindo
+// so o diff (5% dos processos mudam por tick) contra o mesmo motor recebendo
+// todos os processos como alterados, o que equivale a reavaliar todas as
+// regras em todos os processos. Os dois precisam chegar aos mesmos alertas.
+#include "alert_rules.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static const int WARMUP_TICKS = 5;
+static const int TICKS = 60;
+static const uint8_t CHANGED_FIELDS = CHANGE_CPU | CHANGE_MEMORY | CHANGE_THREADS | CHANGE_RATES | CHANGE_NAME;
+
+// Limiares, duracoes, taxas com tres janelas, rankings e filtros por nome,
+// na proporcao de um arquivo de regras de verdade: poucos processos passam
+// de cada limiar.
+static std::string makeRules(size_t count) {
+    std::string text;
+    char line[160];
+    for (size_t i = 0; i < count; ++i) {
+        switch (i % 6) {
+        case 0:
+            snprintf(line, sizeof(line), "cpu_%zu: process cpu > %zu\n", i, 90 + i % 10);
+            break;
+        case 1:
+            snprintf(line, sizeof(line), "mem_%zu: process mem > %zuM for 10s\n", i, 580 + i % 40);
+            break;
+        case 2:
+            snprintf(line, sizeof(line), "cresce_%zu: process mem > 500M and rate(mem, %ds) > 1M for 5s\n", i, 30 << (i % 3));
+            break;
+        case 3:
+            snprintf(line, sizeof(line), "top_%zu: process top %zu cpu for 3s\n", i, 5 + i % 10);
+            break;
+        case 4:
+            snprintf(line, sizeof(line), "nome_%zu: process name=proc%zu core > 600\n", i, i % 50);
+            break;
+        default:
+            snprintf(line, sizeof(line), "io_%zu: process write > %zuK\n", i, 1000 + i % 24);
+            break;
+        }
+        text += line;
+    }
+    return text;
+}
+
+static void initProcesses(SystemInfo& info, size_t processes) {
+    NameInterner names;
+    info.processes.resize(processes);
+    for (size_t i = 0; i < processes; ++i) {
+        ProcessInfo& p = info.processes[i];
+        p.pid = (unsigned long)(i + 100);
+        p.startTime = i + 1;
+        p.name = names.intern("proc" + std::to_string(i % 200));
+        p.memoryUsedBytes = (unsigned long long)(i % 600) * 1024 * 1024;
+        p.cpuUsagePercentage = (double)(i % 100);
+        p.cpuCorePercentage = p.cpuUsagePercentage * 8;
+        p.threadCount = 1 + i % 16;
+        p.ratesValid = processCounterBit(COUNTER_IO_WRITE_BYTES);
+        p.rates[COUNTER_IO_WRITE_BYTES] = (double)(i % 1024) * 1024;
+    }
+}
+
+struct Result {
+    double usPerTick = 0.0;
+    double evaluationsPerTick = 0.0;
+    AlertStats stats;
+};
+
+static Result run(size_t processes, size_t rules, bool fullList) {
+    std::shared_ptr<AlertPlan> plan = std::make_shared<AlertPlan>();
+    std::string error;
+    if (!compileAlertRules(makeRules(rules), *plan, error)) {
+        fprintf(stderr, "regras invalidas: %s\n", error.c_str());
+        exit(1);
+    }
+
+    SystemInfo info;
+    initProcesses(info, processes);
+    AlertEngine engine;
+    engine.setPlan(plan);
+    std::chrono::steady_clock::time_point now{};
+    SnapshotDiff diff;
+    engine.updateProcesses(info, diff, now);
+
+    Result result;
+    unsigned long long evaluationsBefore = 0;
+    unsigned seed = 1;
+    std::vector<bool> changed(processes);
+    for (int tick = 0; tick < WARMUP_TICKS + TICKS; ++tick) {
+        now += std::chrono::seconds(1);
+        // Os mesmos 5% em qualquer modo: so muda o que o motor recebe.
+        diff.changes.clear();
+        std::fill(changed.begin(), changed.end(), false);
+        for (size_t n = 0; n < processes / 20; ++n) {
+            seed = seed * 1103515245u + 12345u;
+            size_t index = (seed >> 8) % processes;
+            ProcessInfo& p = info.processes[index];
+            p.cpuUsagePercentage = (double)((seed >> 4) % 100);
+            p.cpuCorePercentage = p.cpuUsagePercentage * 8;
+            p.memoryUsedBytes += (seed % 3) * 1024 * 1024;
+            changed[index] = true;
+        }
+        // Como o SnapshotDiffer: em ordem de PID, so quem mudou.
+        for (size_t i = 0; i < processes; ++i) {
+            if (fullList || changed[i]) {
+                diff.changes.push_back({ fullList ? CHANGED_FIELDS : (uint8_t)(CHANGE_CPU | CHANGE_MEMORY), info.processes[i] });
+            }
+        }
+
+        if (tick == WARMUP_TICKS) evaluationsBefore = engine.stats().evaluations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        engine.updateProcesses(info, diff, now);
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (tick >= WARMUP_TICKS) result.usPerTick += us / TICKS;
+    }
+    result.stats = engine.stats();
+    result.evaluationsPerTick = (double)(result.stats.evaluations - evaluationsBefore) / TICKS;
+    return result;
+}
+
+int main() {
+    const size_t sizes[][2] = { { 2000, 100 }, { 5000, 300 }, { 10000, 600 } };
+    printf("%-14s %10s %8s %12s %16s %10s\n", "modo", "processos", "regras", "us/tick", "avaliacoes/tick", "disparos");
+    for (const auto& size : sizes) {
+        Result incremental = run(size[0], size[1], false);
+        Result full = run(size[0], size[1], true);
+        printf("%-14s %10zu %8zu %12.1f %16.0f %10llu\n", "diff", size[0], size[1],
+            incremental.usPerTick, incremental.evaluationsPerTick, incremental.stats.fired);
+        printf("%-14s %10zu %8zu %12.1f %16.0f %10llu\n", "lista inteira", size[0], size[1],
+            full.usPerTick, full.evaluationsPerTick, full.stats.fired);
+        if (incremental.stats.fired != full.stats.fired || incremental.stats.resolved != full.stats.resolved) {
+            fprintf(stderr, "alertas divergentes: %llu/%llu != %llu/%llu\n", incremental.stats.fired,
+                incremental.stats.resolved, full.stats.fired, full.stats.resolved);
+            return 1;
+        }
+    }
+    return 0;
+}
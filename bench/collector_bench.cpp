@@ -0,0 +1,299 @@
+// Mede o custo por tick da coleta para tabelas de 100 a 100k processos:
+//   collector   LinuxCollector sobre um /proc falso gerado em disco
+//   monitor     SystemMonitor::collectNow com o SyntheticCollector (contas de
+//               delta, ordenacao, copia e publicacao do snapshot)
+//   ui_table    reordenacao e texto das linhas visiveis da tabela da interface
+//   query       consulta top 20 por CPU numa lista nova (query_hit: a mesma
+//               consulta repetida sobre a mesma lista)
+//   stream_full frame do modo headless comparando a lista inteira
+//   stream_diff o mesmo frame a partir do diff da lista
+//   metrics     texto do Prometheus de um snapshot novo (o que um scrape
+//               paga uma vez por versao)
+//   end_to_end  SystemMonitor::collectNow sobre o /proc falso
+// As fases com /proc falso so existem fora do Windows (ou sem --mock).
+// Cada linha do stdout e um objeto JSON; o resumo legivel vai para o stderr.
+#include "backend.h"
+#include "metrics_server.h"
+#include "process_table.h"
+#include "stream_format.h"
+#include "synthetic_collector.h"
+
+#ifndef _WIN32
+#include "collector_linux.h"
+#include "fake_proc.h"
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+static std::atomic<unsigned long long> g_allocations{ 0 };
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Linhas que cabem na tabela da interface numa janela de 720 px.
+static const size_t UI_VISIBLE_ROWS = 40;
+
+struct BenchOptions {
+    std::vector<size_t> sizes{ 100, 1000, 10000, 100000 };
+    size_t threadsPerProcess = 8;
+    size_t focusedProcesses = 1;
+    int ticks = 30;
+    int warmupTicks = 3;
+    unsigned samplingThreads = 0;
+    std::string root;
+    bool mockOnly = false;
+};
+
+struct PhaseResult {
+    std::vector<double> tickMs;
+    unsigned long long allocations = 0;
+};
+
+// ru_maxrss e o pico do processo inteiro: como os tamanhos rodam em ordem
+// crescente, o valor reportado e dominado pelo tamanho atual.
+static unsigned long long peakRssKb() {
+#ifndef _WIN32
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (unsigned long long)usage.ru_maxrss;
+#else
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (unsigned long long)(pmc.PeakWorkingSetSize / 1024);
+#endif
+}
+
+// between roda fora da medicao (avanca o sistema simulado); work e o tick.
+static PhaseResult measure(const BenchOptions& options, const std::function<void()>& between,
+    const std::function<void()>& work) {
+    PhaseResult result;
+    result.tickMs.reserve(options.ticks);
+    for (int tick = 0; tick < options.warmupTicks + options.ticks; ++tick) {
+        between();
+        unsigned long long allocsBefore = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        work();
+        auto end = std::chrono::steady_clock::now();
+        if (tick < options.warmupTicks) continue;
+        result.allocations += g_allocations.load() - allocsBefore;
+        result.tickMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return result;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+static void report(const char* phase, size_t processes, const BenchOptions& options, PhaseResult& result) {
+    std::sort(result.tickMs.begin(), result.tickMs.end());
+    double allocsPerTick = result.tickMs.empty() ? 0.0 : (double)result.allocations / result.tickMs.size();
+    unsigned long long rss = peakRssKb();
+
+    printf("{\"phase\":\"%s\",\"processes\":%zu,\"threadsPerProcess\":%zu,\"focused\":%zu,\"ticks\":%zu,"
+        "\"p50Ms\":%.4f,\"p90Ms\":%.4f,\"p99Ms\":%.4f,\"maxMs\":%.4f,\"allocsPerTick\":%.1f,\"peakRssKb\":%llu}\n",
+        phase, processes, options.threadsPerProcess, options.focusedProcesses, result.tickMs.size(),
+        percentile(result.tickMs, 0.50), percentile(result.tickMs, 0.90), percentile(result.tickMs, 0.99),
+        result.tickMs.empty() ? 0.0 : result.tickMs.back(), allocsPerTick, rss);
+    fflush(stdout);
+    fprintf(stderr, "%-11s %7zu processos  p50 %9.3f ms  p99 %9.3f ms  %10.1f alocacoes/tick  pico RSS %llu KB\n",
+        phase, processes, percentile(result.tickMs, 0.50), percentile(result.tickMs, 0.99), allocsPerTick, rss);
+}
+
+static void benchSynthetic(size_t processes, const BenchOptions& options) {
+    SyntheticCollector* synthetic = new SyntheticCollector(processes, options.threadsPerProcess, options.focusedProcesses);
+    std::vector<unsigned long> focused = synthetic->focusedPids();
+    SystemMonitor monitor{ std::unique_ptr<Collector>(synthetic) };
+    monitor.setFocusedProcesses(focused);
+
+    PhaseResult result = measure(options, [] {}, [&] { monitor.collectNow(); });
+    report("monitor", processes, options, result);
+
+    // Um frame da interface logo apos uma lista nova, ordenada por CPU (a
+    // coluna que mais muda entre ticks): reordenacao incremental mais o texto
+    // das linhas visiveis.
+    ProcessTableView table;
+    table.setSort(SORT_CPU, true);
+    std::shared_ptr<const SystemInfo> snapshot;
+    result = measure(options, [&] { monitor.collectNow(); snapshot = monitor.getLatestSnapshot(); }, [&] {
+        table.update(*snapshot);
+        for (size_t row = 0; row < std::min<size_t>(table.size(), UI_VISIBLE_ROWS); ++row) {
+            table.text(*snapshot, row);
+        }
+        });
+    report("ui_table", processes, options, result);
+
+    ProcessQuery query;
+    query.sortKey = SORT_CPU;
+    query.limit = 20;
+    result = measure(options, [&] { monitor.collectNow(); }, [&] { monitor.queryProcesses(query); });
+    report("query", processes, options, result);
+    result = measure(options, [] {}, [&] { monitor.queryProcesses(query); });
+    report("query_hit", processes, options, result);
+
+    StreamEncoder fullEncoder;
+    std::vector<uint8_t> frame;
+    result = measure(options, [&] { monitor.collectNow(); snapshot = monitor.getLatestSnapshot(); frame.clear(); },
+        [&] { fullEncoder.encodeTick(*snapshot, frame); });
+    report("stream_full", processes, options, result);
+
+    // O primeiro frame compara a lista inteira; os seguintes partem do diff.
+    StreamEncoder diffEncoder;
+    diffEncoder.encodeTick(*monitor.getLatestSnapshot(), frame);
+    std::vector<std::shared_ptr<const SnapshotDiff>> diffs;
+    result = measure(options, [&] {
+        monitor.collectNow();
+        snapshot = monitor.getLatestSnapshot();
+        diffs.assign(1, snapshot->processDiff);
+        frame.clear();
+        }, [&] { diffEncoder.encodeTick(*snapshot, diffs, frame); });
+    report("stream_diff", processes, options, result);
+
+    MetricsCache metrics;
+    result = measure(options, [&] { monitor.collectNow(); snapshot = monitor.getLatestSnapshot(); },
+        [&] { metrics.body(*snapshot, METRICS_PROMETHEUS); });
+    report("metrics", processes, options, result);
+}
+
+#ifndef _WIN32
+static void benchFakeProc(size_t processes, const BenchOptions& options) {
+    std::string root = options.root + "/proc." + std::to_string(processes);
+    fprintf(stderr, "gerando %s (%zu processos)...\n", root.c_str(), processes);
+    FakeProcTree tree(root, processes, options.threadsPerProcess, options.focusedProcesses);
+    if (!tree.ok()) {
+        fprintf(stderr, "Falha ao criar %s\n", root.c_str());
+        return;
+    }
+    std::vector<unsigned long> focused = tree.focusedPids();
+
+    {
+        LinuxCollector collector(root, options.samplingThreads, tree.cgroupRoot());
+        RawSample sample;
+        PhaseResult result = measure(options, [&] { tree.advance(); }, [&] { collector.sample(sample, focused); });
+        report("collector", processes, options, result);
+    }
+
+    SystemMonitor monitor{ std::unique_ptr<Collector>(new LinuxCollector(root, options.samplingThreads, tree.cgroupRoot())) };
+    monitor.setFocusedProcesses(focused);
+    PhaseResult result = measure(options, [&] { tree.advance(); }, [&] { monitor.collectNow(); });
+    report("end_to_end", processes, options, result);
+}
+#endif
+
+static std::vector<size_t> parseSizes(const char* text) {
+    std::vector<size_t> sizes;
+    while (*text) {
+        char* end;
+        unsigned long long value = strtoull(text, &end, 10);
+        if (end == text) break;
+        sizes.push_back((size_t)value);
+        text = *end == ',' ? end + 1 : end;
+    }
+    return sizes;
+}
+
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+        "Uso: %s [--sizes 100,1000,10000,100000] [--threads N] [--focused N] [--ticks N]\n"
+        "          [--warmup N] [-j workers] [--root dir] [--mock]\n"
+        "  --threads N  threads por processo em foco (padrao: 8)\n"
+        "  --focused N  processos com as threads amostradas (padrao: 1)\n"
+        "  --root dir   onde gerar o /proc falso (padrao: $TMPDIR ou /tmp)\n"
+        "  --mock       so as fases com o collector sintetico\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            options.sizes = parseSizes(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threadsPerProcess = (size_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--focused") == 0 && i + 1 < argc) {
+            options.focusedProcesses = (size_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            options.ticks = std::max(1, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            options.warmupTicks = std::max(0, atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            options.samplingThreads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+            options.root = argv[++i];
+        }
+        else if (strcmp(argv[i], "--mock") == 0) {
+            options.mockOnly = true;
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+#ifndef _WIN32
+    if (options.root.empty()) {
+        const char* tmp = getenv("TMPDIR");
+        options.root = std::string(tmp != nullptr ? tmp : "/tmp") + "/collector_bench." + std::to_string(getpid());
+    }
+    if (!options.mockOnly && mkdir(options.root.c_str(), 0755) != 0) {
+        fprintf(stderr, "Falha ao criar %s\n", options.root.c_str());
+        return 1;
+    }
+#endif
+
+    for (size_t processes : options.sizes) {
+        benchSynthetic(processes, options);
+#ifndef _WIN32
+        if (!options.mockOnly) {
+            benchFakeProc(processes, options);
+        }
+#endif
+    }
+
+#ifndef _WIN32
+    if (!options.mockOnly) {
+        rmdir(options.root.c_str());
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,129 @@
+// Compara o cache de tempos de CPU antigo (std::map reconstruido e trocado a
+// cada tick) com o CpuTimeTable, simulando ticks com 1% de PIDs trocados.
+#include "cpu_time_table.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <vector>
+
+static std::atomic<unsigned long long> g_allocations{ 0 };
+
+void* operator new(size_t size) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+struct CpuTimes {
+    unsigned long long kernelTime;
+    unsigned long long userTime;
+};
+
+static const int WARMUP_TICKS = 5;
+static const int TICKS = 50;
+
+static void churn(std::vector<unsigned long>& keys, unsigned long& nextKey) {
+    for (size_t i = 0; i < keys.size(); i += 100) {
+        keys[i] = nextKey++;
+    }
+}
+
+static double benchMap(size_t entries, unsigned long long& allocsPerTick, double& checksum) {
+    std::vector<unsigned long> keys(entries);
+    for (size_t i = 0; i < entries; ++i) keys[i] = (unsigned long)(i * 4 + 4);
+    unsigned long nextKey = (unsigned long)(entries * 4 + 4);
+
+    std::map<unsigned long, CpuTimes> cache;
+    double elapsed = 0.0;
+    unsigned long long allocs = 0;
+
+    for (int tick = 0; tick < WARMUP_TICKS + TICKS; ++tick) {
+        churn(keys, nextKey);
+        unsigned long long allocsBefore = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+
+        std::map<unsigned long, CpuTimes> newCache;
+        for (unsigned long key : keys) {
+            unsigned long long kernel = key + tick * 3, user = key + tick * 5;
+            auto it = cache.find(key);
+            if (it != cache.end()) {
+                checksum += (double)((kernel - it->second.kernelTime) + (user - it->second.userTime));
+            }
+            newCache[key] = { kernel, user };
+        }
+        cache.swap(newCache);
+        newCache.clear();
+
+        auto end = std::chrono::steady_clock::now();
+        if (tick >= WARMUP_TICKS) {
+            elapsed += std::chrono::duration<double, std::micro>(end - start).count();
+            allocs += g_allocations.load() - allocsBefore;
+        }
+    }
+    allocsPerTick = allocs / TICKS;
+    return elapsed / TICKS;
+}
+
+static double benchTable(size_t entries, unsigned long long& allocsPerTick, double& checksum) {
+    std::vector<unsigned long> keys(entries);
+    for (size_t i = 0; i < entries; ++i) keys[i] = (unsigned long)(i * 4 + 4);
+    unsigned long nextKey = (unsigned long)(entries * 4 + 4);
+
+    CpuTimeTable cache;
+    double elapsed = 0.0;
+    unsigned long long allocs = 0;
+
+    for (int tick = 0; tick < WARMUP_TICKS + TICKS; ++tick) {
+        churn(keys, nextKey);
+        unsigned long long allocsBefore = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+
+        cache.nextGeneration();
+        for (unsigned long key : keys) {
+            unsigned long long kernel = key + tick * 3, user = key + tick * 5;
+            unsigned long long lastKernel, lastUser;
+            if (cache.update(key, 0, kernel, user, lastKernel, lastUser)) {
+                checksum += (double)((kernel - lastKernel) + (user - lastUser));
+            }
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        if (tick >= WARMUP_TICKS) {
+            elapsed += std::chrono::duration<double, std::micro>(end - start).count();
+            allocs += g_allocations.load() - allocsBefore;
+        }
+    }
+    allocsPerTick = allocs / TICKS;
+    return elapsed / TICKS;
+}
+
+int main() {
+    const size_t sizes[] = { 10000, 100000 };
+    printf("%-14s %10s %14s %14s\n", "impl", "entries", "us/tick", "allocs/tick");
+    for (size_t entries : sizes) {
+        double mapChecksum = 0.0, tableChecksum = 0.0;
+        unsigned long long mapAllocs = 0, tableAllocs = 0;
+        double mapUs = benchMap(entries, mapAllocs, mapChecksum);
+        double tableUs = benchTable(entries, tableAllocs, tableChecksum);
+        printf("%-14s %10zu %14.1f %14llu\n", "std::map", entries, mapUs, mapAllocs);
+        printf("%-14s %10zu %14.1f %14llu\n", "CpuTimeTable", entries, tableUs, tableAllocs);
+        if (mapChecksum != tableChecksum) {
+            fprintf(stderr, "checksum divergente: %f != %f\n", mapChecksum, tableChecksum);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "fake_proc.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char* const NAMES[] = {
+    "systemd", "bash", "python3", "postgres", "nginx", "java", "sshd", "kworker/0:1"
+};
+static const size_t NAME_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+
+// Threads de um processo em foco recebem TIDs fora da faixa dos PIDs.
+static const unsigned long TID_BASE = 100000000;
+static const unsigned long TIDS_PER_PROCESS = 1000;
+static const unsigned long FAKE_CGROUPS = 16;
+static const unsigned long FAKE_CORES = 8;
+
+static std::string cgroupPath(unsigned long pid) {
+    return "/fake.slice/ctr-" + std::to_string(pid % FAKE_CGROUPS) + ".scope";
+}
+
+static bool writeFile(const std::string& path, const char* data, size_t size) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+    bool ok = write(fd, data, size) == (ssize_t)size;
+    close(fd);
+    return ok;
+}
+
+static bool writeFile(const std::string& path, const std::string& data) {
+    return writeFile(path, data.data(), data.size());
+}
+
+static int removeEntry(const char* path, const struct stat*, int, struct FTW*) {
+    return remove(path);
+}
+
+FakeProcTree::FakeProcTree(const std::string& root, size_t processes, size_t threadsPerProcess, size_t focusedProcesses) :
+    m_root(root),
+    m_threadsPerProcess(std::max<size_t>(threadsPerProcess, 1)),
+    m_focused(std::min(focusedProcesses, processes))
+{
+    m_threadsPerProcess = std::min<size_t>(m_threadsPerProcess, TIDS_PER_PROCESS);
+    if (mkdir(m_root.c_str(), 0755) != 0) return;
+
+    m_processes.resize(processes);
+    for (size_t i = 0; i < processes; ++i) {
+        FakeProcess& proc = m_processes[i];
+        proc.pid = m_nextPid++;
+        proc.startTime = proc.pid;
+        proc.residentPages = 256 + (proc.pid * 7919) % 65536;
+        writeProcess(proc, i < m_focused);
+    }
+    mkdir((m_root + "/pressure").c_str(), 0755);
+    writeSystemFiles();
+    mkdir(cgroupRoot().c_str(), 0755);
+    mkdir((cgroupRoot() + "/fake.slice").c_str(), 0755);
+    for (unsigned long group = 0; group < FAKE_CGROUPS; ++group) {
+        mkdir((cgroupRoot() + cgroupPath(group)).c_str(), 0755);
+    }
+    writeFile(cgroupRoot() + "/cgroup.controllers", std::string("cpuset cpu io memory pids\n"));
+    writeCgroups();
+    m_ok = true;
+}
+
+FakeProcTree::~FakeProcTree() {
+    nftw(m_root.c_str(), removeEntry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+std::vector<unsigned long> FakeProcTree::focusedPids() const {
+    std::vector<unsigned long> pids;
+    for (size_t i = 0; i < m_focused; ++i) {
+        pids.push_back(m_processes[i].pid);
+    }
+    return pids;
+}
+
+std::string FakeProcTree::processDir(const FakeProcess& proc) const {
+    return m_root + "/" + std::to_string(proc.pid);
+}
+
+void FakeProcTree::writeProcess(const FakeProcess& proc, bool focused) {
+    std::string dir = processDir(proc);
+    mkdir(dir.c_str(), 0755);
+    writeProcessStat(proc);
+
+    char text[512];
+    int n = snprintf(text, sizeof(text), "%llu %llu 512 64 0 1024 0\n",
+        proc.residentPages * 4, proc.residentPages);
+    writeFile(dir + "/statm", text, (size_t)n);
+
+    const char* name = NAMES[proc.pid % NAME_COUNT];
+    n = snprintf(text, sizeof(text), "Name:\t%s\nUmask:\t0022\nState:\tS (sleeping)\nUid:\t%lu\t%lu\t%lu\t%lu\n"
+        "voluntary_ctxt_switches:\t%lu\nnonvoluntary_ctxt_switches:\t%lu\n",
+        name, proc.pid % 3 ? 1000ul : 0ul, proc.pid % 3 ? 1000ul : 0ul, proc.pid % 3 ? 1000ul : 0ul, proc.pid % 3 ? 1000ul : 0ul,
+        proc.pid * 10, proc.pid);
+    writeFile(dir + "/status", text, (size_t)n);
+
+    n = snprintf(text, sizeof(text), "rchar: %llu\nwchar: %llu\nsyscr: 100\nsyscw: 50\nread_bytes: %llu\n"
+        "write_bytes: %llu\ncancelled_write_bytes: 0\n",
+        proc.residentPages * 8192, proc.residentPages * 4096, proc.residentPages * 4096, proc.residentPages * 1024);
+    writeFile(dir + "/io", text, (size_t)n);
+
+    writeFile(dir + "/cgroup", "0::" + cgroupPath(proc.pid) + "\n");
+
+    n = snprintf(text, sizeof(text), "/usr/bin/%s%c--worker%c%lu%c", name, '\0', '\0', proc.pid, '\0');
+    writeFile(dir + "/cmdline", text, (size_t)n);
+    symlink((std::string("/usr/bin/") + name).c_str(), (dir + "/exe").c_str());
+
+    if (focused) {
+        mkdir((dir + "/task").c_str(), 0755);
+        for (size_t t = 0; t < m_threadsPerProcess; ++t) {
+            unsigned long tid = TID_BASE + proc.pid * TIDS_PER_PROCESS + (unsigned long)t;
+            mkdir((dir + "/task/" + std::to_string(tid)).c_str(), 0755);
+        }
+        writeThreadStats(proc);
+    }
+}
+
+void FakeProcTree::writeProcessStat(const FakeProcess& proc) {
+    // Campos 4 a 22 do proc(5); o resto do stat real nao e lido.
+    char text[512];
+    int n = snprintf(text, sizeof(text),
+        "%lu (%s) S 1 %lu %lu 0 -1 4194304 100 0 0 0 %llu %llu 0 0 20 0 %zu 0 %llu %llu %llu\n",
+        proc.pid, NAMES[proc.pid % NAME_COUNT], proc.pid, proc.pid,
+        proc.userTime, proc.kernelTime, m_threadsPerProcess, proc.startTime,
+        proc.residentPages * 16384, proc.residentPages);
+    writeFile(processDir(proc) + "/stat", text, (size_t)n);
+}
+
+void FakeProcTree::writeThreadStats(const FakeProcess& proc) {
+    std::string task = processDir(proc) + "/task/";
+    char text[512];
+    for (size_t t = 0; t < m_threadsPerProcess; ++t) {
+        unsigned long tid = TID_BASE + proc.pid * TIDS_PER_PROCESS + (unsigned long)t;
+        int n = snprintf(text, sizeof(text),
+            "%lu (%s) S 1 %lu %lu 0 -1 4194304 0 0 0 0 %llu %llu 0 0 20 0 %zu 0 %llu 0 0\n",
+            tid, NAMES[proc.pid % NAME_COUNT], proc.pid, proc.pid,
+            (proc.userTime + t) / m_threadsPerProcess, proc.kernelTime / m_threadsPerProcess,
+            m_threadsPerProcess, proc.startTime);
+        writeFile(task + std::to_string(tid) + "/stat", text, (size_t)n);
+    }
+}
+
+void FakeProcTree::writeSystemFiles() {
+    // O total dividido em FAKE_CORES nucleos, cada um com uma carga diferente,
+    // e a pressao dos tres recursos (/proc/pressure).
+    std::string stat;
+    char text[512];
+    unsigned long long idle = m_cpuTotal / 2;
+    int n = snprintf(text, sizeof(text), "cpu  %llu 0 %llu %llu %llu %llu %llu %llu 0 0\n",
+        m_cpuTotal / 3, m_cpuTotal - idle - m_cpuTotal / 3 - m_cpuTotal / 20, idle, m_cpuTotal / 40,
+        m_cpuTotal / 80, m_cpuTotal / 80, m_cpuTotal / 40);
+    stat.append(text, (size_t)n);
+    unsigned long long share = m_cpuTotal / FAKE_CORES;
+    for (unsigned long core = 0; core < FAKE_CORES; ++core) {
+        unsigned long long coreIdle = share * core / FAKE_CORES;
+        unsigned long long coreUser = (share - coreIdle) / 2;
+        n = snprintf(text, sizeof(text), "cpu%lu %llu 0 %llu %llu 0 0 0 0 0 0\n",
+            core, coreUser, share - coreIdle - coreUser, coreIdle);
+        stat.append(text, (size_t)n);
+    }
+    writeFile(m_root + "/stat", stat);
+
+    static const char* const resources[] = { "cpu", "memory", "io" };
+    for (const char* resource : resources) {
+        n = snprintf(text, sizeof(text), "some avg10=1.50 avg60=0.75 avg300=0.25 total=%llu\n"
+            "full avg10=0.50 avg60=0.25 avg300=0.10 total=%llu\n", m_tick * 15000, m_tick * 5000);
+        writeFile(m_root + "/pressure/" + resource, text, (size_t)n);
+    }
+
+    static const char meminfo[] =
+        "MemTotal:       16384000 kB\n"
+        "MemFree:         2048000 kB\n"
+        "MemAvailable:    8192000 kB\n";
+    writeFile(m_root + "/meminfo", meminfo, sizeof(meminfo) - 1);
+}
+
+// Cada grupo gasta CPU e faz I/O proporcionais ao indice; a raiz e
+// fake.slice somam os filhos, como no kernel. A raiz nao tem memory.current.
+void FakeProcTree::writeCgroups() {
+    char text[256];
+    unsigned long long totalUsage = 0, totalRead = 0, totalWrite = 0;
+    for (unsigned long group = 0; group < FAKE_CGROUPS; ++group) {
+        unsigned long long usage = m_tick * (group + 1) * 10000, read = m_tick * group * 4096, write = m_tick * 8192;
+        totalUsage += usage;
+        totalRead += read;
+        totalWrite += write;
+        std::string dir = cgroupRoot() + cgroupPath(group);
+        int n = snprintf(text, sizeof(text), "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\n"
+            "nr_periods 0\nnr_throttled 0\nthrottled_usec %llu\n", usage, usage / 4 * 3, usage / 4, m_tick * group * 100);
+        writeFile(dir + "/cpu.stat", text, (size_t)n);
+        n = snprintf(text, sizeof(text), "%llu\n", (group + 1) * (64ull << 20));
+        writeFile(dir + "/memory.current", text, (size_t)n);
+        writeFile(dir + "/memory.max", group % 2 ? std::string("max\n") : std::to_string((group + 2) * (64ull << 20)) + "\n");
+        n = snprintf(text, sizeof(text), "8:0 rbytes=%llu wbytes=%llu rios=1 wios=1 dbytes=0 dios=0\n", read, write);
+        writeFile(dir + "/io.stat", text, (size_t)n);
+    }
+
+    const char* const dirs[] = { "/fake.slice", "" };
+    for (const char* dir : dirs) {
+        int n = snprintf(text, sizeof(text), "usage_usec %llu\nuser_usec %llu\nsystem_usec %llu\n",
+            totalUsage, totalUsage / 4 * 3, totalUsage / 4);
+        writeFile(cgroupRoot() + dir + "/cpu.stat", text, (size_t)n);
+        n = snprintf(text, sizeof(text), "8:0 rbytes=%llu wbytes=%llu rios=1 wios=1 dbytes=0 dios=0\n", totalRead, totalWrite);
+        writeFile(cgroupRoot() + dir + "/io.stat", text, (size_t)n);
+    }
+    writeFile(cgroupRoot() + "/fake.slice/memory.current", std::to_string(FAKE_CGROUPS * (64ull << 20)) + "\n");
+}
+
+void FakeProcTree::advance() {
+    m_tick++;
+    m_cpuTotal += 400;
+    writeSystemFiles();
+    writeCgroups();
+    if (m_processes.empty()) return;
+
+    size_t busy = std::max<size_t>(m_processes.size() / 100, 1);
+    for (size_t i = 0; i < busy; ++i) {
+        FakeProcess& proc = m_processes[m_busyCursor++ % m_processes.size()];
+        proc.userTime += 3;
+        proc.kernelTime += 1;
+        writeProcessStat(proc);
+    }
+    for (size_t i = 0; i < m_focused; ++i) {
+        FakeProcess& proc = m_processes[i];
+        proc.userTime += 2;
+        writeProcessStat(proc);
+        writeThreadStats(proc);
+    }
+
+    // Os processos em foco nunca saem.
+    if (m_processes.size() <= m_focused) return;
+    size_t churn = std::max<size_t>(m_processes.size() / 1000, 1);
+    size_t candidates = m_processes.size() - m_focused;
+    for (size_t i = 0; i < churn; ++i) {
+        FakeProcess& proc = m_processes[m_focused + m_churnCursor++ % candidates];
+        std::string dir = processDir(proc);
+        nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+
+        proc = FakeProcess();
+        proc.pid = m_nextPid++;
+        proc.startTime = proc.pid + m_tick * 100;
+        proc.residentPages = 256 + (proc.pid * 7919) % 65536;
+        writeProcess(proc, false);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef FAKE_PROC_H
+#define FAKE_PROC_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Gera em disco uma arvore com o layout de /proc que o LinuxCollector le
+// (stat com os nucleos, meminfo, pressure e, por processo, stat, statm,
+// status, io, cgroup, cmdline, exe). So os processos em foco ganham
+// task/<tid>/stat; os demais apenas informam a contagem de threads no stat,
+// como o kernel faz.
+class FakeProcTree {
+public:
+    FakeProcTree(const std::string& root, size_t processes, size_t threadsPerProcess, size_t focusedProcesses);
+    // Apaga a arvore.
+    ~FakeProcTree();
+
+    FakeProcTree(const FakeProcTree&) = delete;
+    FakeProcTree& operator=(const FakeProcTree&) = delete;
+
+    bool ok() const { return m_ok; }
+    const std::string& root() const { return m_root; }
+    // cgroupfs v2 falso (dentro da arvore, ignorado por quem le o /proc):
+    // cada processo fica num de alguns grupos /fake.slice/ctr-N.scope.
+    std::string cgroupRoot() const { return m_root + "/cgroup"; }
+    std::vector<unsigned long> focusedPids() const;
+
+    // Um tick simulado: 1% dos processos gasta CPU e 0,1% sai e da lugar a
+    // um PID novo. Os arquivos sao reescritos no lugar, como no /proc real.
+    void advance();
+
+private:
+    struct FakeProcess {
+        unsigned long pid = 0;
+        unsigned long long userTime = 0;
+        unsigned long long kernelTime = 0;
+        unsigned long long startTime = 0;
+        unsigned long long residentPages = 0;
+    };
+
+    std::string processDir(const FakeProcess& proc) const;
+    void writeProcess(const FakeProcess& proc, bool focused);
+    void writeProcessStat(const FakeProcess& proc);
+    void writeThreadStats(const FakeProcess& proc);
+    void writeSystemFiles();
+    void writeCgroups();
+
+    std::string m_root;
+    size_t m_threadsPerProcess;
+    size_t m_focused;
+    std::vector<FakeProcess> m_processes;
+    unsigned long m_nextPid = 100;
+    unsigned long long m_tick = 0;
+    unsigned long long m_cpuTotal = 0;
+    size_t m_busyCursor = 0;
+    size_t m_churnCursor = 0;
+    bool m_ok = false;
+};
+
+#endif
@@ -0,0 +1,117 @@
+// Gerador de carga de processos de vida curta, para ver o registro de saidas
+// e a lista por eventos (MeuMonitorHeadless -e -x) contra a varredura.
+// Cada filho toca alguns MB, gasta alguns ms de CPU e sai com um codigo que
+// varia; com --exec ele vira /bin/true logo depois do fork.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct LoadOptions {
+    unsigned rate = 200;
+    double seconds = 10.0;
+    unsigned megabytes = 4;
+    unsigned busyMs = 2;
+    bool exec = false;
+};
+
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+        "Uso: %s [--rate n] [--seconds s] [--mb n] [--busy ms] [--exec]\n"
+        "  --rate n     processos criados por segundo (padrao: 200)\n"
+        "  --seconds s  duracao (padrao: 10)\n"
+        "  --mb n       memoria tocada por filho, em MB (padrao: 4)\n"
+        "  --busy ms    CPU gasta por filho (padrao: 2)\n"
+        "  --exec       o filho executa /bin/true em vez de trabalhar\n",
+        argv0);
+}
+
+static int runChild(const LoadOptions& options, unsigned long long sequence) {
+    if (options.exec) {
+        execl("/bin/true", "true", (char*)nullptr);
+        _exit(127);
+    }
+
+    size_t bytes = (size_t)options.megabytes * 1024 * 1024;
+    std::vector<char> memory(bytes);
+    for (size_t i = 0; i < bytes; i += 4096) {
+        memory[i] = (char)i;
+    }
+
+    std::chrono::steady_clock::time_point end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(options.busyMs);
+    volatile unsigned long long spin = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        spin = spin + 1;
+    }
+    return (int)(sequence % 4);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            options.rate = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            options.seconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--mb") == 0 && i + 1 < argc) {
+            options.megabytes = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--busy") == 0 && i + 1 < argc) {
+            options.busyMs = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--exec") == 0) {
+            options.exec = true;
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.rate == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point end =
+        start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.seconds));
+    std::chrono::nanoseconds interval(1000000000ULL / options.rate);
+    std::chrono::steady_clock::time_point next = start;
+    unsigned long long forked = 0, failed = 0, reaped = 0;
+
+    while (std::chrono::steady_clock::now() < end) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(runChild(options, forked));
+        }
+        if (pid < 0) {
+            failed++;
+        }
+        else {
+            forked++;
+        }
+
+        // Recolhe quem ja terminou sem bloquear; os zumbis nao se acumulam.
+        while (waitpid(-1, nullptr, WNOHANG) > 0) {
+            reaped++;
+        }
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    while (waitpid(-1, nullptr, 0) > 0) {
+        reaped++;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(stderr, "%llu processos criados (%.0f/s), %llu recolhidos, %llu forks falharam\n",
+        forked, elapsed > 0.0 ? forked / elapsed : 0.0, reaped, failed);
+    return 0;
+}
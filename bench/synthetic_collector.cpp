@@ -0,0 +1,129 @@
+#include "synthetic_collector.h"
+
+#include <algorithm>
+
+static const char* const NAMES[] = {
+    "systemd", "bash", "python3", "postgres", "nginx", "java", "sshd", "kworker/0:1"
+};
+static const size_t NAME_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+// Processos distribuidos em tantos cgroups (containers) sob bench.slice.
+static const unsigned long CGROUP_COUNT = 64;
+
+SyntheticCollector::SyntheticCollector(size_t processes, size_t threadsPerProcess, size_t focusedProcesses) {
+    m_processes.resize(processes);
+    for (RawProcessSample& proc : m_processes) {
+        proc.pid = m_nextPid++;
+        proc.startTime = proc.pid;
+        proc.metadata = makeMetadata(proc.pid);
+        proc.accessible = true;
+        proc.timesValid = true;
+        proc.memoryUsedBytes = (256 + (proc.pid * 7919) % 65536) * 4096ull;
+        proc.threadCount = 1 + proc.pid % 8;
+    }
+
+    m_focused.resize(std::min(focusedProcesses, processes));
+    for (size_t i = 0; i < m_focused.size(); ++i) {
+        m_focused[i].pid = m_processes[i].pid;
+        m_focused[i].threads.resize(std::max<size_t>(threadsPerProcess, 1));
+        for (size_t t = 0; t < m_focused[i].threads.size(); ++t) {
+            RawThreadSample& thread = m_focused[i].threads[t];
+            thread.tid = 100000000ul + m_focused[i].pid * 1000ul + (unsigned long)t;
+            thread.timesValid = true;
+        }
+    }
+}
+
+ProcessMetadataRef SyntheticCollector::makeMetadata(unsigned long pid) {
+    std::shared_ptr<ProcessMetadata> metadata = std::make_shared<ProcessMetadata>();
+    const char* name = NAMES[pid % NAME_COUNT];
+    metadata->name = m_names.intern(name);
+    metadata->executablePath = std::string("/usr/bin/") + name;
+    metadata->commandLine = metadata->executablePath + " --worker " + std::to_string(pid);
+    metadata->user = m_names.intern(pid % 3 ? "user" : "root");
+    metadata->parentPid = 1;
+    metadata->cgroup = m_names.intern("/bench.slice/ctr-" + std::to_string(pid % CGROUP_COUNT) + ".scope");
+    return metadata;
+}
+
+std::vector<unsigned long> SyntheticCollector::focusedPids() const {
+    std::vector<unsigned long> pids;
+    for (const RawFocusedProcess& focused : m_focused) {
+        pids.push_back(focused.pid);
+    }
+    return pids;
+}
+
+void SyntheticCollector::advance() {
+    m_tick++;
+    m_cpuTotal += 400;
+    if (m_processes.empty()) return;
+
+    size_t busy = std::max<size_t>(m_processes.size() / 100, 1);
+    for (size_t i = 0; i < busy; ++i) {
+        RawProcessSample& proc = m_processes[m_busyCursor++ % m_processes.size()];
+        proc.userTime += 3;
+        proc.kernelTime += 1;
+    }
+    for (RawFocusedProcess& focused : m_focused) {
+        for (RawThreadSample& thread : focused.threads) {
+            thread.userTime += 1;
+        }
+    }
+
+    if (m_processes.size() <= m_focused.size()) return;
+    size_t churn = std::max<size_t>(m_processes.size() / 1000, 1);
+    size_t candidates = m_processes.size() - m_focused.size();
+    for (size_t i = 0; i < churn; ++i) {
+        RawProcessSample& proc = m_processes[m_focused.size() + m_churnCursor++ % candidates];
+        proc.pid = m_nextPid++;
+        proc.startTime = proc.pid + m_tick * 100;
+        proc.userTime = 0;
+        proc.kernelTime = 0;
+        proc.metadata = makeMetadata(proc.pid);
+    }
+}
+
+bool SyntheticCollector::readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) {
+    totalTime = m_cpuTotal;
+    idleTime = m_cpuTotal / 2;
+    return true;
+}
+
+void SyntheticCollector::sampleSystem(RawSample& out) {
+    advance();
+    out.memoryValid = true;
+    out.ramTotalBytes = 16ull << 30;
+    out.ramUsedBytes = 8ull << 30;
+    out.ramUsagePercentage = 50.0;
+    out.cpuValid = readCpuTimes(out.cpuTotalTime, out.cpuIdleTime);
+}
+
+void SyntheticCollector::sampleProcesses(RawSample& out) {
+    out.processes = m_processes;
+    out.stats = CollectorStats();
+    out.shards.clear();
+}
+
+void SyntheticCollector::sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) {
+    size_t count = 0;
+    for (const RawFocusedProcess& focused : m_focused) {
+        if (std::find(pids.begin(), pids.end(), focused.pid) == pids.end()) continue;
+        if (count == out.focused.size()) {
+            out.focused.emplace_back();
+        }
+        out.focused[count++] = focused;
+    }
+    out.focused.resize(count);
+}
+
+ExtraProcessInfo SyntheticCollector::readExtraProcessInfo(unsigned long) {
+    return ExtraProcessInfo();
+}
+
+SignalResult SyntheticCollector::signalProcess(unsigned long, unsigned long long, ProcessSignal) {
+    return SIGNAL_UNSUPPORTED;
+}
+
+unsigned long long SyntheticCollector::readStartTime(unsigned long) {
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef SYNTHETIC_COLLECTOR_H
+#define SYNTHETIC_COLLECTOR_H
+
+#include "collector.h"
+
+#include <vector>
+
+// Collector em memoria para medir o SystemMonitor sem depender do sistema:
+// a cada tick 1% dos processos gasta CPU e 0,1% e trocado por um PID novo
+// (com metadados novos, como num cache real). Os primeiros focusedProcesses
+// processos tem threadsPerProcess threads.
+class SyntheticCollector : public Collector {
+public:
+    SyntheticCollector(size_t processes, size_t threadsPerProcess, size_t focusedProcesses);
+
+    std::vector<unsigned long> focusedPids() const;
+
+    bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) override;
+    void sampleSystem(RawSample& out) override;
+    void sampleProcesses(RawSample& out) override;
+    void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) override;
+    ExtraProcessInfo readExtraProcessInfo(unsigned long pid) override;
+    SignalResult signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) override;
+    unsigned long long readStartTime(unsigned long pid) override;
+
+private:
+    void advance();
+    ProcessMetadataRef makeMetadata(unsigned long pid);
+
+    std::vector<RawProcessSample> m_processes;
+    std::vector<RawFocusedProcess> m_focused;
+    NameInterner m_names;
+    unsigned long m_nextPid = 100;
+    unsigned long long m_cpuTotal = 0;
+    unsigned long long m_tick = 0;
+    size_t m_busyCursor = 0;
+    size_t m_churnCursor = 0;
+};
+
+#endif
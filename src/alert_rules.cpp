@@ -0,0 +1,864 @@
+#include "alert_rules.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "util.h"
+
+// PID das regras de sistema nas chaves de estado e nos prazos.
+static const unsigned long SYSTEM_SUBJECT = 0xFFFFFFFFul;
+// Fatias por janela de taxa.
+static const double SERIES_SLOTS = 16.0;
+static const uint8_t ALL_FIELDS = 0xFF;
+
+struct MetricName {
+    const char* name;
+    AlertMetric metric;
+};
+
+static const MetricName METRIC_NAMES[] = {
+    { "cpu", METRIC_CPU },
+    { "core", METRIC_CORE },
+    { "mem", METRIC_MEMORY },
+    { "threads", METRIC_THREADS },
+    { "read", METRIC_IO_READ },
+    { "write", METRIC_IO_WRITE },
+    { "faults", METRIC_FAULTS },
+    { "switches", METRIC_SWITCHES },
+    { "cpu", METRIC_SYSTEM_CPU },
+    { "iowait", METRIC_SYSTEM_IOWAIT },
+    { "steal", METRIC_SYSTEM_STEAL },
+    { "ram", METRIC_SYSTEM_RAM },
+    { "ramused", METRIC_SYSTEM_RAM_BYTES },
+    { "psi.cpu", METRIC_PSI_CPU },
+    { "psi.memory", METRIC_PSI_MEMORY },
+    { "psi.io", METRIC_PSI_IO }
+};
+
+const char* alertMetricName(AlertMetric metric) {
+    for (const MetricName& entry : METRIC_NAMES) {
+        if (entry.metric == metric) return entry.name;
+    }
+    return "?";
+}
+
+bool alertMetricIsBytes(AlertMetric metric) {
+    return metric == METRIC_MEMORY || metric == METRIC_IO_READ || metric == METRIC_IO_WRITE ||
+        metric == METRIC_SYSTEM_RAM_BYTES;
+}
+
+// Campo do diff que muda quando a metrica muda; 0 para as do sistema.
+static uint8_t metricField(AlertMetric metric) {
+    switch (metric) {
+    case METRIC_CPU:
+    case METRIC_CORE:
+        return CHANGE_CPU;
+    case METRIC_MEMORY:
+        return CHANGE_MEMORY;
+    case METRIC_THREADS:
+        return CHANGE_THREADS;
+    case METRIC_IO_READ:
+    case METRIC_IO_WRITE:
+    case METRIC_FAULTS:
+    case METRIC_SWITCHES:
+        return CHANGE_RATES;
+    default:
+        return 0;
+    }
+}
+
+static double processMetric(const ProcessInfo& p, AlertMetric metric) {
+    switch (metric) {
+    case METRIC_CPU: return p.cpuUsagePercentage;
+    case METRIC_CORE: return p.cpuCorePercentage;
+    case METRIC_MEMORY: return (double)p.memoryUsedBytes;
+    case METRIC_THREADS: return (double)p.threadCount;
+    case METRIC_IO_READ: return p.rate(COUNTER_IO_READ_BYTES);
+    case METRIC_IO_WRITE: return p.rate(COUNTER_IO_WRITE_BYTES);
+    case METRIC_FAULTS: return p.faultRate();
+    case METRIC_SWITCHES: return p.switchRate();
+    default: return 0.0;
+    }
+}
+
+// Pressao indisponivel vale -1, abaixo de qualquer limiar.
+static double systemMetric(const SystemInfo& info, AlertMetric metric) {
+    switch (metric) {
+    case METRIC_SYSTEM_CPU: return info.cpuLoadPercentage;
+    case METRIC_SYSTEM_IOWAIT: return info.cpuStatePercentages[CPU_STATE_IOWAIT];
+    case METRIC_SYSTEM_STEAL: return info.cpuStatePercentages[CPU_STATE_STEAL];
+    case METRIC_SYSTEM_RAM: return info.ramUsagePercentage;
+    case METRIC_SYSTEM_RAM_BYTES: return (double)info.ramUsedBytes;
+    case METRIC_PSI_CPU:
+        return info.pressure[PRESSURE_CPU].valid ? info.pressure[PRESSURE_CPU].some.avg10 : -1.0;
+    case METRIC_PSI_MEMORY:
+        return info.pressure[PRESSURE_MEMORY].valid ? info.pressure[PRESSURE_MEMORY].some.avg10 : -1.0;
+    case METRIC_PSI_IO:
+        return info.pressure[PRESSURE_IO].valid ? info.pressure[PRESSURE_IO].some.avg10 : -1.0;
+    default: return 0.0;
+    }
+}
+
+static bool compare(double value, const AlertCondition& condition) {
+    switch (condition.comparison) {
+    case COMPARE_GREATER: return value > condition.threshold;
+    case COMPARE_GREATER_EQUAL: return value >= condition.threshold;
+    case COMPARE_LESS: return value < condition.threshold;
+    case COMPARE_LESS_EQUAL: return value <= condition.threshold;
+    }
+    return false;
+}
+
+// Palavras, numeros com sufixo e name=valor; ( ) , e os operadores sao
+// tokens separados mesmo sem espacos.
+static void tokenize(const std::string& text, std::vector<std::string>& tokens) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (isspace((unsigned char)c)) {
+            ++i;
+        }
+        else if (c == '(' || c == ')' || c == ',') {
+            tokens.emplace_back(1, c);
+            ++i;
+        }
+        else if (c == '<' || c == '>') {
+            size_t length = i + 1 < text.size() && text[i + 1] == '=' ? 2 : 1;
+            tokens.push_back(text.substr(i, length));
+            i += length;
+        }
+        else {
+            size_t start = i;
+            while (i < text.size() && !isspace((unsigned char)text[i]) && strchr("(),<>", text[i]) == nullptr) {
+                ++i;
+            }
+            tokens.push_back(text.substr(start, i - start));
+        }
+    }
+}
+
+// Numero com sufixo K, M ou G (potencias de 1024) ou %, ignorado.
+static bool parseValue(const std::string& text, double& value) {
+    return parseScaledNumber(text, value, '%');
+}
+
+static bool parseDuration(const std::string& text, std::chrono::milliseconds& duration) {
+    char* end;
+    double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0.0) return false;
+    double scale;
+    if (*end == '\0' || strcmp(end, "s") == 0) scale = 1000.0;
+    else if (strcmp(end, "ms") == 0) scale = 1.0;
+    else if (strcmp(end, "m") == 0) scale = 60000.0;
+    else if (strcmp(end, "h") == 0) scale = 3600000.0;
+    else return false;
+    duration = std::chrono::milliseconds((long long)(value * scale));
+    return true;
+}
+
+static bool parseMetric(const std::string& text, AlertScope scope, AlertMetric& metric) {
+    for (const MetricName& entry : METRIC_NAMES) {
+        bool processMetric = entry.metric < PROCESS_METRIC_COUNT;
+        if (processMetric != (scope == ALERT_PROCESS) || text != entry.name) continue;
+        metric = entry.metric;
+        return true;
+    }
+    return false;
+}
+
+namespace {
+
+struct TokenCursor {
+    const std::vector<std::string>& tokens;
+    size_t pos;
+
+    bool atEnd() const { return pos >= tokens.size(); }
+    const std::string& next() {
+        static const std::string end;
+        return pos < tokens.size() ? tokens[pos++] : end;
+    }
+    bool accept(const char* token) {
+        if (atEnd() || tokens[pos] != token) return false;
+        ++pos;
+        return true;
+    }
+};
+
+}
+
+static bool parseCondition(TokenCursor& cursor, AlertScope scope, AlertCondition& condition, std::string& error) {
+    std::string word = cursor.next();
+    if (word == "top") {
+        if (scope != ALERT_PROCESS) {
+            error = "top so vale para process";
+            return false;
+        }
+        std::string count = cursor.next();
+        condition.kind = CONDITION_TOP;
+        condition.topN = strtoul(count.c_str(), nullptr, 10);
+        if (condition.topN == 0) {
+            error = "top precisa de um N maior que zero: " + count;
+            return false;
+        }
+        word = cursor.next();
+        if (!parseMetric(word, scope, condition.metric)) {
+            error = "metrica desconhecida: " + word;
+            return false;
+        }
+        return true;
+    }
+
+    if (word == "rate") {
+        condition.kind = CONDITION_RATE;
+        if (!cursor.accept("(")) {
+            error = "esperava ( depois de rate";
+            return false;
+        }
+        word = cursor.next();
+        if (!parseMetric(word, scope, condition.metric)) {
+            error = "metrica desconhecida: " + word;
+            return false;
+        }
+        if (cursor.accept(",")) {
+            word = cursor.next();
+            if (!parseDuration(word, condition.window) || condition.window.count() == 0) {
+                error = "janela invalida: " + word;
+                return false;
+            }
+        }
+        if (!cursor.accept(")")) {
+            error = "esperava ) no fim de rate";
+            return false;
+        }
+    }
+    else if (!parseMetric(word, scope, condition.metric)) {
+        error = "metrica desconhecida: " + (word.empty() ? std::string("(fim da linha)") : word);
+        return false;
+    }
+
+    word = cursor.next();
+    if (word == ">") condition.comparison = COMPARE_GREATER;
+    else if (word == ">=") condition.comparison = COMPARE_GREATER_EQUAL;
+    else if (word == "<") condition.comparison = COMPARE_LESS;
+    else if (word == "<=") condition.comparison = COMPARE_LESS_EQUAL;
+    else {
+        error = "esperava > >= < ou <=: " + word;
+        return false;
+    }
+    word = cursor.next();
+    if (!parseValue(word, condition.threshold)) {
+        error = "valor invalido: " + word;
+        return false;
+    }
+    return true;
+}
+
+static bool parseRule(const std::string& line, AlertRule& rule, std::string& error) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) {
+        error = "falta o ':' depois do nome";
+        return false;
+    }
+    size_t first = line.find_first_not_of(" \t");
+    size_t last = line.find_last_not_of(" \t", colon - 1);
+    if (first >= colon || last == std::string::npos || last < first) {
+        error = "regra sem nome";
+        return false;
+    }
+    rule.name = InternedName(line.substr(first, last - first + 1));
+
+    std::vector<std::string> tokens;
+    tokenize(line.substr(colon + 1), tokens);
+    TokenCursor cursor{ tokens, 0 };
+    if (cursor.accept("process")) {
+        rule.scope = ALERT_PROCESS;
+    }
+    else if (cursor.accept("system")) {
+        rule.scope = ALERT_SYSTEM;
+    }
+    else {
+        error = "esperava process ou system";
+        return false;
+    }
+
+    while (rule.scope == ALERT_PROCESS && !cursor.atEnd()) {
+        const std::string& token = tokens[cursor.pos];
+        if (token.compare(0, 5, "name=") == 0) {
+            rule.nameContains = token.substr(5);
+        }
+        else if (token.compare(0, 5, "user=") == 0) {
+            rule.user = token.substr(5);
+        }
+        else {
+            break;
+        }
+        ++cursor.pos;
+    }
+
+    do {
+        AlertCondition condition;
+        if (!parseCondition(cursor, rule.scope, condition, error)) return false;
+        rule.conditions.push_back(condition);
+    } while (cursor.accept("and"));
+
+    if (cursor.accept("for")) {
+        std::string word = cursor.next();
+        if (!parseDuration(word, rule.sustain)) {
+            error = "duracao invalida: " + word;
+            return false;
+        }
+    }
+    if (!cursor.atEnd()) {
+        error = "sobrou: " + tokens[cursor.pos];
+        return false;
+    }
+    return true;
+}
+
+static void appendOnce(std::vector<uint32_t>& list, uint32_t value) {
+    if (list.empty() || list.back() != value) list.push_back(value);
+}
+
+// Liga a regra as series, rankings e campos de que depende.
+static void addRule(AlertRule&& rule, AlertPlan& plan) {
+    uint32_t index = (uint32_t)plan.rules.size();
+    for (AlertCondition& condition : rule.conditions) {
+        if (condition.kind == CONDITION_RATE) {
+            size_t slot = 0;
+            while (slot < plan.series.size() &&
+                (plan.series[slot].metric != condition.metric || plan.series[slot].window != condition.window)) {
+                ++slot;
+            }
+            if (slot == plan.series.size()) {
+                plan.series.push_back({ condition.metric, condition.window });
+                plan.rulesBySeries.emplace_back();
+            }
+            condition.slot = (uint32_t)slot;
+            appendOnce(plan.rulesBySeries[slot], index);
+        }
+        else if (condition.kind == CONDITION_TOP) {
+            size_t slot = 0;
+            while (slot < plan.rankings.size() && plan.rankings[slot].metric != condition.metric) {
+                ++slot;
+            }
+            if (slot == plan.rankings.size()) {
+                plan.rankings.push_back({ condition.metric, 0 });
+                plan.rulesByRanking.emplace_back();
+            }
+            plan.rankings[slot].maxN = std::max(plan.rankings[slot].maxN, condition.topN);
+            condition.slot = (uint32_t)slot;
+            appendOnce(plan.rulesByRanking[slot], index);
+            // A posicao no ranking chega por updateRankings, nao pelo campo.
+            continue;
+        }
+        rule.fields |= metricField(condition.metric);
+    }
+    if (!rule.nameContains.empty() || !rule.user.empty()) {
+        rule.fields |= CHANGE_NAME;
+    }
+
+    if (rule.scope == ALERT_SYSTEM) {
+        plan.systemRules.push_back(index);
+    }
+    else {
+        plan.processRules.push_back(index);
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            if (rule.fields & (1u << bit)) plan.rulesByField[bit].push_back(index);
+        }
+    }
+    plan.rules.push_back(std::move(rule));
+}
+
+bool compileAlertRules(const std::string& text, AlertPlan& plan, std::string& error) {
+    plan = AlertPlan();
+    size_t pos = 0;
+    unsigned lineNumber = 0;
+    while (pos < text.size()) {
+        size_t newline = text.find('\n', pos);
+        std::string line = text.substr(pos, newline == std::string::npos ? std::string::npos : newline - pos);
+        pos = newline == std::string::npos ? text.size() : newline + 1;
+        ++lineNumber;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        AlertRule rule;
+        std::string reason;
+        if (!parseRule(line, rule, reason)) {
+            error = "linha " + std::to_string(lineNumber) + ": " + reason;
+            return false;
+        }
+        addRule(std::move(rule), plan);
+    }
+
+    for (uint32_t slot = 0; slot < (uint32_t)plan.series.size(); ++slot) {
+        uint8_t field = metricField(plan.series[slot].metric);
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            if (field & (1u << bit)) plan.seriesByField[bit].push_back(slot);
+        }
+    }
+    return true;
+}
+
+bool loadAlertRules(const std::string& path, AlertPlan& plan, std::string& error) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = "nao foi possivel abrir " + path;
+        return false;
+    }
+    std::string text;
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, read);
+    }
+    fclose(file);
+    return compileAlertRules(text, plan, error);
+}
+
+bool AlertEngine::Series::add(double time, double value, double window) {
+    // Fatias que ja sairam da janela, menos a ultima delas: o valor no inicio
+    // da janela.
+    size_t expired = 0;
+    while (expired + 1 < samples.size() && samples[expired + 1].time <= time - window) {
+        ++expired;
+    }
+    samples.erase(samples.begin(), samples.begin() + expired);
+    // A primeira amostra fica como base ate sair da janela.
+    if (samples.size() >= 2 && time - samples.back().time < window / SERIES_SLOTS) {
+        samples.back().value = value;
+        return false;
+    }
+    samples.push_back({ time, value });
+    return samples.size() >= 2;
+}
+
+double AlertEngine::Series::rate(double now, double window) const {
+    if (samples.empty()) return 0.0;
+    const Sample* base = &samples.front();
+    for (const Sample& sample : samples) {
+        if (sample.time > now - window) break;
+        base = &sample;
+    }
+    return (samples.back().value - base->value) / window;
+}
+
+AlertEngine::AlertEngine() :
+    m_epoch(std::chrono::steady_clock::now())
+{
+}
+
+AlertEngine::~AlertEngine() {
+    if (m_log != nullptr) fclose(m_log);
+}
+
+void AlertEngine::setPlan(std::shared_ptr<const AlertPlan> plan) {
+    std::lock_guard<std::mutex> lock(m_planMutex);
+    m_pendingPlan = std::move(plan);
+    m_planChanged = true;
+}
+
+bool AlertEngine::openLog(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "a");
+    if (file == nullptr) return false;
+    if (m_log != nullptr) fclose(m_log);
+    m_log = file;
+    return true;
+}
+
+double AlertEngine::seconds(std::chrono::steady_clock::time_point now) const {
+    return std::chrono::duration<double>(now - m_epoch).count();
+}
+
+// Os alertas do plano anterior somem sem evento de fim: as regras mudaram.
+void AlertEngine::adopt(const SystemInfo& info, std::chrono::steady_clock::time_point now) {
+    {
+        std::lock_guard<std::mutex> lock(m_planMutex);
+        m_plan = m_pendingPlan;
+        m_planChanged = false;
+    }
+    m_processes.clear();
+    m_states.clear();
+    m_timers = decltype(m_timers)();
+    m_active.clear();
+    m_activeKeys.clear();
+    m_epoch = now;
+    m_dirty = true;
+
+    size_t rules = m_plan ? m_plan->rules.size() : 0;
+    m_stats.rules = (unsigned)rules;
+    m_stats.states = 0;
+    m_ruleMarks.assign(rules, 0);
+    m_mark = 0;
+    m_rankings.assign(m_plan ? m_plan->rankings.size() : 0, Ranking());
+    m_systemSeries.assign(m_plan ? m_plan->series.size() : 0, Series());
+    if (!m_plan || m_plan->processRules.empty()) return;
+
+    m_changed.clear();
+    for (const ProcessInfo& p : info.processes) {
+        track(p, now);
+        m_changed.emplace_back(p.pid, ALL_FIELDS);
+    }
+    updateRankings();
+    evaluateChanged(now);
+}
+
+void AlertEngine::track(const ProcessInfo& process, std::chrono::steady_clock::time_point now) {
+    Tracked& tracked = m_processes[process.pid];
+    tracked.process = process;
+    tracked.series.assign(m_plan->series.size(), Series());
+    tracked.states = 0;
+    for (size_t r = 0; r < m_rankings.size(); ++r) {
+        m_rankings[r].order.insert({ processMetric(process, m_plan->rankings[r].metric), process.pid });
+    }
+    addSamples(tracked, ALL_FIELDS, now);
+}
+
+void AlertEngine::drop(unsigned long pid) {
+    auto it = m_processes.find(pid);
+    if (it == m_processes.end()) return;
+    Tracked& tracked = it->second;
+    for (size_t r = 0; r < m_rankings.size(); ++r) {
+        m_rankings[r].order.erase({ processMetric(tracked.process, m_plan->rankings[r].metric), pid });
+    }
+    for (size_t i = 0; i < m_plan->processRules.size() && tracked.states > 0; ++i) {
+        uint32_t ruleIndex = m_plan->processRules[i];
+        auto state = m_states.find(((uint64_t)ruleIndex << 32) | (uint32_t)pid);
+        if (state == m_states.end()) continue;
+        if (state->second.firing) {
+            const AlertRule& rule = m_plan->rules[ruleIndex];
+            resolve(rule, &tracked, processMetric(tracked.process, rule.conditions[0].metric), state->second);
+        }
+        m_states.erase(state);
+        --tracked.states;
+        --m_stats.states;
+    }
+    m_processes.erase(it);
+}
+
+// So atualiza o estado; a reavaliacao espera os rankings da lista nova.
+void AlertEngine::apply(const ProcessChange& change, std::chrono::steady_clock::time_point now) {
+    const ProcessInfo& process = change.process;
+    auto it = m_processes.find(process.pid);
+    if (it == m_processes.end() || (change.fields & CHANGE_ADDED)) {
+        // PID novo (ou reaproveitado, ja tirado por diff.removed): comeca do
+        // zero.
+        drop(process.pid);
+        track(process, now);
+        m_changed.emplace_back(process.pid, ALL_FIELDS);
+        return;
+    }
+
+    Tracked& tracked = it->second;
+    for (size_t r = 0; r < m_rankings.size(); ++r) {
+        AlertMetric metric = m_plan->rankings[r].metric;
+        if (!(metricField(metric) & change.fields)) continue;
+        std::set<RankKey>& order = m_rankings[r].order;
+        // Reaproveita o no: mudar de posicao nao aloca.
+        auto node = order.extract({ processMetric(tracked.process, metric), process.pid });
+        RankKey key{ processMetric(process, metric), process.pid };
+        if (node.empty()) {
+            order.insert(key);
+        }
+        else {
+            node.value() = key;
+            order.insert(std::move(node));
+        }
+    }
+    tracked.process = process;
+    addSamples(tracked, change.fields, now);
+    m_changed.emplace_back(process.pid, change.fields);
+}
+
+void AlertEngine::addSamples(Tracked& tracked, uint8_t fields, std::chrono::steady_clock::time_point now) {
+    double time = seconds(now);
+    for (unsigned bit = 0; bit < 8; ++bit) {
+        if (!(fields & (1u << bit))) continue;
+        for (uint32_t slot : m_plan->seriesByField[bit]) {
+            const AlertPlan::Series& series = m_plan->series[slot];
+            double window = series.window.count() / 1000.0;
+            if (tracked.series[slot].add(time, processMetric(tracked.process, series.metric), window)) {
+                // Quando esta fatia virar o inicio da janela, a taxa muda.
+                m_timers.push({ now + series.window, TIMER_SERIES, slot, tracked.process.pid });
+            }
+        }
+    }
+}
+
+void AlertEngine::updateRankings() {
+    m_rankChanged.clear();
+    for (uint32_t r = 0; r < (uint32_t)m_rankings.size(); ++r) {
+        Ranking& ranking = m_rankings[r];
+        size_t count = m_plan->rankings[r].maxN;
+        m_members.clear();
+        for (auto it = ranking.order.begin(); it != ranking.order.end() && m_members.size() < count; ++it) {
+            m_members.push_back(it->pid);
+        }
+        size_t positions = std::max(m_members.size(), ranking.members.size());
+        for (size_t i = 0; i < positions; ++i) {
+            bool hasOld = i < ranking.members.size();
+            bool hasNew = i < m_members.size();
+            if (hasOld && hasNew && ranking.members[i] == m_members[i]) continue;
+            if (hasOld) m_rankChanged.emplace_back(r, ranking.members[i]);
+            if (hasNew) m_rankChanged.emplace_back(r, m_members[i]);
+        }
+        ranking.members.swap(m_members);
+    }
+}
+
+void AlertEngine::evaluateChanged(std::chrono::steady_clock::time_point now) {
+    for (const std::pair<unsigned long, uint8_t>& changed : m_changed) {
+        auto it = m_processes.find(changed.first);
+        if (it == m_processes.end()) continue;
+        if (++m_mark == 0) {
+            std::fill(m_ruleMarks.begin(), m_ruleMarks.end(), 0);
+            m_mark = 1;
+        }
+        if (changed.second & CHANGE_ADDED) {
+            for (uint32_t ruleIndex : m_plan->processRules) {
+                evaluate(ruleIndex, changed.first, &it->second, now);
+            }
+            continue;
+        }
+        for (unsigned bit = 0; bit < 8; ++bit) {
+            if (!(changed.second & (1u << bit))) continue;
+            for (uint32_t ruleIndex : m_plan->rulesByField[bit]) {
+                if (m_ruleMarks[ruleIndex] == m_mark) continue;
+                m_ruleMarks[ruleIndex] = m_mark;
+                evaluate(ruleIndex, changed.first, &it->second, now);
+            }
+        }
+    }
+    for (const std::pair<uint32_t, unsigned long>& changed : m_rankChanged) {
+        auto it = m_processes.find(changed.second);
+        if (it == m_processes.end()) continue;
+        for (uint32_t ruleIndex : m_plan->rulesByRanking[changed.first]) {
+            evaluate(ruleIndex, changed.second, &it->second, now);
+        }
+    }
+}
+
+// Prazos de estados ou processos que ja nao existem sao so descartados.
+void AlertEngine::expireTimers(std::chrono::steady_clock::time_point now) {
+    while (!m_timers.empty() && m_timers.top().at <= now) {
+        Timer timer = m_timers.top();
+        m_timers.pop();
+        Tracked* tracked = nullptr;
+        if (timer.pid != SYSTEM_SUBJECT) {
+            auto it = m_processes.find(timer.pid);
+            if (it == m_processes.end()) continue;
+            tracked = &it->second;
+        }
+        if (timer.kind == TIMER_SUSTAIN) {
+            if (m_states.find(((uint64_t)timer.index << 32) | (uint32_t)timer.pid) == m_states.end()) continue;
+            evaluate(timer.index, timer.pid, tracked, now);
+        }
+        else if (tracked != nullptr) {
+            for (uint32_t ruleIndex : m_plan->rulesBySeries[timer.index]) {
+                evaluate(ruleIndex, timer.pid, tracked, now);
+            }
+        }
+    }
+}
+
+size_t AlertEngine::rankOf(uint32_t ranking, unsigned long pid) const {
+    const std::vector<unsigned long>& members = m_rankings[ranking].members;
+    return (size_t)(std::find(members.begin(), members.end(), pid) - members.begin());
+}
+
+bool AlertEngine::matches(const AlertRule& rule, unsigned long pid, const Tracked& tracked, double now, double& value) const {
+    const ProcessInfo& p = tracked.process;
+    if (!rule.nameContains.empty() && !containsIgnoringCase(p.name.str(), rule.nameContains)) return false;
+    if (!rule.user.empty() && (!p.metadata || p.metadata->user.str() != rule.user)) return false;
+    for (size_t i = 0; i < rule.conditions.size(); ++i) {
+        const AlertCondition& condition = rule.conditions[i];
+        double current;
+        bool ok;
+        switch (condition.kind) {
+        case CONDITION_RATE:
+            current = tracked.series[condition.slot].rate(now, condition.window.count() / 1000.0);
+            ok = compare(current, condition);
+            break;
+        case CONDITION_TOP:
+            current = processMetric(p, condition.metric);
+            ok = rankOf(condition.slot, pid) < condition.topN;
+            break;
+        default:
+            current = processMetric(p, condition.metric);
+            ok = compare(current, condition);
+            break;
+        }
+        if (i == 0) value = current;
+        if (!ok) return false;
+    }
+    return true;
+}
+
+bool AlertEngine::matchesSystem(const AlertRule& rule, double now, double& value) const {
+    for (size_t i = 0; i < rule.conditions.size(); ++i) {
+        const AlertCondition& condition = rule.conditions[i];
+        double current = condition.kind == CONDITION_RATE ?
+            m_systemSeries[condition.slot].rate(now, condition.window.count() / 1000.0) :
+            m_systemValues[condition.metric];
+        if (i == 0) value = current;
+        if (!compare(current, condition)) return false;
+    }
+    return true;
+}
+
+void AlertEngine::evaluate(uint32_t ruleIndex, unsigned long pid, Tracked* tracked, std::chrono::steady_clock::time_point now) {
+    const AlertRule& rule = m_plan->rules[ruleIndex];
+    double time = seconds(now);
+    double value = 0.0;
+    bool matched = tracked != nullptr ? matches(rule, pid, *tracked, time, value) : matchesSystem(rule, time, value);
+    ++m_stats.evaluations;
+
+    uint64_t key = ((uint64_t)ruleIndex << 32) | (uint32_t)pid;
+    auto it = m_states.find(key);
+    if (!matched) {
+        if (it == m_states.end()) return;
+        if (it->second.firing) resolve(rule, tracked, value, it->second);
+        m_states.erase(it);
+        if (tracked != nullptr) --tracked->states;
+        --m_stats.states;
+        return;
+    }
+
+    if (it == m_states.end()) {
+        it = m_states.emplace(key, RuleState()).first;
+        it->second.since = now;
+        it->second.sinceMs = wallClockMs();
+        if (tracked != nullptr) ++tracked->states;
+        ++m_stats.states;
+        if (rule.sustain.count() > 0) {
+            m_timers.push({ now + rule.sustain, TIMER_SUSTAIN, ruleIndex, pid });
+            return;
+        }
+    }
+    if (!it->second.firing && now - it->second.since >= rule.sustain) {
+        fire(rule, it->first, tracked, value, it->second);
+    }
+}
+
+void AlertEngine::fire(const AlertRule& rule, uint64_t key, const Tracked* tracked, double value, RuleState& state) {
+    state.firing = true;
+    state.active = (uint32_t)m_active.size();
+    AlertEvent event;
+    event.kind = ALERT_FIRED;
+    event.rule = rule.name;
+    event.system = tracked == nullptr;
+    if (tracked != nullptr) {
+        event.pid = tracked->process.pid;
+        event.name = tracked->process.name;
+    }
+    event.metric = rule.conditions[0].metric;
+    event.rate = rule.conditions[0].kind == CONDITION_RATE;
+    event.value = value;
+    event.sinceMs = state.sinceMs;
+    event.timestampMs = wallClockMs();
+    m_active.push_back(event);
+    m_activeKeys.push_back(key);
+    ++m_stats.fired;
+    record(std::move(event));
+}
+
+void AlertEngine::resolve(const AlertRule& rule, const Tracked* tracked, double value, const RuleState& state) {
+    AlertEvent event;
+    event.kind = ALERT_RESOLVED;
+    event.rule = rule.name;
+    event.system = tracked == nullptr;
+    if (tracked != nullptr) {
+        event.pid = tracked->process.pid;
+        event.name = tracked->process.name;
+    }
+    event.metric = rule.conditions[0].metric;
+    event.rate = rule.conditions[0].kind == CONDITION_RATE;
+    event.value = value;
+    event.sinceMs = state.sinceMs;
+    event.timestampMs = wallClockMs();
+    if (state.active + 1 != m_active.size()) {
+        m_active[state.active] = std::move(m_active.back());
+        m_activeKeys[state.active] = m_activeKeys.back();
+        m_states[m_activeKeys[state.active]].active = state.active;
+    }
+    m_active.pop_back();
+    m_activeKeys.pop_back();
+    ++m_stats.resolved;
+    record(std::move(event));
+}
+
+void AlertEngine::record(AlertEvent&& event) {
+    if (m_log != nullptr) {
+        fprintf(m_log, "%llu\t%s\t%s\t%lu\t%s\t%s%s%s\t%.3f\n", event.timestampMs,
+            event.kind == ALERT_FIRED ? "disparou" : "terminou", event.rule.c_str(), event.pid,
+            event.system ? "sistema" : event.name.c_str(), event.rate ? "rate(" : "",
+            alertMetricName(event.metric), event.rate ? ")" : "", event.value);
+        fflush(m_log);
+    }
+    m_recent.push_back(std::move(event));
+    while (m_recent.size() > m_options.history) {
+        m_recent.pop_front();
+    }
+    m_dirty = true;
+}
+
+// Copia os alertas ativos e recentes para um AlertStatus novo; o anterior
+// continua anexado aos snapshots ja publicados e nunca e alterado.
+void AlertEngine::publish() {
+    if (!m_dirty) return;
+    m_dirty = false;
+    if (!m_plan) {
+        m_status.reset();
+        return;
+    }
+    std::shared_ptr<AlertStatus> status = std::make_shared<AlertStatus>();
+    status->active = m_active;
+    status->recent.assign(m_recent.begin(), m_recent.end());
+    m_status = status;
+}
+
+void AlertEngine::updateSystem(const SystemInfo& info, std::chrono::steady_clock::time_point now) {
+    if (m_planChanged) adopt(info, now);
+    if (m_plan) {
+        if (!m_plan->systemRules.empty()) {
+            for (unsigned metric = PROCESS_METRIC_COUNT; metric < ALERT_METRIC_COUNT; ++metric) {
+                m_systemValues[metric] = systemMetric(info, (AlertMetric)metric);
+            }
+            double time = seconds(now);
+            for (size_t slot = 0; slot < m_plan->series.size(); ++slot) {
+                const AlertPlan::Series& series = m_plan->series[slot];
+                if (series.metric < PROCESS_METRIC_COUNT) continue;
+                m_systemSeries[slot].add(time, m_systemValues[series.metric], series.window.count() / 1000.0);
+            }
+            // Poucas regras e um valor cada: todas a cada tick do sistema.
+            for (uint32_t ruleIndex : m_plan->systemRules) {
+                evaluate(ruleIndex, SYSTEM_SUBJECT, nullptr, now);
+            }
+        }
+        expireTimers(now);
+    }
+    publish();
+}
+
+void AlertEngine::updateProcesses(const SystemInfo& info, const SnapshotDiff& diff, std::chrono::steady_clock::time_point now) {
+    if (m_planChanged) {
+        // adopt ja parte da lista inteira.
+        adopt(info, now);
+    }
+    else if (m_plan && !m_plan->processRules.empty()) {
+        m_changed.clear();
+        for (unsigned long pid : diff.removed) {
+            drop(pid);
+        }
+        for (const ProcessChange& change : diff.changes) {
+            apply(change, now);
+        }
+        updateRankings();
+        evaluateChanged(now);
+    }
+    if (m_plan) expireTimers(now);
+    publish();
+}
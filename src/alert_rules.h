@@ -0,0 +1,334 @@
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snapshot_diff.h"
+#include "system_info.h"
+
+// Regras de alerta sobre as metricas coletadas, uma por linha:
+//
+//   nome: process [name=texto] [user=nome] condicao [and condicao...] [for duracao]
+//   nome: system condicao [and condicao...] [for duracao]
+//
+// condicao:
+//   metrica op valor              limiar (op: > >= < <=)
+//   rate(metrica[, janela]) op valor
+//                                 variacao por segundo na janela (padrao: 60s)
+//   top N metrica                 entre os N processos de maior valor
+//
+// Metricas de processo: cpu (% da maquina), core (% de um nucleo), mem,
+// threads, read, write (bytes/s), faults, switches (por segundo). Do sistema:
+// cpu, iowait, steal, ram (%), ramused (bytes), psi.cpu, psi.memory, psi.io
+// (pressao "some", media de 10 s). Valores aceitam sufixo K, M ou G (1024);
+// duracoes, ms, s, m ou h (padrao: s). Linhas vazias e comecando com # sao
+// ignoradas. Exemplo:
+//
+//   memoria_crescendo: process mem > 4G and rate(mem, 5m) > 0 for 5m
+//   cpu_alta: system cpu > 90 for 30s
+enum AlertMetric : uint8_t {
+    METRIC_CPU,
+    METRIC_CORE,
+    METRIC_MEMORY,
+    METRIC_THREADS,
+    METRIC_IO_READ,
+    METRIC_IO_WRITE,
+    METRIC_FAULTS,
+    METRIC_SWITCHES,
+    PROCESS_METRIC_COUNT,
+    METRIC_SYSTEM_CPU = PROCESS_METRIC_COUNT,
+    METRIC_SYSTEM_IOWAIT,
+    METRIC_SYSTEM_STEAL,
+    METRIC_SYSTEM_RAM,
+    METRIC_SYSTEM_RAM_BYTES,
+    METRIC_PSI_CPU,
+    METRIC_PSI_MEMORY,
+    METRIC_PSI_IO,
+    ALERT_METRIC_COUNT
+};
+
+// Nome usado nas regras ("mem", "psi.io"...).
+const char* alertMetricName(AlertMetric metric);
+// Metricas em bytes (ou bytes/s), exibidas com formatBytes.
+bool alertMetricIsBytes(AlertMetric metric);
+
+enum AlertScope : uint8_t {
+    ALERT_PROCESS,
+    ALERT_SYSTEM
+};
+
+enum AlertConditionKind : uint8_t {
+    CONDITION_VALUE,
+    CONDITION_RATE,
+    CONDITION_TOP
+};
+
+enum AlertComparison : uint8_t {
+    COMPARE_GREATER,
+    COMPARE_GREATER_EQUAL,
+    COMPARE_LESS,
+    COMPARE_LESS_EQUAL
+};
+
+struct AlertCondition {
+    AlertConditionKind kind = CONDITION_VALUE;
+    AlertMetric metric = METRIC_CPU;
+    AlertComparison comparison = COMPARE_GREATER;
+    double threshold = 0.0;
+    // CONDITION_RATE.
+    std::chrono::milliseconds window{ 60000 };
+    // CONDITION_TOP.
+    size_t topN = 0;
+    // Serie (rate) ou ranking (top) do plano.
+    uint32_t slot = 0;
+};
+
+struct AlertRule {
+    // Compartilhado com os eventos: copiar um evento nao aloca.
+    InternedName name;
+    AlertScope scope = ALERT_PROCESS;
+    // Filtros de processo; vazio = todos. name como no name= das consultas
+    // (trecho do nome, sem diferenciar maiusculas).
+    std::string nameContains;
+    std::string user;
+    std::vector<AlertCondition> conditions;
+    // O alerta so dispara depois de as condicoes valerem por todo esse tempo.
+    std::chrono::milliseconds sustain{ 0 };
+    // ProcessChangeField que podem mudar o resultado da regra.
+    uint8_t fields = 0;
+};
+
+// Regras compiladas: as janelas de taxa e os rankings sao compartilhados
+// entre as regras que usam a mesma metrica, e cada campo do diff aponta para
+// as regras que dependem dele. Imutavel depois de compilado.
+struct AlertPlan {
+    struct Series {
+        AlertMetric metric;
+        std::chrono::milliseconds window;
+    };
+    struct Ranking {
+        AlertMetric metric;
+        // O maior N entre as regras.
+        size_t maxN;
+    };
+
+    std::vector<AlertRule> rules;
+    std::vector<Series> series;
+    std::vector<Ranking> rankings;
+    std::vector<uint32_t> processRules;
+    std::vector<uint32_t> systemRules;
+    // Regras de processo por bit de ProcessChangeField.
+    std::vector<uint32_t> rulesByField[8];
+    std::vector<std::vector<uint32_t>> rulesBySeries;
+    std::vector<std::vector<uint32_t>> rulesByRanking;
+    // Series de processo que cada bit de ProcessChangeField atualiza.
+    std::vector<uint32_t> seriesByField[8];
+};
+
+// Compila o texto inteiro (varias linhas). Em erro, devolve false e error
+// diz a linha e o motivo.
+bool compileAlertRules(const std::string& text, AlertPlan& plan, std::string& error);
+bool loadAlertRules(const std::string& path, AlertPlan& plan, std::string& error);
+
+enum AlertEventKind : uint8_t {
+    ALERT_FIRED,
+    ALERT_RESOLVED
+};
+
+struct AlertEvent {
+    AlertEventKind kind = ALERT_FIRED;
+    InternedName rule;
+    // Regras de sistema nao tem processo.
+    bool system = false;
+    unsigned long pid = 0;
+    InternedName name;
+    // Metrica e valor da primeira condicao no momento do evento; com rate,
+    // o valor e a variacao por segundo.
+    AlertMetric metric = METRIC_CPU;
+    bool rate = false;
+    double value = 0.0;
+    // Desde quando as condicoes valem e quando o evento aconteceu, em ms
+    // desde a epoch.
+    unsigned long long sinceMs = 0;
+    unsigned long long timestampMs = 0;
+};
+
+// Alertas como o AlertEngine os via no fim do ultimo tick em que algo mudou
+// (um disparo, um fim ou regras novas); cada SystemInfo guarda o vigente
+// quando foi publicado.
+struct AlertStatus {
+    // Disparados e ainda valendo (kind == ALERT_FIRED), mais antigos primeiro.
+    std::vector<AlertEvent> active;
+    // Ultimos eventos, mais novos por ultimo.
+    std::vector<AlertEvent> recent;
+};
+
+struct AlertOptions {
+    // Eventos mantidos em AlertStatus::recent.
+    size_t history = 200;
+};
+
+// Avalia as regras a cada tick, na thread de coleta. Uma lista nova so
+// reavalia, para cada processo do diff, as regras que dependem dos campos
+// que mudaram; o resto do custo e proporcional aos processos que entraram ou
+// sairam dos rankings e aos prazos vencidos (duracao e janelas de taxa), nao
+// ao tamanho da lista nem ao numero de regras.
+class AlertEngine {
+public:
+    AlertEngine();
+    ~AlertEngine();
+
+    // Pode ser chamado de qualquer thread; o plano vale a partir do proximo
+    // tick, com o estado (duracoes, janelas, alertas ativos) zerado. Nulo
+    // desliga as regras.
+    void setPlan(std::shared_ptr<const AlertPlan> plan);
+    void setOptions(const AlertOptions& options) { m_options = options; }
+    // Uma linha TSV por evento: ms, disparou|terminou, regra, pid, nome,
+    // metrica, valor. Antes do primeiro tick.
+    bool openLog(const std::string& path);
+
+    // Thread de coleta. info e o estado corrente (m_state do SystemMonitor).
+    void updateSystem(const SystemInfo& info, std::chrono::steady_clock::time_point now);
+    void updateProcesses(const SystemInfo& info, const SnapshotDiff& diff, std::chrono::steady_clock::time_point now);
+    // Ha plano (ou um chegando); sem isso os update* nao fazem nada.
+    bool active() const { return m_plan || m_planChanged; }
+    // Nulo sem plano.
+    std::shared_ptr<const AlertStatus> status() const { return m_status; }
+    const AlertStats& stats() const { return m_stats; }
+
+private:
+    struct Sample {
+        // Inicio da fatia, em segundos desde m_epoch.
+        double time;
+        double value;
+    };
+
+    // Valores de uma metrica na janela, agrupados em fatias de 1/16 da
+    // janela: no maximo 17 amostras por serie, qualquer que seja o periodo.
+    struct Series {
+        std::vector<Sample> samples;
+
+        // Devolve true se abriu uma fatia nova.
+        bool add(double time, double value, double window);
+        // (ultimo valor - valor no inicio da janela) / janela.
+        double rate(double now, double window) const;
+    };
+
+    struct Tracked {
+        ProcessInfo process;
+        // Uma por AlertPlan::series (vazio sem regras de taxa).
+        std::vector<Series> series;
+        // Estados de regra (RuleState) deste processo.
+        unsigned states = 0;
+    };
+
+    struct RuleState {
+        std::chrono::steady_clock::time_point since;
+        unsigned long long sinceMs = 0;
+        bool firing = false;
+        // Posicao em m_active enquanto firing.
+        uint32_t active = 0;
+    };
+
+    enum TimerKind : uint8_t {
+        // Fim da duracao exigida de uma regra.
+        TIMER_SUSTAIN,
+        // Uma fatia sai da janela de uma serie e a taxa muda.
+        TIMER_SERIES
+    };
+
+    struct Timer {
+        std::chrono::steady_clock::time_point at;
+        TimerKind kind;
+        uint32_t index;
+        unsigned long pid;
+
+        bool operator>(const Timer& other) const { return at > other.at; }
+    };
+
+    struct RankKey {
+        double value;
+        unsigned long pid;
+
+        // Maior valor primeiro; empates pelo PID.
+        bool operator<(const RankKey& other) const {
+            return value != other.value ? value > other.value : pid < other.pid;
+        }
+    };
+
+    struct Ranking {
+        std::set<RankKey> order;
+        // Os maxN primeiros na ultima lista.
+        std::vector<unsigned long> members;
+    };
+
+    void adopt(const SystemInfo& info, std::chrono::steady_clock::time_point now);
+    void track(const ProcessInfo& process, std::chrono::steady_clock::time_point now);
+    void drop(unsigned long pid);
+    void apply(const ProcessChange& change, std::chrono::steady_clock::time_point now);
+    void addSamples(Tracked& tracked, uint8_t fields, std::chrono::steady_clock::time_point now);
+    // Recalcula os primeiros de cada ranking; quem mudou de posicao vai
+    // para m_rankChanged.
+    void updateRankings();
+    void evaluateChanged(std::chrono::steady_clock::time_point now);
+    void expireTimers(std::chrono::steady_clock::time_point now);
+    // tracked nulo = regra de sistema.
+    void evaluate(uint32_t ruleIndex, unsigned long pid, Tracked* tracked, std::chrono::steady_clock::time_point now);
+    bool matches(const AlertRule& rule, unsigned long pid, const Tracked& tracked, double now, double& value) const;
+    bool matchesSystem(const AlertRule& rule, double now, double& value) const;
+    size_t rankOf(uint32_t ranking, unsigned long pid) const;
+    void fire(const AlertRule& rule, uint64_t key, const Tracked* tracked, double value, RuleState& state);
+    void resolve(const AlertRule& rule, const Tracked* tracked, double value, const RuleState& state);
+    void record(AlertEvent&& event);
+    void publish();
+    double seconds(std::chrono::steady_clock::time_point now) const;
+
+    AlertOptions m_options;
+    FILE* m_log = nullptr;
+
+    std::mutex m_planMutex;
+    std::shared_ptr<const AlertPlan> m_pendingPlan;
+    std::atomic<bool> m_planChanged{ false };
+
+    // So a thread de coleta usa.
+    std::shared_ptr<const AlertPlan> m_plan;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::unordered_map<unsigned long, Tracked> m_processes;
+    // Chave: indice da regra << 32 | PID (regras de sistema usam um PID
+    // reservado). So existe enquanto as condicoes valem.
+    std::unordered_map<uint64_t, RuleState> m_states;
+    double m_systemValues[ALERT_METRIC_COUNT] = {};
+    std::vector<Series> m_systemSeries;
+    std::vector<Ranking> m_rankings;
+    // Processos da lista atual a reavaliar, com os campos que mudaram.
+    std::vector<std::pair<unsigned long, uint8_t>> m_changed;
+    // (ranking, PID) que entraram, sairam ou mudaram de posicao.
+    std::vector<std::pair<uint32_t, unsigned long>> m_rankChanged;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+    // Marca das regras ja avaliadas para o processo atual.
+    std::vector<uint32_t> m_ruleMarks;
+    uint32_t m_mark = 0;
+    // Sem ordem: quem termina da lugar ao ultimo, cuja chave em m_activeKeys
+    // leva ao estado a corrigir.
+    std::vector<AlertEvent> m_active;
+    std::vector<uint64_t> m_activeKeys;
+    std::deque<AlertEvent> m_recent;
+    std::vector<unsigned long> m_members;
+    AlertStats m_stats;
+    bool m_dirty = false;
+
+    std::shared_ptr<const AlertStatus> m_status;
+};
+
+#endif
@@ -0,0 +1,41 @@
+// Substitui o operator new global para contar alocacoes. Ligado so nos
+// executaveis (GUI e headless), nunca na biblioteca: cada programa pode ter
+// apenas uma substituicao, e os benchmarks ja tem a deles.
+#include <cstdlib>
+#include <new>
+
+#include "instrumentation.h"
+
+namespace {
+struct EnableAllocationCounting {
+    EnableAllocationCounting() { instrumentation::enableAllocationCounting(); }
+} g_enableAllocationCounting;
+}
+
+void* operator new(std::size_t size) {
+    instrumentation::countAllocation();
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -1,41 +1,39 @@
 #include "backend.h"
+#include <atomic>
 #include <chrono>   
 #include <string>
 #include <vector>
 #include <algorithm> 
-#include <map> 
 
-#include <Pdh.h>    
-#include <psapi.h>  
-#include <tlhelp32.h> 
-#pragma comment(lib, "pdh.lib") 
+#include "util.h"
 
-void SystemMonitor::internal_GetSystemInfo(SystemInfo& info) {
+// Cada camada guarda o total de CPU do sistema da sua ultima amostragem: os
+// tempos de um processo ou thread sao divididos pelo tempo de CPU que passou
+// entre as mesmas duas amostragens, qualquer que seja o periodo da camada.
+static unsigned long long advanceCpuReference(bool valid, unsigned long long cpuTotal, unsigned long long& lastTotal) {
+    if (!valid) return 0;
+    unsigned long long totalSystem = lastTotal != 0 ? cpuTotal - lastTotal : 0;
+    lastTotal = cpuTotal;
+    return totalSystem;
+}
 
-    MEMORYSTATUSEX memInfo;
-    memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-    if (GlobalMemoryStatusEx(&memInfo)) {
-        info.ramTotalBytes = memInfo.ullTotalPhys;
-        info.ramUsedBytes = memInfo.ullTotalPhys - memInfo.ullAvailPhys;
-        info.ramUsagePercentage = memInfo.dwMemoryLoad;
+void SystemMonitor::internal_SampleSystem(SystemInfo& info) {
+    {
+        ScopedPhaseTimer timer(m_sample.timings, PHASE_SYSTEM);
+        m_collector->sampleSystem(m_sample);
     }
 
-    FILETIME idleTime, kernelTime, userTime;
-    ULARGE_INTEGER currentIdle, currentKernel, currentUser;
-    ULONGLONG totalSystem = 0;
-
-    if (GetSystemTimes(&idleTime, &kernelTime, &userTime)) {
-        currentIdle.QuadPart = idleTime.dwLowDateTime | ((ULONGLONG)idleTime.dwHighDateTime << 32);
-        currentKernel.QuadPart = kernelTime.dwLowDateTime | ((ULONGLONG)kernelTime.dwHighDateTime << 32);
-        currentUser.QuadPart = userTime.dwLowDateTime | ((ULONGLONG)userTime.dwHighDateTime << 32);
-
-        if (m_lastCpuKernel.QuadPart != 0) {
-            ULONGLONG totalKernel = currentKernel.QuadPart - m_lastCpuKernel.QuadPart;
-            ULONGLONG totalUser = currentUser.QuadPart - m_lastCpuUser.QuadPart;
-            ULONGLONG totalIdle = currentIdle.QuadPart - m_lastCpuIdle.QuadPart;
+    if (m_sample.memoryValid) {
+        info.ramTotalBytes = m_sample.ramTotalBytes;
+        info.ramUsedBytes = m_sample.ramUsedBytes;
+        info.ramUsagePercentage = m_sample.ramUsagePercentage;
+    }
 
-            totalSystem = totalKernel + totalUser;
-            ULONGLONG totalUsed = totalSystem - totalIdle;
+    if (m_sample.cpuValid) {
+        if (m_lastCpuTotal != 0) {
+            unsigned long long totalSystem = m_sample.cpuTotalTime - m_lastCpuTotal;
+            unsigned long long totalIdle = m_sample.cpuIdleTime - m_lastCpuIdle;
+            unsigned long long totalUsed = totalSystem - totalIdle;
 
             if (totalSystem > 0) {
                 info.cpuLoadPercentage = (double)(totalUsed * 100.0) / totalSystem;
@@ -48,140 +46,256 @@ void SystemMonitor::internal_GetSystemInfo(SystemInfo& info) {
             info.cpuLoadPercentage = 0.0;
         }
 
-        m_lastTotalSystemTime = totalSystem;
-        m_lastCpuIdle = currentIdle;
-        m_lastCpuKernel = currentKernel;
-        m_lastCpuUser = currentUser;
+        m_lastCpuTotal = m_sample.cpuTotalTime;
+        m_lastCpuIdle = m_sample.cpuIdleTime;
     }
 
-    unsigned long focusedPid = m_focusedPid.load();
-    std::map<unsigned long, ProcessCpuTimes> newProcessCpuCache;
-    std::map<unsigned long, ThreadCpuTimes> newThreadCpuCache;
-
-    info.processes.clear();
-    info.focusedProcessThreads.clear();
+    std::chrono::steady_clock::time_point now = m_collector->now();
+    double elapsedUsec = m_hasSystemSample ? std::chrono::duration<double, std::micro>(now - m_systemSampleWall).count() : 0.0;
+    m_systemSampleWall = now;
+    m_hasSystemSample = true;
+
+    sampleCpuStates(info);
+
+    for (int resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+        const RawPressure& raw = m_sample.pressure[resource];
+        RawPressure& last = m_lastPressure[resource];
+        PressureInfo& pressure = info.pressure[resource];
+        pressure.valid = raw.valid;
+        pressure.hasFull = raw.hasFull;
+        pressure.some = PressureLine();
+        pressure.full = PressureLine();
+        if (raw.valid) {
+            pressure.some.avg10 = raw.someAvg[0];
+            pressure.some.avg60 = raw.someAvg[1];
+            pressure.some.avg300 = raw.someAvg[2];
+            if (last.valid && elapsedUsec > 0.0 && raw.someTotalUsec >= last.someTotalUsec) {
+                pressure.some.lastInterval = std::min(100.0, (raw.someTotalUsec - last.someTotalUsec) * 100.0 / elapsedUsec);
+            }
+        }
+        if (raw.hasFull) {
+            pressure.full.avg10 = raw.fullAvg[0];
+            pressure.full.avg60 = raw.fullAvg[1];
+            pressure.full.avg300 = raw.fullAvg[2];
+            if (last.hasFull && elapsedUsec > 0.0 && raw.fullTotalUsec >= last.fullTotalUsec) {
+                pressure.full.lastInterval = std::min(100.0, (raw.fullTotalUsec - last.fullTotalUsec) * 100.0 / elapsedUsec);
+            }
+        }
+        last = raw;
+    }
 
-    DWORD aProcesses[1024], cbNeeded;
-    if (!EnumProcesses(aProcesses, sizeof(aProcesses), &cbNeeded)) {
-        return;
+    if (m_alerts.active()) {
+        ScopedPhaseTimer alertTimer(m_sample.timings, PHASE_ALERTS);
+        m_alerts.updateSystem(info, now);
     }
-    DWORD cProcesses = cbNeeded / sizeof(DWORD);
+}
 
-    HANDLE hThreadSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+// Divide o intervalo desde a amostragem anterior do sistema por estado, no
+// total e em cada nucleo. Os nucleos sao casados pela posicao; se o conjunto
+// mudou (hotplug), o nucleo fica zerado ate a proxima leitura.
+void SystemMonitor::sampleCpuStates(SystemInfo& info) {
+    const RawCpuCores& cores = m_sample.cores;
+    if (cores.online > 0) {
+        m_cpuCoreCount = cores.online;
+    }
+    info.cpuCoreCount = m_cpuCoreCount;
+
+    std::fill(info.cpuStatePercentages, info.cpuStatePercentages + CPU_STATE_COUNT, 0.0);
+    if (m_sample.cpuValid) {
+        unsigned long long delta[RAW_CPU_FIELDS];
+        unsigned long long total = 0;
+        for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+            unsigned long long current = m_sample.cpuStateTimes[field], last = m_lastCpuStates[field];
+            delta[field] = current >= last ? current - last : 0;
+            total += delta[field];
+            m_lastCpuStates[field] = current;
+        }
+        for (unsigned state = 0; state < CPU_STATE_COUNT && total > 0 && m_hasCpuStates; ++state) {
+            info.cpuStatePercentages[state] = delta[state] * 100.0 / total;
+        }
+        m_hasCpuStates = true;
+    }
 
-    for (DWORD i = 0; i < cProcesses; i++) {
-        if (aProcesses[i] == 0) continue;
+    CpuCoreUsage& usage = info.cpuCores;
+    usage.count = cores.count;
+    for (unsigned core = 0; core < cores.count; ++core) {
+        bool sameCore = core < m_lastCores.count && m_lastCores.id[core] == cores.id[core];
+        unsigned long long delta[RAW_CPU_FIELDS];
+        unsigned long long total = 0;
+        for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+            unsigned long long current = cores.times[field][core], last = m_lastCores.times[field][core];
+            delta[field] = sameCore && current >= last ? current - last : 0;
+            total += delta[field];
+        }
+        usage.id[core] = cores.id[core];
+        double scale = total > 0 ? 100.0 / total : 0.0;
+        for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+            usage.states[state][core] = (float)(delta[state] * scale);
+        }
+        usage.busy[core] = total > 0 ? (float)(100.0 - (delta[RAW_CPU_IDLE] + delta[CPU_STATE_IOWAIT]) * scale) : 0.0f;
+    }
 
-        ProcessInfo procInfo;
-        procInfo.pid = aProcesses[i];
+    m_lastCores.count = cores.count;
+    std::copy(cores.id, cores.id + cores.count, m_lastCores.id);
+    for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+        std::copy(cores.times[field], cores.times[field] + cores.count, m_lastCores.times[field]);
+    }
+}
 
-        HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ |
-            PROCESS_QUERY_LIMITED_INFORMATION,
-            FALSE, aProcesses[i]);
+void SystemMonitor::internal_SampleProcesses(SystemInfo& info) {
+    unsigned long long cpuTotal = 0, cpuIdle = 0;
+    bool cpuValid = m_collector->readCpuTimes(cpuTotal, cpuIdle);
+    m_collector->sampleProcesses(m_sample);
+    unsigned long long totalSystem = advanceCpuReference(cpuValid, cpuTotal, m_processCpuTotal);
 
-        if (hProcess != NULL) {
-            PROCESS_MEMORY_COUNTERS pmc;
-            if (GetProcessMemoryInfo(hProcess, &pmc, sizeof(pmc))) {
-                procInfo.memoryUsedBytes = pmc.WorkingSetSize;
-            }
-            TCHAR szProcessName[MAX_PATH] = TEXT("<desconhecido>");
-            if (GetModuleBaseName(hProcess, NULL, szProcessName, sizeof(szProcessName) / sizeof(TCHAR))) {
-#ifdef UNICODE
-                std::wstring wstr(szProcessName);
-                std::string str(wstr.begin(), wstr.end());
-                procInfo.name = str;
-#else
-                procInfo.name = szProcessName;
-#endif
-            }
+    std::chrono::steady_clock::time_point now = m_collector->now();
+    double elapsedSeconds = m_hasProcessSample ? std::chrono::duration<double>(now - m_processSampleWall).count() : 0.0;
+    m_processSampleWall = now;
+    m_hasProcessSample = true;
 
-            FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
-            if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile)) {
-                ULARGE_INTEGER procKernel, procUser;
-                procKernel.QuadPart = kernelTimeFile.dwLowDateTime | ((ULONGLONG)kernelTimeFile.dwHighDateTime << 32);
-                procUser.QuadPart = userTimeFile.dwLowDateTime | ((ULONGLONG)userTimeFile.dwHighDateTime << 32);
+    info.collectorStats = m_sample.stats;
+    info.samplingShards = m_sample.shards;
+    info.exitedProcesses = m_sample.exits;
 
-                auto it = m_processCpuCache.find(procInfo.pid);
-                if (it != m_processCpuCache.end() && totalSystem > 0) {
-                    ULONGLONG totalProcDelta = (procKernel.QuadPart - it->second.kernelTime.QuadPart) +
-                        (procUser.QuadPart - it->second.userTime.QuadPart);
+    {
+        ScopedPhaseTimer deltaTimer(m_sample.timings, PHASE_CPU_DELTAS);
+        m_processCpuCache.nextGeneration();
+        info.processes.clear();
+
+        for (const RawProcessSample& raw : m_sample.processes) {
+            ProcessInfo procInfo;
+            procInfo.pid = raw.pid;
+            procInfo.startTime = raw.startTime;
+            if (raw.metadata) {
+                procInfo.name = raw.metadata->name;
+                procInfo.metadata = raw.metadata;
+            }
+            procInfo.memoryUsedBytes = raw.memoryUsedBytes;
+            procInfo.threadCount = raw.threadCount;
+
+            unsigned long long counters[PROCESS_COUNTER_COUNT + 1];
+            unsigned long long lastCounters[PROCESS_COUNTER_COUNT + 1];
+            std::copy(raw.counters, raw.counters + PROCESS_COUNTER_COUNT, counters);
+            counters[PROCESS_COUNTER_COUNT] = raw.countersValid;
+
+            unsigned long long lastKernel, lastUser;
+            if (raw.timesValid &&
+                m_processCpuCache.update(procInfo.pid, raw.startTime, raw.kernelTime, raw.userTime, counters,
+                    lastKernel, lastUser, lastCounters)) {
+                // Tempo que voltou (leitura inconsistente) fica sem CPU.
+                if (totalSystem > 0 && raw.kernelTime >= lastKernel && raw.userTime >= lastUser) {
+                    unsigned long long totalProcDelta = (raw.kernelTime - lastKernel) + (raw.userTime - lastUser);
                     procInfo.cpuUsagePercentage = (double)(totalProcDelta * 100.0) / totalSystem;
+                    procInfo.cpuCorePercentage = procInfo.cpuUsagePercentage * m_cpuCoreCount;
+                }
+
+                // Contador que voltou fica sem taxa.
+                unsigned bothValid = raw.countersValid & (unsigned)lastCounters[PROCESS_COUNTER_COUNT];
+                for (unsigned c = 0; c < PROCESS_COUNTER_COUNT && elapsedSeconds > 0.0; ++c) {
+                    if (!(bothValid & (1u << c)) || raw.counters[c] < lastCounters[c]) continue;
+                    procInfo.rates[c] = (double)(raw.counters[c] - lastCounters[c]) / elapsedSeconds;
+                    procInfo.ratesValid |= 1u << c;
                 }
-                newProcessCpuCache[procInfo.pid] = { procKernel, procUser };
             }
 
-            CloseHandle(hProcess);
-        }
-        else {
-            procInfo.name = "<acesso negado>";
+            info.processes.push_back(procInfo);
         }
+    }
 
-        info.processes.push_back(procInfo);
-    }
-
-    if (focusedPid != 0 && hThreadSnapshot != INVALID_HANDLE_VALUE) {
-        THREADENTRY32 te32;
-        te32.dwSize = sizeof(THREADENTRY32);
-
-        if (Thread32First(hThreadSnapshot, &te32)) {
-            do {
-                if (te32.th32OwnerProcessID == focusedPid) {
-                    ThreadInfo threadInfo;
-                    threadInfo.tid = te32.th32ThreadID;
-
-                    HANDLE hThread = OpenThread(THREAD_QUERY_INFORMATION, FALSE, te32.th32ThreadID);
-                    if (hThread != NULL) {
-                        FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
-                        if (GetThreadTimes(hThread, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile)) {
-                            ULARGE_INTEGER threadKernel, threadUser;
-                            threadKernel.QuadPart = kernelTimeFile.dwLowDateTime | ((ULONGLONG)kernelTimeFile.dwHighDateTime << 32);
-                            threadUser.QuadPart = userTimeFile.dwLowDateTime | ((ULONGLONG)userTimeFile.dwHighDateTime << 32);
-
-                            auto it = m_threadCpuCache.find(threadInfo.tid);
-                            if (it != m_threadCpuCache.end() && m_lastTotalSystemTime > 0) {
-                                ULONGLONG totalThreadDelta = (threadKernel.QuadPart - it->second.kernelTime.QuadPart) +
-                                    (threadUser.QuadPart - it->second.userTime.QuadPart);
-                                threadInfo.cpuUsagePercentage = (double)(totalThreadDelta * 100.0) / m_lastTotalSystemTime;
-                            }
-
-                            newThreadCpuCache[threadInfo.tid] = { threadKernel, threadUser };
-                        }
-                        CloseHandle(hThread);
-                    }
-                    info.focusedProcessThreads.push_back(threadInfo);
-                }
-            } while (Thread32Next(hThreadSnapshot, &te32));
-        }
+    {
+        ScopedPhaseTimer diffTimer(m_sample.timings, PHASE_DIFF);
+        std::shared_ptr<SnapshotDiff> diff = acquireDiffBuffer();
+        m_differ.update(info.processes, info.processListVersion, info.processListVersion + 1, *diff);
+        diff->exits = m_sample.exits;
+        info.processDiff = diff;
+        m_pendingDiff = diff;
     }
-    if (hThreadSnapshot != INVALID_HANDLE_VALUE) {
-        CloseHandle(hThreadSnapshot);
+
+    {
+        ScopedPhaseTimer cgroupTimer(m_sample.timings, PHASE_CGROUPS);
+        m_cgroupRollup.update(info.processes, m_sample.cgroups, elapsedSeconds);
+        info.cgroups = m_cgroupRollup.published();
     }
 
-    m_processCpuCache.swap(newProcessCpuCache);
-    m_threadCpuCache.swap(newThreadCpuCache);
+    if (m_alerts.active()) {
+        ScopedPhaseTimer alertTimer(m_sample.timings, PHASE_ALERTS);
+        m_alerts.updateProcesses(info, *info.processDiff, now);
+    }
 
+    ScopedPhaseTimer sortTimer(m_sample.timings, PHASE_SORT);
     std::sort(info.processes.begin(), info.processes.end(), [](const ProcessInfo& a, const ProcessInfo& b) {
         return a.memoryUsedBytes > b.memoryUsedBytes;
         });
 
-    std::sort(info.focusedProcessThreads.begin(), info.focusedProcessThreads.end(), [](const ThreadInfo& a, const ThreadInfo& b) {
-        return a.cpuUsagePercentage > b.cpuUsagePercentage;
-        });
+    info.processListVersion++;
+}
+
+void SystemMonitor::internal_SampleThreads(SystemInfo& info) {
+    {
+        std::lock_guard<std::mutex> lock(m_focusMutex);
+        m_threadPids = m_focusedPids;
+    }
+
+    unsigned long long cpuTotal = 0, cpuIdle = 0;
+    bool cpuValid = m_collector->readCpuTimes(cpuTotal, cpuIdle);
+    {
+        ScopedPhaseTimer timer(m_sample.timings, PHASE_THREADS);
+        m_collector->sampleThreads(m_sample, m_threadPids);
+    }
+    unsigned long long totalSystem = advanceCpuReference(cpuValid, cpuTotal, m_threadCpuTotal);
+
+    info.collectorStats = m_sample.stats;
+
+    m_threadCpuCache.nextGeneration();
+    info.focusedProcesses.resize(m_sample.focused.size());
+
+    for (size_t i = 0; i < m_sample.focused.size(); ++i) {
+        const RawFocusedProcess& rawProcess = m_sample.focused[i];
+        FocusedProcessInfo& focused = info.focusedProcesses[i];
+        focused.pid = rawProcess.pid;
+        focused.threads.clear();
+
+        {
+            ScopedPhaseTimer deltaTimer(m_sample.timings, PHASE_CPU_DELTAS);
+            for (const RawThreadSample& raw : rawProcess.threads) {
+                ThreadInfo threadInfo;
+                threadInfo.tid = raw.tid;
+
+                unsigned long long lastKernel, lastUser;
+                if (raw.timesValid &&
+                    m_threadCpuCache.update(threadInfo.tid, 0, raw.kernelTime, raw.userTime, lastKernel, lastUser) &&
+                    totalSystem > 0 && raw.kernelTime >= lastKernel && raw.userTime >= lastUser) {
+                    unsigned long long totalThreadDelta = (raw.kernelTime - lastKernel) + (raw.userTime - lastUser);
+                    threadInfo.cpuUsagePercentage = (double)(totalThreadDelta * 100.0) / totalSystem;
+                }
+                focused.threads.push_back(threadInfo);
+            }
+        }
+
+        ScopedPhaseTimer sortTimer(m_sample.timings, PHASE_SORT);
+        std::sort(focused.threads.begin(), focused.threads.end(), [](const ThreadInfo& a, const ThreadInfo& b) {
+            return a.cpuUsagePercentage > b.cpuUsagePercentage;
+            });
+    }
 }
 
 SystemMonitor::SystemMonitor() :
-    m_running(false),
-    m_info{},
-    m_lastCpuIdle{ 0 },
-    m_lastCpuKernel{ 0 },
-    m_lastCpuUser{ 0 }
+    SystemMonitor(createPlatformCollector())
 {
-    FILETIME idleTime, kernelTime, userTime;
-    if (GetSystemTimes(&idleTime, &kernelTime, &userTime)) {
-        m_lastCpuIdle.QuadPart = idleTime.dwLowDateTime | ((ULONGLONG)idleTime.dwHighDateTime << 32);
-        m_lastCpuKernel.QuadPart = kernelTime.dwLowDateTime | ((ULONGLONG)kernelTime.dwHighDateTime << 32);
-        m_lastCpuUser.QuadPart = userTime.dwLowDateTime | ((ULONGLONG)userTime.dwHighDateTime << 32);
-    }
+}
+
+SystemMonitor::SystemMonitor(std::unique_ptr<Collector> collector) :
+    m_collector(std::move(collector)),
+    m_actions(*m_collector),
+    m_snapshot(std::make_shared<SystemInfo>()),
+    m_running(false)
+{
+    m_collector->readCpuTimes(m_lastCpuTotal, m_lastCpuIdle);
+    m_cpuCoreCount = std::max(1u, std::thread::hardware_concurrency());
+    m_startWall = m_selfSampleWall = std::chrono::steady_clock::now();
+    unsigned long long rssBytes = 0;
+    instrumentation::readSelfUsage(m_startCpu, rssBytes);
+    m_selfSampleCpu = m_startCpu;
 }
 
 SystemMonitor::~SystemMonitor() {
@@ -194,77 +308,306 @@ void SystemMonitor::start() {
 }
 
 void SystemMonitor::stop() {
-    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        m_running = false;
+    }
+    m_publishCv.notify_all();
     if (m_collectionThread.joinable()) {
         m_collectionThread.join();
     }
 }
 
 void SystemMonitor::collectionLoop() {
-    while (m_running) {
-        SystemInfo localInfo;
-        internal_GetSystemInfo(localInfo);
+    TickScheduler scheduler(m_schedulerConfig);
+    scheduler.start(TickScheduler::Clock::now());
 
+    while (m_running) {
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_info = localInfo;
+            // Espera pelo prazo absoluto da proxima camada; stop() acorda antes.
+            std::unique_lock<std::mutex> lock(m_publishMutex);
+            m_publishCv.wait_until(lock, scheduler.nextDeadline(), [&] { return !m_running; });
         }
+        if (!m_running) break;
 
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        TickScheduler::Clock::time_point tickStart = TickScheduler::Clock::now();
+        unsigned due = scheduler.dueTiers(tickStart);
+        if (due == 0) continue;
+
+        TickScheduler::Clock::duration tierWork[TickScheduler::TIER_COUNT] = {};
+        sampleTiers(due, tierWork);
+        scheduler.complete(due, tierWork, tickStart, TickScheduler::Clock::now());
+        m_state.scheduler = scheduler.stats();
+        publishState(due);
     }
 }
 
-void SystemMonitor::getLatestInfo(SystemInfo& outInfo) {
+void SystemMonitor::collectNow(unsigned tiers) {
+    sampleTiers(tiers);
+    publishState(tiers);
+}
+
+void SystemMonitor::sampleTiers(unsigned tiers, TickScheduler::Clock::duration* tierWork) {
+    unsigned long long syscallsBefore = instrumentation::syscallCount();
+    unsigned long long allocationsBefore = instrumentation::allocationCount();
+    m_sample.timings.clear();
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        outInfo = m_info;
+        ScopedPhaseTimer timer(m_sample.timings, PHASE_TICK);
+        void (SystemMonitor::*const samplers[TickScheduler::TIER_COUNT])(SystemInfo&) = {
+            &SystemMonitor::internal_SampleSystem,
+            &SystemMonitor::internal_SampleProcesses,
+            &SystemMonitor::internal_SampleThreads
+        };
+        for (int i = 0; i < TickScheduler::TIER_COUNT; ++i) {
+            if ((tiers & (1u << i)) == 0) continue;
+            TickScheduler::Clock::time_point start = TickScheduler::Clock::now();
+            (this->*samplers[i])(m_state);
+            if (tierWork) tierWork[i] = TickScheduler::Clock::now() - start;
+        }
     }
+    updateDiagnostics(syscallsBefore, allocationsBefore);
 }
 
-void SystemMonitor::killProcess(unsigned long pid) {
-    HANDLE hProcess = OpenProcess(PROCESS_TERMINATE, FALSE, pid);
-    if (hProcess == NULL) return;
-    TerminateProcess(hProcess, 1);
-    CloseHandle(hProcess);
+void SystemMonitor::updateDiagnostics(unsigned long long syscallsBefore, unsigned long long allocationsBefore) {
+    MonitorDiagnostics& diagnostics = m_state.diagnostics;
+    for (unsigned phase = 0; phase < PHASE_COUNT; ++phase) {
+        if (m_sample.timings.has((TickPhase)phase)) {
+            diagnostics.phases[phase].record(m_sample.timings.ns[phase]);
+        }
+    }
+
+    diagnostics.syscallsTotal = instrumentation::syscallCount();
+    diagnostics.syscallsLastTick = diagnostics.syscallsTotal - syscallsBefore;
+    diagnostics.allocationsCounted = instrumentation::allocationCountingEnabled();
+    diagnostics.allocationsTotal = instrumentation::allocationCount();
+    diagnostics.allocationsLastTick = diagnostics.allocationsTotal - allocationsBefore;
+
+    // getrusage/GetProcessTimes tem resolucao grosseira; a CPU propria so e
+    // recalculada em janelas de pelo menos um segundo.
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double window = std::chrono::duration<double>(now - m_selfSampleWall).count();
+    if (window < 1.0) return;
+
+    double cpuSeconds = 0.0;
+    unsigned long long rssBytes = 0;
+    if (instrumentation::readSelfUsage(cpuSeconds, rssBytes)) {
+        diagnostics.selfCpuPercent = (cpuSeconds - m_selfSampleCpu) * 100.0 / window;
+        diagnostics.selfCpuSeconds = cpuSeconds - m_startCpu;
+        diagnostics.uptimeSeconds = std::chrono::duration<double>(now - m_startWall).count();
+        diagnostics.selfCpuAveragePercent = diagnostics.selfCpuSeconds * 100.0 / diagnostics.uptimeSeconds;
+        diagnostics.selfRssBytes = rssBytes;
+        m_selfSampleCpu = cpuSeconds;
+    }
+    m_selfSampleWall = now;
 }
 
-void SystemMonitor::setFocusedProcess(unsigned long pid) {
-    m_focusedPid = pid;
+// O tempo de publicacao so aparece no snapshot seguinte.
+void SystemMonitor::publishState(unsigned tiers) {
+    PhaseTimings timings;
+    {
+        ScopedPhaseTimer timer(timings, PHASE_PUBLISH);
+        std::shared_ptr<SystemInfo> localInfo = acquireSnapshotBuffer();
+        m_state.processActions = m_actions.status();
+        m_state.alerts = m_alerts.status();
+        m_state.alertStats = m_alerts.stats();
+        copyState(*localInfo);
+        // Antes do snapshot: quem acorda com a lista nova ja encontra o diff.
+        if (m_pendingDiff) {
+            deliverDiff(m_pendingDiff);
+            m_pendingDiff.reset();
+        }
+        publishSnapshot(localInfo);
+        if (m_history.isOpen() && (tiers & TickScheduler::TIER_PROCESSES)) {
+            m_history.append(*localInfo);
+        }
+    }
+    m_state.diagnostics.phases[PHASE_PUBLISH].record(timings.ns[PHASE_PUBLISH]);
 }
 
-ExtraProcessInfo SystemMonitor::getExtraProcessInfo(unsigned long pid) {
-    ExtraProcessInfo extraInfo = {};
+// Copia m_state para um buffer reciclado. Se o buffer ja tem a lista de
+// processos atual (so as camadas rapidas rodaram desde entao), ela nao e
+// copiada de novo.
+void SystemMonitor::copyState(SystemInfo& target) {
+    if (target.processListVersion != m_state.processListVersion) {
+        target = m_state;
+        return;
+    }
+    std::vector<ProcessInfo> processes;
+    processes.swap(target.processes);
+    std::vector<ProcessInfo> stateProcesses;
+    stateProcesses.swap(m_state.processes);
+    target = m_state;
+    m_state.processes.swap(stateProcesses);
+    target.processes.swap(processes);
+}
 
-    HANDLE hProcess = OpenProcess(
-        PROCESS_QUERY_INFORMATION | PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ,
-        FALSE, pid
-    );
+// O snapshot publicado no tick anterior ainda esta em m_snapshot; o de dois
+// ticks atras so pode ser reaproveitado se nenhum leitor ainda o segura.
+// use_count() e uma leitura relaxed: a barreira de acquire ordena as escritas
+// seguintes depois das ultimas leituras de quem soltou a referencia.
+std::shared_ptr<SystemInfo> SystemMonitor::acquireSnapshotBuffer() {
+    for (std::shared_ptr<SystemInfo>& recycled : m_recycled) {
+        if (recycled && recycled.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            std::shared_ptr<SystemInfo> buffer;
+            buffer.swap(recycled);
+            return buffer;
+        }
+    }
+    return std::make_shared<SystemInfo>();
+}
 
-    if (hProcess == NULL) {
-        return extraInfo;
+// Como nos snapshots, um buffer so volta a ser usado quando nenhum
+// snapshot, assinatura ou consumidor o segura mais.
+std::shared_ptr<SnapshotDiff> SystemMonitor::acquireDiffBuffer() {
+    for (std::shared_ptr<SnapshotDiff>& buffer : m_diffBuffers) {
+        if (buffer && buffer.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return buffer;
+        }
     }
+    std::shared_ptr<SnapshotDiff>& slot = m_diffBuffers[m_nextDiffBuffer++ % 8];
+    slot = std::make_shared<SnapshotDiff>();
+    return slot;
+}
 
-    IO_COUNTERS ioCounters;
-    if (GetProcessIoCounters(hProcess, &ioCounters)) {
-        extraInfo.ioReadBytes = ioCounters.ReadTransferCount;
-        extraInfo.ioWriteBytes = ioCounters.WriteTransferCount;
+void SystemMonitor::deliverDiff(const std::shared_ptr<const SnapshotDiff>& diff) {
+    std::lock_guard<std::mutex> lock(m_subscriptionsMutex);
+    for (size_t i = 0; i < m_subscriptions.size();) {
+        std::shared_ptr<DiffSubscription> subscription = m_subscriptions[i].lock();
+        if (!subscription) {
+            m_subscriptions[i] = m_subscriptions.back();
+            m_subscriptions.pop_back();
+            continue;
+        }
+        subscription->push(diff);
+        ++i;
     }
+}
 
-    HANDLE hSnapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
-    if (hSnapshot != INVALID_HANDLE_VALUE) {
-        THREADENTRY32 te32;
-        te32.dwSize = sizeof(THREADENTRY32);
+std::shared_ptr<DiffSubscription> SystemMonitor::subscribeDiffs(size_t capacity) {
+    std::shared_ptr<DiffSubscription> subscription = std::make_shared<DiffSubscription>(capacity);
+    std::lock_guard<std::mutex> lock(m_subscriptionsMutex);
+    m_subscriptions.push_back(subscription);
+    return subscription;
+}
 
-        if (Thread32First(hSnapshot, &te32)) {
-            do {
-                if (te32.th32OwnerProcessID == pid) {
-                    extraInfo.threadCount++;
-                }
-            } while (Thread32Next(hSnapshot, &te32));
+void SystemMonitor::setAlertRules(std::shared_ptr<const AlertPlan> plan) {
+    m_alerts.setPlan(std::move(plan));
+}
+
+bool SystemMonitor::openAlertLog(const std::string& path) {
+    return m_alerts.openLog(path);
+}
+
+void SystemMonitor::setDiffThresholds(const DiffThresholds& thresholds) {
+    m_differ.setThresholds(thresholds);
+}
+
+void SystemMonitor::publishSnapshot(const std::shared_ptr<SystemInfo>& snapshot) {
+    snapshot->version = m_snapshotVersion.load() + 1;
+    snapshot->timestampMs = wallClockMs();
+    std::atomic_store(&m_snapshot, std::shared_ptr<const SystemInfo>(snapshot));
+    {
+        std::lock_guard<std::mutex> lock(m_publishMutex);
+        m_snapshotVersion = snapshot->version;
+    }
+    m_publishCv.notify_all();
+
+    for (std::shared_ptr<SystemInfo>& recycled : m_recycled) {
+        if (!recycled) {
+            recycled = snapshot;
+            return;
         }
-        CloseHandle(hSnapshot);
     }
+    m_recycled[0].swap(m_recycled[1]);
+    m_recycled[1] = snapshot;
+}
+
+std::shared_ptr<const SystemInfo> SystemMonitor::getLatestSnapshot() const {
+    return std::atomic_load(&m_snapshot);
+}
+
+unsigned long long SystemMonitor::getSnapshotVersion() const {
+    return m_snapshotVersion.load();
+}
+
+std::shared_ptr<const SystemInfo> SystemMonitor::waitForSnapshot(unsigned long long lastVersion, std::chrono::milliseconds timeout) {
+    {
+        std::unique_lock<std::mutex> lock(m_publishMutex);
+        m_publishCv.wait_for(lock, timeout, [&] {
+            return m_snapshotVersion.load() > lastVersion || !m_running;
+            });
+    }
+    return getLatestSnapshot();
+}
+
+void SystemMonitor::getLatestInfo(SystemInfo& outInfo) {
+    std::shared_ptr<const SystemInfo> snapshot = getLatestSnapshot();
+    if (outInfo.version != snapshot->version) {
+        outInfo = *snapshot;
+    }
+}
+
+std::shared_ptr<const ProcessQueryResult> SystemMonitor::queryProcesses(const ProcessQuery& query) {
+    std::shared_ptr<const SystemInfo> snapshot = getLatestSnapshot();
+    return m_queryCache.run(*snapshot, query);
+}
+
+uint64_t SystemMonitor::requestProcessAction(const ProcessActionRequest& request) {
+    return m_actions.submit(request, getLatestSnapshot());
+}
+
+void SystemMonitor::setProcessActionOptions(const ProcessActionOptions& options) {
+    m_actions.setOptions(options);
+}
+
+uint64_t SystemMonitor::killProcess(unsigned long pid) {
+    ProcessActionRequest request;
+    request.kind = ACTION_KILL;
+    request.pids.push_back(pid);
+    return requestProcessAction(request);
+}
+
+void SystemMonitor::setFocusedProcess(unsigned long pid) {
+    std::lock_guard<std::mutex> lock(m_focusMutex);
+    m_focusedPids.clear();
+    if (pid != 0) {
+        m_focusedPids.push_back(pid);
+    }
+}
 
-    CloseHandle(hProcess);
+void SystemMonitor::setFocusedProcesses(const std::vector<unsigned long>& pids) {
+    std::lock_guard<std::mutex> lock(m_focusMutex);
+    m_focusedPids = pids;
+}
+
+std::vector<unsigned long> SystemMonitor::getFocusedProcesses() const {
+    std::lock_guard<std::mutex> lock(m_focusMutex);
+    return m_focusedPids;
+}
+
+void SystemMonitor::setSchedulerConfig(const SchedulerConfig& config) {
+    m_schedulerConfig = config;
+}
+
+bool SystemMonitor::enableHistory(const std::string& path, const HistoryOptions& options) {
+    return m_history.open(path, options);
+}
+
+bool SystemMonitor::enableLifecycleEvents() {
+    return m_collector->enableLifecycleEvents();
+}
+
+ExtraProcessInfo SystemMonitor::getExtraProcessInfo(unsigned long pid) {
+    ExtraProcessInfo extraInfo = m_collector->readExtraProcessInfo(pid);
+    // Para processos em foco a contagem sai da mesma passada das threads.
+    std::shared_ptr<const SystemInfo> snapshot = getLatestSnapshot();
+    for (const FocusedProcessInfo& focused : snapshot->focusedProcesses) {
+        if (focused.pid == pid) {
+            extraInfo.threadCount = (unsigned long)focused.threads.size();
+            break;
+        }
+    }
     return extraInfo;
 }
\ No newline at end of file
@@ -1,85 +1,175 @@
 #ifndef BACKEND_H
 #define BACKEND_H
 
-#include <mutex>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <string>   
 #include <vector>   
-#include <map>      
-
-#ifndef WIN32_LEAN_AND_MEAN
-#define WIN32_LEAN_AND_MEAN
-#endif
-#include <windows.h> 
-
-struct ProcessInfo {
-    unsigned long pid = 0;
-    std::string name;
-    unsigned long long memoryUsedBytes = 0;
-    double cpuUsagePercentage = 0.0;
-};
-
-struct ExtraProcessInfo {
-    unsigned long threadCount = 0;
-    unsigned long long ioReadBytes = 0;
-    unsigned long long ioWriteBytes = 0;
-    unsigned long handleCount = 0;
-    std::string priorityClass;
-};
-
-struct ThreadInfo {
-    unsigned long tid = 0;
-    double cpuUsagePercentage = 0.0;
-};
+#include <memory>
 
-struct SystemInfo {
-    double ramUsagePercentage = 0.0;
-    unsigned long long ramUsedBytes = 0;
-    unsigned long long ramTotalBytes = 0;
-    double cpuLoadPercentage = 0.0;
-    std::vector<ProcessInfo> processes;
-    std::vector<ThreadInfo> focusedProcessThreads;
-};
+#include "system_info.h"
+#include "alert_rules.h"
+#include "cgroup_rollup.h"
+#include "collector.h"
+#include "cpu_time_table.h"
+#include "history_store.h"
+#include "process_actions.h"
+#include "process_query.h"
+#include "scheduler.h"
+#include "snapshot_diff.h"
 
 class SystemMonitor {
 public:
     SystemMonitor();
+    explicit SystemMonitor(std::unique_ptr<Collector> collector);
     ~SystemMonitor();
 
     void start();
     void stop();
+    // Roda as camadas (TickScheduler::TIER_*) uma vez na thread atual e
+    // publica o snapshot, sem o agendador. Para ferramentas, benchmarks e
+    // reproducao de gravacoes; nao usar junto com start().
+    void collectNow(unsigned tiers = TickScheduler::TIER_SYSTEM | TickScheduler::TIER_PROCESSES |
+        TickScheduler::TIER_THREADS);
+    // Snapshot imutavel mais recente. Leitores seguram o shared_ptr pelo tempo
+    // que quiserem, sem copia e sem bloquear a coleta.
+    std::shared_ptr<const SystemInfo> getLatestSnapshot() const;
+    unsigned long long getSnapshotVersion() const;
+    // Bloqueia ate existir um snapshot com versao maior que lastVersion, o
+    // monitor parar ou o timeout expirar; devolve o snapshot mais recente.
+    std::shared_ptr<const SystemInfo> waitForSnapshot(unsigned long long lastVersion, std::chrono::milliseconds timeout);
+    // Copia o snapshot para outInfo apenas se outInfo.version estiver desatualizada.
     void getLatestInfo(SystemInfo& outInfo);
-    void killProcess(unsigned long pid);
+    // Processos do snapshot mais recente que passam no filtro da consulta, ja
+    // ordenados e limitados. O resultado fica em cache ate a proxima lista.
+    std::shared_ptr<const ProcessQueryResult> queryProcesses(const ProcessQuery& query);
+    const ProcessQueryCache& queryCache() const { return m_queryCache; }
+    // Arvore de cgroups mantida pela thread de coleta; os leitores usam
+    // SystemInfo::cgroups.
+    const CgroupRollup& cgroupRollup() const { return m_cgroupRollup; }
+    // Enfileira uma acao de controle de processo e volta na hora (ver
+    // ProcessActionQueue); o andamento aparece em SystemInfo::processActions
+    // dos snapshots seguintes. killProcess e um SIGKILL num so PID.
+    uint64_t requestProcessAction(const ProcessActionRequest& request);
+    void setProcessActionOptions(const ProcessActionOptions& options);
+    uint64_t killProcess(unsigned long pid);
     ExtraProcessInfo getExtraProcessInfo(unsigned long pid);
+    // Processos cujas threads sao amostradas. setFocusedProcess substitui a
+    // lista inteira por um unico PID (0 = nenhum).
     void setFocusedProcess(unsigned long pid);
+    void setFocusedProcesses(const std::vector<unsigned long>& pids);
+    std::vector<unsigned long> getFocusedProcesses() const;
+
+    // Periodos de cada camada da coleta. Deve ser chamado antes de start().
+    void setSchedulerConfig(const SchedulerConfig& config);
+
+    // Grava no historico em disco cada snapshot que traz uma lista de
+    // processos nova. Deve ser chamado antes de start().
+    bool enableHistory(const std::string& path, const HistoryOptions& options);
+    // Acompanha criacao e saida de processos por eventos do sistema, quando
+    // disponiveis (ver Collector::enableLifecycleEvents). Deve ser chamado
+    // antes de start().
+    bool enableLifecycleEvents();
+    const HistoryStore& history() const { return m_history; }
+    // Zona morta do diff da lista de processos (ver SnapshotDiffer); os
+    // snapshots publicados tambem seguem esses limiares. Antes de start().
+    void setDiffThresholds(const DiffThresholds& thresholds);
+    // Cada lista nova gera um SnapshotDiff, entregue a todas as assinaturas
+    // vivas antes do snapshot correspondente ser publicado. A assinatura
+    // termina quando o shared_ptr devolvido e destruido.
+    std::shared_ptr<DiffSubscription> subscribeDiffs(size_t capacity = 64);
+    // Regras de alerta (ver compileAlertRules); podem ser trocadas com a
+    // coleta rodando e valem a partir do proximo tick. Nulo desliga.
+    void setAlertRules(std::shared_ptr<const AlertPlan> plan);
+    // Anexa os eventos de alerta a este arquivo. Antes de start().
+    bool openAlertLog(const std::string& path);
 
 private:
     void collectionLoop();
-    void internal_GetSystemInfo(SystemInfo& info);
+    void internal_SampleSystem(SystemInfo& info);
+    void sampleCpuStates(SystemInfo& info);
+    void internal_SampleProcesses(SystemInfo& info);
+    void internal_SampleThreads(SystemInfo& info);
+    // tierWork, se dado, recebe o tempo de cada camada (TIER_COUNT entradas,
+    // a da camada 1 << i em i).
+    void sampleTiers(unsigned tiers, TickScheduler::Clock::duration* tierWork = nullptr);
+    void updateDiagnostics(unsigned long long syscallsBefore, unsigned long long allocationsBefore);
+    void publishState(unsigned tiers);
+    void copyState(SystemInfo& target);
+    std::shared_ptr<SystemInfo> acquireSnapshotBuffer();
+    std::shared_ptr<SnapshotDiff> acquireDiffBuffer();
+    void deliverDiff(const std::shared_ptr<const SnapshotDiff>& diff);
+    void publishSnapshot(const std::shared_ptr<SystemInfo>& snapshot);
+
+    std::unique_ptr<Collector> m_collector;
+    // Depois de m_collector: a thread de acoes para antes do coletor sumir.
+    ProcessActionQueue m_actions;
+    RawSample m_sample;
+    SchedulerConfig m_schedulerConfig;
+    // Resultado mais recente de cada camada; so a thread de coleta usa.
+    SystemInfo m_state;
+
+    // Acessado apenas via std::atomic_load/atomic_store.
+    std::shared_ptr<const SystemInfo> m_snapshot;
+    std::atomic<unsigned long long> m_snapshotVersion{ 0 };
+    // Snapshots ja publicados que voltam a ser usados como buffer quando
+    // nenhum leitor os segura mais.
+    std::shared_ptr<SystemInfo> m_recycled[2];
+    // So para acordar quem espera em waitForSnapshot; leitores comuns nao usam.
+    std::mutex m_publishMutex;
+    std::condition_variable m_publishCv;
 
-    SystemInfo m_info;
-    std::mutex m_mutex;
     std::thread m_collectionThread;
     std::atomic<bool> m_running;
 
-    ULARGE_INTEGER m_lastCpuIdle;
-    ULARGE_INTEGER m_lastCpuKernel;
-    ULARGE_INTEGER m_lastCpuUser;
-    ULONGLONG m_lastTotalSystemTime = 0;
-
-    struct ProcessCpuTimes {
-        ULARGE_INTEGER kernelTime;
-        ULARGE_INTEGER userTime;
-    };
-    std::map<unsigned long, ProcessCpuTimes> m_processCpuCache;
-
-    struct ThreadCpuTimes {
-        ULARGE_INTEGER kernelTime;
-        ULARGE_INTEGER userTime;
-    };
-    std::map<unsigned long, ThreadCpuTimes> m_threadCpuCache;
-    std::atomic<unsigned long> m_focusedPid{ 0 };
+    unsigned long long m_lastCpuTotal = 0;
+    unsigned long long m_lastCpuIdle = 0;
+    unsigned long long m_processCpuTotal = 0;
+    unsigned long long m_threadCpuTotal = 0;
+    // Bases da divisao por estado, por nucleo e da pressao (camada do sistema).
+    unsigned long long m_lastCpuStates[RAW_CPU_FIELDS] = {};
+    bool m_hasCpuStates = false;
+    RawCpuCores m_lastCores;
+    RawPressure m_lastPressure[PRESSURE_RESOURCE_COUNT];
+    std::chrono::steady_clock::time_point m_systemSampleWall;
+    bool m_hasSystemSample = false;
+    // Nucleos online; converte % da maquina em % de um nucleo.
+    unsigned m_cpuCoreCount = 1;
+    // Momento da ultima lista de processos, base das taxas por segundo.
+    std::chrono::steady_clock::time_point m_processSampleWall;
+    bool m_hasProcessSample = false;
+
+    // Tempos de CPU e os ProcessCounter de cada processo, mais uma coluna com
+    // a mascara de contadores validos.
+    CpuTimeTable m_processCpuCache{ 256, PROCESS_COUNTER_COUNT + 1 };
+    CpuTimeTable m_threadCpuCache;
+    mutable std::mutex m_focusMutex;
+    std::vector<unsigned long> m_focusedPids;
+    // Copia de m_focusedPids usada pela thread de coleta.
+    std::vector<unsigned long> m_threadPids;
+
+    HistoryStore m_history;
+    ProcessQueryCache m_queryCache;
+    CgroupRollup m_cgroupRollup;
+    AlertEngine m_alerts;
+
+    SnapshotDiffer m_differ;
+    // Diffs reaproveitados quando ninguem mais os segura, como os snapshots.
+    std::shared_ptr<SnapshotDiff> m_diffBuffers[8];
+    size_t m_nextDiffBuffer = 0;
+    // Diff da lista amostrada neste tick, entregue em publishState.
+    std::shared_ptr<const SnapshotDiff> m_pendingDiff;
+    std::mutex m_subscriptionsMutex;
+    std::vector<std::weak_ptr<DiffSubscription>> m_subscriptions;
+
+    // Base para a CPU propria em MonitorDiagnostics.
+    std::chrono::steady_clock::time_point m_startWall;
+    std::chrono::steady_clock::time_point m_selfSampleWall;
+    double m_startCpu = 0.0;
+    double m_selfSampleCpu = 0.0;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "cgroup_linux.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "instrumentation.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+static int openFile(const std::string& path) {
+    instrumentation::countSyscalls();
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+static void closeFile(int fd) {
+    if (fd < 0) return;
+    instrumentation::countSyscalls();
+    close(fd);
+}
+
+static ssize_t readFile(int fd, std::vector<char>& buffer) {
+    if (fd < 0) return -1;
+    for (;;) {
+        instrumentation::countSyscalls();
+        ssize_t n = pread(fd, buffer.data(), buffer.size() - 1, 0);
+        if (n < 0) return -1;
+        if ((size_t)n < buffer.size() - 1) {
+            buffer[n] = '\0';
+            return n;
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+// Linhas "chave valor" do cpu.stat.
+static bool parseKeyValue(const char* text, const char* key, unsigned long long& value) {
+    size_t length = strlen(key);
+    for (const char* line = text; *line != '\0';) {
+        if (strncmp(line, key, length) == 0 && line[length] == ' ') {
+            value = strtoull(line + length + 1, nullptr, 10);
+            return true;
+        }
+        const char* next = strchr(line, '\n');
+        if (next == nullptr) break;
+        line = next + 1;
+    }
+    return false;
+}
+
+// Soma um campo "chave=valor" de todas as linhas (dispositivos) do io.stat.
+static unsigned long long sumField(const char* text, const char* key) {
+    unsigned long long total = 0;
+    size_t length = strlen(key);
+    for (const char* p = strstr(text, key); p != nullptr; p = strstr(p + length, key)) {
+        if (p == text || p[-1] == ' ') {
+            total += strtoull(p + length, nullptr, 10);
+        }
+    }
+    return total;
+}
+
+static bool hasControllers(const std::string& root) {
+    return access((root + "/cgroup.controllers").c_str(), R_OK) == 0;
+}
+
+CgroupReader::CgroupReader(const std::string& root) :
+    m_root(root),
+    m_buffer(4096)
+{
+}
+
+CgroupReader::~CgroupReader() {
+    for (auto& entry : m_groups) {
+        closeGroup(entry.second);
+    }
+}
+
+std::string CgroupReader::findUnifiedRoot() {
+    if (hasControllers("/sys/fs/cgroup")) return "/sys/fs/cgroup";
+    if (hasControllers("/sys/fs/cgroup/unified")) return "/sys/fs/cgroup/unified";
+    return std::string();
+}
+
+CgroupReader::Group& CgroupReader::findGroup(const std::string& path, CollectorStats& stats) {
+    auto it = m_groups.find(path);
+    if (it != m_groups.end()) return it->second;
+
+    Group* parent = nullptr;
+    if (path != "/") {
+        size_t slash = path.rfind('/');
+        parent = &findGroup(slash == 0 || slash == std::string::npos ? std::string("/") : path.substr(0, slash), stats);
+    }
+    Group& group = m_groups[path];
+    group.path = InternedName(path);
+    group.parent = parent;
+    openGroup(group, stats);
+    return group;
+}
+
+void CgroupReader::openGroup(Group& group, CollectorStats& stats) {
+    std::string base = m_root + (group.path.str() == "/" ? std::string() : group.path.str());
+    group.cpuFd = openFile(base + "/cpu.stat");
+    group.memoryFd = openFile(base + "/memory.current");
+    group.memoryMaxFd = openFile(base + "/memory.max");
+    group.ioFd = openFile(base + "/io.stat");
+    stats.handlesOpened++;
+}
+
+void CgroupReader::closeGroup(Group& group) {
+    closeFile(group.cpuFd);
+    closeFile(group.memoryFd);
+    closeFile(group.memoryMaxFd);
+    closeFile(group.ioFd);
+    group.cpuFd = group.memoryFd = group.memoryMaxFd = group.ioFd = -1;
+}
+
+void CgroupReader::readGroup(Group& group, RawCgroupSample& out) {
+    out.path = group.path;
+
+    out.cpuValid = readFile(group.cpuFd, m_buffer) > 0 &&
+        parseKeyValue(m_buffer.data(), "usage_usec", out.cpuUsageUsec);
+    if (out.cpuValid) {
+        out.cpuUserUsec = out.cpuSystemUsec = out.throttledUsec = 0;
+        parseKeyValue(m_buffer.data(), "user_usec", out.cpuUserUsec);
+        parseKeyValue(m_buffer.data(), "system_usec", out.cpuSystemUsec);
+        // So existe com o controlador cpu habilitado no grupo.
+        parseKeyValue(m_buffer.data(), "throttled_usec", out.throttledUsec);
+    }
+
+    out.memoryValid = readFile(group.memoryFd, m_buffer) > 0;
+    if (out.memoryValid) {
+        out.memoryCurrentBytes = strtoull(m_buffer.data(), nullptr, 10);
+        out.memoryMaxBytes = 0;
+        if (readFile(group.memoryMaxFd, m_buffer) > 0 && strncmp(m_buffer.data(), "max", 3) != 0) {
+            out.memoryMaxBytes = strtoull(m_buffer.data(), nullptr, 10);
+        }
+    }
+
+    // Um arquivo vazio e valido: o grupo ainda nao fez I/O.
+    out.ioValid = readFile(group.ioFd, m_buffer) >= 0;
+    if (out.ioValid) {
+        out.ioReadBytes = sumField(m_buffer.data(), "rbytes=");
+        out.ioWriteBytes = sumField(m_buffer.data(), "wbytes=");
+    }
+}
+
+void CgroupReader::sample(std::vector<const std::string*>& paths, std::vector<RawCgroupSample>& out,
+    CollectorStats& stats) {
+    for (auto& entry : m_groups) {
+        entry.second.seen = false;
+    }
+
+    // Processos do mesmo grupo compartilham a string (metadados internados),
+    // entao ordenar por endereco basta para tirar quase todos os repetidos.
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    static const std::string rootPath("/");
+    for (const std::string* path : paths) {
+        Group* group = &findGroup(path->empty() ? rootPath : *path, stats);
+        while (group != nullptr && !group->seen) {
+            group->seen = true;
+            group = group->parent;
+        }
+    }
+
+    size_t count = 0;
+    for (auto it = m_groups.begin(); it != m_groups.end();) {
+        if (!it->second.seen) {
+            closeGroup(it->second);
+            stats.handlesEvicted++;
+            it = m_groups.erase(it);
+            continue;
+        }
+        if (count == out.size()) {
+            out.emplace_back();
+        }
+        readGroup(it->second, out[count++]);
+        ++it;
+    }
+    out.resize(count);
+}
@@ -0,0 +1,52 @@
+#ifndef CGROUP_LINUX_H
+#define CGROUP_LINUX_H
+
+#include "collector.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Le os contadores de cgroups v2 sob uma raiz (o cgroupfs montado ou uma
+// arvore falsa com o mesmo layout). Como no /proc, os arquivos de cada grupo
+// ficam abertos entre ticks e sao relidos com pread.
+class CgroupReader {
+public:
+    explicit CgroupReader(const std::string& root);
+    ~CgroupReader();
+
+    CgroupReader(const CgroupReader&) = delete;
+    CgroupReader& operator=(const CgroupReader&) = delete;
+
+    // Raiz do cgroup v2 do sistema: /sys/fs/cgroup, ou /sys/fs/cgroup/unified
+    // no modo hibrido. Vazio se nao houver.
+    static std::string findUnifiedRoot();
+
+    // Le os grupos de paths (pode ter repetidos; vazio = raiz) e todos os
+    // ancestrais deles. out sai ordenado pelo caminho. Os grupos que nao
+    // aparecem em paths tem os arquivos fechados.
+    void sample(std::vector<const std::string*>& paths, std::vector<RawCgroupSample>& out, CollectorStats& stats);
+
+private:
+    struct Group {
+        InternedName path;
+        Group* parent = nullptr;
+        int cpuFd = -1;
+        int memoryFd = -1;
+        int memoryMaxFd = -1;
+        int ioFd = -1;
+        bool seen = false;
+    };
+
+    Group& findGroup(const std::string& path, CollectorStats& stats);
+    void openGroup(Group& group, CollectorStats& stats);
+    void closeGroup(Group& group);
+    void readGroup(Group& group, RawCgroupSample& out);
+
+    std::string m_root;
+    // Ordenado pelo caminho; os nos do map tem endereco estavel.
+    std::map<std::string, Group> m_groups;
+    std::vector<char> m_buffer;
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "cgroup_rollup.h"
+
+#include <algorithm>
+
+// Listas de processos entre duas compactacoes da arvore.
+static const unsigned COMPACT_LISTS = 64;
+static const uint32_t DROPPED = 0xFFFFFFFFu;
+
+static const std::string& rootPath() {
+    static const std::string path("/");
+    return path;
+}
+
+CgroupRollup::CgroupRollup() {
+    nodeFor(rootPath());
+}
+
+// Os pais sempre sao criados antes dos filhos, entao um no tem indice maior
+// que o do pai (a compactacao depende disso).
+uint32_t CgroupRollup::nodeFor(const std::string& path) {
+    const std::string& key = path.empty() ? rootPath() : path;
+    auto it = m_index.find(key);
+    if (it != m_index.end()) return it->second;
+
+    uint32_t parent = 0;
+    size_t slash = key.rfind('/');
+    if (key != rootPath()) {
+        parent = nodeFor(slash == 0 || slash == std::string::npos ? rootPath() : key.substr(0, slash));
+    }
+
+    uint32_t index = (uint32_t)m_nodes.size();
+    m_nodes.emplace_back();
+    m_raw.emplace_back();
+    CgroupInfo& node = m_nodes.back();
+    node.path = InternedName(key);
+    node.name = key == rootPath() || slash == std::string::npos ? key : key.substr(slash + 1);
+    node.parent = parent;
+    if (index != 0) {
+        node.depth = m_nodes[parent].depth + 1;
+        m_nodes[parent].children.push_back(index);
+    }
+    m_index.emplace(key, index);
+    return index;
+}
+
+void CgroupRollup::apply(uint32_t node, const Contribution& value, int sign) {
+    for (uint32_t n = node;; n = m_nodes[n].parent) {
+        CgroupInfo& info = m_nodes[n];
+        if (sign > 0) {
+            info.processCount++;
+            info.threadCount += value.threads;
+            info.memoryUsedBytes += value.memory;
+        }
+        else {
+            info.processCount--;
+            info.threadCount -= value.threads;
+            info.memoryUsedBytes -= value.memory;
+        }
+        info.cpuUsagePercentage += sign * value.cpu;
+        info.ioReadBytesPerSec += sign * value.ioRead;
+        info.ioWriteBytesPerSec += sign * value.ioWrite;
+        if (n == 0) break;
+    }
+}
+
+void CgroupRollup::addMember(unsigned long pid, Member& member, uint32_t node) {
+    member.node = node;
+    member.slot = (uint32_t)m_nodes[node].pids.size();
+    m_nodes[node].pids.push_back(pid);
+    apply(node, member.value, +1);
+}
+
+void CgroupRollup::removeMember(unsigned long pid, Member& member) {
+    apply(member.node, member.value, -1);
+    std::vector<unsigned long>& pids = m_nodes[member.node].pids;
+    unsigned long last = pids.back();
+    pids[member.slot] = last;
+    pids.pop_back();
+    if (last != pid) {
+        m_members.find(last)->second.slot = member.slot;
+    }
+}
+
+void CgroupRollup::update(const std::vector<ProcessInfo>& processes, const std::vector<RawCgroupSample>& cgroups,
+    double elapsedSeconds) {
+    ++m_generation;
+    m_lastChanged = 0;
+
+    for (const ProcessInfo& p : processes) {
+        Contribution value;
+        value.threads = p.threadCount;
+        value.cpu = p.cpuUsagePercentage;
+        value.memory = p.memoryUsedBytes;
+        value.ioRead = std::max(p.rate(COUNTER_IO_READ_BYTES), 0.0);
+        value.ioWrite = std::max(p.rate(COUNTER_IO_WRITE_BYTES), 0.0);
+
+        // find antes de emplace: emplace aloca o no do mapa mesmo quando o
+        // PID ja existe, e quase todos ja existem.
+        auto it = m_members.find(p.pid);
+        bool isNew = it == m_members.end();
+        if (isNew) {
+            it = m_members.emplace(p.pid, Member()).first;
+        }
+        Member& member = it->second;
+        member.generation = m_generation;
+
+        if (isNew || member.metadata != p.metadata) {
+            // Processo novo, PID reaproveitado ou exec: o grupo pode ser outro.
+            uint32_t node = nodeFor(p.metadata ? p.metadata->cgroup.str() : rootPath());
+            member.metadata = p.metadata;
+            if (!isNew && node == member.node && value == member.value) continue;
+            if (!isNew) {
+                removeMember(p.pid, member);
+            }
+            member.value = value;
+            addMember(p.pid, member, node);
+            ++m_lastChanged;
+        }
+        else if (!(value == member.value)) {
+            apply(member.node, member.value, -1);
+            member.value = value;
+            apply(member.node, member.value, +1);
+            ++m_lastChanged;
+        }
+    }
+
+    for (auto it = m_members.begin(); it != m_members.end();) {
+        if (it->second.generation != m_generation) {
+            removeMember(it->first, it->second);
+            it = m_members.erase(it);
+            ++m_lastChanged;
+        }
+        else {
+            ++it;
+        }
+    }
+
+    for (CgroupInfo& node : m_nodes) {
+        node.cgroupCpuCores = -1.0;
+        node.cgroupThrottledPercentage = -1.0;
+        node.cgroupMemoryBytes = 0;
+        node.cgroupMemoryMaxBytes = 0;
+        node.cgroupIoReadBytesPerSec = -1.0;
+        node.cgroupIoWriteBytesPerSec = -1.0;
+    }
+    for (const RawCgroupSample& raw : cgroups) {
+        applyRaw(raw, elapsedSeconds);
+    }
+
+    if (++m_listsSinceCompaction >= COMPACT_LISTS) {
+        compact();
+        m_changed = true;
+    }
+    if (m_lastChanged > 0 || countersChanged()) {
+        m_changed = true;
+    }
+}
+
+bool CgroupRollup::countersChanged() const {
+    if (!m_published || m_published->size() != m_nodes.size()) return true;
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        const CgroupInfo& a = m_nodes[i];
+        const CgroupInfo& b = (*m_published)[i];
+        if (a.cgroupCpuCores != b.cgroupCpuCores || a.cgroupThrottledPercentage != b.cgroupThrottledPercentage ||
+            a.cgroupMemoryBytes != b.cgroupMemoryBytes || a.cgroupMemoryMaxBytes != b.cgroupMemoryMaxBytes ||
+            a.cgroupIoReadBytesPerSec != b.cgroupIoReadBytesPerSec ||
+            a.cgroupIoWriteBytesPerSec != b.cgroupIoWriteBytesPerSec) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<const std::vector<CgroupInfo>> CgroupRollup::published() {
+    if (m_changed) {
+        m_published = std::make_shared<const std::vector<CgroupInfo>>(m_nodes);
+        m_changed = false;
+    }
+    return m_published;
+}
+
+void CgroupRollup::applyRaw(const RawCgroupSample& raw, double elapsedSeconds) {
+    uint32_t index = nodeFor(raw.path.str());
+    CgroupInfo& node = m_nodes[index];
+    RawBase& base = m_raw[index];
+    const RawCgroupSample& previous = base.sample;
+    bool hasBase = base.generation + 1 == m_generation && elapsedSeconds > 0.0;
+    double elapsedUsec = elapsedSeconds * 1e6;
+
+    if (hasBase && raw.cpuValid && previous.cpuValid && raw.cpuUsageUsec >= previous.cpuUsageUsec) {
+        node.cgroupCpuCores = (double)(raw.cpuUsageUsec - previous.cpuUsageUsec) / elapsedUsec;
+        if (raw.throttledUsec >= previous.throttledUsec) {
+            node.cgroupThrottledPercentage = (double)(raw.throttledUsec - previous.throttledUsec) * 100.0 / elapsedUsec;
+        }
+    }
+    if (raw.memoryValid) {
+        node.cgroupMemoryBytes = raw.memoryCurrentBytes;
+        node.cgroupMemoryMaxBytes = raw.memoryMaxBytes;
+    }
+    if (hasBase && raw.ioValid && previous.ioValid &&
+        raw.ioReadBytes >= previous.ioReadBytes && raw.ioWriteBytes >= previous.ioWriteBytes) {
+        node.cgroupIoReadBytesPerSec = (double)(raw.ioReadBytes - previous.ioReadBytes) / elapsedSeconds;
+        node.cgroupIoWriteBytesPerSec = (double)(raw.ioWriteBytes - previous.ioWriteBytes) / elapsedSeconds;
+    }
+
+    base.generation = m_generation;
+    base.sample = raw;
+}
+
+// Tira os nos sem processos (exceto a raiz), renumera os demais mantendo a
+// ordem e refaz as somas a partir das contribuicoes guardadas.
+void CgroupRollup::compact() {
+    m_listsSinceCompaction = 0;
+    ++m_compactions;
+
+    std::vector<uint32_t> remap(m_nodes.size(), DROPPED);
+    std::vector<CgroupInfo> nodes;
+    std::vector<RawBase> raw;
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        if (i != 0 && m_nodes[i].processCount == 0) continue;
+        remap[i] = (uint32_t)nodes.size();
+        nodes.push_back(std::move(m_nodes[i]));
+        raw.push_back(std::move(m_raw[i]));
+    }
+
+    m_index.clear();
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        CgroupInfo& node = nodes[i];
+        node.parent = remap[node.parent];
+        size_t kept = 0;
+        for (uint32_t child : node.children) {
+            if (remap[child] != DROPPED) node.children[kept++] = remap[child];
+        }
+        node.children.resize(kept);
+
+        node.processCount = 0;
+        node.threadCount = 0;
+        node.cpuUsagePercentage = 0.0;
+        node.memoryUsedBytes = 0;
+        node.ioReadBytesPerSec = 0.0;
+        node.ioWriteBytesPerSec = 0.0;
+        m_index.emplace(node.path.str(), (uint32_t)i);
+    }
+    m_nodes.swap(nodes);
+    m_raw.swap(raw);
+
+    for (auto& entry : m_members) {
+        entry.second.node = remap[entry.second.node];
+        apply(entry.second.node, entry.second.value, +1);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CGROUP_ROLLUP_H
+#define CGROUP_ROLLUP_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "collector.h"
+#include "system_info.h"
+
+// Mantem a arvore de cgroups e os agregados de cada no entre listas de
+// processos. Cada processo lembra a contribuicao que deu na lista anterior;
+// numa lista nova so quem entrou, saiu, mudou de grupo ou de valores mexe
+// nos agregados, e so nos nos do caminho ate a raiz. De tempos em tempos a
+// arvore e compactada (nos sem processos saem) e as somas sao refeitas do
+// zero, o que tambem zera o erro acumulado das somas em ponto flutuante.
+class CgroupRollup {
+public:
+    CgroupRollup();
+
+    // processes: a lista nova; cgroups: leituras dos proprios grupos;
+    // elapsedSeconds: tempo desde a lista anterior (0 = sem base para taxas).
+    void update(const std::vector<ProcessInfo>& processes, const std::vector<RawCgroupSample>& cgroups,
+        double elapsedSeconds);
+
+    const std::vector<CgroupInfo>& nodes() const { return m_nodes; }
+    // Copia imutavel da arvore para os snapshots, refeita so quando a ultima
+    // lista mudou algum no; senao devolve a mesma da lista anterior.
+    std::shared_ptr<const std::vector<CgroupInfo>> published();
+    // Processos que mexeram nos agregados na ultima lista.
+    size_t lastChanged() const { return m_lastChanged; }
+    unsigned long long compactions() const { return m_compactions; }
+
+private:
+    struct Contribution {
+        unsigned long threads = 0;
+        double cpu = 0.0;
+        unsigned long long memory = 0;
+        double ioRead = 0.0;
+        double ioWrite = 0.0;
+
+        bool operator==(const Contribution& other) const {
+            return threads == other.threads && cpu == other.cpu && memory == other.memory &&
+                ioRead == other.ioRead && ioWrite == other.ioWrite;
+        }
+    };
+
+    struct Member {
+        uint32_t node = 0;
+        // Posicao do PID em CgroupInfo::pids do no.
+        uint32_t slot = 0;
+        uint32_t generation = 0;
+        // O grupo so e procurado de novo quando os metadados mudam.
+        ProcessMetadataRef metadata;
+        Contribution value;
+    };
+
+    // Contadores lidos do cgroup na lista anterior, base das taxas.
+    struct RawBase {
+        uint32_t generation = 0;
+        RawCgroupSample sample;
+    };
+
+    uint32_t nodeFor(const std::string& path);
+    // sign = +1 soma a contribuicao no no e nos ancestrais, -1 subtrai.
+    void apply(uint32_t node, const Contribution& value, int sign);
+    void addMember(unsigned long pid, Member& member, uint32_t node);
+    void removeMember(unsigned long pid, Member& member);
+    void applyRaw(const RawCgroupSample& raw, double elapsedSeconds);
+    void compact();
+    // true se os contadores lidos dos grupos diferem dos publicados.
+    bool countersChanged() const;
+
+    std::vector<CgroupInfo> m_nodes;
+    std::vector<RawBase> m_raw;
+    std::unordered_map<std::string, uint32_t> m_index;
+    std::unordered_map<unsigned long, Member> m_members;
+    uint32_t m_generation = 0;
+    unsigned m_listsSinceCompaction = 0;
+    size_t m_lastChanged = 0;
+    unsigned long long m_compactions = 0;
+    std::shared_ptr<const std::vector<CgroupInfo>> m_published;
+    bool m_changed = true;
+};
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "system_info.h"
+
+// Leituras brutas de um tick, sem nenhuma conta de delta. Os tempos de CPU
+// estao na unidade nativa da plataforma (100ns no Windows, clock ticks no
+// Linux); o SystemMonitor so usa razoes entre eles, entao a unidade se cancela.
+struct RawProcessSample {
+    unsigned long pid = 0;
+    unsigned long long startTime = 0;
+    // Compartilhado enquanto o processo (PID + startTime) for o mesmo.
+    ProcessMetadataRef metadata;
+    bool accessible = false;
+    bool timesValid = false;
+    unsigned long long memoryUsedBytes = 0;
+    unsigned long long kernelTime = 0;
+    unsigned long long userTime = 0;
+    unsigned long threadCount = 0;
+    // Valores cumulativos de cada ProcessCounter; so os bits de countersValid
+    // foram lidos.
+    unsigned long long counters[PROCESS_COUNTER_COUNT] = {};
+    unsigned countersValid = 0;
+};
+
+struct RawThreadSample {
+    unsigned long tid = 0;
+    bool timesValid = false;
+    unsigned long long kernelTime = 0;
+    unsigned long long userTime = 0;
+};
+
+// Contadores de um cgroup v2, lidos dos arquivos do proprio grupo (valem
+// para o grupo e todos os descendentes, inclusive processos que ja sairam).
+struct RawCgroupSample {
+    InternedName path;
+    // cpu.stat
+    bool cpuValid = false;
+    unsigned long long cpuUsageUsec = 0;
+    unsigned long long cpuUserUsec = 0;
+    unsigned long long cpuSystemUsec = 0;
+    unsigned long long throttledUsec = 0;
+    // memory.current e memory.max (0 = sem limite); a raiz nao tem.
+    bool memoryValid = false;
+    unsigned long long memoryCurrentBytes = 0;
+    unsigned long long memoryMaxBytes = 0;
+    // io.stat, somando todos os dispositivos.
+    bool ioValid = false;
+    unsigned long long ioReadBytes = 0;
+    unsigned long long ioWriteBytes = 0;
+};
+
+// Campos crus de tempo de CPU: os CpuState e, por ultimo, o ocioso.
+const unsigned RAW_CPU_IDLE = CPU_STATE_COUNT;
+const unsigned RAW_CPU_FIELDS = CPU_STATE_COUNT + 1;
+
+// Tempos cumulativos de cada nucleo, no mesmo layout SoA de CpuCoreUsage.
+struct RawCpuCores {
+    // Nucleos guardados (ate MAX_CPU_CORES) e nucleos online, todos contados.
+    unsigned count = 0;
+    unsigned online = 0;
+    uint16_t id[MAX_CPU_CORES] = {};
+    unsigned long long times[RAW_CPU_FIELDS][MAX_CPU_CORES] = {};
+};
+
+struct RawPressure {
+    bool valid = false;
+    bool hasFull = false;
+    double someAvg[3] = {};
+    double fullAvg[3] = {};
+    unsigned long long someTotalUsec = 0;
+    unsigned long long fullTotalUsec = 0;
+};
+
+struct RawFocusedProcess {
+    unsigned long pid = 0;
+    std::vector<RawThreadSample> threads;
+};
+
+struct RawSample {
+    bool memoryValid = false;
+    unsigned long long ramTotalBytes = 0;
+    unsigned long long ramUsedBytes = 0;
+    double ramUsagePercentage = 0.0;
+
+    bool cpuValid = false;
+    unsigned long long cpuTotalTime = 0;
+    unsigned long long cpuIdleTime = 0;
+    // Divisao de cpuTotalTime por estado e por nucleo (cores.count == 0 se a
+    // plataforma nao separar).
+    unsigned long long cpuStateTimes[RAW_CPU_FIELDS] = {};
+    RawCpuCores cores;
+    RawPressure pressure[PRESSURE_RESOURCE_COUNT];
+
+    std::vector<RawProcessSample> processes;
+    // Saidas percebidas desde a amostragem anterior da lista.
+    std::vector<ProcessExit> exits;
+    // Cgroups dos processos da lista e os ancestrais deles, ordenados pelo
+    // caminho (pais antes dos filhos). Vazio sem cgroup v2.
+    std::vector<RawCgroupSample> cgroups;
+    // Uma entrada por processo em foco que ainda existe.
+    std::vector<RawFocusedProcess> focused;
+
+    // Contadores desde a ultima amostragem da lista de processos
+    // (handles/fds reaproveitados entre ticks).
+    CollectorStats stats;
+    std::vector<ShardStats> shards;
+    // Fases medidas pelo coletor (enumeracao e leitura dos processos); o
+    // SystemMonitor limpa no inicio de cada tick.
+    PhaseTimings timings;
+};
+
+// Sinais de controle de processo. PROBE nao envia nada: so confere se o
+// processo ainda existe.
+enum ProcessSignal {
+    SIGNAL_PROBE,
+    // Pede para o processo sair (SIGTERM); onde nao ha pedido gracioso, e
+    // UNSUPPORTED e quem chama parte para o KILL.
+    SIGNAL_TERMINATE,
+    SIGNAL_KILL
+};
+
+enum SignalResult {
+    SIGNAL_SENT,
+    // O processo nao existe mais (ou o PID ja e de outro processo).
+    SIGNAL_GONE,
+    SIGNAL_DENIED,
+    SIGNAL_UNSUPPORTED,
+    SIGNAL_FAILED
+};
+
+class Collector {
+public:
+    virtual ~Collector() = default;
+
+    virtual bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) = 0;
+    // As camadas sao independentes para o SystemMonitor poder amostrar cada
+    // uma no seu proprio ritmo. Cada uma so escreve os campos dela em out.
+    // sampleSystem: memoria, tempos de CPU (totais, por estado e por nucleo)
+    // e pressao.
+    virtual void sampleSystem(RawSample& out) = 0;
+    // sampleProcesses: processes, exits, cgroups, stats e shards.
+    virtual void sampleProcesses(RawSample& out) = 0;
+    // sampleThreads: focused, com as threads de cada processo de pids (vazio
+    // = nenhum, libera os recursos); soma os proprios contadores em stats.
+    virtual void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) = 0;
+    // Liga a fonte de eventos de criacao/exec/saida de processos, se a
+    // plataforma e as permissoes permitirem; senao a lista continua sendo
+    // descoberta por varredura. Chamar antes da primeira amostragem.
+    virtual bool enableLifecycleEvents() { return false; }
+    virtual ExtraProcessInfo readExtraProcessInfo(unsigned long pid) = 0;
+    // Envia o sinal se pid ainda for o processo iniciado em startTime (na
+    // unidade de RawProcessSample::startTime; 0 = nao confere). Nao guarda
+    // estado: pode ser chamado de qualquer thread durante as amostragens.
+    virtual SignalResult signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) = 0;
+    // startTime do processo vivo com este PID, para prender a ele os sinais
+    // seguintes; 0 se nao existe (ou ja e zumbi) ou nao da para ler.
+    virtual unsigned long long readStartTime(unsigned long pid) = 0;
+    // Relogio das leituras. O SystemMonitor o consulta logo depois de
+    // sampleSystem e sampleProcesses para medir o intervalo das taxas; quem
+    // reproduz leituras gravadas devolve o momento da gravacao.
+    virtual std::chrono::steady_clock::time_point now() { return std::chrono::steady_clock::now(); }
+
+    // Todas as camadas de uma vez.
+    void sample(RawSample& out, const std::vector<unsigned long>& focusedPids) {
+        sampleSystem(out);
+        sampleProcesses(out);
+        sampleThreads(out, focusedPids);
+    }
+};
+
+// samplingThreads: tamanho do pool que amostra os processos em paralelo
+// (0 = padrao da plataforma).
+std::unique_ptr<Collector> createPlatformCollector(unsigned samplingThreads = 0);
+
+#endif
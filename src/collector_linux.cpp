@@ -0,0 +1,924 @@
+#include "collector_linux.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "instrumentation.h"
+#include "util.h"
+
+#include <fcntl.h>
+#include <pwd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static bool isPidName(const char* name) {
+    if (*name == '\0') return false;
+    for (const char* c = name; *c; ++c) {
+        if (*c < '0' || *c > '9') return false;
+    }
+    return true;
+}
+
+static unsigned long long parseLabeledValue(const char* text, const char* label) {
+    const char* p = strstr(text, label);
+    if (p == nullptr) return 0;
+    return strtoull(p + strlen(label), nullptr, 10);
+}
+
+// /proc/<pid>/stat: "pid (comm) state campo4 campo5 ...". O comm pode conter
+// espacos e parenteses, entao os campos numericos comecam apos o ultimo ')'.
+// fields[i] recebe o campo (i + 4) da documentacao do proc(5).
+static bool parseStat(const char* text, std::string* name, unsigned long long* fields, int count) {
+    const char* open = strchr(text, '(');
+    const char* close = strrchr(text, ')');
+    if (open == nullptr || close == nullptr || close < open) return false;
+    if (name != nullptr) {
+        name->assign(open + 1, close);
+    }
+
+    const char* p = close + 1;
+    while (*p == ' ') ++p;
+    while (*p != ' ' && *p != '\0') ++p;
+
+    for (int i = 0; i < count; ++i) {
+        char* end;
+        fields[i] = strtoull(p, &end, 10);
+        if (end == p) return false;
+        p = end;
+    }
+    return true;
+}
+
+enum StatField {
+    STAT_PPID = 0,
+    STAT_MINFLT = 6,
+    STAT_MAJFLT = 8,
+    STAT_UTIME = 10,
+    STAT_STIME = 11,
+    STAT_PRIORITY = 14,
+    STAT_NICE = 15,
+    STAT_NUM_THREADS = 16,
+    STAT_STARTTIME = 18,
+    STAT_FIELD_COUNT = 19
+};
+
+// priority < 0 no stat indica politica de tempo real (priority = -1 -
+// prioridade RT); nas demais vale o nice.
+static std::string describePriority(long long priority, long long nice) {
+    char text[48];
+    if (priority < 0) {
+        snprintf(text, sizeof(text), "tempo real (%lld)", -1 - priority);
+    }
+    else if (nice < 0) {
+        snprintf(text, sizeof(text), "alta (nice %lld)", nice);
+    }
+    else if (nice > 0) {
+        snprintf(text, sizeof(text), "baixa (nice %lld)", nice);
+    }
+    else {
+        snprintf(text, sizeof(text), "normal (nice 0)");
+    }
+    return text;
+}
+
+// Linha "cpu..." do /proc/stat depois do rotulo: user nice system idle iowait
+// irq softirq steal (guest e guest_nice ja estao somados em user e nice).
+// Devolve o fim do que foi lido.
+static const char* parseCpuLine(const char* p, unsigned long long values[8]) {
+    for (int i = 0; i < 8; ++i) {
+        char* end;
+        values[i] = strtoull(p, &end, 10);
+        if (end == p) {
+            std::fill(values + i, values + 8, 0ull);
+            break;
+        }
+        p = end;
+    }
+    return p;
+}
+
+static void splitCpuTimes(const unsigned long long values[8], unsigned long long* fields, size_t stride) {
+    fields[CPU_STATE_USER * stride] = values[0] + values[1];
+    fields[CPU_STATE_SYSTEM * stride] = values[2];
+    fields[RAW_CPU_IDLE * stride] = values[3];
+    fields[CPU_STATE_IOWAIT * stride] = values[4];
+    fields[CPU_STATE_IRQ * stride] = values[5] + values[6];
+    fields[CPU_STATE_STEAL * stride] = values[7];
+}
+
+// Linhas cpuN do /proc/stat (text aponta para o arquivo inteiro).
+static void parseCpuCores(const char* text, RawCpuCores& cores) {
+    cores.count = cores.online = 0;
+    for (const char* line = strchr(text, '\n'); line != nullptr; line = strchr(line, '\n')) {
+        ++line;
+        if (strncmp(line, "cpu", 3) != 0 || line[3] < '0' || line[3] > '9') break;
+        char* end;
+        unsigned long id = strtoul(line + 3, &end, 10);
+        cores.online++;
+        if (cores.count == MAX_CPU_CORES) continue;
+        unsigned long long values[8];
+        line = parseCpuLine(end, values);
+        cores.id[cores.count] = (uint16_t)id;
+        splitCpuTimes(values, &cores.times[0][cores.count], MAX_CPU_CORES);
+        cores.count++;
+    }
+}
+
+// "some avg10=0.12 avg60=0.05 avg300=0.01 total=123456" e a linha full.
+static bool parsePressureLine(const char* text, const char* kind, double avg[3], unsigned long long& totalUsec) {
+    const char* line = strstr(text, kind);
+    if (line == nullptr) return false;
+    static const char* const labels[] = { "avg10=", "avg60=", "avg300=" };
+    for (int i = 0; i < 3; ++i) {
+        const char* p = strstr(line, labels[i]);
+        if (p == nullptr) return false;
+        avg[i] = strtod(p + strlen(labels[i]), nullptr);
+    }
+    const char* total = strstr(line, "total=");
+    if (total == nullptr) return false;
+    totalUsec = strtoull(total + 6, nullptr, 10);
+    return true;
+}
+
+static const size_t SAMPLE_CHUNK = 16;
+// Com eventos de ciclo de vida, /proc ainda e varrido a cada tantos ticks da
+// lista de processos para corrigir qualquer divergencia.
+static const unsigned RESCAN_TICKS = 60;
+// Amostragens que uma saida registrada por varredura espera pelo EXIT.
+static const unsigned REPORTED_EXIT_TICKS = 8;
+
+static void closeFile(int fd) {
+    if (fd < 0) return;
+    instrumentation::countSyscalls();
+    close(fd);
+}
+
+// Reposiciona e relista um diretorio aberto: lseek + getdents (um so, exceto
+// em diretorios muito grandes).
+static void rewindDirectory(DIR* dir) {
+    instrumentation::countSyscalls(2);
+    rewinddir(dir);
+}
+
+LinuxCollector::LinuxCollector(const std::string& procRoot, unsigned samplingThreads, const std::string& cgroupRoot) :
+    m_root(procRoot),
+    m_buffer(4096),
+    m_pool(samplingThreads),
+    m_workerBuffers(m_pool.size(), std::vector<char>(4096)),
+    m_workerNames(m_pool.size()),
+    m_extraBuffer(4096)
+{
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize > 0) {
+        m_pageSize = pageSize;
+    }
+    long clockTicks = sysconf(_SC_CLK_TCK);
+    if (clockTicks > 0) {
+        m_clockTicks = clockTicks;
+    }
+    // Ate quatro fds por processo; sobra uma folga para o resto do programa.
+    // O limite flexivel costuma ser 1024, entao sobe ate o rigido.
+    struct rlimit limit;
+    bool limited = getrlimit(RLIMIT_NOFILE, &limit) == 0;
+    if (limited && limit.rlim_cur < limit.rlim_max) {
+        struct rlimit raised = limit;
+        raised.rlim_cur = limit.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0) {
+            limit = raised;
+        }
+    }
+    if (limited && limit.rlim_cur != RLIM_INFINITY) {
+        long available = (long)limit.rlim_cur;
+        m_fdBudget = available > 1024 ? available - 512 : available / 2;
+    }
+    m_statFd = openFile(m_root + "/stat");
+    m_meminfoFd = openFile(m_root + "/meminfo");
+    // Sem CONFIG_PSI (ou com psi=0) os arquivos nao existem e a pressao fica
+    // invalida.
+    static const char* const pressureFiles[PRESSURE_RESOURCE_COUNT] = { "/pressure/cpu", "/pressure/memory", "/pressure/io" };
+    for (int resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+        m_pressureFds[resource] = openFile(m_root + pressureFiles[resource]);
+    }
+    m_procDir = opendir(m_root.c_str());
+
+    std::string cgroups = cgroupRoot.empty() && m_root == "/proc" ? CgroupReader::findUnifiedRoot() : cgroupRoot;
+    if (!cgroups.empty()) {
+        m_cgroups.reset(new CgroupReader(cgroups));
+    }
+}
+
+LinuxCollector::~LinuxCollector() {
+    for (auto& entry : m_procFiles) {
+        closeProcFiles(entry.second);
+    }
+    for (auto& entry : m_focused) {
+        closeFocusedTasks(entry.second);
+    }
+    if (m_procDir != nullptr) closedir(m_procDir);
+    closeFile(m_statFd);
+    closeFile(m_meminfoFd);
+    for (int fd : m_pressureFds) {
+        closeFile(fd);
+    }
+    closeFile(m_extraStatFd);
+    closeFile(m_extraIoFd);
+}
+
+int LinuxCollector::openFile(const std::string& path) {
+    instrumentation::countSyscalls();
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+ssize_t LinuxCollector::readFile(int fd, std::vector<char>& buffer) {
+    if (fd < 0) return -1;
+    for (;;) {
+        instrumentation::countSyscalls();
+        ssize_t n = pread(fd, buffer.data(), buffer.size() - 1, 0);
+        if (n < 0) return -1;
+        if ((size_t)n < buffer.size() - 1) {
+            buffer[n] = '\0';
+            return n;
+        }
+        buffer.resize(buffer.size() * 2);
+    }
+}
+
+static long openCount(int a, int b, int c, int d) {
+    return (a >= 0) + (b >= 0) + (c >= 0) + (d >= 0);
+}
+
+void LinuxCollector::closeProcFiles(ProcFiles& files) {
+    long opened = openCount(files.statFd, files.statmFd, files.ioFd, files.statusFd);
+    closeFile(files.statFd);
+    closeFile(files.statmFd);
+    closeFile(files.ioFd);
+    closeFile(files.statusFd);
+    files.statFd = -1;
+    files.statmFd = -1;
+    files.ioFd = -1;
+    files.statusFd = -1;
+    m_cachedFds.fetch_sub(opened, std::memory_order_relaxed);
+}
+
+void LinuxCollector::openProcFiles(unsigned long pid, ProcFiles& files, CollectorStats& stats) {
+    std::string base = m_root + "/" + std::to_string(pid);
+    files.statFd = openFile(base + "/stat");
+    files.statmFd = openFile(base + "/statm");
+    files.ioFd = openFile(base + "/io");
+    files.statusFd = openFile(base + "/status");
+    m_cachedFds.fetch_add(openCount(files.statFd, files.statmFd, files.ioFd, files.statusFd), std::memory_order_relaxed);
+    stats.handlesOpened++;
+}
+
+bool LinuxCollector::readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) {
+    if (readFile(m_statFd, m_buffer) <= 0) return false;
+
+    // cpu  user nice system idle iowait irq softirq steal guest guest_nice
+    const char* p = m_buffer.data();
+    if (strncmp(p, "cpu ", 4) != 0) return false;
+
+    unsigned long long values[8];
+    parseCpuLine(p + 4, values);
+    totalTime = 0;
+    for (unsigned long long v : values) totalTime += v;
+    idleTime = values[3] + values[4];
+    return true;
+}
+
+// Os fds ficam presos ao processo que existia quando foram abertos: se ele
+// saiu, o pread falha com ESRCH mesmo que o PID ja tenha sido reutilizado.
+// Nesse caso (ou se o starttime mudou) os arquivos sao reabertos uma vez.
+bool LinuxCollector::sampleProcess(unsigned long pid, ProcFiles& files, RawProcessSample& proc,
+    std::vector<char>& buffer, std::string& name, CollectorStats& stats) {
+    unsigned long long fields[STAT_FIELD_COUNT];
+    bool cached = files.statFd >= 0;
+    if (!cached) {
+        openProcFiles(pid, files, stats);
+    }
+
+    bool parsed = readFile(files.statFd, buffer) > 0 &&
+        parseStat(buffer.data(), &name, fields, STAT_FIELD_COUNT);
+    bool reused = parsed && cached && files.startTime != fields[STAT_STARTTIME];
+
+    if (cached && (!parsed || reused)) {
+        closeProcFiles(files);
+        stats.handlesEvicted++;
+        openProcFiles(pid, files, stats);
+        cached = false;
+        parsed = readFile(files.statFd, buffer) > 0 &&
+            parseStat(buffer.data(), &name, fields, STAT_FIELD_COUNT);
+    }
+    if (!parsed) return false;
+
+    if (cached) {
+        // open + close de cada arquivo mantido aberto
+        stats.syscallsSaved += 2 * (unsigned long long)openCount(files.statFd, files.statmFd, files.ioFd, files.statusFd);
+    }
+    if (files.startTime != fields[STAT_STARTTIME]) {
+        files.startTime = fields[STAT_STARTTIME];
+        files.metadata.reset();
+    }
+
+    // O comm muda num exec e o ppid quando o pai sai; fora isso os metadados
+    // valem pela vida toda do processo.
+    unsigned long parentPid = (unsigned long)fields[STAT_PPID];
+    if (!files.metadata || files.metadata->parentPid != parentPid || files.metadata->name.str() != name) {
+        files.metadata = loadMetadata(pid, name, parentPid, buffer);
+        stats.metadataLoads++;
+    }
+
+    proc.pid = pid;
+    proc.metadata = files.metadata;
+    proc.memoryUsedBytes = 0;
+    proc.accessible = true;
+    proc.timesValid = true;
+    proc.userTime = fields[STAT_UTIME];
+    proc.kernelTime = fields[STAT_STIME];
+    proc.startTime = fields[STAT_STARTTIME];
+    proc.threadCount = (unsigned long)fields[STAT_NUM_THREADS];
+    proc.counters[COUNTER_MINOR_FAULTS] = fields[STAT_MINFLT];
+    proc.counters[COUNTER_MAJOR_FAULTS] = fields[STAT_MAJFLT];
+    proc.countersValid = processCounterBit(COUNTER_MINOR_FAULTS) | processCounterBit(COUNTER_MAJOR_FAULTS);
+
+    if (readFile(files.statmFd, buffer) > 0) {
+        char* end;
+        strtoull(buffer.data(), &end, 10);
+        unsigned long long residentPages = strtoull(end, nullptr, 10);
+        proc.memoryUsedBytes = residentPages * (unsigned long long)m_pageSize;
+    }
+    // Bytes que de fato foram ao dispositivo de bloco (sem cache de pagina).
+    if (readFile(files.ioFd, buffer) > 0 && strstr(buffer.data(), "read_bytes:") != nullptr) {
+        proc.counters[COUNTER_IO_READ_BYTES] = parseLabeledValue(buffer.data(), "\nread_bytes:");
+        proc.counters[COUNTER_IO_WRITE_BYTES] = parseLabeledValue(buffer.data(), "\nwrite_bytes:");
+        proc.countersValid |= processCounterBit(COUNTER_IO_READ_BYTES) | processCounterBit(COUNTER_IO_WRITE_BYTES);
+    }
+    if (readFile(files.statusFd, buffer) > 0 && strstr(buffer.data(), "ctxt_switches:") != nullptr) {
+        proc.counters[COUNTER_VOLUNTARY_SWITCHES] = parseLabeledValue(buffer.data(), "\nvoluntary_ctxt_switches:");
+        proc.counters[COUNTER_INVOLUNTARY_SWITCHES] = parseLabeledValue(buffer.data(), "\nnonvoluntary_ctxt_switches:");
+        proc.countersValid |= processCounterBit(COUNTER_VOLUNTARY_SWITCHES) | processCounterBit(COUNTER_INVOLUNTARY_SWITCHES);
+    }
+    files.lastKernel = proc.kernelTime;
+    files.lastUser = proc.userTime;
+    files.peakRss = std::max(files.peakRss, proc.memoryUsedBytes);
+
+    // Acima do orcamento de descritores o processo e lido sem cache: os fds
+    // abertos neste tick sao fechados e reabertos no proximo.
+    if (!cached && m_cachedFds.load(std::memory_order_relaxed) > m_fdBudget) {
+        closeProcFiles(files);
+    }
+    return true;
+}
+
+ProcessMetadataRef LinuxCollector::loadMetadata(unsigned long pid, const std::string& name, unsigned long parentPid,
+    std::vector<char>& buffer) {
+    std::shared_ptr<ProcessMetadata> metadata = std::make_shared<ProcessMetadata>();
+    metadata->name = m_names.intern(name);
+    metadata->parentPid = parentPid;
+
+    std::string base = m_root + "/" + std::to_string(pid);
+    instrumentation::countSyscalls();
+    ssize_t n = readlink((base + "/exe").c_str(), buffer.data(), buffer.size());
+    if (n > 0) {
+        metadata->executablePath.assign(buffer.data(), (size_t)n);
+    }
+
+    // Argumentos separados por '\0'; threads de kernel nao tem nenhum.
+    int fd = openFile(base + "/cmdline");
+    n = readFile(fd, buffer);
+    if (n > 0) {
+        size_t length = (size_t)n;
+        while (length > 0 && buffer[length - 1] == '\0') --length;
+        std::replace(buffer.begin(), buffer.begin() + length, '\0', ' ');
+        metadata->commandLine.assign(buffer.data(), length);
+    }
+    closeFile(fd);
+
+    fd = openFile(base + "/status");
+    if (readFile(fd, buffer) > 0 && strstr(buffer.data(), "Uid:") != nullptr) {
+        metadata->user = lookupUser((unsigned)parseLabeledValue(buffer.data(), "Uid:"));
+    }
+    closeFile(fd);
+
+    // Uma linha por hierarquia; a do cgroup v2 e "0::<caminho>".
+    if (m_cgroups) {
+        fd = openFile(base + "/cgroup");
+        if (readFile(fd, buffer) > 0) {
+            const char* line = buffer.data();
+            const char* unified = strncmp(line, "0::", 3) == 0 ? line : strstr(line, "\n0::");
+            if (unified != nullptr) {
+                unified += *unified == '\n' ? 4 : 3;
+                const char* end = strchr(unified, '\n');
+                metadata->cgroup = m_names.intern(std::string(unified, end != nullptr ? end : unified + strlen(unified)));
+            }
+        }
+        closeFile(fd);
+    }
+
+    return metadata;
+}
+
+InternedName LinuxCollector::lookupUser(unsigned uid) {
+    std::lock_guard<std::mutex> lock(m_usersMutex);
+    auto it = m_users.find(uid);
+    if (it != m_users.end()) {
+        return it->second;
+    }
+
+    long size = sysconf(_SC_GETPW_R_SIZE_MAX);
+    std::vector<char> buffer(size > 0 ? (size_t)size : 16384);
+    struct passwd pwd;
+    struct passwd* result = nullptr;
+    std::string userName = getpwuid_r((uid_t)uid, &pwd, buffer.data(), buffer.size(), &result) == 0 && result != nullptr ?
+        std::string(pwd.pw_name) : std::to_string(uid);
+
+    InternedName interned = m_names.intern(userName);
+    m_users.emplace(uid, interned);
+    return interned;
+}
+
+void LinuxCollector::sampleSystem(RawSample& out) {
+    out.memoryValid = false;
+    if (readFile(m_meminfoFd, m_buffer) > 0) {
+        unsigned long long totalKb = parseLabeledValue(m_buffer.data(), "MemTotal:");
+        unsigned long long availableKb = parseLabeledValue(m_buffer.data(), "MemAvailable:");
+        if (availableKb == 0) {
+            availableKb = parseLabeledValue(m_buffer.data(), "MemFree:");
+        }
+        if (totalKb > 0) {
+            out.memoryValid = true;
+            out.ramTotalBytes = totalKb * 1024;
+            out.ramUsedBytes = (totalKb - availableKb) * 1024;
+            out.ramUsagePercentage = (double)(totalKb - availableKb) * 100.0 / totalKb;
+        }
+    }
+
+    // readCpuTimes deixa o /proc/stat em m_buffer: a divisao por estado e as
+    // linhas de cada nucleo saem da mesma leitura.
+    out.cpuValid = readCpuTimes(out.cpuTotalTime, out.cpuIdleTime);
+    out.cores.count = out.cores.online = 0;
+    if (out.cpuValid) {
+        unsigned long long values[8];
+        parseCpuLine(m_buffer.data() + 4, values);
+        splitCpuTimes(values, out.cpuStateTimes, 1);
+        parseCpuCores(m_buffer.data(), out.cores);
+    }
+
+    for (int resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+        RawPressure& pressure = out.pressure[resource];
+        pressure.valid = readFile(m_pressureFds[resource], m_buffer) > 0 &&
+            parsePressureLine(m_buffer.data(), "some ", pressure.someAvg, pressure.someTotalUsec);
+        pressure.hasFull = pressure.valid &&
+            parsePressureLine(m_buffer.data(), "full ", pressure.fullAvg, pressure.fullTotalUsec);
+    }
+}
+
+void LinuxCollector::sampleProcesses(RawSample& out) {
+    out.stats = CollectorStats();
+    out.exits.clear();
+
+    if (m_procDir == nullptr) {
+        out.processes.clear();
+        out.stats.cachedHandles = cachedHandleCount();
+        return;
+    }
+
+    for (auto& entry : m_procFiles) {
+        entry.second.seen = false;
+    }
+
+    // Todas as insercoes em m_procFiles acontecem aqui; depois disso os
+    // ponteiros para os elementos ficam estaveis durante a fase paralela.
+    m_pids.clear();
+    m_pidFiles.clear();
+    {
+        ScopedPhaseTimer timer(out.timings, PHASE_ENUMERATE);
+        bool rescan = true;
+        if (m_events) {
+            out.stats.eventDriven = true;
+            bool lost = applyEvents(out);
+            rescan = lost || ++m_ticksSinceRescan >= RESCAN_TICKS;
+        }
+
+        if (rescan) {
+            if (m_events) {
+                out.stats.rescans++;
+                m_ticksSinceRescan = 0;
+            }
+            rewindDirectory(m_procDir);
+            while (dirent* ent = readdir(m_procDir)) {
+                if (!isPidName(ent->d_name)) continue;
+
+                unsigned long pid = strtoul(ent->d_name, nullptr, 10);
+                m_pids.push_back(pid);
+                m_pidFiles.push_back(&m_procFiles[pid]);
+            }
+        }
+        else {
+            // O conjunto ja esta atualizado pelos eventos: nada de readdir.
+            for (auto& entry : m_procFiles) {
+                m_pids.push_back(entry.first);
+                m_pidFiles.push_back(&entry.second);
+            }
+        }
+    }
+
+    ScopedPhaseTimer readTimer(out.timings, PHASE_PROCESS_READ);
+    out.processes.resize(m_pids.size());
+    m_workerStats.assign(m_pool.size(), CollectorStats());
+    m_pool.run(m_pids.size(), SAMPLE_CHUNK, [this, &out](unsigned worker, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ProcFiles& files = *m_pidFiles[i];
+            RawProcessSample& proc = out.processes[i];
+            files.seen = sampleProcess(m_pids[i], files, proc, m_workerBuffers[worker],
+                m_workerNames[worker], m_workerStats[worker]);
+            if (!files.seen) {
+                proc.pid = 0;
+            }
+            else {
+                files.listed = true;
+            }
+        }
+        }, &out.shards);
+
+    for (const CollectorStats& stats : m_workerStats) {
+        out.stats.handlesOpened += stats.handlesOpened;
+        out.stats.handlesEvicted += stats.handlesEvicted;
+        out.stats.syscallsSaved += stats.syscallsSaved;
+        out.stats.metadataLoads += stats.metadataLoads;
+    }
+
+    // Remove os processos que sairam durante a leitura, mantendo a ordem da
+    // enumeracao.
+    out.processes.erase(std::remove_if(out.processes.begin(), out.processes.end(),
+        [](const RawProcessSample& proc) { return proc.pid == 0; }), out.processes.end());
+
+    if (m_cgroups) {
+        m_cgroupPaths.clear();
+        for (const RawProcessSample& proc : out.processes) {
+            m_cgroupPaths.push_back(&proc.metadata->cgroup.str());
+        }
+        m_cgroups->sample(m_cgroupPaths, out.cgroups, out.stats);
+    }
+    else {
+        out.cgroups.clear();
+    }
+
+    // Quem ja tinha aparecido numa lista e sumiu saiu (com os ultimos
+    // valores lidos). Com eventos, o EXIT dele chega depois e e ignorado.
+    for (auto it = m_procFiles.begin(); it != m_procFiles.end();) {
+        if (!it->second.seen) {
+            if (it->second.statFd >= 0) {
+                out.stats.handlesEvicted++;
+            }
+            if (it->second.listed) {
+                recordExit(it->first, &it->second, nullptr, out.exits);
+                if (m_events) {
+                    ReportedExit reported;
+                    reported.pid = it->first;
+                    m_reportedExits.push_back(reported);
+                }
+            }
+            closeProcFiles(it->second);
+            it = m_procFiles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    m_names.purge();
+    out.stats.cachedHandles = cachedHandleCount();
+}
+
+bool LinuxCollector::enableLifecycleEvents() {
+    // Os eventos falam dos processos reais; uma arvore falsa nao tem eventos.
+    if (m_root != "/proc") return false;
+    if (m_events) return true;
+
+    std::unique_ptr<ProcEventListener> events(new ProcEventListener());
+    if (!events->start()) return false;
+    m_events = std::move(events);
+    // A primeira amostragem varre /proc para montar o conjunto inicial.
+    m_ticksSinceRescan = RESCAN_TICKS;
+    return true;
+}
+
+// Aplica os eventos pendentes a m_procFiles: FORK inclui o processo (lido ja
+// nesta amostragem), EXEC forca reler os metadados e EXIT registra a saida.
+// Devolve true se eventos se perderam e /proc precisa ser varrido.
+bool LinuxCollector::applyEvents(RawSample& out) {
+    bool complete = m_events->drain(m_pendingEvents);
+    // Tira a saida ja registrada de pid; true se havia uma.
+    auto takeReported = [this](unsigned long pid) {
+        for (ReportedExit& reported : m_reportedExits) {
+            if (reported.pid != pid) continue;
+            reported = m_reportedExits.back();
+            m_reportedExits.pop_back();
+            return true;
+        }
+        return false;
+    };
+    for (const ProcEvent& event : m_pendingEvents) {
+        out.stats.lifecycleEvents++;
+        switch (event.type) {
+        case ProcEvent::FORK:
+            // Os eventos chegam em ordem: o EXIT do dono anterior do PID, se
+            // vinha, ja passou.
+            takeReported(event.pid);
+            m_procFiles[event.pid];
+            break;
+        case ProcEvent::EXEC:
+            m_procFiles[event.pid].metadata.reset();
+            break;
+        case ProcEvent::EXIT: {
+            if (takeReported(event.pid)) break;
+            auto it = m_procFiles.find(event.pid);
+            if (it != m_procFiles.end()) {
+                recordExit(event.pid, &it->second, &event, out.exits);
+                if (it->second.statFd >= 0) {
+                    out.stats.handlesEvicted++;
+                }
+                closeProcFiles(it->second);
+                m_procFiles.erase(it);
+            }
+            else {
+                recordExit(event.pid, nullptr, &event, out.exits);
+            }
+            break;
+        }
+        }
+    }
+    for (size_t i = 0; i < m_reportedExits.size();) {
+        if (++m_reportedExits[i].ticks < REPORTED_EXIT_TICKS) {
+            ++i;
+            continue;
+        }
+        m_reportedExits[i] = m_reportedExits.back();
+        m_reportedExits.pop_back();
+    }
+    return !complete;
+}
+
+void LinuxCollector::recordExit(unsigned long pid, const ProcFiles* files, const ProcEvent* event,
+    std::vector<ProcessExit>& exits) {
+    ProcessExit exit;
+    exit.pid = pid;
+    exit.shortLived = files == nullptr || !files->listed;
+    unsigned long long cpuTicks = 0;
+    if (files != nullptr) {
+        cpuTicks = files->lastKernel + files->lastUser;
+        exit.peakRssBytes = files->peakRss;
+        if (files->metadata) {
+            exit.name = files->metadata->name;
+            exit.parentPid = files->metadata->parentPid;
+        }
+    }
+
+    if (event != nullptr) {
+        exit.timestampMs = event->timestampMs;
+        if (event->parentPid != 0) {
+            exit.parentPid = event->parentPid;
+        }
+        // Convencao do shell: morto por sinal = 128 + sinal.
+        exit.exitCode = WIFSIGNALED(event->exitStatus) ? 128 + WTERMSIG(event->exitStatus) :
+            WEXITSTATUS(event->exitStatus);
+
+        unsigned long long fields[STAT_FIELD_COUNT];
+        std::string name;
+        if (!event->finalStat.empty() && parseStat(event->finalStat.c_str(), &name, fields, STAT_FIELD_COUNT)) {
+            cpuTicks = std::max(cpuTicks, fields[STAT_UTIME] + fields[STAT_STIME]);
+            if (exit.name.empty()) {
+                exit.name = m_names.intern(name);
+            }
+        }
+    }
+    else {
+        exit.timestampMs = wallClockMs();
+    }
+
+    exit.cpuSeconds = (double)cpuTicks / (double)m_clockTicks;
+    exits.push_back(exit);
+}
+
+unsigned long LinuxCollector::cachedHandleCount() const {
+    size_t count = (size_t)m_cachedFds.load(std::memory_order_relaxed);
+    for (const auto& entry : m_focused) {
+        count += entry.second.threads.size();
+    }
+    return (unsigned long)count;
+}
+
+void LinuxCollector::sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) {
+    for (auto& entry : m_focused) {
+        entry.second.seen = false;
+    }
+
+    size_t count = 0;
+    for (unsigned long pid : pids) {
+        if (pid == 0) continue;
+        FocusedTasks& tasks = m_focused[pid];
+        if (tasks.seen) continue;
+
+        if (count == out.focused.size()) {
+            out.focused.emplace_back();
+        }
+        // Um processo que saiu tem o diretorio fechado e e reaberto no
+        // proximo tick, caso o PID volte a existir.
+        tasks.seen = readThreads(pid, tasks, out.focused[count], out.stats);
+        if (tasks.seen) {
+            ++count;
+        }
+    }
+    out.focused.resize(count);
+
+    for (auto it = m_focused.begin(); it != m_focused.end();) {
+        if (!it->second.seen) {
+            closeFocusedTasks(it->second);
+            it = m_focused.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    out.stats.cachedHandles = cachedHandleCount();
+}
+
+void LinuxCollector::closeFocusedTasks(FocusedTasks& tasks) {
+    for (auto& entry : tasks.threads) {
+        closeFile(entry.second.statFd);
+    }
+    tasks.threads.clear();
+    if (tasks.taskDir != nullptr) {
+        closedir(tasks.taskDir);
+        tasks.taskDir = nullptr;
+    }
+}
+
+bool LinuxCollector::readThreads(unsigned long pid, FocusedTasks& tasks, RawFocusedProcess& focused, CollectorStats& stats) {
+    std::string taskPath = m_root + "/" + std::to_string(pid) + "/task";
+    if (tasks.taskDir == nullptr) {
+        instrumentation::countSyscalls();
+        tasks.taskDir = opendir(taskPath.c_str());
+        if (tasks.taskDir == nullptr) return false;
+    }
+
+    focused.pid = pid;
+    focused.threads.clear();
+    for (auto& entry : tasks.threads) {
+        entry.second.seen = false;
+    }
+
+    rewindDirectory(tasks.taskDir);
+    while (dirent* ent = readdir(tasks.taskDir)) {
+        if (!isPidName(ent->d_name)) continue;
+
+        RawThreadSample thread;
+        thread.tid = strtoul(ent->d_name, nullptr, 10);
+
+        ThreadFiles& files = tasks.threads[thread.tid];
+        files.seen = true;
+        if (files.statFd < 0) {
+            files.statFd = openFile(taskPath + "/" + ent->d_name + "/stat");
+            stats.handlesOpened++;
+        }
+        else {
+            stats.syscallsSaved += 2;
+        }
+
+        unsigned long long fields[STAT_FIELD_COUNT];
+        if (readFile(files.statFd, m_buffer) > 0 &&
+            parseStat(m_buffer.data(), nullptr, fields, STAT_FIELD_COUNT)) {
+            thread.timesValid = true;
+            thread.userTime = fields[STAT_UTIME];
+            thread.kernelTime = fields[STAT_STIME];
+        }
+        focused.threads.push_back(thread);
+    }
+
+    for (auto it = tasks.threads.begin(); it != tasks.threads.end();) {
+        if (!it->second.seen) {
+            closeFile(it->second.statFd);
+            stats.handlesEvicted++;
+            it = tasks.threads.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    return !focused.threads.empty();
+}
+
+ExtraProcessInfo LinuxCollector::readExtraProcessInfo(unsigned long pid) {
+    ExtraProcessInfo extraInfo = {};
+    std::lock_guard<std::mutex> lock(m_extraMutex);
+
+    if (pid != m_extraPid) {
+        closeFile(m_extraStatFd);
+        closeFile(m_extraIoFd);
+        m_extraStatFd = m_extraIoFd = -1;
+        m_extraBase = m_root + "/" + std::to_string(pid);
+        m_extraPid = pid;
+    }
+    // Um fd de um processo que ja saiu devolve ESRCH (ou nada) para sempre,
+    // mesmo que o PID ja seja de outro: reabre e le uma vez mais.
+    auto readExtra = [this](int& fd, const char* name) {
+        if (fd >= 0 && readFile(fd, m_extraBuffer) > 0) return true;
+        closeFile(fd);
+        fd = openFile(m_extraBase + name);
+        return readFile(fd, m_extraBuffer) > 0;
+    };
+
+    unsigned long long fields[STAT_FIELD_COUNT];
+    if (readExtra(m_extraStatFd, "/stat") &&
+        parseStat(m_extraBuffer.data(), nullptr, fields, STAT_FIELD_COUNT)) {
+        extraInfo.threadCount = (unsigned long)fields[STAT_NUM_THREADS];
+        extraInfo.priorityClass = describePriority((long long)fields[STAT_PRIORITY], (long long)fields[STAT_NICE]);
+    }
+
+    // Descritores abertos; como o io, exige permissao sobre o processo.
+    // opendir + getdents + closedir
+    instrumentation::countSyscalls(3);
+    if (DIR* fdDir = opendir((m_extraBase + "/fd").c_str())) {
+        while (dirent* ent = readdir(fdDir)) {
+            if (isPidName(ent->d_name)) extraInfo.handleCount++;
+        }
+        closedir(fdDir);
+    }
+
+    if (readExtra(m_extraIoFd, "/io")) {
+        extraInfo.ioReadBytes = parseLabeledValue(m_extraBuffer.data(), "read_bytes:");
+        extraInfo.ioWriteBytes = parseLabeledValue(m_extraBuffer.data(), "write_bytes:");
+    }
+
+    return extraInfo;
+}
+
+unsigned long long LinuxCollector::readStartTime(unsigned long pid) {
+    if (pid == 0) return 0;
+    // Um zumbi ja saiu; so falta o pai recolher o codigo de saida.
+    char text[1024];
+    int fd = openFile(m_root + "/" + std::to_string(pid) + "/stat");
+    instrumentation::countSyscalls();
+    ssize_t n = fd >= 0 ? pread(fd, text, sizeof(text) - 1, 0) : -1;
+    closeFile(fd);
+    if (n <= 0) return 0;
+    text[n] = '\0';
+    const char* state = strrchr(text, ')');
+    unsigned long long fields[STAT_FIELD_COUNT];
+    if (state == nullptr || state[1] != ' ' || state[2] == 'Z' || state[2] == 'X' ||
+        !parseStat(text, nullptr, fields, STAT_FIELD_COUNT)) {
+        return 0;
+    }
+    return fields[STAT_STARTTIME];
+}
+
+// Com pidfd (Linux 5.3+) o descritor e aberto antes de conferir o
+// starttime, e o sinal vai para o processo que ele referencia: um PID
+// reaproveitado entre a conferencia e o sinal nao recebe nada. Sem pidfd,
+// kill() com a mesma conferencia.
+SignalResult LinuxCollector::signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) {
+    if (pid == 0) return SIGNAL_FAILED;
+    int pidfd = -1;
+#ifdef SYS_pidfd_open
+    instrumentation::countSyscalls();
+    pidfd = (int)syscall(SYS_pidfd_open, (pid_t)pid, 0);
+    if (pidfd < 0 && errno == ESRCH) return SIGNAL_GONE;
+#endif
+
+    unsigned long long current = readStartTime(pid);
+    bool alive = current != 0 && (startTime == 0 || current == startTime);
+    if (!alive || signal == SIGNAL_PROBE) {
+        closeFile(pidfd);
+        return alive ? SIGNAL_SENT : SIGNAL_GONE;
+    }
+
+    int number = signal == SIGNAL_TERMINATE ? SIGTERM : SIGKILL;
+    instrumentation::countSyscalls();
+    int rc;
+#ifdef SYS_pidfd_send_signal
+    if (pidfd >= 0) {
+        rc = (int)syscall(SYS_pidfd_send_signal, pidfd, number, nullptr, 0);
+    }
+    else
+#endif
+    {
+        rc = kill((pid_t)pid, number);
+    }
+    int error = errno;
+    closeFile(pidfd);
+    if (rc == 0) return SIGNAL_SENT;
+    if (error == ESRCH) return SIGNAL_GONE;
+    if (error == EPERM) return SIGNAL_DENIED;
+    return SIGNAL_FAILED;
+}
+
+std::unique_ptr<Collector> createPlatformCollector(unsigned samplingThreads) {
+    return std::unique_ptr<Collector>(new LinuxCollector("/proc", samplingThreads));
+}
@@ -0,0 +1,144 @@
+#ifndef COLLECTOR_LINUX_H
+#define COLLECTOR_LINUX_H
+
+#include "cgroup_linux.h"
+#include "collector.h"
+#include "proc_events_linux.h"
+#include "worker_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/types.h>
+
+// Le /proc (ou uma arvore falsa com o mesmo layout, via procRoot) mantendo os
+// descritores abertos entre ticks e relendo com pread no mesmo buffer.
+// cgroupRoot: raiz do cgroup v2; vazio = a do sistema quando procRoot e o
+// /proc de verdade, e nenhuma (sem RawSample::cgroups) caso contrario.
+class LinuxCollector : public Collector {
+public:
+    explicit LinuxCollector(const std::string& procRoot = "/proc", unsigned samplingThreads = 0,
+        const std::string& cgroupRoot = std::string());
+    ~LinuxCollector() override;
+
+    bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) override;
+    void sampleSystem(RawSample& out) override;
+    void sampleProcesses(RawSample& out) override;
+    void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) override;
+    bool enableLifecycleEvents() override;
+    ExtraProcessInfo readExtraProcessInfo(unsigned long pid) override;
+    SignalResult signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) override;
+    unsigned long long readStartTime(unsigned long pid) override;
+
+private:
+    struct ProcFiles {
+        int statFd = -1;
+        int statmFd = -1;
+        // Contadores de I/O e de trocas de contexto; io so abre com permissao
+        // de ptrace sobre o processo, senao fica -1 ate a proxima reabertura.
+        int ioFd = -1;
+        int statusFd = -1;
+        unsigned long long startTime = 0;
+        ProcessMetadataRef metadata;
+        // Ultimos tempos lidos e maior RSS visto, para o registro de saida.
+        unsigned long long lastKernel = 0;
+        unsigned long long lastUser = 0;
+        unsigned long long peakRss = 0;
+        bool seen = false;
+        // Ja apareceu numa lista de processos.
+        bool listed = false;
+    };
+
+    struct ThreadFiles {
+        int statFd = -1;
+        bool seen = false;
+    };
+
+    // Estado de um processo em foco: so /proc/<pid>/task dele e lido.
+    struct FocusedTasks {
+        DIR* taskDir = nullptr;
+        std::unordered_map<unsigned long, ThreadFiles> threads;
+        bool seen = false;
+    };
+
+    int openFile(const std::string& path);
+    static ssize_t readFile(int fd, std::vector<char>& buffer);
+    void closeProcFiles(ProcFiles& files);
+    void openProcFiles(unsigned long pid, ProcFiles& files, CollectorStats& stats);
+    bool sampleProcess(unsigned long pid, ProcFiles& files, RawProcessSample& proc,
+        std::vector<char>& buffer, std::string& name, CollectorStats& stats);
+    ProcessMetadataRef loadMetadata(unsigned long pid, const std::string& name, unsigned long parentPid,
+        std::vector<char>& buffer);
+    InternedName lookupUser(unsigned uid);
+    bool readThreads(unsigned long pid, FocusedTasks& tasks, RawFocusedProcess& focused, CollectorStats& stats);
+    void closeFocusedTasks(FocusedTasks& tasks);
+    bool applyEvents(RawSample& out);
+    void recordExit(unsigned long pid, const ProcFiles* files, const ProcEvent* event, std::vector<ProcessExit>& exits);
+    unsigned long cachedHandleCount() const;
+
+    std::string m_root;
+    int m_statFd = -1;
+    int m_meminfoFd = -1;
+    int m_pressureFds[PRESSURE_RESOURCE_COUNT] = { -1, -1, -1 };
+    DIR* m_procDir = nullptr;
+    std::vector<char> m_buffer;
+    long m_pageSize = 4096;
+
+    std::unordered_map<unsigned long, ProcFiles> m_procFiles;
+    // fds de processos abertos e o limite derivado de RLIMIT_NOFILE.
+    std::atomic<long> m_cachedFds{ 0 };
+    long m_fdBudget = 1L << 30;
+
+    // A enumeracao e serial; a leitura de cada processo e dividida no pool,
+    // com um buffer e contadores por worker.
+    WorkerPool m_pool;
+    std::vector<unsigned long> m_pids;
+    std::vector<ProcFiles*> m_pidFiles;
+    std::vector<std::vector<char>> m_workerBuffers;
+    std::vector<std::string> m_workerNames;
+    std::vector<CollectorStats> m_workerStats;
+
+    NameInterner m_names;
+    std::mutex m_usersMutex;
+    std::unordered_map<unsigned, InternedName> m_users;
+
+    std::unordered_map<unsigned long, FocusedTasks> m_focused;
+
+    std::unique_ptr<CgroupReader> m_cgroups;
+    std::vector<const std::string*> m_cgroupPaths;
+
+    // Eventos de ciclo de vida (opcional). Com eles a lista de processos e
+    // mantida pelos eventos e /proc so e varrido a cada RESCAN_TICKS ou
+    // quando eventos se perdem.
+    std::unique_ptr<ProcEventListener> m_events;
+    std::vector<ProcEvent> m_pendingEvents;
+    unsigned m_ticksSinceRescan = 0;
+    // Saidas ja registradas por varredura; o EXIT delas, que chega depois
+    // (as vezes alguns ticks depois), e ignorado. A entrada sai quando esse
+    // EXIT e consumido, quando um FORK reaproveita o PID ou, se o EXIT nunca
+    // vier (eventos perdidos), depois de REPORTED_EXIT_TICKS amostragens.
+    struct ReportedExit {
+        unsigned long pid = 0;
+        unsigned ticks = 0;
+    };
+    std::vector<ReportedExit> m_reportedExits;
+    long m_clockTicks = 100;
+
+    // readExtraProcessInfo roda na thread da UI, entao tem estado proprio.
+    // Os fds ficam abertos enquanto o PID for o mesmo e as leituras derem
+    // certo; uma leitura que falha (processo saiu, PID reaproveitado ou
+    // open sem permissao) reabre o arquivo na hora.
+    std::mutex m_extraMutex;
+    unsigned long m_extraPid = 0;
+    int m_extraStatFd = -1;
+    int m_extraIoFd = -1;
+    std::string m_extraBase;
+    std::vector<char> m_extraBuffer;
+};
+
+#endif
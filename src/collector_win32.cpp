@@ -0,0 +1,671 @@
+#include "collector_win32.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Pdh.h>
+#include <psapi.h>
+
+#include "instrumentation.h"
+#include "util.h"
+#pragma comment(lib, "pdh.lib")
+#pragma comment(lib, "advapi32.lib")
+
+static ULONGLONG fileTimeToU64(const FILETIME& ft) {
+    return ft.dwLowDateTime | ((ULONGLONG)ft.dwHighDateTime << 32);
+}
+
+static std::string toNarrow(const TCHAR* text) {
+#ifdef UNICODE
+    std::wstring wstr(text);
+    return std::string(wstr.begin(), wstr.end());
+#else
+    return std::string(text);
+#endif
+}
+
+// NtQueryInformationProcess nao esta no SDK como funcao publica; as classes
+// usadas aqui (0 = informacao basica, 60 = linha de comando) sao estaveis.
+typedef LONG(NTAPI* NtQueryInformationProcessFn)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+
+struct BasicProcessInformation {
+    PVOID reserved1;
+    PVOID pebBaseAddress;
+    PVOID reserved2[2];
+    ULONG_PTR uniqueProcessId;
+    ULONG_PTR inheritedFromUniqueProcessId;
+};
+
+struct CountedUnicodeString {
+    USHORT length;
+    USHORT maximumLength;
+    PWSTR buffer;
+};
+
+static NtQueryInformationProcessFn ntQueryInformationProcess() {
+    static NtQueryInformationProcessFn fn = (NtQueryInformationProcessFn)GetProcAddress(
+        GetModuleHandleW(L"ntdll.dll"), "NtQueryInformationProcess");
+    return fn;
+}
+
+// SYSTEM_PROCESS_INFORMATION e SYSTEM_THREAD_INFORMATION (classe 5 do
+// NtQuerySystemInformation). Cada processo e seguido pelas suas threads, com
+// os tempos ja preenchidos, entao nao e preciso abrir nenhuma thread.
+typedef LONG(NTAPI* NtQuerySystemInformationFn)(ULONG, PVOID, ULONG, PULONG);
+
+static const ULONG SYSTEM_PROCESS_INFORMATION_CLASS = 5;
+static const LONG STATUS_INFO_LENGTH_MISMATCH_CODE = (LONG)0xC0000004;
+
+struct SystemThreadEntry {
+    LARGE_INTEGER kernelTime;
+    LARGE_INTEGER userTime;
+    LARGE_INTEGER createTime;
+    ULONG waitTime;
+    PVOID startAddress;
+    HANDLE uniqueProcess;
+    HANDLE uniqueThread;
+    LONG priority;
+    LONG basePriority;
+    ULONG contextSwitches;
+    ULONG threadState;
+    ULONG waitReason;
+};
+
+struct SystemProcessEntry {
+    ULONG nextEntryOffset;
+    ULONG numberOfThreads;
+    LARGE_INTEGER workingSetPrivateSize;
+    ULONG hardFaultCount;
+    ULONG numberOfThreadsHighWatermark;
+    ULONGLONG cycleTime;
+    LARGE_INTEGER createTime;
+    LARGE_INTEGER userTime;
+    LARGE_INTEGER kernelTime;
+    CountedUnicodeString imageName;
+    LONG basePriority;
+    HANDLE uniqueProcessId;
+    HANDLE inheritedFromUniqueProcessId;
+    ULONG handleCount;
+    ULONG sessionId;
+    ULONG_PTR uniqueProcessKey;
+    SIZE_T peakVirtualSize;
+    SIZE_T virtualSize;
+    ULONG pageFaultCount;
+    SIZE_T peakWorkingSetSize;
+    SIZE_T workingSetSize;
+    SIZE_T quotaPeakPagedPoolUsage;
+    SIZE_T quotaPagedPoolUsage;
+    SIZE_T quotaPeakNonPagedPoolUsage;
+    SIZE_T quotaNonPagedPoolUsage;
+    SIZE_T pagefileUsage;
+    SIZE_T peakPagefileUsage;
+    SIZE_T privatePageCount;
+    LARGE_INTEGER readOperationCount;
+    LARGE_INTEGER writeOperationCount;
+    LARGE_INTEGER otherOperationCount;
+    LARGE_INTEGER readTransferCount;
+    LARGE_INTEGER writeTransferCount;
+    LARGE_INTEGER otherTransferCount;
+};
+
+// SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION (classe 8): um por processador do
+// grupo do processo chamador (ate 64). kernelTime inclui ocioso, DPC e
+// interrupcoes.
+static const ULONG SYSTEM_PROCESSOR_PERFORMANCE_CLASS = 8;
+
+struct ProcessorPerformanceEntry {
+    LARGE_INTEGER idleTime;
+    LARGE_INTEGER kernelTime;
+    LARGE_INTEGER userTime;
+    LARGE_INTEGER dpcTime;
+    LARGE_INTEGER interruptTime;
+    ULONG interruptCount;
+};
+
+static NtQuerySystemInformationFn ntQuerySystemInformation() {
+    static NtQuerySystemInformationFn fn = (NtQuerySystemInformationFn)GetProcAddress(
+        GetModuleHandleW(L"ntdll.dll"), "NtQuerySystemInformation");
+    return fn;
+}
+
+static const size_t SAMPLE_CHUNK = 16;
+
+Win32Collector::Win32Collector(unsigned samplingThreads) :
+    m_pidBuffer(1024),
+    m_pool(samplingThreads)
+{
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    m_processorInfo.resize(sizeof(ProcessorPerformanceEntry) *
+        std::min<size_t>(std::max<DWORD>(systemInfo.dwNumberOfProcessors, 1), MAX_CPU_CORES));
+    std::shared_ptr<ProcessMetadata> denied = std::make_shared<ProcessMetadata>();
+    denied->name = m_names.intern("<acesso negado>");
+    m_deniedMetadata = denied;
+}
+
+Win32Collector::~Win32Collector() {
+    for (auto& entry : m_processHandles) {
+        if (entry.second.handle != NULL) {
+            CloseHandle(entry.second.handle);
+        }
+    }
+}
+
+// EnumProcesses nao informa quantos PIDs existem: se o buffer voltou cheio,
+// dobra e tenta de novo. O buffer fica com o maior tamanho ja visto.
+bool Win32Collector::enumerateProcesses(DWORD& count) {
+    for (;;) {
+        DWORD cbBuffer = (DWORD)(m_pidBuffer.size() * sizeof(DWORD));
+        DWORD cbNeeded = 0;
+        instrumentation::countSyscalls();
+        if (!EnumProcesses(m_pidBuffer.data(), cbBuffer, &cbNeeded)) {
+            return false;
+        }
+        if (cbNeeded < cbBuffer) {
+            count = cbNeeded / sizeof(DWORD);
+            return true;
+        }
+        m_pidBuffer.resize(m_pidBuffer.size() * 2);
+    }
+}
+
+HANDLE Win32Collector::acquireProcess(CachedProcess& cached, DWORD pid, RawProcessSample& proc, CollectorStats& stats) {
+    FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
+    if (cached.handle != NULL) {
+        instrumentation::countSyscalls();
+        bool valid = GetProcessTimes(cached.handle, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile) != 0 &&
+            fileTimeToU64(exitTime) == 0 &&
+            fileTimeToU64(creationTime) == cached.creationTime;
+        if (valid) {
+            // OpenProcess + CloseHandle
+            stats.syscallsSaved += 2;
+        }
+        else {
+            instrumentation::countSyscalls();
+            CloseHandle(cached.handle);
+            cached.handle = NULL;
+            stats.handlesEvicted++;
+        }
+    }
+
+    if (cached.handle == NULL) {
+        // OpenProcess + GetProcessTimes
+        instrumentation::countSyscalls(2);
+        cached.handle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ |
+            PROCESS_QUERY_LIMITED_INFORMATION,
+            FALSE, pid);
+        if (cached.handle == NULL) {
+            return NULL;
+        }
+        cached.metadata.reset();
+        stats.handlesOpened++;
+        if (!GetProcessTimes(cached.handle, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile)) {
+            cached.creationTime = 0;
+            return cached.handle;
+        }
+        cached.creationTime = fileTimeToU64(creationTime);
+    }
+
+    proc.timesValid = true;
+    proc.startTime = cached.creationTime;
+    proc.kernelTime = fileTimeToU64(kernelTimeFile);
+    proc.userTime = fileTimeToU64(userTimeFile);
+    return cached.handle;
+}
+
+void Win32Collector::sampleProcess(CachedProcess& cached, DWORD pid, RawProcessSample& proc, CollectorStats& stats) {
+    proc.pid = pid;
+    proc.accessible = false;
+    proc.timesValid = false;
+    proc.startTime = 0;
+    proc.memoryUsedBytes = 0;
+    proc.kernelTime = 0;
+    proc.userTime = 0;
+    proc.countersValid = 0;
+    proc.threadCount = 0;
+
+    HANDLE hProcess = acquireProcess(cached, pid, proc, stats);
+
+    if (hProcess != NULL) {
+        proc.accessible = true;
+
+        PROCESS_MEMORY_COUNTERS pmc;
+        instrumentation::countSyscalls();
+        if (GetProcessMemoryInfo(hProcess, &pmc, sizeof(pmc))) {
+            proc.memoryUsedBytes = pmc.WorkingSetSize;
+            cached.peakRss = pmc.PeakWorkingSetSize;
+        }
+        cached.lastKernel = proc.kernelTime;
+        cached.lastUser = proc.userTime;
+        if (!cached.metadata) {
+            cached.metadata = loadMetadata(hProcess);
+            stats.metadataLoads++;
+        }
+        proc.metadata = cached.metadata;
+    }
+    else {
+        proc.metadata = m_deniedMetadata;
+    }
+}
+
+ProcessMetadataRef Win32Collector::loadMetadata(HANDLE hProcess) {
+    std::shared_ptr<ProcessMetadata> metadata = std::make_shared<ProcessMetadata>();
+    // Nome, caminho e as tres consultas ao NtQueryInformationProcess; cada
+    // chamada conta como uma, embora algumas facam mais de uma ida ao kernel.
+    instrumentation::countSyscalls(5);
+
+    TCHAR szProcessName[MAX_PATH] = TEXT("<desconhecido>");
+    if (GetModuleBaseName(hProcess, NULL, szProcessName, sizeof(szProcessName) / sizeof(TCHAR))) {
+        metadata->name = m_names.intern(toNarrow(szProcessName));
+    }
+
+    TCHAR szPath[MAX_PATH];
+    DWORD pathSize = sizeof(szPath) / sizeof(TCHAR);
+    if (QueryFullProcessImageName(hProcess, 0, szPath, &pathSize)) {
+        metadata->executablePath = toNarrow(szPath);
+    }
+
+    metadata->user = lookupUser(hProcess);
+
+    NtQueryInformationProcessFn query = ntQueryInformationProcess();
+    if (query != nullptr) {
+        BasicProcessInformation basic;
+        if (query(hProcess, 0, &basic, sizeof(basic), NULL) >= 0) {
+            metadata->parentPid = (unsigned long)basic.inheritedFromUniqueProcessId;
+        }
+
+        ULONG size = 0;
+        query(hProcess, 60, NULL, 0, &size);
+        if (size >= sizeof(CountedUnicodeString)) {
+            std::vector<BYTE> buffer(size);
+            if (query(hProcess, 60, buffer.data(), size, &size) >= 0) {
+                const CountedUnicodeString* cmdline = (const CountedUnicodeString*)buffer.data();
+                std::wstring wstr(cmdline->buffer, cmdline->length / sizeof(WCHAR));
+                metadata->commandLine.assign(wstr.begin(), wstr.end());
+            }
+        }
+    }
+
+    return metadata;
+}
+
+InternedName Win32Collector::lookupUser(HANDLE hProcess) {
+    HANDLE hToken = NULL;
+    // OpenProcessToken, duas GetTokenInformation, LookupAccountSid, CloseHandle
+    instrumentation::countSyscalls(5);
+    if (!OpenProcessToken(hProcess, TOKEN_QUERY, &hToken)) {
+        return InternedName();
+    }
+
+    InternedName user;
+    DWORD size = 0;
+    GetTokenInformation(hToken, TokenUser, NULL, 0, &size);
+    std::vector<BYTE> buffer(size);
+    if (size > 0 && GetTokenInformation(hToken, TokenUser, buffer.data(), size, &size)) {
+        const TOKEN_USER* tokenUser = (const TOKEN_USER*)buffer.data();
+        TCHAR szName[256], szDomain[256];
+        DWORD nameSize = 256, domainSize = 256;
+        SID_NAME_USE use;
+        if (LookupAccountSid(NULL, tokenUser->User.Sid, szName, &nameSize, szDomain, &domainSize, &use)) {
+            user = m_names.intern(toNarrow(szDomain) + "\\" + toNarrow(szName));
+        }
+    }
+    CloseHandle(hToken);
+    return user;
+}
+
+bool Win32Collector::readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) {
+    FILETIME idleFile, kernelFile, userFile;
+    instrumentation::countSyscalls();
+    if (!GetSystemTimes(&idleFile, &kernelFile, &userFile)) {
+        return false;
+    }
+    // O tempo de kernel do GetSystemTimes ja inclui o tempo ocioso.
+    totalTime = fileTimeToU64(kernelFile) + fileTimeToU64(userFile);
+    idleTime = fileTimeToU64(idleFile);
+    return true;
+}
+
+void Win32Collector::sampleSystem(RawSample& out) {
+    MEMORYSTATUSEX memInfo;
+    memInfo.dwLength = sizeof(MEMORYSTATUSEX);
+    instrumentation::countSyscalls();
+    out.memoryValid = GlobalMemoryStatusEx(&memInfo) != 0;
+    if (out.memoryValid) {
+        out.ramTotalBytes = memInfo.ullTotalPhys;
+        out.ramUsedBytes = memInfo.ullTotalPhys - memInfo.ullAvailPhys;
+        out.ramUsagePercentage = memInfo.dwMemoryLoad;
+    }
+
+    out.cpuValid = readCpuTimes(out.cpuTotalTime, out.cpuIdleTime);
+    readProcessorTimes(out);
+    // Sem PSI no Windows.
+    for (RawPressure& pressure : out.pressure) {
+        pressure.valid = false;
+    }
+}
+
+// Divide o tempo de cada processador. O Windows nao separa iowait nem steal:
+// ficam zerados, e DPC + interrupcoes vao em CPU_STATE_IRQ.
+void Win32Collector::readProcessorTimes(RawSample& out) {
+    out.cores.count = out.cores.online = 0;
+    std::fill(out.cpuStateTimes, out.cpuStateTimes + RAW_CPU_FIELDS, 0ull);
+    NtQuerySystemInformationFn query = ntQuerySystemInformation();
+    if (query == nullptr) return;
+
+    ULONG returned = 0;
+    instrumentation::countSyscalls();
+    if (query(SYSTEM_PROCESSOR_PERFORMANCE_CLASS, m_processorInfo.data(), (ULONG)m_processorInfo.size(), &returned) < 0) {
+        return;
+    }
+    const ProcessorPerformanceEntry* entries = (const ProcessorPerformanceEntry*)m_processorInfo.data();
+    unsigned count = (unsigned)std::min<size_t>(returned / sizeof(ProcessorPerformanceEntry), MAX_CPU_CORES);
+    RawCpuCores& cores = out.cores;
+    for (unsigned i = 0; i < count; ++i) {
+        const ProcessorPerformanceEntry& entry = entries[i];
+        unsigned long long idle = (unsigned long long)entry.idleTime.QuadPart;
+        unsigned long long irq = (unsigned long long)(entry.dpcTime.QuadPart + entry.interruptTime.QuadPart);
+        unsigned long long kernel = (unsigned long long)entry.kernelTime.QuadPart;
+        cores.id[i] = (uint16_t)i;
+        cores.times[CPU_STATE_USER][i] = (unsigned long long)entry.userTime.QuadPart;
+        cores.times[CPU_STATE_SYSTEM][i] = kernel > idle + irq ? kernel - idle - irq : 0;
+        cores.times[CPU_STATE_IOWAIT][i] = 0;
+        cores.times[CPU_STATE_IRQ][i] = irq;
+        cores.times[CPU_STATE_STEAL][i] = 0;
+        cores.times[RAW_CPU_IDLE][i] = idle;
+        for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+            out.cpuStateTimes[field] += cores.times[field][i];
+        }
+    }
+    cores.count = count;
+    // GetSystemTimes soma todos os grupos de processadores.
+    cores.online = std::max<unsigned>(GetActiveProcessorCount(ALL_PROCESSOR_GROUPS), count);
+}
+
+void Win32Collector::sampleProcesses(RawSample& out) {
+    out.stats = CollectorStats();
+    out.exits.clear();
+    // Sem cgroups no Windows: todos os processos ficam no grupo raiz.
+    out.cgroups.clear();
+
+    {
+        ScopedPhaseTimer timer(out.timings, PHASE_ENUMERATE);
+        DWORD cProcesses = 0;
+        if (!enumerateProcesses(cProcesses)) {
+            out.processes.clear();
+            return;
+        }
+
+        for (auto& entry : m_processHandles) {
+            entry.second.seen = false;
+        }
+
+        // Insercoes no cache so na fase serial; a fase paralela usa ponteiros
+        // estaveis para os elementos.
+        m_pids.clear();
+        m_cachedProcesses.clear();
+        for (DWORD i = 0; i < cProcesses; i++) {
+            DWORD pid = m_pidBuffer[i];
+            if (pid == 0) continue;
+            CachedProcess& cached = m_processHandles[pid];
+            cached.seen = true;
+            cached.sampleIndex = m_pids.size();
+            m_pids.push_back(pid);
+            m_cachedProcesses.push_back(&cached);
+        }
+    }
+
+    ScopedPhaseTimer readTimer(out.timings, PHASE_PROCESS_READ);
+    out.processes.resize(m_pids.size());
+    m_workerStats.assign(m_pool.size(), CollectorStats());
+    m_pool.run(m_pids.size(), SAMPLE_CHUNK, [this, &out](unsigned worker, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            sampleProcess(*m_cachedProcesses[i], m_pids[i], out.processes[i], m_workerStats[worker]);
+        }
+        }, &out.shards);
+    readProcessCounters(out);
+
+    for (const CollectorStats& stats : m_workerStats) {
+        out.stats.handlesOpened += stats.handlesOpened;
+        out.stats.handlesEvicted += stats.handlesEvicted;
+        out.stats.syscallsSaved += stats.syscallsSaved;
+        out.stats.metadataLoads += stats.metadataLoads;
+    }
+
+    for (auto it = m_processHandles.begin(); it != m_processHandles.end();) {
+        if (!it->second.seen) {
+            recordExit(it->first, it->second, out.exits);
+            if (it->second.handle != NULL) {
+                instrumentation::countSyscalls();
+                CloseHandle(it->second.handle);
+                out.stats.handlesEvicted++;
+            }
+            it = m_processHandles.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    m_names.purge();
+    out.stats.cachedHandles = (unsigned long)m_processHandles.size();
+}
+
+// Sem eventos no Windows: a saida e percebida quando o PID some da lista. O
+// handle mantido aberto ainda da os tempos finais e o codigo de saida.
+void Win32Collector::recordExit(DWORD pid, const CachedProcess& cached, std::vector<ProcessExit>& exits) {
+    ProcessExit exit;
+    exit.pid = pid;
+    exit.peakRssBytes = cached.peakRss;
+    if (cached.metadata) {
+        exit.name = cached.metadata->name;
+        exit.parentPid = cached.metadata->parentPid;
+    }
+    ULONGLONG cpuTime = cached.lastKernel + cached.lastUser;
+    if (cached.handle != NULL) {
+        FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
+        DWORD exitCode = 0;
+        // GetProcessTimes, GetExitCodeProcess
+        instrumentation::countSyscalls(2);
+        if (GetProcessTimes(cached.handle, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile) &&
+            fileTimeToU64(creationTime) == cached.creationTime) {
+            cpuTime = std::max(cpuTime, fileTimeToU64(kernelTimeFile) + fileTimeToU64(userTimeFile));
+        }
+        if (GetExitCodeProcess(cached.handle, &exitCode) && exitCode != STILL_ACTIVE) {
+            exit.exitCode = (int)exitCode;
+        }
+    }
+    // FILETIME conta intervalos de 100 ns.
+    exit.cpuSeconds = (double)cpuTime / 1e7;
+    exit.timestampMs = wallClockMs();
+    exits.push_back(exit);
+}
+
+// O Windows nao tem uma API que enumere as threads de um unico processo; o
+// Toolhelp tira uma copia de todas as threads da maquina e ainda exigia um
+// OpenThread + GetThreadTimes por thread. Aqui uma unica consulta atende
+// todos os processos em foco: os demais processos sao pulados pelo
+// nextEntryOffset, sem percorrer as threads deles.
+bool Win32Collector::querySystemProcesses() {
+    NtQuerySystemInformationFn query = ntQuerySystemInformation();
+    if (query == nullptr) return false;
+
+    if (m_systemProcesses.empty()) {
+        m_systemProcesses.resize(256 * 1024);
+    }
+    for (;;) {
+        ULONG needed = 0;
+        instrumentation::countSyscalls();
+        LONG status = query(SYSTEM_PROCESS_INFORMATION_CLASS, m_systemProcesses.data(),
+            (ULONG)m_systemProcesses.size(), &needed);
+        if (status == STATUS_INFO_LENGTH_MISMATCH_CODE) {
+            // Folga para processos criados entre as duas chamadas.
+            m_systemProcesses.resize(std::max<size_t>(needed + 64 * 1024, m_systemProcesses.size() * 2));
+            continue;
+        }
+        return status >= 0;
+    }
+}
+
+// I/O, faltas de pagina, trocas de contexto e numero de threads de todos os
+// processos numa so consulta, em vez de um GetProcessIoCounters por processo.
+// Vale inclusive para processos que OpenProcess recusa, mas so entra no
+// resultado quem tem tempos validos e o mesmo creationTime (o PID pode ter
+// sido reaproveitado entre o EnumProcesses e a consulta). O Windows nao separa trocas
+// voluntarias e involuntarias: o total vai em COUNTER_VOLUNTARY_SWITCHES.
+void Win32Collector::readProcessCounters(RawSample& out) {
+    if (out.processes.empty() || !querySystemProcesses()) return;
+
+    const BYTE* entry = m_systemProcesses.data();
+    for (;;) {
+        const SystemProcessEntry* process = (const SystemProcessEntry*)entry;
+        auto it = m_processHandles.find((DWORD)(ULONG_PTR)process->uniqueProcessId);
+        if (it != m_processHandles.end() && it->second.seen) {
+            RawProcessSample& proc = out.processes[it->second.sampleIndex];
+            if (proc.timesValid && (ULONGLONG)process->createTime.QuadPart == it->second.creationTime) {
+                ULONGLONG switches = 0;
+                const SystemThreadEntry* threads = (const SystemThreadEntry*)(process + 1);
+                for (ULONG i = 0; i < process->numberOfThreads; ++i) {
+                    switches += threads[i].contextSwitches;
+                }
+                unsigned long long hardFaults = process->hardFaultCount;
+                unsigned long long faults = std::max<unsigned long long>(process->pageFaultCount, hardFaults);
+                proc.counters[COUNTER_IO_READ_BYTES] = (unsigned long long)process->readTransferCount.QuadPart;
+                proc.counters[COUNTER_IO_WRITE_BYTES] = (unsigned long long)process->writeTransferCount.QuadPart;
+                proc.counters[COUNTER_MINOR_FAULTS] = faults - hardFaults;
+                proc.counters[COUNTER_MAJOR_FAULTS] = hardFaults;
+                proc.counters[COUNTER_VOLUNTARY_SWITCHES] = switches;
+                proc.threadCount = process->numberOfThreads;
+                proc.countersValid = processCounterBit(COUNTER_IO_READ_BYTES) | processCounterBit(COUNTER_IO_WRITE_BYTES) |
+                    processCounterBit(COUNTER_MINOR_FAULTS) | processCounterBit(COUNTER_MAJOR_FAULTS) |
+                    processCounterBit(COUNTER_VOLUNTARY_SWITCHES);
+            }
+        }
+
+        if (process->nextEntryOffset == 0) break;
+        entry += process->nextEntryOffset;
+    }
+}
+
+void Win32Collector::sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) {
+    size_t count = 0;
+    if (!pids.empty() && querySystemProcesses()) {
+        const BYTE* entry = m_systemProcesses.data();
+        for (;;) {
+            const SystemProcessEntry* process = (const SystemProcessEntry*)entry;
+            unsigned long pid = (unsigned long)(ULONG_PTR)process->uniqueProcessId;
+
+            if (pid != 0 && std::find(pids.begin(), pids.end(), pid) != pids.end()) {
+                if (count == out.focused.size()) {
+                    out.focused.emplace_back();
+                }
+                RawFocusedProcess& focused = out.focused[count++];
+                focused.pid = pid;
+                focused.threads.clear();
+
+                const SystemThreadEntry* threads = (const SystemThreadEntry*)(process + 1);
+                for (ULONG i = 0; i < process->numberOfThreads; ++i) {
+                    RawThreadSample thread;
+                    thread.tid = (unsigned long)(ULONG_PTR)threads[i].uniqueThread;
+                    thread.timesValid = true;
+                    thread.kernelTime = (unsigned long long)threads[i].kernelTime.QuadPart;
+                    thread.userTime = (unsigned long long)threads[i].userTime.QuadPart;
+                    focused.threads.push_back(thread);
+                }
+            }
+
+            if (process->nextEntryOffset == 0) break;
+            entry += process->nextEntryOffset;
+        }
+    }
+    out.focused.resize(count);
+}
+
+ExtraProcessInfo Win32Collector::readExtraProcessInfo(unsigned long pid) {
+    ExtraProcessInfo extraInfo = {};
+
+    // OpenProcess, GetProcessIoCounters, GetProcessHandleCount,
+    // GetPriorityClass, CloseHandle
+    instrumentation::countSyscalls(5);
+    HANDLE hProcess = OpenProcess(
+        PROCESS_QUERY_INFORMATION | PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ,
+        FALSE, pid
+    );
+
+    if (hProcess == NULL) {
+        return extraInfo;
+    }
+
+    IO_COUNTERS ioCounters;
+    if (GetProcessIoCounters(hProcess, &ioCounters)) {
+        extraInfo.ioReadBytes = ioCounters.ReadTransferCount;
+        extraInfo.ioWriteBytes = ioCounters.WriteTransferCount;
+    }
+
+    DWORD handleCount = 0;
+    if (GetProcessHandleCount(hProcess, &handleCount)) {
+        extraInfo.handleCount = handleCount;
+    }
+
+    switch (GetPriorityClass(hProcess)) {
+    case IDLE_PRIORITY_CLASS: extraInfo.priorityClass = "ociosa"; break;
+    case BELOW_NORMAL_PRIORITY_CLASS: extraInfo.priorityClass = "abaixo do normal"; break;
+    case NORMAL_PRIORITY_CLASS: extraInfo.priorityClass = "normal"; break;
+    case ABOVE_NORMAL_PRIORITY_CLASS: extraInfo.priorityClass = "acima do normal"; break;
+    case HIGH_PRIORITY_CLASS: extraInfo.priorityClass = "alta"; break;
+    case REALTIME_PRIORITY_CLASS: extraInfo.priorityClass = "tempo real"; break;
+    default: break;
+    }
+
+    // threadCount fica para o SystemMonitor, que o tira da amostragem das
+    // threads do processo em foco em vez de percorrer todas as threads.
+
+    CloseHandle(hProcess);
+    return extraInfo;
+}
+
+// O Windows nao tem um pedido de saida para qualquer processo (WM_CLOSE so
+// alcanca quem tem janela): TERMINATE e UNSUPPORTED e quem chama usa KILL.
+// O handle aberto prende o objeto do processo, entao a conferencia do
+// creationTime vale ate o TerminateProcess.
+SignalResult Win32Collector::signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) {
+    if (signal == SIGNAL_TERMINATE) return SIGNAL_UNSUPPORTED;
+    instrumentation::countSyscalls(2);
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION |
+        (signal == SIGNAL_KILL ? PROCESS_TERMINATE : 0), FALSE, (DWORD)pid);
+    if (hProcess == NULL) {
+        DWORD error = GetLastError();
+        return error == ERROR_ACCESS_DENIED ? SIGNAL_DENIED : error == ERROR_INVALID_PARAMETER ? SIGNAL_GONE : SIGNAL_FAILED;
+    }
+
+    FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
+    bool alive = GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile) &&
+        fileTimeToU64(exitTime) == 0 && (startTime == 0 || fileTimeToU64(creationTime) == startTime);
+    SignalResult result = alive ? SIGNAL_SENT : SIGNAL_GONE;
+    if (alive && signal == SIGNAL_KILL) {
+        instrumentation::countSyscalls();
+        if (!TerminateProcess(hProcess, 1)) {
+            result = GetLastError() == ERROR_ACCESS_DENIED ? SIGNAL_DENIED : SIGNAL_FAILED;
+        }
+    }
+    CloseHandle(hProcess);
+    return result;
+}
+
+unsigned long long Win32Collector::readStartTime(unsigned long pid) {
+    instrumentation::countSyscalls(2);
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, (DWORD)pid);
+    if (hProcess == NULL) return 0;
+    FILETIME creationTime, exitTime, kernelTimeFile, userTimeFile;
+    unsigned long long startTime = 0;
+    if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTimeFile, &userTimeFile) &&
+        fileTimeToU64(exitTime) == 0) {
+        startTime = fileTimeToU64(creationTime);
+    }
+    CloseHandle(hProcess);
+    return startTime;
+}
+
+std::unique_ptr<Collector> createPlatformCollector(unsigned samplingThreads) {
+    return std::unique_ptr<Collector>(new Win32Collector(samplingThreads));
+}
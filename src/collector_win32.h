@@ -0,0 +1,74 @@
+#ifndef COLLECTOR_WIN32_H
+#define COLLECTOR_WIN32_H
+
+#include "collector.h"
+#include "worker_pool.h"
+
+#include <unordered_map>
+#include <vector>
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+class Win32Collector : public Collector {
+public:
+    explicit Win32Collector(unsigned samplingThreads = 0);
+    ~Win32Collector() override;
+
+    bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) override;
+    void sampleSystem(RawSample& out) override;
+    void sampleProcesses(RawSample& out) override;
+    void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) override;
+    ExtraProcessInfo readExtraProcessInfo(unsigned long pid) override;
+    SignalResult signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) override;
+    unsigned long long readStartTime(unsigned long pid) override;
+
+private:
+    // Handle aberto para um PID, valido enquanto o processo com este
+    // creationTime existir. Um handle mantem o objeto do processo vivo, entao
+    // saida ou reuso do PID aparecem como exitTime != 0 ou creationTime diferente.
+    struct CachedProcess {
+        HANDLE handle = NULL;
+        ULONGLONG creationTime = 0;
+        // Lido quando o handle e (re)aberto, ou seja, uma vez por processo.
+        ProcessMetadataRef metadata;
+        // Ultimos tempos lidos e pico do working set, para o registro de saida.
+        ULONGLONG lastKernel = 0;
+        ULONGLONG lastUser = 0;
+        unsigned long long peakRss = 0;
+        // Posicao em RawSample::processes no tick atual.
+        size_t sampleIndex = 0;
+        bool seen = false;
+    };
+
+    bool enumerateProcesses(DWORD& count);
+    bool querySystemProcesses();
+    void readProcessorTimes(RawSample& out);
+    void readProcessCounters(RawSample& out);
+    HANDLE acquireProcess(CachedProcess& cached, DWORD pid, RawProcessSample& proc, CollectorStats& stats);
+    void sampleProcess(CachedProcess& cached, DWORD pid, RawProcessSample& proc, CollectorStats& stats);
+    ProcessMetadataRef loadMetadata(HANDLE hProcess);
+    InternedName lookupUser(HANDLE hProcess);
+    void recordExit(DWORD pid, const CachedProcess& cached, std::vector<ProcessExit>& exits);
+
+    std::vector<DWORD> m_pidBuffer;
+    std::unordered_map<DWORD, CachedProcess> m_processHandles;
+
+    WorkerPool m_pool;
+    std::vector<DWORD> m_pids;
+    std::vector<CachedProcess*> m_cachedProcesses;
+    std::vector<CollectorStats> m_workerStats;
+
+    // Resultado de NtQuerySystemInformation, reaproveitado entre ticks.
+    std::vector<BYTE> m_systemProcesses;
+    // Uma ProcessorPerformanceEntry por processador.
+    std::vector<BYTE> m_processorInfo;
+
+    NameInterner m_names;
+    // Compartilhado por todos os processos que OpenProcess recusa.
+    ProcessMetadataRef m_deniedMetadata;
+};
+
+#endif
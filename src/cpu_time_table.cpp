@@ -0,0 +1,177 @@
+#include "cpu_time_table.h"
+
+#include <algorithm>
+
+static size_t roundUpPow2(size_t n) {
+    size_t capacity = 16;
+    while (capacity < n) capacity <<= 1;
+    return capacity;
+}
+
+static unsigned log2Pow2(size_t n) {
+    unsigned bits = 0;
+    while (((size_t)1 << bits) < n) ++bits;
+    return bits;
+}
+
+CpuTimeTable::CpuTimeTable(size_t initialCapacity, size_t counterCount) :
+    m_counters(counterCount),
+    m_scratchCounters(counterCount)
+{
+    size_t capacity = roundUpPow2(initialCapacity);
+    m_keys.assign(capacity, 0);
+    m_generations.assign(capacity, EMPTY);
+    m_startTimes.assign(capacity, 0);
+    m_kernelTimes.assign(capacity, 0);
+    m_userTimes.assign(capacity, 0);
+    for (std::vector<unsigned long long>& column : m_counters) {
+        column.assign(capacity, 0);
+    }
+    m_shift = 64 - log2Pow2(capacity);
+}
+
+size_t CpuTimeTable::slotFor(unsigned long key) const {
+    return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> m_shift);
+}
+
+bool CpuTimeTable::isStale(uint32_t generation) const {
+    return generation != EMPTY && generation + 1 < m_generation;
+}
+
+void CpuTimeTable::nextGeneration() {
+    m_liveCount = 0;
+    if (m_generation == UINT32_MAX) {
+        std::fill(m_generations.begin(), m_generations.end(), EMPTY);
+        m_occupied = 0;
+        m_generation = 1;
+        return;
+    }
+    ++m_generation;
+}
+
+void CpuTimeTable::rehash(size_t newCapacity) {
+    m_scratchKeys.resize(newCapacity);
+    m_scratchGenerations.assign(newCapacity, EMPTY);
+    m_scratchStartTimes.resize(newCapacity);
+    m_scratchKernelTimes.resize(newCapacity);
+    m_scratchUserTimes.resize(newCapacity);
+    for (std::vector<unsigned long long>& column : m_scratchCounters) {
+        column.resize(newCapacity);
+    }
+
+    unsigned newShift = 64 - log2Pow2(newCapacity);
+    size_t mask = newCapacity - 1;
+    size_t occupied = 0;
+
+    for (size_t i = 0; i < m_keys.size(); ++i) {
+        uint32_t generation = m_generations[i];
+        if (generation == EMPTY || isStale(generation)) continue;
+
+        size_t slot = (size_t)(((uint64_t)m_keys[i] * 0x9E3779B97F4A7C15ull) >> newShift);
+        while (m_scratchGenerations[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        m_scratchKeys[slot] = m_keys[i];
+        m_scratchGenerations[slot] = generation;
+        m_scratchStartTimes[slot] = m_startTimes[i];
+        m_scratchKernelTimes[slot] = m_kernelTimes[i];
+        m_scratchUserTimes[slot] = m_userTimes[i];
+        for (size_t c = 0; c < m_counters.size(); ++c) {
+            m_scratchCounters[c][slot] = m_counters[c][i];
+        }
+        ++occupied;
+    }
+
+    m_keys.swap(m_scratchKeys);
+    m_generations.swap(m_scratchGenerations);
+    m_startTimes.swap(m_scratchStartTimes);
+    m_kernelTimes.swap(m_scratchKernelTimes);
+    m_userTimes.swap(m_scratchUserTimes);
+    for (size_t c = 0; c < m_counters.size(); ++c) {
+        m_counters[c].swap(m_scratchCounters[c]);
+    }
+    m_shift = newShift;
+    m_occupied = occupied;
+}
+
+size_t CpuTimeTable::findSlot(unsigned long key, unsigned long long startTime, bool& hasPrevious) {
+    // Ocupacao maxima de 75% (vivas + antigas ainda nao reaproveitadas); se a
+    // compactacao nao libera espaco, a tabela dobra.
+    if ((m_liveCount + 1) * 2 > m_keys.size()) {
+        rehash(m_keys.size() * 2);
+    }
+    else if ((m_occupied + 1) * 4 > m_keys.size() * 3) {
+        rehash(m_keys.size());
+        if ((m_occupied + 1) * 4 > m_keys.size() * 3) {
+            rehash(m_keys.size() * 2);
+        }
+    }
+
+    size_t mask = m_keys.size() - 1;
+    size_t slot = slotFor(key);
+    size_t freeSlot = (size_t)-1;
+
+    for (;;) {
+        uint32_t generation = m_generations[slot];
+        if (generation == EMPTY) break;
+
+        if (m_keys[slot] == key) {
+            hasPrevious = generation + 1 == m_generation && m_startTimes[slot] == startTime;
+            if (generation != m_generation) {
+                ++m_liveCount;
+            }
+            m_generations[slot] = m_generation;
+            m_startTimes[slot] = startTime;
+            return slot;
+        }
+
+        if (freeSlot == (size_t)-1 && isStale(generation)) {
+            freeSlot = slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (freeSlot == (size_t)-1) {
+        freeSlot = slot;
+        ++m_occupied;
+    }
+    m_keys[freeSlot] = key;
+    m_generations[freeSlot] = m_generation;
+    m_startTimes[freeSlot] = startTime;
+    ++m_liveCount;
+    hasPrevious = false;
+    return freeSlot;
+}
+
+bool CpuTimeTable::update(unsigned long key, unsigned long long startTime, unsigned long long kernelTime,
+    unsigned long long userTime, unsigned long long& previousKernel, unsigned long long& previousUser) {
+    bool hasPrevious;
+    size_t slot = findSlot(key, startTime, hasPrevious);
+    if (hasPrevious) {
+        previousKernel = m_kernelTimes[slot];
+        previousUser = m_userTimes[slot];
+    }
+    m_kernelTimes[slot] = kernelTime;
+    m_userTimes[slot] = userTime;
+    return hasPrevious;
+}
+
+bool CpuTimeTable::update(unsigned long key, unsigned long long startTime, unsigned long long kernelTime,
+    unsigned long long userTime, const unsigned long long* counters, unsigned long long& previousKernel,
+    unsigned long long& previousUser, unsigned long long* previousCounters) {
+    bool hasPrevious;
+    size_t slot = findSlot(key, startTime, hasPrevious);
+    if (hasPrevious) {
+        previousKernel = m_kernelTimes[slot];
+        previousUser = m_userTimes[slot];
+        for (size_t c = 0; c < m_counters.size(); ++c) {
+            previousCounters[c] = m_counters[c][slot];
+        }
+    }
+    m_kernelTimes[slot] = kernelTime;
+    m_userTimes[slot] = userTime;
+    for (size_t c = 0; c < m_counters.size(); ++c) {
+        m_counters[c][slot] = counters[c];
+    }
+    return hasPrevious;
+}
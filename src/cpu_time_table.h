@@ -0,0 +1,75 @@
+#ifndef CPU_TIME_TABLE_H
+#define CPU_TIME_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Tabela hash de enderecamento aberto (sondagem linear) PID/TID -> tempos de
+// CPU, com os tempos de kernel e usuario em arrays separados. Cada entrada
+// guarda a geracao (tick) em que foi escrita: so as da geracao anterior servem
+// de base para o delta, e as mais antigas sao tratadas como livres e
+// reaproveitadas na insercao, sem reconstruir a tabela a cada tick. Cada
+// entrada guarda tambem o instante de inicio do dono da chave: um PID
+// reaproveitado nao herda os tempos do processo anterior.
+//
+// Opcionalmente guarda, tambem em arrays separados, counterCount contadores
+// cumulativos extras por chave (ex.: bytes de I/O, faltas de pagina), com a
+// mesma regra de geracao dos tempos.
+class CpuTimeTable {
+public:
+    explicit CpuTimeTable(size_t initialCapacity = 256, size_t counterCount = 0);
+
+    // Inicia um novo tick. Entradas nao atualizadas no tick anterior deixam
+    // de ser consideradas.
+    void nextGeneration();
+
+    // Grava os tempos de `key` no tick atual. Retorna true e preenche
+    // previousKernel/previousUser se a chave foi gravada no tick anterior com
+    // o mesmo startTime (0 quando a plataforma nao informa).
+    bool update(unsigned long key, unsigned long long startTime, unsigned long long kernelTime,
+        unsigned long long userTime, unsigned long long& previousKernel, unsigned long long& previousUser);
+    // Idem, gravando tambem os counterCount() contadores extras; previous
+    // recebe os do tick anterior quando o retorno e true.
+    bool update(unsigned long key, unsigned long long startTime, unsigned long long kernelTime,
+        unsigned long long userTime, const unsigned long long* counters, unsigned long long& previousKernel,
+        unsigned long long& previousUser, unsigned long long* previousCounters);
+
+    size_t counterCount() const { return m_counters.size(); }
+    size_t liveCount() const { return m_liveCount; }
+    size_t capacity() const { return m_keys.size(); }
+
+private:
+    static constexpr uint32_t EMPTY = 0;
+
+    size_t slotFor(unsigned long key) const;
+    bool isStale(uint32_t generation) const;
+    void rehash(size_t newCapacity);
+    // Slot de `key` no tick atual (inserindo se preciso); hasPrevious indica
+    // se o slot guarda os valores do tick anterior do mesmo startTime.
+    size_t findSlot(unsigned long key, unsigned long long startTime, bool& hasPrevious);
+
+    std::vector<unsigned long> m_keys;
+    std::vector<uint32_t> m_generations;
+    std::vector<unsigned long long> m_startTimes;
+    std::vector<unsigned long long> m_kernelTimes;
+    std::vector<unsigned long long> m_userTimes;
+    // Um array por contador extra.
+    std::vector<std::vector<unsigned long long>> m_counters;
+
+    // Arrays reservados para o rehash de compactacao, que nao aloca depois
+    // do primeiro uso na mesma capacidade.
+    std::vector<unsigned long> m_scratchKeys;
+    std::vector<uint32_t> m_scratchGenerations;
+    std::vector<unsigned long long> m_scratchStartTimes;
+    std::vector<unsigned long long> m_scratchKernelTimes;
+    std::vector<unsigned long long> m_scratchUserTimes;
+    std::vector<std::vector<unsigned long long>> m_scratchCounters;
+
+    uint32_t m_generation = 1;
+    size_t m_liveCount = 0;
+    size_t m_occupied = 0;
+    unsigned m_shift = 0;
+};
+
+#endif
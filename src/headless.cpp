@@ -0,0 +1,616 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "backend.h"
+#include "metrics_server.h"
+#include "profiler.h"
+#include "raw_recording.h"
+#include "stream_format.h"
+#include "ui_format.h"
+
+static volatile std::sig_atomic_t g_stopRequested = 0;
+
+static void onSignal(int) {
+    g_stopRequested = 1;
+}
+
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+        "Uso: %s [-o arquivo] [-n ticks] [-f pid] [-j threads] [-i ms] [-S ms] [-P ms] [-T ms] [-a]\n"
+        "          [-H historico [-R horas]] [-d segundos] [-e] [-x arquivo]\n"
+        "          [-q consulta] [-c] [-u] [-z] [-m socket [-K processos]]\n"
+        "          [-p pid [-F hz] [-M perf|ptrace] [-g arquivo]] [-w arquivo]\n"
+        "          [-k consulta [-t] [-G ms]] [-r regras [-l arquivo]]\n"
+        "  -o arquivo  grava o stream binario no arquivo (padrao: stdout)\n"
+        "  -n ticks    encerra apos N ticks (padrao: sem limite)\n"
+        "  -f pid      inclui as threads deste processo em cada tick (repetivel)\n"
+        "  -j threads  workers da amostragem de processos (padrao: automatico)\n"
+        "  -i ms       periodo de todas as camadas (padrao: 1000)\n"
+        "  -S ms       periodo dos totais do sistema (memoria e CPU)\n"
+        "  -P ms       periodo da lista de processos\n"
+        "  -T ms       periodo das threads do processo em foco\n"
+        "  -a          aumenta o periodo de uma camada quando o tick estoura o prazo\n"
+        "  -H arquivo  mantem o historico em anel neste arquivo\n"
+        "  -R horas    horas de historico guardadas (padrao: 1)\n"
+        "  -d segundos imprime o custo do proprio monitor a cada N segundos\n"
+        "  -e          acompanha criacao e saida de processos por eventos do kernel\n"
+        "  -x arquivo  grava uma linha (TSV) por processo encerrado\n"
+        "  -q consulta imprime em stderr, a cada lista nova, os processos da consulta:\n"
+        "              top=N,sort=pid|name|cpu|mem|read|write|faults|switches,\n"
+        "              asc,name=texto,user=nome,\n"
+        "              mincpu=%%,minmem=bytes[K|M|G],regex=expr (por ultimo)\n"
+        "  -c          imprime em stderr, a cada lista nova, a arvore de cgroups\n"
+        "  -u          imprime em stderr, a cada snapshot, a divisao da CPU e a pressao\n"
+        "  -z          sem zona morta no diff: qualquer variacao de CPU, memoria ou\n"
+        "              taxa conta como mudanca\n"
+        "  -m socket   serve as metricas do ultimo snapshot neste socket Unix\n"
+        "              (GET /metrics: texto do Prometheus; GET /metrics.bin: binario)\n"
+        "  -K N        so os N processos de mais memoria tem series proprias\n"
+        "  -p pid      amostra as pilhas deste processo e imprime as funcoes mais\n"
+        "              quentes ao sair\n"
+        "  -F hz       amostras por segundo de CPU de cada thread (padrao: 99)\n"
+        "  -M metodo   perf ou ptrace (padrao: perf, com ptrace se nao houver permissao)\n"
+        "  -g arquivo  grava as pilhas no formato folded (flamegraph.pl, speedscope)\n"
+        "  -w arquivo  grava as leituras brutas do coletor, para o MeuMonitorReplay\n"
+        "  -k consulta encerra os processos da consulta (mesmo formato de -q) na\n"
+        "              primeira lista: SIGTERM e, apos o prazo, SIGKILL; exige um\n"
+        "              filtro (name, regex, user, mincpu, minmem) ou top\n"
+        "  -t          -k inclui os descendentes de cada processo\n"
+        "  -G ms       prazo entre o SIGTERM e o SIGKILL de -k (padrao: 5000)\n"
+        "  -r regras   avalia as regras de alerta do arquivo e imprime em stderr\n"
+        "              cada alerta que dispara ou termina\n"
+        "  -l arquivo  anexa os eventos de alerta ao arquivo (TSV)\n",
+        argv0);
+}
+
+// Custo do proprio monitor, em stderr: uma linha com CPU/RSS/syscalls e uma
+// por fase com media, p50, p99 e maximo.
+static void printDiagnostics(const MonitorDiagnostics& diagnostics) {
+    fprintf(stderr, "monitor: CPU %.3f%% de um nucleo (media %.3f%%, %.2f s em %.0f s), RSS %.1f MB, %llu syscalls no ultimo tick",
+        diagnostics.selfCpuPercent, diagnostics.selfCpuAveragePercent, diagnostics.selfCpuSeconds,
+        diagnostics.uptimeSeconds, diagnostics.selfRssBytes / (1024.0 * 1024.0), diagnostics.syscallsLastTick);
+    if (diagnostics.allocationsCounted) {
+        fprintf(stderr, ", %llu alocacoes no ultimo tick\n", diagnostics.allocationsLastTick);
+    }
+    else {
+        fprintf(stderr, "\n");
+    }
+    for (unsigned phase = 0; phase < PHASE_COUNT; ++phase) {
+        const PhaseHistogram& histogram = diagnostics.phases[phase];
+        if (histogram.samples == 0) continue;
+        fprintf(stderr, "  %-22s %8llu x  media %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms\n",
+            phaseName((TickPhase)phase), histogram.samples, histogram.meanMs(),
+            histogram.percentileMs(0.50), histogram.percentileMs(0.99), histogram.maxMs);
+    }
+}
+
+// Uma linha por saida: horario (ms), pid, ppid, nome, CPU (s), pico de RSS
+// (bytes), codigo de saida (-1 = desconhecido) e se viveu menos que um tick.
+static void writeExits(FILE* file, const std::vector<ProcessExit>& exits) {
+    for (const ProcessExit& exit : exits) {
+        fprintf(file, "%llu\t%lu\t%lu\t%s\t%.3f\t%llu\t%d\t%d\n",
+            exit.timestampMs, exit.pid, exit.parentPid, exit.name.c_str(), exit.cpuSeconds,
+            exit.peakRssBytes, exit.exitCode, exit.shortLived ? 1 : 0);
+    }
+}
+
+// Saidas dos diffs recem-chegados (de first em diante): cada lista e vista
+// uma vez, mesmo que varias saiam entre dois snapshots lidos.
+struct ExitCounts {
+    unsigned long long exits = 0;
+    unsigned long long shortLived = 0;
+};
+
+static void consumeExits(const std::vector<std::shared_ptr<const SnapshotDiff>>& diffs, size_t first,
+    FILE* exitLog, ExitCounts& counts) {
+    for (size_t i = first; i < diffs.size(); ++i) {
+        for (const ProcessExit& exit : diffs[i]->exits) {
+            ++counts.exits;
+            if (exit.shortLived) ++counts.shortLived;
+        }
+        if (exitLog != nullptr) {
+            writeExits(exitLog, diffs[i]->exits);
+        }
+    }
+}
+
+// Os count eventos mais novos; os que ja sairam do historico se perdem.
+static void printAlerts(const AlertStatus& status, unsigned long long count) {
+    size_t first = count < status.recent.size() ? status.recent.size() - (size_t)count : 0;
+    for (size_t i = first; i < status.recent.size(); ++i) {
+        const AlertEvent& event = status.recent[i];
+        char text[256];
+        formatAlertEvent(event, text, sizeof(text));
+        fprintf(stderr, "alerta %s: %s\n", event.kind == ALERT_FIRED ? "disparou" : "terminou", text);
+    }
+}
+
+static void printQuery(const ProcessQueryResult& result) {
+    if (!result.valid) {
+        fprintf(stderr, "consulta: expressao regular invalida\n");
+        return;
+    }
+    fprintf(stderr, "consulta: %zu de %zu processos que passam no filtro\n", result.processes.size(), result.matched);
+    for (const ProcessInfo& p : result.processes) {
+        ProcessRowText row;
+        formatProcessRow(p, row);
+        fprintf(stderr, "  %8lu %-24s %7.2f%% %8.1f%% %12llu %12s %12s %10s %10s\n", p.pid, p.name.c_str(),
+            p.cpuUsagePercentage, p.cpuCorePercentage, p.memoryUsedBytes, row.ioRead, row.ioWrite, row.faults, row.switches);
+    }
+}
+
+// Divisao da CPU da maquina, o nucleo mais ocupado e a pressao (PSI) do
+// ultimo intervalo, numa linha.
+static void printCpu(const SystemInfo& info) {
+    fprintf(stderr, "cpu: %u nucleos", info.cpuCoreCount);
+    for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+        fprintf(stderr, " %s %.1f%%", cpuStateName((CpuState)state), info.cpuStatePercentages[state]);
+    }
+    const CpuCoreUsage& cores = info.cpuCores;
+    unsigned busiest = 0;
+    for (unsigned core = 1; core < cores.count; ++core) {
+        if (cores.busy[core] > cores.busy[busiest]) busiest = core;
+    }
+    if (cores.count > 0) {
+        fprintf(stderr, ", mais ocupado CPU %u %.1f%%", cores.id[busiest], cores.busy[busiest]);
+    }
+    for (unsigned resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+        const PressureInfo& pressure = info.pressure[resource];
+        if (!pressure.valid) continue;
+        fprintf(stderr, ", pressao %s some %.2f%%", pressureResourceName((PressureResource)resource),
+            std::max(pressure.some.lastInterval, 0.0));
+        if (pressure.hasFull) {
+            fprintf(stderr, " full %.2f%%", std::max(pressure.full.lastInterval, 0.0));
+        }
+    }
+    fprintf(stderr, "\n");
+}
+
+// Arvore em pre-ordem, indentada pela profundidade: processos/threads, CPU
+// somada dos processos, nucleos e throttling do grupo, memoria e I/O.
+static void printCgroups(const std::vector<CgroupInfo>& cgroups) {
+    if (cgroups.empty()) return;
+    fprintf(stderr, "cgroups: %zu grupos\n", cgroups.size());
+    std::vector<uint32_t> stack(1, 0);
+    while (!stack.empty()) {
+        const CgroupInfo& group = cgroups[stack.back()];
+        stack.pop_back();
+        CgroupRowText row;
+        formatCgroupRow(group, row);
+        fprintf(stderr, "  %*s%-*s %11s %7s %5s %6s %10s %24s %12s %12s\n", (int)group.depth * 2, "",
+            std::max(1, 40 - (int)group.depth * 2), group.name.c_str(), row.processes, row.cpu, row.groupCpu,
+            row.throttled, row.memory, row.groupMemory, row.ioRead, row.ioWrite);
+        for (auto it = group.children.rbegin(); it != group.children.rend(); ++it) {
+            stack.push_back(*it);
+        }
+    }
+}
+
+static void printProfile(Profiler& profiler, const char* foldedPath) {
+    ProfileStatus status = profiler.status();
+    if (!status.error.empty()) {
+        fprintf(stderr, "perfil: falhou (%s)\n", status.error.c_str());
+        return;
+    }
+    FlameGraph graph;
+    profiler.buildFlameGraph(graph);
+    fprintf(stderr, "perfil do PID %lu via %s: %llu amostras em %.1f s, %llu perdidas\n",
+        status.pid, status.method.c_str(), status.samples, status.seconds, status.lostSamples);
+    unsigned long long total = graph.totalSamples();
+    for (const HotFunction& function : graph.hottest(15)) {
+        fprintf(stderr, "  %6.2f%% proprio  %6.2f%% total  %s\n",
+            total ? 100.0 * function.self / total : 0.0, total ? 100.0 * function.total / total : 0.0,
+            function.name.c_str());
+    }
+    if (foldedPath != nullptr && !graph.writeFolded(foldedPath)) {
+        fprintf(stderr, "Falha ao gravar %s\n", foldedPath);
+    }
+}
+
+int main(int argc, char** argv) {
+    const char* outputPath = nullptr;
+    unsigned long long maxTicks = 0;
+    std::vector<unsigned long> focusedPids;
+    const char* historyPath = nullptr;
+    double historyHours = 1.0;
+    unsigned samplingThreads = 0;
+    double diagnosticsSeconds = 0.0;
+    bool lifecycleEvents = false;
+    const char* exitLogPath = nullptr;
+    bool hasQuery = false;
+    ProcessQuery query;
+    bool showCgroups = false;
+    bool showCpu = false;
+    bool exactDiffs = false;
+    MetricsServerOptions metricsOptions;
+    unsigned long profilePid = 0;
+    ProfileOptions profileOptions;
+    const char* foldedPath = nullptr;
+    const char* recordingPath = nullptr;
+    bool hasAction = false;
+    ProcessActionRequest action;
+    action.useQuery = true;
+    std::shared_ptr<const AlertPlan> alertPlan;
+    const char* alertLogPath = nullptr;
+    SchedulerConfig schedule;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            maxTicks = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            focusedPids.push_back(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            samplingThreads = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            std::chrono::milliseconds period(strtoul(argv[++i], nullptr, 10));
+            schedule.systemPeriod = schedule.processPeriod = schedule.threadPeriod = period;
+        }
+        else if (strcmp(argv[i], "-S") == 0 && i + 1 < argc) {
+            schedule.systemPeriod = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc) {
+            schedule.processPeriod = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-T") == 0 && i + 1 < argc) {
+            schedule.threadPeriod = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-a") == 0) {
+            schedule.adaptive = true;
+        }
+        else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            historyPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-R") == 0 && i + 1 < argc) {
+            historyHours = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+            diagnosticsSeconds = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-e") == 0) {
+            lifecycleEvents = true;
+        }
+        else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            exitLogPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            if (!parseProcessQuery(argv[++i], query)) {
+                fprintf(stderr, "Consulta invalida: %s\n", argv[i]);
+                return 1;
+            }
+            hasQuery = true;
+        }
+        else if (strcmp(argv[i], "-c") == 0) {
+            showCgroups = true;
+        }
+        else if (strcmp(argv[i], "-u") == 0) {
+            showCpu = true;
+        }
+        else if (strcmp(argv[i], "-z") == 0) {
+            exactDiffs = true;
+        }
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+            metricsOptions.socketPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            metricsOptions.processLimit = (size_t)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            profilePid = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-F") == 0 && i + 1 < argc) {
+            profileOptions.frequencyHz = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc) {
+            ++i;
+            if (strcmp(argv[i], "perf") == 0) {
+                profileOptions.method = ProfileOptions::METHOD_PERF_EVENT;
+            }
+            else if (strcmp(argv[i], "ptrace") == 0) {
+                profileOptions.method = ProfileOptions::METHOD_PTRACE;
+            }
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+            foldedPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+            recordingPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc) {
+            if (!parseProcessQuery(argv[++i], action.query)) {
+                fprintf(stderr, "Consulta invalida: %s\n", argv[i]);
+                return 1;
+            }
+            // Sem filtro a consulta pega todos os processos que o usuario
+            // pode sinalizar.
+            if (!action.query.selective()) {
+                fprintf(stderr, "-k precisa de um filtro (name, regex, user, mincpu, minmem ou top): %s\n", argv[i]);
+                return 1;
+            }
+            hasAction = true;
+        }
+        else if (strcmp(argv[i], "-t") == 0) {
+            action.tree = true;
+        }
+        else if (strcmp(argv[i], "-G") == 0 && i + 1 < argc) {
+            action.gracePeriod = std::chrono::milliseconds(strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            std::shared_ptr<AlertPlan> plan = std::make_shared<AlertPlan>();
+            std::string error;
+            if (!loadAlertRules(argv[++i], *plan, error)) {
+                fprintf(stderr, "Regras de alerta invalidas (%s): %s\n", argv[i], error.c_str());
+                return 1;
+            }
+            alertPlan = plan;
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            alertLogPath = argv[++i];
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* out = stdout;
+    if (outputPath != nullptr) {
+        out = fopen(outputPath, "wb");
+        if (out == nullptr) {
+            fprintf(stderr, "Falha ao abrir %s\n", outputPath);
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    else {
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+    FILE* exitLog = nullptr;
+    if (exitLogPath != nullptr) {
+        exitLog = fopen(exitLogPath, "w");
+        if (exitLog == nullptr) {
+            fprintf(stderr, "Falha ao abrir %s\n", exitLogPath);
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::unique_ptr<Collector> collector = createPlatformCollector(samplingThreads);
+    RecordingCollector* recording = nullptr;
+    if (recordingPath != nullptr) {
+        // Aberta antes do monitor: o construtor ja faz a primeira leitura.
+        std::unique_ptr<RecordingCollector> recorder(new RecordingCollector(std::move(collector)));
+        if (!recorder->open(recordingPath)) {
+            fprintf(stderr, "Falha ao abrir %s\n", recordingPath);
+            return 1;
+        }
+        recording = recorder.get();
+        collector = std::move(recorder);
+    }
+    SystemMonitor monitor(std::move(collector));
+    monitor.setFocusedProcesses(focusedPids);
+    monitor.setSchedulerConfig(schedule);
+    if (exactDiffs) {
+        monitor.setDiffThresholds(DiffThresholds::exact());
+    }
+    // Assinado antes de start() para nao perder o diff da primeira lista.
+    std::shared_ptr<DiffSubscription> diffSubscription = monitor.subscribeDiffs();
+    if (historyPath != nullptr) {
+        // O historico recebe um ponto por amostragem da lista de processos.
+        double processPeriodSeconds = std::max<long long>(schedule.processPeriod.count(), 1) / 1000.0;
+        HistoryOptions options;
+        options.ticks = (uint32_t)std::max(1.0, historyHours * 3600.0 / processPeriodSeconds);
+        if (!monitor.enableHistory(historyPath, options)) {
+            fprintf(stderr, "Falha ao abrir o historico %s\n", historyPath);
+            return 1;
+        }
+    }
+    if (alertPlan) {
+        monitor.setAlertRules(alertPlan);
+        if (alertLogPath != nullptr && !monitor.openAlertLog(alertLogPath)) {
+            fprintf(stderr, "Falha ao abrir %s\n", alertLogPath);
+            return 1;
+        }
+    }
+    if (lifecycleEvents && !monitor.enableLifecycleEvents()) {
+        fprintf(stderr, "Eventos de processos indisponiveis (permissao ou plataforma); varrendo a lista\n");
+    }
+    monitor.start();
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (!metricsOptions.socketPath.empty()) {
+        metricsServer = createPlatformMetricsServer(monitor);
+        if (!metricsServer->start(metricsOptions)) {
+            fprintf(stderr, "Servidor de metricas: %s\n", metricsServer->stats().error.c_str());
+            metricsServer.reset();
+        }
+    }
+    std::unique_ptr<Profiler> profiler;
+    if (profilePid != 0) {
+        profiler = createPlatformProfiler();
+        profiler->start(profilePid, profileOptions);
+    }
+
+    StreamEncoder encoder;
+    std::vector<uint8_t> buffer;
+    stream_format::writeHeader(buffer);
+    unsigned long long bytesWritten = 0;
+    unsigned long long ticks = 0;
+    unsigned long long lastVersion = 0;
+    unsigned long long lastListVersion = 0;
+    // Lista que o encoder ja conhece; 0 = nenhuma.
+    unsigned long long encodedListVersion = 0;
+    std::vector<std::shared_ptr<const SnapshotDiff>> pendingDiffs;
+    std::vector<std::shared_ptr<const SnapshotDiff>> frameDiffs;
+    bool diffsComplete = true;
+    unsigned long long fullFrames = 0;
+    ExitCounts exitCounts;
+    // A fila de diffs encheu e levou saidas junto.
+    bool exitsLost = false;
+    // Acao de -k: id depois de enfileirada, e se o resultado ja foi impresso.
+    uint64_t actionId = 0;
+    bool actionReported = false;
+    // Eventos de alerta ja impressos (disparos + fins).
+    unsigned long long alertEvents = 0;
+    AlertStats alertStats;
+    CollectorStats collectorStats;
+    SchedulerStats schedulerStats;
+    MonitorDiagnostics diagnostics;
+    std::chrono::steady_clock::time_point lastDiagnostics = std::chrono::steady_clock::now();
+
+    while (!g_stopRequested && (maxTicks == 0 || ticks < maxTicks)) {
+        std::shared_ptr<const SystemInfo> snapshot =
+            monitor.waitForSnapshot(lastVersion, std::chrono::milliseconds(250));
+        if (snapshot->version == lastVersion) continue;
+        lastVersion = snapshot->version;
+        schedulerStats = snapshot->scheduler;
+        diagnostics = snapshot->diagnostics;
+        // As saidas vem pelos diffs, nao pelo snapshot: entre duas leituras
+        // podem ter saido varias listas.
+        size_t taken = pendingDiffs.size();
+        if (!diffSubscription->take(pendingDiffs)) {
+            diffsComplete = false;
+            exitsLost = true;
+        }
+        consumeExits(pendingDiffs, taken, exitLog, exitCounts);
+        if (snapshot->processListVersion != lastListVersion) {
+            lastListVersion = snapshot->processListVersion;
+            collectorStats = snapshot->collectorStats;
+            if (hasQuery) {
+                printQuery(*monitor.queryProcesses(query));
+            }
+            if (showCgroups && snapshot->cgroups) {
+                printCgroups(*snapshot->cgroups);
+            }
+            if (hasAction && actionId == 0) {
+                actionId = monitor.requestProcessAction(action);
+            }
+        }
+        if (actionId != 0 && !actionReported && snapshot->processActions) {
+            for (const ProcessActionResult& result : snapshot->processActions->actions) {
+                if (result.id != actionId || result.state != ACTION_DONE) continue;
+                char text[256];
+                formatActionResult(result, text, sizeof(text));
+                fprintf(stderr, "acao: %s\n", text);
+                actionReported = true;
+            }
+        }
+
+        alertStats = snapshot->alertStats;
+        if (snapshot->alerts && alertStats.fired + alertStats.resolved != alertEvents) {
+            printAlerts(*snapshot->alerts, alertStats.fired + alertStats.resolved - alertEvents);
+            alertEvents = alertStats.fired + alertStats.resolved;
+        }
+
+        if (showCpu) {
+            printCpu(*snapshot);
+        }
+
+        // Os diffs que levam da ultima lista enviada ate a deste snapshot;
+        // os mais novos ficam para o proximo. Se faltar algum (fila cheia),
+        // o frame compara a lista inteira.
+        frameDiffs.clear();
+        unsigned long long reached = encodedListVersion;
+        bool contiguous = diffsComplete && encodedListVersion != 0;
+        size_t used = 0;
+        for (; used < pendingDiffs.size() && pendingDiffs[used]->toListVersion <= snapshot->processListVersion; ++used) {
+            const SnapshotDiff& diff = *pendingDiffs[used];
+            if (diff.toListVersion <= encodedListVersion) continue;
+            if (diff.fromListVersion == 0 || diff.fromListVersion != reached) contiguous = false;
+            reached = diff.toListVersion;
+            frameDiffs.push_back(pendingDiffs[used]);
+        }
+        pendingDiffs.erase(pendingDiffs.begin(), pendingDiffs.begin() + used);
+
+        if (contiguous && reached == snapshot->processListVersion) {
+            encoder.encodeTick(*snapshot, frameDiffs, buffer);
+        }
+        else {
+            encoder.encodeTick(*snapshot, buffer);
+            ++fullFrames;
+        }
+        encodedListVersion = snapshot->processListVersion;
+        diffsComplete = true;
+        if (fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size() || fflush(out) != 0) {
+            fprintf(stderr, "Falha ao gravar o stream\n");
+            break;
+        }
+        bytesWritten += buffer.size();
+        buffer.clear();
+        ++ticks;
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (diagnosticsSeconds > 0.0 && std::chrono::duration<double>(now - lastDiagnostics).count() >= diagnosticsSeconds) {
+            printDiagnostics(diagnostics);
+            lastDiagnostics = now;
+        }
+    }
+
+    if (metricsServer) {
+        metricsServer->stop();
+    }
+    monitor.stop();
+    // Saidas das listas publicadas depois do ultimo snapshot lido.
+    size_t taken = pendingDiffs.size();
+    if (!diffSubscription->take(pendingDiffs)) exitsLost = true;
+    consumeExits(pendingDiffs, taken, exitLog, exitCounts);
+    if (profiler) {
+        profiler->stop();
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (exitLog != nullptr) {
+        fclose(exitLog);
+    }
+
+    fprintf(stderr, "%llu ticks, %llu bytes (%.1f bytes/tick), %llu frames comparando a lista inteira\n",
+        ticks, bytesWritten, ticks ? (double)bytesWritten / ticks : 0.0, fullFrames);
+    fprintf(stderr, "agendador: %llu prazos perdidos, periodos efetivos %.0f/%.0f/%.0f ms (sistema/processos/threads)\n",
+        schedulerStats.missedDeadlines, schedulerStats.systemPeriodMs,
+        schedulerStats.processPeriodMs, schedulerStats.threadPeriodMs);
+    fprintf(stderr, "processos encerrados: %llu (%llu antes de aparecer numa lista%s), lista %s",
+        exitCounts.exits, exitCounts.shortLived, exitsLost ? "; parte perdida com a fila de diffs cheia" : "",
+        collectorStats.eventDriven ? "por eventos" : "por varredura");
+    if (collectorStats.eventDriven) {
+        fprintf(stderr, " (%lu eventos e %lu varreduras no ultimo tick)", collectorStats.lifecycleEvents, collectorStats.rescans);
+    }
+    fprintf(stderr, "\n");
+    if (metricsServer) {
+        MetricsServerStats metricsStats = metricsServer->stats();
+        fprintf(stderr, "metricas: %llu pedidos, %llu serializacoes, %llu recusados, %llu bytes enviados\n",
+            metricsStats.requests, metricsStats.serializations, metricsStats.rejected, metricsStats.bytesSent);
+    }
+    if (alertPlan) {
+        fprintf(stderr, "alertas: %u regras, %llu disparos, %llu fins, %lu ainda valendo ou em espera, %llu avaliacoes\n",
+            alertStats.rules, alertStats.fired, alertStats.resolved, alertStats.states, alertStats.evaluations);
+    }
+    if (recording != nullptr) {
+        fprintf(stderr, "gravacao: %llu bytes em %s\n", recording->bytesWritten(), recordingPath);
+    }
+    printDiagnostics(diagnostics);
+    if (profiler) {
+        printProfile(*profiler, foldedPath);
+    }
+    return 0;
+}
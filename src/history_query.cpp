@@ -0,0 +1,73 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "history_store.h"
+
+// Consultas sobre o historico gravado pelo MeuMonitorHeadless -H. As janelas
+// sao relativas ao tick mais recente do arquivo.
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+        "Uso: %s arquivo comando\n"
+        "  top K segundos        processos com maior CPU media na janela\n"
+        "  processo PID segundos serie de CPU/memoria de um processo\n"
+        "  sistema segundos      serie de CPU/RAM do sistema\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    HistoryStore store;
+    if (!store.open(argv[1], HistoryOptions(), true)) {
+        fprintf(stderr, "Falha ao abrir o historico %s\n", argv[1]);
+        return 1;
+    }
+
+    unsigned long long oldestMs = 0, newestMs = 0;
+    if (!store.timeRange(oldestMs, newestMs)) {
+        fprintf(stderr, "Historico vazio\n");
+        return 0;
+    }
+
+    const char* command = argv[2];
+    if (strcmp(command, "top") == 0 && argc >= 5) {
+        size_t k = strtoul(argv[3], nullptr, 10);
+        unsigned long long windowMs = strtoull(argv[4], nullptr, 10) * 1000;
+        unsigned long long fromMs = newestMs > windowMs ? newestMs - windowMs : 0;
+        printf("%8s %-24s %10s %10s %14s %8s\n", "PID", "Nome", "CPU media", "CPU max", "Pico memoria", "Amostras");
+        for (const HistoryTopEntry& e : store.topByCpu(fromMs, newestMs, k)) {
+            printf("%8lu %-24s %9.2f%% %9.2f%% %14llu %8u\n",
+                e.pid, e.name.c_str(), e.averageCpu, e.maxCpu, e.peakMemoryBytes, e.samples);
+        }
+    }
+    else if (strcmp(command, "processo") == 0 && argc >= 5) {
+        unsigned long pid = strtoul(argv[3], nullptr, 10);
+        unsigned long long windowMs = strtoull(argv[4], nullptr, 10) * 1000;
+        unsigned long long fromMs = newestMs > windowMs ? newestMs - windowMs : 0;
+        unsigned long long startTime = 0;
+        for (const HistoryProcessPoint& point : store.processSeries(pid, fromMs, newestMs)) {
+            if (startTime != 0 && point.startTime != startTime) {
+                printf("# PID reaproveitado por outro processo\n");
+            }
+            startTime = point.startTime;
+            printf("%llu %.2f%% %llu\n", point.timestampMs, point.cpuUsagePercentage, point.memoryUsedBytes);
+        }
+    }
+    else if (strcmp(command, "sistema") == 0) {
+        unsigned long long windowMs = strtoull(argv[3], nullptr, 10) * 1000;
+        unsigned long long fromMs = newestMs > windowMs ? newestMs - windowMs : 0;
+        for (const HistoryTick& tick : store.systemSeries(fromMs, newestMs)) {
+            printf("%llu cpu=%.2f%% ram=%llu/%llu processos=%u\n", tick.timestampMs,
+                tick.cpuLoadPercentage, tick.ramUsedBytes, tick.ramTotalBytes, tick.processCount);
+        }
+    }
+    else {
+        printUsage(argv[0]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,527 @@
+#include "history_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "snapshot_diff.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char HISTORY_MAGIC[8] = { 'P', 'C', 'H', 'K', 'H', 'I', 'S', 'T' };
+// 2: startTime por processo e na tabela de nomes.
+static const uint32_t HISTORY_FORMAT_VERSION = 2;
+static const size_t HEADER_SIZE = 4096;
+
+struct HistoryStore::Header {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t ticks;
+    uint32_t processSlots;
+    uint32_t nameSlots;
+    // Proximo indice fisico a ser escrito e quantos ticks sao validos.
+    uint64_t head;
+    uint64_t count;
+};
+
+// Chave (pid, startTime): o nome de um processo que ja saiu continua ate
+// outro ocupar a entrada, mesmo que o PID tenha sido reaproveitado.
+struct HistoryStore::NameEntry {
+    uint32_t pid;
+    uint32_t reserved;
+    uint64_t startTime;
+    char name[48];
+};
+static const size_t NAME_ENTRY_SIZE = 64;
+
+namespace {
+
+struct Layout {
+    size_t timestamps, cpuLoad, ramUsed, ramTotal, processCount;
+    size_t pids, startTimes, cpu, memory, names;
+    size_t total;
+};
+
+size_t alignUp(size_t value) {
+    return (value + 63) & ~(size_t)63;
+}
+
+Layout computeLayout(uint32_t ticks, uint32_t slots, uint32_t nameSlots) {
+    Layout l;
+    size_t t = ticks, cells = (size_t)ticks * slots;
+    size_t offset = HEADER_SIZE;
+    l.timestamps = offset;   offset = alignUp(offset + t * sizeof(uint64_t));
+    l.cpuLoad = offset;      offset = alignUp(offset + t * sizeof(float));
+    l.ramUsed = offset;      offset = alignUp(offset + t * sizeof(uint64_t));
+    l.ramTotal = offset;     offset = alignUp(offset + t * sizeof(uint64_t));
+    l.processCount = offset; offset = alignUp(offset + t * sizeof(uint32_t));
+    l.pids = offset;         offset = alignUp(offset + cells * sizeof(uint32_t));
+    l.startTimes = offset;   offset = alignUp(offset + cells * sizeof(uint64_t));
+    l.cpu = offset;          offset = alignUp(offset + cells * sizeof(float));
+    l.memory = offset;       offset = alignUp(offset + cells * sizeof(uint64_t));
+    l.names = offset;        offset = alignUp(offset + (size_t)nameSlots * NAME_ENTRY_SIZE);
+    l.total = offset;
+    return l;
+}
+
+// head/count sao lidos uma vez por consulta: outro processo pode estar
+// gravando no mesmo arquivo.
+struct RingView {
+    size_t ticks;
+    size_t head;
+    size_t count;
+
+    size_t physical(size_t logical) const {
+        return (head + ticks - count + logical) % ticks;
+    }
+};
+
+}
+
+HistoryStore::HistoryStore() {
+}
+
+HistoryStore::~HistoryStore() {
+    close();
+}
+
+#ifdef _WIN32
+bool HistoryStore::mapFile(const std::string& path, size_t size, bool readOnly, bool& created) {
+    created = false;
+    HANDLE file = CreateFileA(path.c_str(), readOnly ? GENERIC_READ : (GENERIC_READ | GENERIC_WRITE),
+        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, readOnly ? OPEN_EXISTING : OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER currentSize;
+    if (!GetFileSizeEx(file, &currentSize)) {
+        CloseHandle(file);
+        return false;
+    }
+    if (readOnly) {
+        size = (size_t)currentSize.QuadPart;
+    }
+    else if ((size_t)currentSize.QuadPart != size) {
+        LARGE_INTEGER newSize;
+        newSize.QuadPart = (LONGLONG)size;
+        if (!SetFilePointerEx(file, newSize, NULL, FILE_BEGIN) || !SetEndOfFile(file)) {
+            CloseHandle(file);
+            return false;
+        }
+        created = true;
+    }
+    if (size < HEADER_SIZE) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, readOnly ? PAGE_READONLY : PAGE_READWRITE, 0, 0, NULL);
+    if (mapping == NULL) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+    if (view == NULL) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file = file;
+    m_mapping = mapping;
+    m_base = (uint8_t*)view;
+    m_size = size;
+    return true;
+}
+
+void HistoryStore::unmapFile() {
+    if (m_base != nullptr) {
+        FlushViewOfFile(m_base, 0);
+        UnmapViewOfFile(m_base);
+    }
+    if (m_mapping != nullptr) CloseHandle((HANDLE)m_mapping);
+    if (m_file != nullptr) CloseHandle((HANDLE)m_file);
+    m_base = nullptr;
+    m_mapping = nullptr;
+    m_file = nullptr;
+    m_size = 0;
+}
+#else
+bool HistoryStore::mapFile(const std::string& path, size_t size, bool readOnly, bool& created) {
+    created = false;
+    int fd = ::open(path.c_str(), readOnly ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (readOnly) {
+        size = (size_t)st.st_size;
+    }
+    else if ((size_t)st.st_size != size) {
+        // Geometria diferente: recomeca do zero em vez de interpretar dados
+        // com outro layout.
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0) {
+            ::close(fd);
+            return false;
+        }
+        created = true;
+    }
+    if (size < HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+
+    void* base = mmap(nullptr, size, readOnly ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    m_base = (uint8_t*)base;
+    m_size = size;
+    return true;
+}
+
+void HistoryStore::unmapFile() {
+    if (m_base != nullptr) {
+        if (!m_readOnly) msync(m_base, m_size, MS_ASYNC);
+        munmap(m_base, m_size);
+    }
+    if (m_fd >= 0) ::close(m_fd);
+    m_base = nullptr;
+    m_fd = -1;
+    m_size = 0;
+}
+#endif
+
+void HistoryStore::layoutColumns() {
+    static_assert(sizeof(NameEntry) == NAME_ENTRY_SIZE, "NameEntry faz parte do formato do arquivo");
+    Layout l = computeLayout(m_header->ticks, m_header->processSlots, m_header->nameSlots);
+    m_timestamps = (uint64_t*)(m_base + l.timestamps);
+    m_cpuLoad = (float*)(m_base + l.cpuLoad);
+    m_ramUsed = (uint64_t*)(m_base + l.ramUsed);
+    m_ramTotal = (uint64_t*)(m_base + l.ramTotal);
+    m_processCount = (uint32_t*)(m_base + l.processCount);
+    m_pids = (uint32_t*)(m_base + l.pids);
+    m_startTimes = (uint64_t*)(m_base + l.startTimes);
+    m_cpu = (float*)(m_base + l.cpu);
+    m_memory = (uint64_t*)(m_base + l.memory);
+    m_names = (NameEntry*)(m_base + l.names);
+}
+
+bool HistoryStore::open(const std::string& path, const HistoryOptions& options, bool readOnly) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_base != nullptr) unmapFile();
+    m_lastListVersion = 0;
+    if (!readOnly && (options.ticks == 0 || options.processSlots == 0 || options.nameSlots == 0)) {
+        return false;
+    }
+
+    Layout layout = computeLayout(options.ticks, options.processSlots, options.nameSlots);
+    bool created = false;
+    m_readOnly = readOnly;
+    if (!mapFile(path, layout.total, readOnly, created)) {
+        return false;
+    }
+    m_header = (Header*)m_base;
+
+    bool valid = memcmp(m_header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) == 0 &&
+        m_header->formatVersion == HISTORY_FORMAT_VERSION &&
+        m_header->ticks != 0 && m_header->processSlots != 0 && m_header->nameSlots != 0;
+
+    if (readOnly) {
+        if (!valid || computeLayout(m_header->ticks, m_header->processSlots, m_header->nameSlots).total > m_size) {
+            unmapFile();
+            return false;
+        }
+    }
+    else {
+        valid = valid && !created &&
+            m_header->ticks == options.ticks &&
+            m_header->processSlots == options.processSlots &&
+            m_header->nameSlots == options.nameSlots;
+        if (!valid) {
+            memset(m_base, 0, HEADER_SIZE);
+            memcpy(m_header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+            m_header->formatVersion = HISTORY_FORMAT_VERSION;
+            m_header->ticks = options.ticks;
+            m_header->processSlots = options.processSlots;
+            m_header->nameSlots = options.nameSlots;
+            memset(m_base + layout.names, 0, layout.total - layout.names);
+        }
+    }
+
+    layoutColumns();
+    return true;
+}
+
+void HistoryStore::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    unmapFile();
+    m_header = nullptr;
+}
+
+void HistoryStore::append(const SystemInfo& info) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_base == nullptr || m_readOnly) return;
+
+    size_t ticks = m_header->ticks;
+    size_t slots = m_header->processSlots;
+    size_t index = (size_t)m_header->head;
+
+    m_selected.clear();
+    for (const ProcessInfo& p : info.processes) {
+        m_selected.push_back(&p);
+    }
+    if (m_selected.size() > slots) {
+        std::nth_element(m_selected.begin(), m_selected.begin() + slots, m_selected.end(),
+            [](const ProcessInfo* a, const ProcessInfo* b) {
+                return a->cpuUsagePercentage > b->cpuUsagePercentage;
+            });
+        m_selected.resize(slots);
+    }
+
+    // A busca binaria depende de timestamps nao decrescentes, mesmo que o
+    // relogio volte.
+    unsigned long long timestampMs = info.timestampMs;
+    if (m_header->count > 0) {
+        size_t previous = (index + ticks - 1) % ticks;
+        timestampMs = std::max<unsigned long long>(timestampMs, m_timestamps[previous]);
+    }
+
+    m_timestamps[index] = timestampMs;
+    m_cpuLoad[index] = (float)info.cpuLoadPercentage;
+    m_ramUsed[index] = info.ramUsedBytes;
+    m_ramTotal[index] = info.ramTotalBytes;
+    m_processCount[index] = (uint32_t)m_selected.size();
+
+    uint32_t* pids = m_pids + index * slots;
+    uint64_t* startTimes = m_startTimes + index * slots;
+    float* cpu = m_cpu + index * slots;
+    uint64_t* memory = m_memory + index * slots;
+    for (size_t i = 0; i < m_selected.size(); ++i) {
+        const ProcessInfo& p = *m_selected[i];
+        pids[i] = (uint32_t)p.pid;
+        startTimes[i] = p.startTime;
+        cpu[i] = (float)p.cpuUsagePercentage;
+        memory[i] = p.memoryUsedBytes;
+    }
+
+    // Os nomes so mudam com processos novos ou exec; o diff diz quais.
+    const SnapshotDiff* diff = info.processDiff.get();
+    bool namesFromDiff = diff != nullptr && diff->fromListVersion != 0 && diff->fromListVersion == m_lastListVersion;
+    if (namesFromDiff) {
+        for (const ProcessChange& change : diff->changes) {
+            if ((change.fields & (CHANGE_ADDED | CHANGE_NAME)) && !storeName(change.process)) {
+                namesFromDiff = false;
+            }
+        }
+    }
+    if (!namesFromDiff) {
+        for (const ProcessInfo* p : m_selected) {
+            storeName(*p);
+        }
+    }
+    m_lastListVersion = info.processListVersion;
+
+    // Os dados do tick precisam estar visiveis antes de head/count avancarem.
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->head = (index + 1) % ticks;
+    if (m_header->count < ticks) {
+        m_header->count++;
+    }
+}
+
+size_t HistoryStore::tickCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_base != nullptr ? (size_t)m_header->count : 0;
+}
+
+bool HistoryStore::timeRange(unsigned long long& oldestMs, unsigned long long& newestMs) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_base == nullptr || m_header->count == 0) return false;
+    RingView ring{ m_header->ticks, (size_t)m_header->head, (size_t)m_header->count };
+    oldestMs = m_timestamps[ring.physical(0)];
+    newestMs = m_timestamps[ring.physical(ring.count - 1)];
+    return true;
+}
+
+static size_t findBound(const uint64_t* timestamps, const RingView& ring, unsigned long long timestampMs, bool upper) {
+    size_t lo = 0, hi = ring.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint64_t value = timestamps[ring.physical(mid)];
+        if (upper ? value <= timestampMs : value < timestampMs) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+std::vector<HistoryTick> HistoryStore::systemSeries(unsigned long long fromMs, unsigned long long toMs) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<HistoryTick> series;
+    if (m_base == nullptr) return series;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    RingView ring{ m_header->ticks, (size_t)m_header->head, (size_t)m_header->count };
+    size_t first = findBound(m_timestamps, ring, fromMs, false);
+    size_t last = findBound(m_timestamps, ring, toMs, true);
+
+    for (size_t i = first; i < last; ++i) {
+        size_t index = ring.physical(i);
+        HistoryTick tick;
+        tick.timestampMs = m_timestamps[index];
+        tick.cpuLoadPercentage = m_cpuLoad[index];
+        tick.ramUsedBytes = m_ramUsed[index];
+        tick.ramTotalBytes = m_ramTotal[index];
+        tick.processCount = m_processCount[index];
+        series.push_back(tick);
+    }
+    return series;
+}
+
+std::vector<HistoryProcessPoint> HistoryStore::processSeries(unsigned long pid, unsigned long long fromMs, unsigned long long toMs) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<HistoryProcessPoint> series;
+    if (m_base == nullptr) return series;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    RingView ring{ m_header->ticks, (size_t)m_header->head, (size_t)m_header->count };
+    size_t slots = m_header->processSlots;
+    size_t first = findBound(m_timestamps, ring, fromMs, false);
+    size_t last = findBound(m_timestamps, ring, toMs, true);
+
+    for (size_t i = first; i < last; ++i) {
+        size_t index = ring.physical(i);
+        const uint32_t* pids = m_pids + index * slots;
+        uint32_t count = std::min<uint32_t>(m_processCount[index], (uint32_t)slots);
+        for (uint32_t j = 0; j < count; ++j) {
+            if (pids[j] != pid) continue;
+            HistoryProcessPoint point;
+            point.timestampMs = m_timestamps[index];
+            point.startTime = m_startTimes[index * slots + j];
+            point.cpuUsagePercentage = m_cpu[index * slots + j];
+            point.memoryUsedBytes = m_memory[index * slots + j];
+            series.push_back(point);
+            break;
+        }
+    }
+    return series;
+}
+
+HistoryStore::NameEntry& HistoryStore::nameSlot(unsigned long pid, unsigned long long startTime) const {
+    uint64_t hash = (pid ^ (startTime * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+    return m_names[(hash >> 32) % m_header->nameSlots];
+}
+
+bool HistoryStore::storeName(const ProcessInfo& p) {
+    NameEntry& entry = nameSlot(p.pid, p.startTime);
+    bool same = entry.pid == p.pid && entry.startTime == p.startTime;
+    bool collided = !same && entry.name[0] != '\0';
+    if (!same || strncmp(entry.name, p.name.c_str(), sizeof(entry.name) - 1) != 0) {
+        entry.pid = (uint32_t)p.pid;
+        entry.startTime = p.startTime;
+        strncpy(entry.name, p.name.c_str(), sizeof(entry.name) - 1);
+        entry.name[sizeof(entry.name) - 1] = '\0';
+    }
+    return !collided;
+}
+
+std::string HistoryStore::nameOf(unsigned long pid, unsigned long long startTime) const {
+    const NameEntry& entry = nameSlot(pid, startTime);
+    if (entry.pid != pid || entry.startTime != startTime) return std::string();
+    return std::string(entry.name, strnlen(entry.name, sizeof(entry.name)));
+}
+
+std::vector<HistoryTopEntry> HistoryStore::topByCpu(unsigned long long fromMs, unsigned long long toMs, size_t k) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<HistoryTopEntry> top;
+    if (m_base == nullptr || k == 0) return top;
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    RingView ring{ m_header->ticks, (size_t)m_header->head, (size_t)m_header->count };
+    size_t slots = m_header->processSlots;
+    size_t first = findBound(m_timestamps, ring, fromMs, false);
+    size_t last = findBound(m_timestamps, ring, toMs, true);
+    if (first >= last) return top;
+
+    struct Accumulator {
+        unsigned long pid = 0;
+        unsigned long long startTime = 0;
+        double cpuSum = 0.0;
+        double maxCpu = 0.0;
+        unsigned long long peakMemory = 0;
+        uint32_t samples = 0;
+    };
+    // (pid, startTime) -> acumulador: os dois donos de um PID reaproveitado
+    // na janela nao se misturam.
+    struct KeyHash {
+        size_t operator()(const std::pair<uint32_t, uint64_t>& key) const {
+            return std::hash<uint64_t>()(key.second * 0x9E3779B97F4A7C15ull ^ key.first);
+        }
+    };
+    std::unordered_map<std::pair<uint32_t, uint64_t>, Accumulator, KeyHash> totals;
+
+    for (size_t i = first; i < last; ++i) {
+        size_t index = ring.physical(i);
+        uint32_t count = std::min<uint32_t>(m_processCount[index], (uint32_t)slots);
+        const uint32_t* pids = m_pids + index * slots;
+        const uint64_t* startTimes = m_startTimes + index * slots;
+        const float* cpu = m_cpu + index * slots;
+        const uint64_t* memory = m_memory + index * slots;
+        for (uint32_t j = 0; j < count; ++j) {
+            Accumulator& acc = totals[std::make_pair(pids[j], startTimes[j])];
+            acc.pid = pids[j];
+            acc.startTime = startTimes[j];
+            acc.cpuSum += cpu[j];
+            acc.maxCpu = std::max<double>(acc.maxCpu, cpu[j]);
+            acc.peakMemory = std::max<unsigned long long>(acc.peakMemory, memory[j]);
+            acc.samples++;
+        }
+    }
+
+    // Media sobre todos os ticks da janela: um pico curto nao supera um
+    // processo que consumiu CPU o intervalo inteiro.
+    double windowTicks = (double)(last - first);
+    top.reserve(totals.size());
+    for (const auto& entry : totals) {
+        HistoryTopEntry e;
+        e.pid = entry.second.pid;
+        e.startTime = entry.second.startTime;
+        e.averageCpu = entry.second.cpuSum / windowTicks;
+        e.maxCpu = entry.second.maxCpu;
+        e.peakMemoryBytes = entry.second.peakMemory;
+        e.samples = entry.second.samples;
+        top.push_back(e);
+    }
+
+    size_t limit = std::min(k, top.size());
+    std::partial_sort(top.begin(), top.begin() + limit, top.end(), [](const HistoryTopEntry& a, const HistoryTopEntry& b) {
+        return a.averageCpu > b.averageCpu;
+        });
+    top.resize(limit);
+    for (HistoryTopEntry& e : top) {
+        e.name = nameOf(e.pid, e.startTime);
+    }
+    return top;
+}
@@ -0,0 +1,118 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "system_info.h"
+
+struct HistoryOptions {
+    // 3600 ticks = 1 hora no intervalo padrao de 1s.
+    uint32_t ticks = 3600;
+    // Processos guardados por tick; acima disso ficam os de maior CPU.
+    uint32_t processSlots = 1024;
+    uint32_t nameSlots = 65536;
+};
+
+struct HistoryTick {
+    unsigned long long timestampMs = 0;
+    float cpuLoadPercentage = 0.0f;
+    unsigned long long ramUsedBytes = 0;
+    unsigned long long ramTotalBytes = 0;
+    uint32_t processCount = 0;
+};
+
+struct HistoryProcessPoint {
+    unsigned long long timestampMs = 0;
+    // Muda no meio da serie se o PID foi reaproveitado.
+    unsigned long long startTime = 0;
+    float cpuUsagePercentage = 0.0f;
+    unsigned long long memoryUsedBytes = 0;
+};
+
+// Um processo e (pid, startTime): um PID reaproveitado na janela aparece
+// como duas entradas, cada uma com o proprio nome.
+struct HistoryTopEntry {
+    unsigned long pid = 0;
+    unsigned long long startTime = 0;
+    std::string name;
+    double averageCpu = 0.0;
+    double maxCpu = 0.0;
+    unsigned long long peakMemoryBytes = 0;
+    uint32_t samples = 0;
+};
+
+// Historico em anel, de tamanho fixo, num arquivo mapeado em memoria. Cada
+// metrica e um array proprio (colunar): as consultas localizam a janela por
+// busca binaria nos timestamps e so tocam as colunas dos ticks dentro dela.
+// O arquivo e reaproveitado entre execucoes se a geometria for a mesma.
+class HistoryStore {
+public:
+    HistoryStore();
+    ~HistoryStore();
+
+    HistoryStore(const HistoryStore&) = delete;
+    HistoryStore& operator=(const HistoryStore&) = delete;
+
+    // Em modo somente leitura a geometria vem do arquivo e options e ignorado.
+    bool open(const std::string& path, const HistoryOptions& options, bool readOnly = false);
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+
+    // Com info.processDiff contiguo a ultima lista gravada, so os nomes dos
+    // processos novos ou renomeados sao conferidos.
+    void append(const SystemInfo& info);
+
+    size_t tickCount() const;
+    bool timeRange(unsigned long long& oldestMs, unsigned long long& newestMs) const;
+
+    std::vector<HistoryTick> systemSeries(unsigned long long fromMs, unsigned long long toMs) const;
+    std::vector<HistoryProcessPoint> processSeries(unsigned long pid, unsigned long long fromMs, unsigned long long toMs) const;
+    // Top-K por CPU media no intervalo [fromMs, toMs].
+    std::vector<HistoryTopEntry> topByCpu(unsigned long long fromMs, unsigned long long toMs, size_t k) const;
+
+private:
+    struct Header;
+    struct NameEntry;
+
+    bool mapFile(const std::string& path, size_t size, bool readOnly, bool& created);
+    void unmapFile();
+    void layoutColumns();
+    NameEntry& nameSlot(unsigned long pid, unsigned long long startTime) const;
+    std::string nameOf(unsigned long pid, unsigned long long startTime) const;
+    // Grava o nome de p na tabela. Retorna false se a entrada era de outro
+    // processo (colisao), caso em que os nomes de todo o tick sao regravados.
+    bool storeName(const ProcessInfo& p);
+
+    mutable std::mutex m_mutex;
+    bool m_readOnly = false;
+    uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_file = nullptr;
+    void* m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+
+    Header* m_header = nullptr;
+    uint64_t* m_timestamps = nullptr;
+    float* m_cpuLoad = nullptr;
+    uint64_t* m_ramUsed = nullptr;
+    uint64_t* m_ramTotal = nullptr;
+    uint32_t* m_processCount = nullptr;
+    uint32_t* m_pids = nullptr;
+    uint64_t* m_startTimes = nullptr;
+    float* m_cpu = nullptr;
+    uint64_t* m_memory = nullptr;
+    NameEntry* m_names = nullptr;
+
+    std::vector<const ProcessInfo*> m_selected;
+    // Lista de processos do ultimo append; 0 = nenhuma.
+    unsigned long long m_lastListVersion = 0;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "instrumentation.h"
+
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<unsigned long long> g_syscalls{ 0 };
+static std::atomic<unsigned long long> g_allocations{ 0 };
+static std::atomic<bool> g_allocationsEnabled{ false };
+
+const char* phaseName(TickPhase phase) {
+    switch (phase) {
+    case PHASE_SYSTEM: return "totais do sistema";
+    case PHASE_ENUMERATE: return "enumeracao";
+    case PHASE_PROCESS_READ: return "leitura dos processos";
+    case PHASE_THREADS: return "threads em foco";
+    case PHASE_CPU_DELTAS: return "deltas de CPU";
+    case PHASE_DIFF: return "diff da lista";
+    case PHASE_CGROUPS: return "agregados de cgroups";
+    case PHASE_ALERTS: return "regras de alerta";
+    case PHASE_SORT: return "ordenacao";
+    case PHASE_PUBLISH: return "publicacao";
+    case PHASE_TICK: return "tick completo";
+    default: return "?";
+    }
+}
+
+void PhaseHistogram::record(unsigned long long ns) {
+    unsigned long long us = ns / 1000;
+    int bucket = 0;
+    while (us > 1 && bucket < BUCKETS - 1) {
+        us >>= 1;
+        ++bucket;
+    }
+    counts[bucket]++;
+    samples++;
+    lastMs = ns / 1e6;
+    totalMs += lastMs;
+    if (lastMs > maxMs) maxMs = lastMs;
+}
+
+double PhaseHistogram::percentileMs(double fraction) const {
+    if (samples == 0) return 0.0;
+    unsigned long long target = (unsigned long long)(fraction * samples);
+    if (target >= samples) target = samples - 1;
+    unsigned long long seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen > target) {
+            double upperMs = (double)(1ULL << (i + 1)) / 1000.0;
+            return upperMs < maxMs ? upperMs : maxMs;
+        }
+    }
+    return maxMs;
+}
+
+namespace instrumentation {
+
+void countSyscalls(unsigned long long n) {
+    g_syscalls.fetch_add(n, std::memory_order_relaxed);
+}
+
+unsigned long long syscallCount() {
+    return g_syscalls.load(std::memory_order_relaxed);
+}
+
+void countAllocation() {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void enableAllocationCounting() {
+    g_allocationsEnabled = true;
+}
+
+bool allocationCountingEnabled() {
+    return g_allocationsEnabled.load();
+}
+
+unsigned long long allocationCount() {
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+#ifdef _WIN32
+bool readSelfUsage(double& cpuSeconds, unsigned long long& rssBytes) {
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) return false;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    cpuSeconds = (double)(k.QuadPart + u.QuadPart) / 1e7;
+
+    PROCESS_MEMORY_COUNTERS counters;
+    rssBytes = GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ?
+        (unsigned long long)counters.WorkingSetSize : 0;
+    return true;
+}
+
+unsigned long selfPid() {
+    return (unsigned long)GetCurrentProcessId();
+}
+#else
+bool readSelfUsage(double& cpuSeconds, unsigned long long& rssBytes) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return false;
+    cpuSeconds = usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+        (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+
+    // ru_maxrss e o pico; o residente atual vem de /proc/self/statm.
+    rssBytes = 0;
+    if (FILE* statm = fopen("/proc/self/statm", "r")) {
+        unsigned long long sizePages = 0, residentPages = 0;
+        if (fscanf(statm, "%llu %llu", &sizePages, &residentPages) == 2) {
+            rssBytes = residentPages * (unsigned long long)sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+    return true;
+}
+
+unsigned long selfPid() {
+    return (unsigned long)getpid();
+}
+#endif
+
+}
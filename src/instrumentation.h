@@ -0,0 +1,118 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+
+// Fases de um tick medidas pelo proprio monitor. As duas primeiras da lista
+// de processos sao medidas dentro do coletor; as demais pelo SystemMonitor.
+enum TickPhase : unsigned {
+    PHASE_SYSTEM,        // memoria e tempos de CPU totais
+    PHASE_ENUMERATE,     // listagem dos PIDs
+    PHASE_PROCESS_READ,  // abertura e leitura (tempos + memoria) de cada processo
+    PHASE_THREADS,       // threads dos processos em foco
+    PHASE_CPU_DELTAS,    // contas de CPU% de processos e threads
+    PHASE_DIFF,          // diff da lista de processos contra a anterior
+    PHASE_CGROUPS,       // agregados da arvore de cgroups
+    PHASE_ALERTS,        // regras de alerta
+    PHASE_SORT,          // ordenacao das listas
+    PHASE_PUBLISH,       // copia e publicacao do snapshot
+    PHASE_TICK,          // tick completo, sem a publicacao
+    PHASE_COUNT
+};
+
+const char* phaseName(TickPhase phase);
+
+// Duracoes das fases de um tick, preenchidas pelos ScopedPhaseTimer.
+struct PhaseTimings {
+    unsigned long long ns[PHASE_COUNT] = {};
+    unsigned recorded = 0;
+
+    void clear() { recorded = 0; }
+    void add(TickPhase phase, unsigned long long elapsedNs) {
+        if ((recorded & (1u << phase)) == 0) {
+            recorded |= 1u << phase;
+            ns[phase] = 0;
+        }
+        ns[phase] += elapsedNs;
+    }
+    bool has(TickPhase phase) const { return (recorded & (1u << phase)) != 0; }
+};
+
+// Soma o tempo do escopo na fase. Sao dois steady_clock::now() por escopo,
+// entao so e usado em volta de fases inteiras, nunca por processo.
+class ScopedPhaseTimer {
+public:
+    ScopedPhaseTimer(PhaseTimings& timings, TickPhase phase) :
+        m_timings(timings), m_phase(phase), m_start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedPhaseTimer() {
+        m_timings.add(m_phase, (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - m_start).count());
+    }
+
+    ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+    ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+private:
+    PhaseTimings& m_timings;
+    TickPhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Histograma de tamanho fixo em potencias de 2 de microssegundos: o balde i
+// guarda duracoes em [2^i, 2^(i+1)) us (o balde 0 tambem guarda < 1 us).
+// Registrar nao aloca; os percentis sao o limite superior do balde.
+struct PhaseHistogram {
+    static const int BUCKETS = 24;
+
+    unsigned long long counts[BUCKETS] = {};
+    unsigned long long samples = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    double lastMs = 0.0;
+
+    void record(unsigned long long ns);
+    double meanMs() const { return samples ? totalMs / samples : 0.0; }
+    double percentileMs(double fraction) const;
+};
+
+// Custo do proprio monitor. A CPU e o RSS sao do processo inteiro (inclusive
+// a UI); syscalls e alocacoes sao contadas em todas as threads durante o tick.
+struct MonitorDiagnostics {
+    PhaseHistogram phases[PHASE_COUNT];
+    unsigned long long syscallsLastTick = 0;
+    unsigned long long syscallsTotal = 0;
+    // Falso quando o executavel nao foi ligado com alloc_counter.cpp.
+    bool allocationsCounted = false;
+    unsigned long long allocationsLastTick = 0;
+    unsigned long long allocationsTotal = 0;
+    // CPU em % de um nucleo: na ultima janela de ~1 s e desde o inicio.
+    double selfCpuPercent = 0.0;
+    double selfCpuAveragePercent = 0.0;
+    double selfCpuSeconds = 0.0;
+    double uptimeSeconds = 0.0;
+    unsigned long long selfRssBytes = 0;
+};
+
+namespace instrumentation {
+
+// Contador global de chamadas ao sistema feitas pelos coletores. Cada ponto
+// de chamada soma o que faz; e aproximado (readdir conta um getdents por
+// varredura), mas barato: um incremento relaxado.
+void countSyscalls(unsigned long long n = 1);
+unsigned long long syscallCount();
+
+// Alimentados pelo operator new de alloc_counter.cpp, quando ligado.
+void countAllocation();
+void enableAllocationCounting();
+bool allocationCountingEnabled();
+unsigned long long allocationCount();
+
+// CPU (usuario + kernel) e memoria residente do processo atual.
+bool readSelfUsage(double& cpuSeconds, unsigned long long& rssBytes);
+unsigned long selfPid();
+
+}
+
+#endif
@@ -4,150 +4,345 @@
 #include <GLFW/glfw3.h> 
 
 #include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <sstream>
 #include <string>       
-#include <sstream>      
-#include <iomanip> 
+#include <unordered_map>
 
 #include "backend.h"   
+#include "process_table.h"
+#include "profiler.h"
+#include "ui_format.h"
+#include "util.h"
 
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 720;
 const ImVec4 CLEAR_COLOR = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
+const size_t MAX_EXIT_LOG = 500;
+const uint32_t FLAME_NO_CLICK = 0xFFFFFFFFu;
+const float HEATMAP_CELL_HEIGHT = 12.0f;
+const char* const ALERT_RULES_FILE = "alertas.txt";
+const char* const ALERT_LOG_FILE = "alertas.log";
 
-std::string formatBytes(unsigned long long bytes) {
-    std::stringstream ss;
-    ss << std::fixed << std::setprecision(2);
-    if (bytes > (1024 * 1024 * 1024)) { // GB
-        ss << (bytes / (1024.0 * 1024.0 * 1024.0)) << " GB";
+// O processo selecionado vem primeiro; os fixados com Ctrl+clique tambem tem
+// as threads amostradas.
+static void applyFocus(SystemMonitor& monitor, unsigned long focusedPid, const std::vector<unsigned long>& pinnedPids) {
+    std::vector<unsigned long> pids;
+    if (focusedPid != 0) {
+        pids.push_back(focusedPid);
     }
-    else if (bytes > (1024 * 1024)) { // MB
-        ss << (bytes / (1024.0 * 1024.0)) << " MB";
-    }
-    else if (bytes > 1024) { // KB
-        ss << (bytes / 1024.0) << " KB";
-    }
-    else {
-        ss << bytes << " B";
+    for (unsigned long pid : pinnedPids) {
+        if (pid != focusedPid) {
+            pids.push_back(pid);
+        }
     }
-    return ss.str();
+    monitor.setFocusedProcesses(pids);
 }
 
-void renderUI_ProcessTab(SystemMonitor& monitor, SystemInfo& info) {
+// Enfileira e volta na hora; o resultado chega em info.processActions.
+static void requestAction(SystemMonitor& monitor, ProcessActionKind kind, unsigned long pid, bool tree) {
+    ProcessActionRequest request;
+    request.kind = kind;
+    request.pids.push_back(pid);
+    request.tree = tree;
+    monitor.requestProcessAction(request);
+}
+
+void renderUI_ProcessTab(SystemMonitor& monitor, const SystemInfo& info) {
 
     static unsigned long focusedPid = 0;
     static ProcessInfo focusedProcessInfo;
-    bool foundFocusedProcess = false;
+    static std::vector<unsigned long> pinnedPids;
+    static ExtraProcessInfo extraInfo;
+    static unsigned long long extraInfoVersion = 0;
+    static unsigned long extraInfoPid = 0;
+    static ProcessTableView table;
+    static char bulkQuery[128] = "";
+    static bool bulkTree = false;
+
+    enum ColumnId {
+        COLUMN_PID, COLUMN_NAME, COLUMN_CPU, COLUMN_CPU_CORE, COLUMN_MEMORY,
+        COLUMN_IO_READ, COLUMN_IO_WRITE, COLUMN_FAULTS, COLUMN_SWITCHES, COLUMN_ACTION, COLUMN_COUNT
+    };
+    // Tambem fora da tabela: o painel de detalhes usa find() mesmo quando a
+    // tabela nao e desenhada.
+    table.update(info);
 
     ImGui::Columns(2, "ProcessSplitter", true);
     ImGui::SetColumnWidth(0, ImGui::GetWindowWidth() * 0.7f);
 
     ImGui::Text("Lista de Processos");
-    if (ImGui::BeginChild("ProcessListChild", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()), false, ImGuiWindowFlags_None)) {
-        if (ImGui::BeginTable("processTable", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY)) {
-            ImGui::TableSetupColumn("PID");
-            ImGui::TableSetupColumn("Nome");
-            ImGui::TableSetupColumn("CPU %");
-            ImGui::TableSetupColumn("Memoria");
-            ImGui::TableSetupColumn("");
+    if (ImGui::BeginChild("ProcessListChild", ImVec2(0, -ImGui::GetFrameHeightWithSpacing() * 3), false, ImGuiWindowFlags_None)) {
+        if (ImGui::BeginTable("processTable", COLUMN_COUNT, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+            ImGuiTableFlags_Resizable | ImGuiTableFlags_Hideable | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Sortable)) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("PID", ImGuiTableColumnFlags_None, 0.0f, COLUMN_PID);
+            ImGui::TableSetupColumn("Nome", ImGuiTableColumnFlags_None, 0.0f, COLUMN_NAME);
+            ImGui::TableSetupColumn("CPU %", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_CPU);
+            ImGui::TableSetupColumn("% nucleo", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_CPU_CORE);
+            ImGui::TableSetupColumn("Memoria", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending,
+                0.0f, COLUMN_MEMORY);
+            ImGui::TableSetupColumn("Leitura/s", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_IO_READ);
+            ImGui::TableSetupColumn("Escrita/s", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_IO_WRITE);
+            ImGui::TableSetupColumn("Faltas/s", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_FAULTS);
+            ImGui::TableSetupColumn("Trocas/s", ImGuiTableColumnFlags_PreferSortDescending, 0.0f, COLUMN_SWITCHES);
+            ImGui::TableSetupColumn("", ImGuiTableColumnFlags_NoSort, 0.0f, COLUMN_ACTION);
             ImGui::TableHeadersRow();
 
-            for (const ProcessInfo& p : info.processes) {
-                ImGui::TableNextRow();
-
-                if (p.pid == focusedPid) {
-                    focusedProcessInfo = p;
-                    foundFocusedProcess = true;
+            ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+            if (sortSpecs != NULL && sortSpecs->SpecsDirty && sortSpecs->SpecsCount > 0) {
+                const ImGuiTableColumnSortSpecs& spec = sortSpecs->Specs[0];
+                ProcessSortKey column = SORT_MEMORY;
+                switch (spec.ColumnUserID) {
+                case COLUMN_PID: column = SORT_PID; break;
+                case COLUMN_NAME: column = SORT_NAME; break;
+                case COLUMN_CPU: column = SORT_CPU; break;
+                case COLUMN_CPU_CORE: column = SORT_CPU; break;
+                case COLUMN_IO_READ: column = SORT_IO_READ; break;
+                case COLUMN_IO_WRITE: column = SORT_IO_WRITE; break;
+                case COLUMN_FAULTS: column = SORT_FAULTS; break;
+                case COLUMN_SWITCHES: column = SORT_SWITCHES; break;
                 }
+                table.setSort(column, spec.SortDirection == ImGuiSortDirection_Descending);
+                sortSpecs->SpecsDirty = false;
+                table.update(info);
+            }
 
-                ImGui::TableSetColumnIndex(0);
-                char pidStr[32];
-                sprintf(pidStr, "%lu", p.pid);
-
-                if (ImGui::Selectable(pidStr, p.pid == focusedPid, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap)) {
-                    focusedPid = p.pid;
-                    monitor.setFocusedProcess(p.pid);
-                    focusedProcessInfo = p;
-                    foundFocusedProcess = true;
-                }
+            // So as linhas visiveis sao montadas; o texto vem do cache da tabela.
+            ImGuiListClipper clipper;
+            clipper.Begin((int)table.size());
+            while (clipper.Step()) {
+                for (int rowIndex = clipper.DisplayStart; rowIndex < clipper.DisplayEnd; ++rowIndex) {
+                    const ProcessInfo& p = table.process(info, (size_t)rowIndex);
+                    const ProcessRowText& row = table.text(info, (size_t)rowIndex);
+                    ImGui::TableNextRow();
 
-                ImGui::TableSetColumnIndex(1);
-                ImGui::Text("%s", p.name.c_str());
+                    auto pinned = std::find(pinnedPids.begin(), pinnedPids.end(), p.pid);
 
-                ImGui::TableSetColumnIndex(2);
-                ImGui::Text("%.1f %%", p.cpuUsagePercentage);
+                    ImGui::TableSetColumnIndex(COLUMN_PID);
 
-                ImGui::TableSetColumnIndex(3);
-                std::string memStr = formatBytes(p.memoryUsedBytes);
-                ImGui::Text("%s", memStr.c_str());
+                    bool selected = p.pid == focusedPid || pinned != pinnedPids.end();
+                    if (ImGui::Selectable(row.pid, selected, ImGuiSelectableFlags_SpanAllColumns | ImGuiSelectableFlags_AllowItemOverlap)) {
+                        if (ImGui::GetIO().KeyCtrl) {
+                            if (pinned != pinnedPids.end()) {
+                                pinnedPids.erase(pinned);
+                            }
+                            else {
+                                pinnedPids.push_back(p.pid);
+                            }
+                        }
+                        else {
+                            focusedPid = p.pid;
+                        }
+                        applyFocus(monitor, focusedPid, pinnedPids);
+                    }
 
-                ImGui::TableSetColumnIndex(4);
-                ImGui::PushID(p.pid);
-                if (ImGui::Button("Encerrar")) {
-                    monitor.killProcess(p.pid);
-                    if (p.pid == focusedPid) {
-                        focusedPid = 0;
-                        monitor.setFocusedProcess(0);
+                    ImGui::TableSetColumnIndex(COLUMN_NAME);
+                    ImGui::TextUnformatted(p.name.c_str());
+
+                    ImGui::TableSetColumnIndex(COLUMN_CPU);
+                    ImGui::TextUnformatted(row.cpu);
+                    ImGui::TableSetColumnIndex(COLUMN_CPU_CORE);
+                    ImGui::TextUnformatted(row.cpuCore);
+
+                    ImGui::TableSetColumnIndex(COLUMN_MEMORY);
+                    ImGui::TextUnformatted(row.memory);
+
+                    ImGui::TableSetColumnIndex(COLUMN_IO_READ);
+                    ImGui::TextUnformatted(row.ioRead);
+                    ImGui::TableSetColumnIndex(COLUMN_IO_WRITE);
+                    ImGui::TextUnformatted(row.ioWrite);
+                    ImGui::TableSetColumnIndex(COLUMN_FAULTS);
+                    ImGui::TextUnformatted(row.faults);
+                    ImGui::TableSetColumnIndex(COLUMN_SWITCHES);
+                    ImGui::TextUnformatted(row.switches);
+
+                    ImGui::TableSetColumnIndex(COLUMN_ACTION);
+                    ImGui::PushID((int)p.pid);
+                    // O foco sai sozinho quando o processo some da lista.
+                    if (ImGui::Button("Encerrar")) {
+                        requestAction(monitor, ACTION_TERMINATE, p.pid, false);
                     }
+                    ImGui::PopID();
                 }
-                ImGui::PopID();
             }
             ImGui::EndTable();
         }
     }
     ImGui::EndChild();
+    // O que a ultima lista mudou em relacao a anterior (ja com a zona morta).
+    if (info.processDiff) {
+        const SnapshotDiff& diff = *info.processDiff;
+        ImGui::TextDisabled("%zu processos: +%zu -%zu ~%zu, %zu sem mudanca; %zu linhas reposicionadas",
+            info.processes.size(), diff.added, diff.removed.size(), diff.changes.size() - diff.added,
+            diff.unchanged, table.lastMoves());
+    }
+
+    // Acao em lote: os processos da consulta (mesmo formato do -q do daemon)
+    // na lista atual.
+    ProcessQuery bulk;
+    std::shared_ptr<const ProcessQueryResult> bulkResult;
+    // Sem filtro a consulta e a lista inteira; a fila recusaria o pedido.
+    if (bulkQuery[0] != '\0' && parseProcessQuery(bulkQuery, bulk) && bulk.selective()) {
+        bulkResult = monitor.queryProcesses(bulk);
+    }
+    ImGui::SetNextItemWidth(ImGui::GetWindowWidth() * 0.3f);
+    ImGui::InputText("##bulkQuery", bulkQuery, sizeof(bulkQuery));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("name=texto,user=nome,mincpu=%%,minmem=bytes[K|M|G],top=N,sort=...,regex=expr");
+    }
+    ImGui::SameLine();
+    char bulkLabel[64];
+    snprintf(bulkLabel, sizeof(bulkLabel), "Encerrar %zu filtrados",
+        bulkResult && bulkResult->valid ? bulkResult->processes.size() : (size_t)0);
+    // So sai depois da confirmacao; a consulta e refeita no snapshot do
+    // pedido, entao o numero pode mudar um pouco ate la.
+    static ProcessQuery pendingBulk;
+    static size_t pendingCount = 0;
+    static bool pendingTree = false;
+    if (ImGui::Button(bulkLabel) && bulkResult && bulkResult->valid && !bulkResult->processes.empty()) {
+        pendingBulk = bulk;
+        pendingCount = bulkResult->processes.size();
+        pendingTree = bulkTree;
+        ImGui::OpenPopup("Confirmar encerramento");
+    }
+    if (ImGui::BeginPopupModal("Confirmar encerramento", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
+        ImGui::Text("Encerrar %zu processos%s?", pendingCount, pendingTree ? " e seus descendentes" : "");
+        ImGui::TextDisabled("Consulta: %s", bulkQuery);
+        if (ImGui::Button("Encerrar")) {
+            ProcessActionRequest request;
+            request.useQuery = true;
+            request.query = pendingBulk;
+            request.tree = pendingTree;
+            monitor.requestProcessAction(request);
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Cancelar")) {
+            ImGui::CloseCurrentPopup();
+        }
+        ImGui::EndPopup();
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("com descendentes", &bulkTree);
+    if (info.processActions && !info.processActions->actions.empty()) {
+        char text[256];
+        formatActionResult(info.processActions->actions.back(), text, sizeof(text));
+        ImGui::TextDisabled("%s", text);
+    }
 
     ImGui::NextColumn();
 
     ImGui::Text("Detalhes do Processo");
     ImGui::Separator();
 
-    if (!foundFocusedProcess) {
-        focusedPid = 0;
-        monitor.setFocusedProcess(0);
+    // Processos que sairam deixam de estar em foco.
+    const ProcessInfo* focusedProcess = focusedPid != 0 ? table.find(info, focusedPid) : NULL;
+    if (focusedProcess != NULL) {
+        focusedProcessInfo = *focusedProcess;
+    }
+    size_t pinnedBefore = pinnedPids.size();
+    pinnedPids.erase(std::remove_if(pinnedPids.begin(), pinnedPids.end(), [&](unsigned long pid) {
+        return table.find(info, pid) == NULL;
+        }), pinnedPids.end());
+    if ((focusedPid != 0 && focusedProcess == NULL) || pinnedPids.size() != pinnedBefore) {
+        if (focusedProcess == NULL) {
+            focusedPid = 0;
+        }
+        applyFocus(monitor, focusedPid, pinnedPids);
     }
 
     if (ImGui::BeginChild("DetailsChild", ImVec2(0, -ImGui::GetFrameHeightWithSpacing()))) {
         if (focusedPid == 0) {
             ImGui::Text("Clique no PID de um processo na tabela para ver os detalhes.");
+            ImGui::Text("Ctrl+clique acompanha as threads de varios processos.");
         }
         else {
-            ExtraProcessInfo extraInfo = monitor.getExtraProcessInfo(focusedPid);
+            // Relido uma vez por snapshot, nao a cada frame.
+            if (extraInfoVersion != info.version || extraInfoPid != focusedPid) {
+                extraInfo = monitor.getExtraProcessInfo(focusedPid);
+                extraInfoVersion = info.version;
+                extraInfoPid = focusedPid;
+            }
 
             ImGui::Text("PID: %lu", focusedProcessInfo.pid);
             ImGui::Text("Nome: %s", focusedProcessInfo.name.c_str());
+            if (focusedProcessInfo.metadata) {
+                const ProcessMetadata& metadata = *focusedProcessInfo.metadata;
+                ImGui::Text("Processo pai: %lu", metadata.parentPid);
+                ImGui::Text("Usuario: %s", metadata.user.c_str());
+                ImGui::TextWrapped("Executavel: %s", metadata.executablePath.c_str());
+                ImGui::TextWrapped("Linha de comando: %s", metadata.commandLine.c_str());
+            }
+            // SIGTERM e SIGKILL depois do prazo; Forcar vai direto ao SIGKILL.
+            if (ImGui::Button("Encerrar")) {
+                requestAction(monitor, ACTION_TERMINATE, focusedPid, false);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Forcar")) {
+                requestAction(monitor, ACTION_KILL, focusedPid, false);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Encerrar arvore")) {
+                requestAction(monitor, ACTION_TERMINATE, focusedPid, true);
+            }
             ImGui::Separator();
 
             std::string memStr = formatBytes(focusedProcessInfo.memoryUsedBytes);
             ImGui::Text("Memoria: %s", memStr.c_str());
 
-            ImGui::Text("CPU: %.1f %%", focusedProcessInfo.cpuUsagePercentage);
+            ImGui::Text("CPU: %.1f %% da maquina, %.1f %% de um nucleo", focusedProcessInfo.cpuUsagePercentage,
+                focusedProcessInfo.cpuCorePercentage);
             ImGui::Separator();
             ImGui::Text("Contagem de Threads: %lu", extraInfo.threadCount);
+            ImGui::Text("Handles abertos: %lu", extraInfo.handleCount);
+            if (!extraInfo.priorityClass.empty()) {
+                ImGui::Text("Prioridade: %s", extraInfo.priorityClass.c_str());
+            }
             ImGui::Separator();
 
             std::string readStr = formatBytes(extraInfo.ioReadBytes);
-            ImGui::Text("I/O Leitura: %s", readStr.c_str());
-
-
             std::string writeStr = formatBytes(extraInfo.ioWriteBytes);
-            ImGui::Text("I/O Escrita: %s", writeStr.c_str());
+            char readRate[32], writeRate[32];
+            formatByteRate(focusedProcessInfo.rate(COUNTER_IO_READ_BYTES), readRate, sizeof(readRate));
+            formatByteRate(focusedProcessInfo.rate(COUNTER_IO_WRITE_BYTES), writeRate, sizeof(writeRate));
+            ImGui::Text("I/O Leitura: %s (%s)", readStr.c_str(), readRate);
+            ImGui::Text("I/O Escrita: %s (%s)", writeStr.c_str(), writeRate);
+
+            char minorRate[32], majorRate[32], voluntaryRate[32], involuntaryRate[32];
+            formatEventRate(focusedProcessInfo.rate(COUNTER_MINOR_FAULTS), minorRate, sizeof(minorRate));
+            formatEventRate(focusedProcessInfo.rate(COUNTER_MAJOR_FAULTS), majorRate, sizeof(majorRate));
+            formatEventRate(focusedProcessInfo.rate(COUNTER_VOLUNTARY_SWITCHES), voluntaryRate, sizeof(voluntaryRate));
+            formatEventRate(focusedProcessInfo.rate(COUNTER_INVOLUNTARY_SWITCHES), involuntaryRate, sizeof(involuntaryRate));
+            ImGui::Text("Faltas de pagina: %s menores, %s maiores", minorRate, majorRate);
+            ImGui::Text("Trocas de contexto: %s voluntarias, %s involuntarias", voluntaryRate, involuntaryRate);
 
             ImGui::Separator();
             ImGui::Text("Uso de CPU por Thread:");
 
             if (ImGui::BeginChild("ThreadListChild", ImVec2(0, 0), false, ImGuiWindowFlags_None)) {
-                if (ImGui::BeginTable("ThreadTable", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
-                    ImGui::TableSetupColumn("Thread ID (TID)");
-                    ImGui::TableSetupColumn("CPU %");
-                    ImGui::TableHeadersRow();
-                    for (const ThreadInfo& t : info.focusedProcessThreads) {
-                        ImGui::TableNextRow();
-                        ImGui::TableSetColumnIndex(0);
-                        ImGui::Text("%lu", t.tid);
-                        ImGui::TableSetColumnIndex(1);
-                        ImGui::Text("%.1f %%", t.cpuUsagePercentage);
+                for (const FocusedProcessInfo& focused : info.focusedProcesses) {
+                    ImGui::PushID((int)focused.pid);
+                    char header[64];
+                    sprintf(header, "PID %lu (%zu threads)", focused.pid, focused.threads.size());
+                    if (ImGui::CollapsingHeader(header, ImGuiTreeNodeFlags_DefaultOpen) &&
+                        ImGui::BeginTable("ThreadTable", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+                        ImGui::TableSetupColumn("Thread ID (TID)");
+                        ImGui::TableSetupColumn("CPU %");
+                        ImGui::TableHeadersRow();
+                        for (const ThreadInfo& t : focused.threads) {
+                            ImGui::TableNextRow();
+                            ImGui::TableSetColumnIndex(0);
+                            ImGui::Text("%lu", t.tid);
+                            ImGui::TableSetColumnIndex(1);
+                            ImGui::Text("%.1f %%", t.cpuUsagePercentage);
+                        }
+                        ImGui::EndTable();
                     }
-                    ImGui::EndTable();
+                    ImGui::PopID();
                 }
             }
             ImGui::EndChild();
@@ -158,6 +353,647 @@ void renderUI_ProcessTab(SystemMonitor& monitor, SystemInfo& info) {
     ImGui::Columns(1);
 }
 
+// Custo do proprio monitor: CPU e RSS do processo e o histograma de cada
+// fase do tick.
+void renderUI_DiagnosticsTab(const SystemInfo& info) {
+    const MonitorDiagnostics& diagnostics = info.diagnostics;
+    ImGui::Text("CPU do monitor: %.3f%% de um nucleo (media %.3f%% em %.0f s)",
+        diagnostics.selfCpuPercent, diagnostics.selfCpuAveragePercent, diagnostics.uptimeSeconds);
+    ImGui::Text("Memoria residente: %s", formatBytes(diagnostics.selfRssBytes).c_str());
+    ImGui::Text("Syscalls do coletor: %llu no ultimo tick, %llu no total",
+        diagnostics.syscallsLastTick, diagnostics.syscallsTotal);
+    if (diagnostics.allocationsCounted) {
+        ImGui::Text("Alocacoes: %llu no ultimo tick, %llu no total",
+            diagnostics.allocationsLastTick, diagnostics.allocationsTotal);
+    }
+    else {
+        ImGui::TextDisabled("Alocacoes: nao contadas neste executavel");
+    }
+    ImGui::Spacing();
+
+    if (ImGui::BeginTable("PhaseTable", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Fase");
+        ImGui::TableSetupColumn("Amostras");
+        ImGui::TableSetupColumn("Ultimo (ms)");
+        ImGui::TableSetupColumn("Media (ms)");
+        ImGui::TableSetupColumn("p50 (ms)");
+        ImGui::TableSetupColumn("p99 (ms)");
+        ImGui::TableSetupColumn("Max (ms)");
+        ImGui::TableHeadersRow();
+        for (unsigned phase = 0; phase < PHASE_COUNT; ++phase) {
+            const PhaseHistogram& histogram = diagnostics.phases[phase];
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(phaseName((TickPhase)phase));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%llu", histogram.samples);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", histogram.lastMs);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.3f", histogram.meanMs());
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.3f", histogram.percentileMs(0.50));
+            ImGui::TableSetColumnIndex(5);
+            ImGui::Text("%.3f", histogram.percentileMs(0.99));
+            ImGui::TableSetColumnIndex(6);
+            ImGui::Text("%.3f", histogram.maxMs);
+        }
+        ImGui::EndTable();
+    }
+}
+
+// Cor estavel por nome, em tons quentes como nos flame graphs classicos.
+static ImU32 flameColor(const std::string& name) {
+    unsigned hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+    }
+    return IM_COL32(200 + hash % 55, 80 + (hash >> 8) % 120, 40 + (hash >> 16) % 40, 255);
+}
+
+// Desenha o no e seus filhos a partir de (x, y), com a largura proporcional
+// as amostras. Nos com menos de um pixel nao sao desenhados.
+static void drawFlameNode(const FlameGraph& graph, uint32_t index, float x, float y, float width, float rowHeight,
+    unsigned long long total, uint32_t& clicked) {
+    const FlameNode& node = graph.nodes()[index];
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    ImVec2 min(x, y);
+    ImVec2 max(x + width - 1.0f, y + rowHeight - 1.0f);
+    drawList->AddRectFilled(min, max, index == 0 ? IM_COL32(120, 120, 120, 255) : flameColor(node.name));
+    if (width > 30.0f) {
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(x + 3.0f, y + 1.0f), IM_COL32(0, 0, 0, 255), node.name.c_str());
+        drawList->PopClipRect();
+    }
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+        ImGui::SetTooltip("%s\n%llu amostras (%.2f%%), %llu no topo da pilha", node.name.c_str(), node.total,
+            total ? 100.0 * node.total / total : 0.0, node.self);
+        if (ImGui::IsMouseClicked(0)) {
+            clicked = index;
+        }
+    }
+
+    float childX = x;
+    for (uint32_t child : node.children) {
+        float childWidth = width * (float)graph.nodes()[child].total / (float)node.total;
+        if (childWidth < 1.0f) break;
+        drawFlameNode(graph, child, childX, y + rowHeight, childWidth, rowHeight, total, clicked);
+        childX += childWidth;
+    }
+}
+
+// Perfil de pilhas do processo selecionado na aba de processos: funcoes
+// mais quentes e o flame graph (raiz em cima; clique para ampliar um no).
+void renderUI_ProfileTab(SystemMonitor& monitor, Profiler& profiler, FlameGraphBuilder& flameGraphs) {
+    static int frequency = 99;
+    static int method = 0;
+    static uint32_t zoom = 0;
+    static double lastBuild = -1.0;
+    static std::string exportMessage;
+
+    std::vector<unsigned long> focused = monitor.getFocusedProcesses();
+    unsigned long pid = focused.empty() ? 0 : focused[0];
+    ProfileStatus status = profiler.status();
+
+    if (status.running) {
+        if (ImGui::Button("Parar")) {
+            profiler.stop();
+            lastBuild = -1.0;
+        }
+    }
+    else if (pid == 0) {
+        ImGui::TextDisabled("Selecione um processo na aba Processos para amostrar as pilhas.");
+    }
+    else {
+        char label[64];
+        snprintf(label, sizeof(label), "Amostrar PID %lu", pid);
+        if (ImGui::Button(label)) {
+            ProfileOptions options;
+            options.frequencyHz = (unsigned)std::max(1, frequency);
+            options.method = (ProfileOptions::Method)method;
+            profiler.start(pid, options);
+            flameGraphs.reset();
+            zoom = 0;
+            lastBuild = -1.0;
+            exportMessage.clear();
+        }
+    }
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(120.0f);
+    ImGui::InputInt("Hz", &frequency);
+    ImGui::SameLine();
+    const char* methods[] = { "Automatico", "perf_event", "ptrace" };
+    ImGui::SetNextItemWidth(140.0f);
+    ImGui::Combo("Metodo", &method, methods, 3);
+
+    status = profiler.status();
+    if (!status.error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "Falhou: %s", status.error.c_str());
+    }
+    else if (status.pid != 0) {
+        ImGui::Text("PID %lu via %s%s: %llu amostras em %.1f s, %lu threads, %llu perdidas",
+            status.pid, status.method.c_str(), status.running ? "" : " (parado)", status.samples,
+            status.seconds, status.threads, status.lostSamples);
+    }
+
+    // A arvore e remontada fora desta thread, no maximo uma vez por segundo
+    // enquanto amostra; ate ficar pronta, a anterior continua na tela.
+    double now = ImGui::GetTime();
+    if (status.pid != 0 && (lastBuild < 0.0 || (status.running && now - lastBuild >= 1.0))) {
+        flameGraphs.request();
+        lastBuild = now;
+    }
+    std::shared_ptr<const FlameGraph> latest = flameGraphs.latest();
+    if (!latest || latest->totalSamples() == 0) return;
+    const FlameGraph& graph = *latest;
+    if (zoom >= graph.nodes().size()) {
+        zoom = 0;
+    }
+
+    if (ImGui::Button("Exportar (folded)")) {
+        char path[64];
+        snprintf(path, sizeof(path), "perfil_%lu.folded", status.pid);
+        exportMessage = graph.writeFolded(path) ? std::string("Gravado em ") + path : std::string("Falha ao gravar ") + path;
+    }
+    if (!exportMessage.empty()) {
+        ImGui::SameLine();
+        ImGui::TextUnformatted(exportMessage.c_str());
+    }
+
+    unsigned long long total = graph.totalSamples();
+    if (ImGui::BeginTable("HotFunctions", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Proprio %");
+        ImGui::TableSetupColumn("Total %");
+        ImGui::TableSetupColumn("Funcao");
+        ImGui::TableHeadersRow();
+        for (const HotFunction& function : graph.hottest(8)) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.2f", 100.0 * function.self / total);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.2f", 100.0 * function.total / total);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextUnformatted(function.name.c_str());
+        }
+        ImGui::EndTable();
+    }
+
+    if (ImGui::BeginChild("FlameGraphChild", ImVec2(0, 0), true)) {
+        const std::vector<FlameNode>& nodes = graph.nodes();
+        float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        float width = ImGui::GetContentRegionAvail().x;
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        uint32_t clicked = FLAME_NO_CLICK;
+
+        // Ancestrais do no ampliado ocupam a largura toda, acima dele.
+        std::vector<uint32_t> ancestors;
+        for (uint32_t node = zoom; node != 0;) {
+            node = nodes[node].parent;
+            ancestors.push_back(node);
+        }
+        float y = origin.y;
+        for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+            ImVec2 min(origin.x, y);
+            ImVec2 max(origin.x + width - 1.0f, y + rowHeight - 1.0f);
+            ImGui::GetWindowDrawList()->AddRectFilled(min, max, IM_COL32(90, 90, 90, 255));
+            ImGui::GetWindowDrawList()->AddText(ImVec2(min.x + 3.0f, min.y + 1.0f), IM_COL32(230, 230, 230, 255),
+                nodes[*it].name.c_str());
+            if (ImGui::IsMouseHoveringRect(min, max) && ImGui::IsMouseClicked(0)) {
+                clicked = *it;
+            }
+            y += rowHeight;
+        }
+        drawFlameNode(graph, zoom, origin.x, y, width, rowHeight, total, clicked);
+        ImGui::Dummy(ImVec2(width, rowHeight * (float)(graph.maxDepth() + 1)));
+        if (clicked != FLAME_NO_CLICK) {
+            zoom = clicked;
+        }
+    }
+    ImGui::EndChild();
+}
+
+// Verde (ocioso) a vermelho (ocupado).
+static ImU32 heatColor(float busy) {
+    float t = std::min(std::max(busy / 100.0f, 0.0f), 1.0f);
+    return IM_COL32((int)(40 + 180 * t), (int)(160 - 120 * t), 60, 255);
+}
+
+// Uma celula por nucleo, quebrando em linhas quando nao cabem com pelo menos
+// 3 px cada. Le direto as colunas do CpuCoreUsage: nada e alocado por frame.
+static void drawCoreHeatmap(const CpuCoreUsage& cores) {
+    if (cores.count == 0) return;
+    float width = ImGui::GetContentRegionAvail().x;
+    unsigned perRow = std::max(1u, std::min(cores.count, (unsigned)(width / 3.0f)));
+    unsigned rows = (cores.count + perRow - 1) / perRow;
+    float cellWidth = width / perRow;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    for (unsigned core = 0; core < cores.count; ++core) {
+        float x = origin.x + (core % perRow) * cellWidth;
+        float y = origin.y + (core / perRow) * HEATMAP_CELL_HEIGHT;
+        drawList->AddRectFilled(ImVec2(x, y), ImVec2(x + cellWidth - 1.0f, y + HEATMAP_CELL_HEIGHT - 1.0f),
+            heatColor(cores.busy[core]));
+    }
+
+    ImVec2 end(origin.x + width, origin.y + rows * HEATMAP_CELL_HEIGHT);
+    ImGui::Dummy(ImVec2(width, rows * HEATMAP_CELL_HEIGHT));
+    if (ImGui::IsMouseHoveringRect(origin, end)) {
+        ImVec2 mouse = ImGui::GetMousePos();
+        unsigned core = (unsigned)((mouse.y - origin.y) / HEATMAP_CELL_HEIGHT) * perRow +
+            (unsigned)((mouse.x - origin.x) / cellWidth);
+        if (core < cores.count) {
+            ImGui::SetTooltip("CPU %u: %.1f %% (user %.1f, system %.1f, iowait %.1f, irq %.1f, steal %.1f)",
+                cores.id[core], cores.busy[core], cores.states[CPU_STATE_USER][core],
+                cores.states[CPU_STATE_SYSTEM][core], cores.states[CPU_STATE_IOWAIT][core],
+                cores.states[CPU_STATE_IRQ][core], cores.states[CPU_STATE_STEAL][core]);
+        }
+    }
+}
+
+static void pressureCell(const PressureLine& line, bool valid) {
+    ImGui::TableNextColumn();
+    if (valid) ImGui::Text("%.2f", line.avg10); else ImGui::TextDisabled("-");
+    ImGui::TableNextColumn();
+    if (valid) ImGui::Text("%.2f", line.avg60); else ImGui::TextDisabled("-");
+    ImGui::TableNextColumn();
+    if (valid) ImGui::Text("%.2f", line.avg300); else ImGui::TextDisabled("-");
+    ImGui::TableNextColumn();
+    if (valid && line.lastInterval >= 0.0) ImGui::Text("%.2f", line.lastInterval); else ImGui::TextDisabled("-");
+}
+
+// Divisao do tempo de CPU (maquina e cada nucleo) e pressao de recursos.
+void renderUI_CpuTab(const SystemInfo& info) {
+    ImGui::Text("%u nucleos online; divisao da maquina:", info.cpuCoreCount);
+    for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+        ImGui::SameLine();
+        ImGui::Text("%s %.1f %%", cpuStateName((CpuState)state), info.cpuStatePercentages[state]);
+    }
+
+    ImGui::Spacing();
+    ImGui::Text("Pressao (PSI, %% do tempo com tarefas paradas esperando o recurso)");
+    if (ImGui::BeginTable("PressureTable", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Recurso");
+        ImGui::TableSetupColumn("some 10s");
+        ImGui::TableSetupColumn("some 60s");
+        ImGui::TableSetupColumn("some 300s");
+        ImGui::TableSetupColumn("some ultimo");
+        ImGui::TableSetupColumn("full 10s");
+        ImGui::TableSetupColumn("full 60s");
+        ImGui::TableSetupColumn("full 300s");
+        ImGui::TableSetupColumn("full ultimo");
+        ImGui::TableHeadersRow();
+        for (unsigned resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+            const PressureInfo& pressure = info.pressure[resource];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(pressureResourceName((PressureResource)resource));
+            pressureCell(pressure.some, pressure.valid);
+            pressureCell(pressure.full, pressure.hasFull);
+        }
+        ImGui::EndTable();
+    }
+
+    ImGui::Spacing();
+    const CpuCoreUsage& cores = info.cpuCores;
+    if (ImGui::BeginTable("CoreTable", 2 + CPU_STATE_COUNT, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Nucleo");
+        ImGui::TableSetupColumn("Uso %");
+        for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+            ImGui::TableSetupColumn(cpuStateName((CpuState)state));
+        }
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)cores.count);
+        while (clipper.Step()) {
+            for (int core = clipper.DisplayStart; core < clipper.DisplayEnd; ++core) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("CPU %u", cores.id[core]);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", cores.busy[core]);
+                for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", cores.states[state][core]);
+                }
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+// Um cgroup e, abaixo dele, os subgrupos e os processos que estao direto
+// nele. As threads so aparecem para processos em foco (as unicas amostradas);
+// os demais mostram apenas a contagem.
+static void drawCgroupNode(const SystemInfo& info, uint32_t index,
+    const std::unordered_map<unsigned long, size_t>& processIndex) {
+    const CgroupInfo& group = (*info.cgroups)[index];
+    CgroupRowText row;
+    formatCgroupRow(group, row);
+
+    ImGui::TableNextRow();
+    ImGui::TableSetColumnIndex(0);
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth;
+    if (index == 0) flags |= ImGuiTreeNodeFlags_DefaultOpen;
+    if (group.children.empty() && group.pids.empty()) flags |= ImGuiTreeNodeFlags_Leaf;
+    bool open = ImGui::TreeNodeEx(&group, flags, "%s", group.name.c_str());
+    ImGui::TableSetColumnIndex(1);
+    ImGui::TextUnformatted(row.processes);
+    ImGui::TableSetColumnIndex(2);
+    ImGui::TextUnformatted(row.cpu);
+    ImGui::TableSetColumnIndex(3);
+    ImGui::TextUnformatted(row.groupCpu);
+    ImGui::TableSetColumnIndex(4);
+    ImGui::TextUnformatted(row.throttled);
+    ImGui::TableSetColumnIndex(5);
+    ImGui::TextUnformatted(row.memory);
+    ImGui::TableSetColumnIndex(6);
+    ImGui::TextUnformatted(row.groupMemory);
+    ImGui::TableSetColumnIndex(7);
+    ImGui::TextUnformatted(row.ioRead);
+    ImGui::TableSetColumnIndex(8);
+    ImGui::TextUnformatted(row.ioWrite);
+    if (!open) return;
+
+    for (uint32_t child : group.children) {
+        drawCgroupNode(info, child, processIndex);
+    }
+    for (unsigned long pid : group.pids) {
+        auto found = processIndex.find(pid);
+        if (found == processIndex.end()) continue;
+        const ProcessInfo& p = info.processes[found->second];
+        const FocusedProcessInfo* focused = nullptr;
+        for (const FocusedProcessInfo& candidate : info.focusedProcesses) {
+            if (candidate.pid == pid) focused = &candidate;
+        }
+        ProcessRowText text;
+        formatProcessRow(p, text);
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGuiTreeNodeFlags processFlags = ImGuiTreeNodeFlags_SpanFullWidth;
+        if (focused == nullptr) processFlags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+        bool processOpen = ImGui::TreeNodeEx(&p, processFlags, "%s (%lu)", p.name.c_str(), p.pid);
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%lu", p.threadCount);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::TextUnformatted(text.cpu);
+        ImGui::TableSetColumnIndex(5);
+        ImGui::TextUnformatted(text.memory);
+        ImGui::TableSetColumnIndex(7);
+        ImGui::TextUnformatted(text.ioRead);
+        ImGui::TableSetColumnIndex(8);
+        ImGui::TextUnformatted(text.ioWrite);
+        if (focused == nullptr || !processOpen) continue;
+
+        for (const ThreadInfo& t : focused->threads) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TreeNodeEx(&t, ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen,
+                "thread %lu", t.tid);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.1f%%", t.cpuUsagePercentage);
+        }
+        ImGui::TreePop();
+    }
+    ImGui::TreePop();
+}
+
+void renderUI_CgroupTab(const SystemInfo& info) {
+    static unsigned long long indexVersion = 0;
+    static std::unordered_map<unsigned long, size_t> processIndex;
+    if (info.processListVersion != indexVersion) {
+        indexVersion = info.processListVersion;
+        processIndex.clear();
+        for (size_t i = 0; i < info.processes.size(); ++i) {
+            processIndex[info.processes[i].pid] = i;
+        }
+    }
+
+    if (!info.cgroups || info.cgroups->size() <= 1) {
+        ImGui::TextDisabled("Nenhum cgroup v2 alem da raiz (plataforma sem cgroups ou todos os processos na raiz)");
+    }
+    if (!info.cgroups || info.cgroups->empty()) return;
+
+    if (ImGui::BeginTable("CgroupTable", 9, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Grupo");
+        ImGui::TableSetupColumn("Processos/threads");
+        ImGui::TableSetupColumn("CPU");
+        ImGui::TableSetupColumn("Nucleos (grupo)");
+        ImGui::TableSetupColumn("Throttling");
+        ImGui::TableSetupColumn("Memoria");
+        ImGui::TableSetupColumn("Memoria (grupo) / limite");
+        ImGui::TableSetupColumn("Leitura");
+        ImGui::TableSetupColumn("Escrita");
+        ImGui::TableHeadersRow();
+        drawCgroupNode(info, 0, processIndex);
+        ImGui::EndTable();
+    }
+}
+
+// Ultimas saidas de processos, da mais recente para a mais antiga. Acumula
+// as saidas de cada lista nova, mesmo com a aba fechada.
+void collectExits(const SystemInfo& info, std::deque<ProcessExit>& log) {
+    static unsigned long long lastListVersion = 0;
+    if (info.processListVersion == lastListVersion) return;
+    lastListVersion = info.processListVersion;
+    for (const ProcessExit& exit : info.exitedProcesses) {
+        log.push_front(exit);
+    }
+    while (log.size() > MAX_EXIT_LOG) {
+        log.pop_back();
+    }
+}
+
+void renderUI_ExitedTab(const SystemInfo& info, const std::deque<ProcessExit>& log) {
+    if (info.collectorStats.eventDriven) {
+        ImGui::Text("Lista mantida por eventos do kernel: %lu eventos e %lu varreduras no ultimo tick",
+            info.collectorStats.lifecycleEvents, info.collectorStats.rescans);
+    }
+    else {
+        ImGui::TextDisabled("Lista por varredura: processos que vivem menos que um tick nao aparecem");
+    }
+
+    if (ImGui::BeginTable("ExitTable", 7, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY)) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("PID");
+        ImGui::TableSetupColumn("Pai");
+        ImGui::TableSetupColumn("Nome");
+        ImGui::TableSetupColumn("CPU (s)");
+        ImGui::TableSetupColumn("Pico de memoria");
+        ImGui::TableSetupColumn("Codigo");
+        ImGui::TableSetupColumn("Vida curta");
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)log.size());
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const ProcessExit& exit = log[row];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::Text("%lu", exit.pid);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%lu", exit.parentPid);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::TextUnformatted(exit.name.c_str());
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.2f", exit.cpuSeconds);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::TextUnformatted(exit.peakRssBytes ? formatBytes(exit.peakRssBytes).c_str() : "-");
+                ImGui::TableSetColumnIndex(5);
+                if (exit.exitCode >= 0) {
+                    ImGui::Text("%d", exit.exitCode);
+                }
+                else {
+                    ImGui::TextDisabled("?");
+                }
+                ImGui::TableSetColumnIndex(6);
+                ImGui::TextUnformatted(exit.shortLived ? "sim" : "");
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+// O arquivo de regras inteiro, linha a linha: comentarios e linhas vazias
+// continuam no lugar quando a aba acrescenta ou tira uma regra.
+static std::vector<std::string> readAlertRuleFile(const char* path) {
+    std::vector<std::string> lines;
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return lines;
+    std::string line;
+    char buffer[512];
+    while (fgets(buffer, sizeof(buffer), file) != NULL) {
+        line += buffer;
+        if (line.back() != '\n' && !feof(file)) continue;
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        lines.push_back(line);
+        line.clear();
+    }
+    fclose(file);
+    return lines;
+}
+
+static void writeAlertRuleFile(const char* path, const std::vector<std::string>& lines) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return;
+    for (const std::string& line : lines) {
+        fprintf(file, "%s\n", line.c_str());
+    }
+    fclose(file);
+}
+
+static bool isAlertRuleLine(const std::string& line) {
+    size_t first = line.find_first_not_of(" \t");
+    return first != std::string::npos && line[first] != '#';
+}
+
+// Compila o arquivo inteiro (os erros citam a linha do arquivo); com erro, o
+// plano em uso continua valendo.
+static bool applyAlertRules(SystemMonitor& monitor, const std::vector<std::string>& lines, std::string& error) {
+    std::string text;
+    for (const std::string& line : lines) {
+        text += line;
+        text += '\n';
+    }
+    std::shared_ptr<AlertPlan> plan = std::make_shared<AlertPlan>();
+    if (!compileAlertRules(text, *plan, error)) return false;
+    monitor.setAlertRules(plan->rules.empty() ? nullptr : plan);
+    error.clear();
+    return true;
+}
+
+// Duracao: das condicoes passarem ate nowMs (alertas valendo) ou ate o
+// evento (nowMs = 0).
+static void alertTable(const char* id, const std::vector<AlertEvent>& events, bool newestFirst,
+    unsigned long long nowMs, float height) {
+    if (!ImGui::BeginTable(id, 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY,
+        ImVec2(0.0f, height))) {
+        return;
+    }
+    ImGui::TableSetupScrollFreeze(0, 1);
+    ImGui::TableSetupColumn("Duracao (s)");
+    ImGui::TableSetupColumn("Evento");
+    ImGui::TableSetupColumn("Alerta");
+    ImGui::TableHeadersRow();
+    ImGuiListClipper clipper;
+    clipper.Begin((int)events.size());
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+            const AlertEvent& event = events[newestFirst ? events.size() - 1 - row : row];
+            char text[256];
+            formatAlertEvent(event, text, sizeof(text));
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::Text("%.1f", ((nowMs != 0 ? nowMs : event.timestampMs) - event.sinceMs) / 1000.0);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::TextUnformatted(event.kind == ALERT_FIRED ? "disparou" : "terminou");
+            ImGui::TableSetColumnIndex(2);
+            ImGui::TextUnformatted(text);
+        }
+    }
+    ImGui::EndTable();
+}
+
+void renderUI_AlertTab(SystemMonitor& monitor, const SystemInfo& info,
+    std::vector<std::string>& ruleFile, std::string& error) {
+    static char newRule[256] = "";
+    ImGui::SetNextItemWidth(-ImGui::CalcTextSize("Adicionar").x * 2.0f);
+    ImGui::InputText("##NovaRegra", newRule, sizeof(newRule));
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("nome: process|system [name=texto] [user=nome] cond [and cond...] [for dur]\n"
+            "cond: metrica > valor, rate(metrica[, janela]) > valor ou top N metrica");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Adicionar") && newRule[0] != '\0') {
+        ruleFile.push_back(newRule);
+        if (applyAlertRules(monitor, ruleFile, error)) {
+            writeAlertRuleFile(ALERT_RULES_FILE, ruleFile);
+            newRule[0] = '\0';
+        }
+        else {
+            ruleFile.pop_back();
+        }
+    }
+    if (!error.empty()) {
+        ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.4f, 1.0f), "%s", error.c_str());
+    }
+
+    size_t ruleCount = 0;
+    for (size_t i = 0; i < ruleFile.size(); ++i) {
+        if (!isAlertRuleLine(ruleFile[i])) continue;
+        ++ruleCount;
+        ImGui::PushID((int)i);
+        if (ImGui::SmallButton("Remover")) {
+            ruleFile.erase(ruleFile.begin() + i);
+            applyAlertRules(monitor, ruleFile, error);
+            writeAlertRuleFile(ALERT_RULES_FILE, ruleFile);
+            ImGui::PopID();
+            break;
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(ruleFile[i].c_str());
+        ImGui::PopID();
+    }
+    if (ruleCount == 0) {
+        ImGui::TextDisabled("Nenhuma regra (arquivo %s)", ALERT_RULES_FILE);
+        return;
+    }
+
+    const AlertStats& stats = info.alertStats;
+    ImGui::Text("%u regras, %lu em espera ou valendo, %llu disparos, %llu fins, %llu avaliacoes",
+        stats.rules, stats.states, stats.fired, stats.resolved, stats.evaluations);
+    if (!info.alerts) return;
+    ImGui::Separator();
+    ImGui::Text("Valendo agora (%zu)", info.alerts->active.size());
+    alertTable("AlertActive", info.alerts->active, false, wallClockMs(), ImGui::GetContentRegionAvail().y * 0.4f);
+    ImGui::Text("Ultimos eventos");
+    alertTable("AlertRecent", info.alerts->recent, true, 0, 0.0f);
+}
+
 int main(int, char**) {
     if (!glfwInit()) {
         fprintf(stderr, "Falha ao inicializar GLFW\n");
@@ -184,8 +1020,21 @@ int main(int, char**) {
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     SystemMonitor monitor;
+    // Sem permissao para os eventos, a lista continua sendo varrida.
+    monitor.enableLifecycleEvents();
+    // O log de alertas so pode ser aberto antes da thread de coleta existir.
+    monitor.openAlertLog(ALERT_LOG_FILE);
+    std::vector<std::string> alertRuleFile = readAlertRuleFile(ALERT_RULES_FILE);
+    std::string alertError;
+    applyAlertRules(monitor, alertRuleFile, alertError);
     monitor.start();
-    SystemInfo currentInfo;
+    std::deque<ProcessExit> exitLog;
+    std::unique_ptr<Profiler> profiler = createPlatformProfiler();
+    // Depois do profiler: a thread de montagem para antes dele sumir.
+    FlameGraphBuilder flameGraphs(*profiler);
+    unsigned long long labelsVersion = 0;
+    std::string ramLabel;
+    std::string cpuLabel;
 
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
@@ -202,20 +1051,29 @@ int main(int, char**) {
 
         ImGui::Begin("Monitor de Sistema Principal", NULL, window_flags);
 
-        monitor.getLatestInfo(currentInfo);
+        std::shared_ptr<const SystemInfo> snapshot = monitor.getLatestSnapshot();
+        const SystemInfo& currentInfo = *snapshot;
+        collectExits(currentInfo, exitLog);
+
+        if (currentInfo.version != labelsVersion) {
+            labelsVersion = currentInfo.version;
+            std::stringstream ssRam;
+            ssRam << std::fixed << std::setprecision(1)
+                << (currentInfo.ramUsedBytes / (1024.0 * 1024.0 * 1024.0)) << " GB / "
+                << (currentInfo.ramTotalBytes / (1024.0 * 1024.0 * 1024.0)) << " GB ("
+                << (int)currentInfo.ramUsagePercentage << "%%)";
+            ramLabel = ssRam.str();
+            std::stringstream ssCpu;
+            ssCpu << std::fixed << std::setprecision(1) << currentInfo.cpuLoadPercentage << " %%";
+            cpuLabel = ssCpu.str();
+        }
 
         ImGui::Text("Uso de RAM:");
-        std::stringstream ssRam;
-        ssRam << std::fixed << std::setprecision(1)
-            << (currentInfo.ramUsedBytes / (1024.0 * 1024.0 * 1024.0)) << " GB / "
-            << (currentInfo.ramTotalBytes / (1024.0 * 1024.0 * 1024.0)) << " GB ("
-            << (int)currentInfo.ramUsagePercentage << "%%)";
-        ImGui::ProgressBar(currentInfo.ramUsagePercentage / 100.0, ImVec2(-1.0f, 0.0f), ssRam.str().c_str());
+        ImGui::ProgressBar(currentInfo.ramUsagePercentage / 100.0, ImVec2(-1.0f, 0.0f), ramLabel.c_str());
         ImGui::Spacing();
         ImGui::Text("Carga da CPU:");
-        std::stringstream ssCpu;
-        ssCpu << std::fixed << std::setprecision(1) << currentInfo.cpuLoadPercentage << " %%";
-        ImGui::ProgressBar(currentInfo.cpuLoadPercentage / 100.0, ImVec2(-1.0f, 0.0f), ssCpu.str().c_str());
+        ImGui::ProgressBar(currentInfo.cpuLoadPercentage / 100.0, ImVec2(-1.0f, 0.0f), cpuLabel.c_str());
+        drawCoreHeatmap(currentInfo.cpuCores);
         ImGui::Separator();
 
         if (ImGui::BeginTabBar("MainTabBar")) {
@@ -223,11 +1081,51 @@ int main(int, char**) {
                 renderUI_ProcessTab(monitor, currentInfo);
                 ImGui::EndTabItem();
             }
+            if (ImGui::BeginTabItem("CPU")) {
+                renderUI_CpuTab(currentInfo);
+                ImGui::EndTabItem();
+            }
+            if (ImGui::BeginTabItem("Grupos")) {
+                renderUI_CgroupTab(currentInfo);
+                ImGui::EndTabItem();
+            }
+            if (ImGui::BeginTabItem("Perfil")) {
+                renderUI_ProfileTab(monitor, *profiler, flameGraphs);
+                ImGui::EndTabItem();
+            }
+            if (ImGui::BeginTabItem("Encerrados")) {
+                renderUI_ExitedTab(currentInfo, exitLog);
+                ImGui::EndTabItem();
+            }
+            if (ImGui::BeginTabItem("Alertas")) {
+                renderUI_AlertTab(monitor, currentInfo, alertRuleFile, alertError);
+                ImGui::EndTabItem();
+            }
+            if (ImGui::BeginTabItem("Diagnostico")) {
+                renderUI_DiagnosticsTab(currentInfo);
+                ImGui::EndTabItem();
+            }
             ImGui::EndTabBar();
         }
 
         ImGui::Separator();
         ImGui::Text("Desempenho da UI: %.1f FPS (%.3f ms/frame)", io.Framerate, 1000.0f / io.Framerate);
+        ImGui::Text("Coletor: %lu handles em cache, %lu abertos, %lu descartados, %llu syscalls economizadas, %lu metadados lidos no ultimo tick",
+            currentInfo.collectorStats.cachedHandles, currentInfo.collectorStats.handlesOpened,
+            currentInfo.collectorStats.handlesEvicted, currentInfo.collectorStats.syscallsSaved,
+            currentInfo.collectorStats.metadataLoads);
+        double slowestShardMs = 0.0;
+        unsigned long stolenChunks = 0;
+        for (const ShardStats& shard : currentInfo.samplingShards) {
+            slowestShardMs = shard.busyMs > slowestShardMs ? shard.busyMs : slowestShardMs;
+            stolenChunks += shard.stolen;
+        }
+        ImGui::Text("Amostragem: %zu workers, worker mais lento %.2f ms, %lu blocos roubados",
+            currentInfo.samplingShards.size(), slowestShardMs, stolenChunks);
+        ImGui::Text("Agendador: tick %.2f ms, %llu prazos perdidos, periodos %.0f/%.0f/%.0f ms",
+            currentInfo.scheduler.lastTickMs, currentInfo.scheduler.missedDeadlines,
+            currentInfo.scheduler.systemPeriodMs, currentInfo.scheduler.processPeriodMs,
+            currentInfo.scheduler.threadPeriodMs);
 
         ImGui::End();
 
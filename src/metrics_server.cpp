@@ -0,0 +1,191 @@
+#include "metrics_server.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+#include "stream_format.h"
+#include "ui_format.h"
+
+static const char* const PRESSURE_LABELS[PRESSURE_RESOURCE_COUNT] = { "cpu", "memory", "io" };
+
+static void appendf(std::string& out, const char* format, ...) {
+    char buffer[128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (n > 0) out.append(buffer, std::min<size_t>((size_t)n, sizeof(buffer) - 1));
+}
+
+// Valores de rotulo escapam barra invertida, aspas e quebra de linha.
+static void appendLabel(std::string& out, const std::string& value) {
+    for (char c : value) {
+        if (c == '\\') out += "\\\\";
+        else if (c == '"') out += "\\\"";
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+}
+
+static void family(std::string& out, const char* name, const char* type, const char* help) {
+    appendf(out, "# HELP %s ", name);
+    out += help;
+    appendf(out, "\n# TYPE %s %s\n", name, type);
+}
+
+static void sample(std::string& out, const char* name, double value) {
+    appendf(out, "%s %.6g\n", name, value);
+}
+
+static void sample(std::string& out, const char* name, unsigned long long value) {
+    appendf(out, "%s %llu\n", name, value);
+}
+
+static void processLabels(std::string& out, const char* name, const ProcessInfo& p) {
+    appendf(out, "%s{pid=\"%lu\",name=\"", name, p.pid);
+    appendLabel(out, p.name.str());
+    out += "\"} ";
+}
+
+static void cgroupLabels(std::string& out, const char* name, const CgroupInfo& group) {
+    appendf(out, "%s{path=\"", name);
+    appendLabel(out, group.path.str());
+    out += "\"} ";
+}
+
+void formatPrometheus(const SystemInfo& info, size_t processLimit, std::string& out) {
+    out.clear();
+    size_t processCount = processLimit ? std::min(processLimit, info.processes.size()) : info.processes.size();
+
+    family(out, "meumonitor_snapshot_version", "counter", "Snapshots publicados pelo coletor.");
+    sample(out, "meumonitor_snapshot_version", info.version);
+    family(out, "meumonitor_snapshot_timestamp_seconds", "gauge", "Momento da publicacao do snapshot.");
+    appendf(out, "meumonitor_snapshot_timestamp_seconds %.3f\n", info.timestampMs / 1000.0);
+
+    family(out, "meumonitor_memory_total_bytes", "gauge", "Memoria fisica total.");
+    sample(out, "meumonitor_memory_total_bytes", info.ramTotalBytes);
+    family(out, "meumonitor_memory_used_bytes", "gauge", "Memoria fisica em uso.");
+    sample(out, "meumonitor_memory_used_bytes", info.ramUsedBytes);
+
+    family(out, "meumonitor_cpu_usage_percent", "gauge", "CPU da maquina em uso (100 = todos os nucleos).");
+    sample(out, "meumonitor_cpu_usage_percent", info.cpuLoadPercentage);
+    family(out, "meumonitor_cpu_state_percent", "gauge", "Divisao do tempo de CPU da maquina por estado.");
+    for (unsigned state = 0; state < CPU_STATE_COUNT; ++state) {
+        appendf(out, "meumonitor_cpu_state_percent{state=\"%s\"} %.6g\n", cpuStateName((CpuState)state),
+            info.cpuStatePercentages[state]);
+    }
+    family(out, "meumonitor_cpu_core_busy_percent", "gauge", "Ocupacao de cada nucleo.");
+    for (unsigned core = 0; core < info.cpuCores.count; ++core) {
+        appendf(out, "meumonitor_cpu_core_busy_percent{cpu=\"%u\"} %.6g\n", info.cpuCores.id[core],
+            (double)info.cpuCores.busy[core]);
+    }
+
+    family(out, "meumonitor_pressure_percent", "gauge", "Pressao (PSI): % do tempo com tarefas esperando o recurso.");
+    for (unsigned resource = 0; resource < PRESSURE_RESOURCE_COUNT; ++resource) {
+        const PressureInfo& pressure = info.pressure[resource];
+        if (!pressure.valid) continue;
+        for (int kind = 0; kind < (pressure.hasFull ? 2 : 1); ++kind) {
+            const PressureLine& line = kind == 0 ? pressure.some : pressure.full;
+            const char* kindName = kind == 0 ? "some" : "full";
+            const double values[3] = { line.avg10, line.avg60, line.avg300 };
+            const char* const windows[3] = { "10s", "60s", "300s" };
+            for (int w = 0; w < 3; ++w) {
+                appendf(out, "meumonitor_pressure_percent{resource=\"%s\",kind=\"%s\",window=\"%s\"} %.6g\n",
+                    PRESSURE_LABELS[resource], kindName, windows[w], values[w]);
+            }
+        }
+    }
+
+    family(out, "meumonitor_processes", "gauge", "Processos na ultima lista.");
+    sample(out, "meumonitor_processes", (unsigned long long)info.processes.size());
+
+    family(out, "meumonitor_process_cpu_percent", "gauge", "CPU do processo (100 = todos os nucleos).");
+    for (size_t i = 0; i < processCount; ++i) {
+        processLabels(out, "meumonitor_process_cpu_percent", info.processes[i]);
+        appendf(out, "%.6g\n", info.processes[i].cpuUsagePercentage);
+    }
+    family(out, "meumonitor_process_memory_bytes", "gauge", "Memoria residente do processo.");
+    for (size_t i = 0; i < processCount; ++i) {
+        processLabels(out, "meumonitor_process_memory_bytes", info.processes[i]);
+        appendf(out, "%llu\n", info.processes[i].memoryUsedBytes);
+    }
+    family(out, "meumonitor_process_threads", "gauge", "Threads do processo.");
+    for (size_t i = 0; i < processCount; ++i) {
+        processLabels(out, "meumonitor_process_threads", info.processes[i]);
+        appendf(out, "%lu\n", info.processes[i].threadCount);
+    }
+    // Sem a taxa medida (primeira lista, sem permissao) a serie fica de fora.
+    static const struct {
+        ProcessCounter counter;
+        const char* name;
+        const char* help;
+    } RATES[] = {
+        { COUNTER_IO_READ_BYTES, "meumonitor_process_io_read_bytes_per_second", "Leitura de disco do processo." },
+        { COUNTER_IO_WRITE_BYTES, "meumonitor_process_io_write_bytes_per_second", "Escrita em disco do processo." },
+    };
+    for (const auto& rate : RATES) {
+        family(out, rate.name, "gauge", rate.help);
+        for (size_t i = 0; i < processCount; ++i) {
+            double value = info.processes[i].rate(rate.counter);
+            if (value < 0.0) continue;
+            processLabels(out, rate.name, info.processes[i]);
+            appendf(out, "%.6g\n", value);
+        }
+    }
+
+    static const std::vector<CgroupInfo> noCgroups;
+    const std::vector<CgroupInfo>& cgroups = info.cgroups ? *info.cgroups : noCgroups;
+    family(out, "meumonitor_cgroup_cpu_percent", "gauge", "CPU somada dos processos do grupo e subgrupos.");
+    for (const CgroupInfo& group : cgroups) {
+        cgroupLabels(out, "meumonitor_cgroup_cpu_percent", group);
+        appendf(out, "%.6g\n", group.cpuUsagePercentage);
+    }
+    family(out, "meumonitor_cgroup_memory_bytes", "gauge", "Memoria somada dos processos do grupo e subgrupos.");
+    for (const CgroupInfo& group : cgroups) {
+        cgroupLabels(out, "meumonitor_cgroup_memory_bytes", group);
+        appendf(out, "%llu\n", group.memoryUsedBytes);
+    }
+    family(out, "meumonitor_cgroup_processes", "gauge", "Processos do grupo e subgrupos.");
+    for (const CgroupInfo& group : cgroups) {
+        cgroupLabels(out, "meumonitor_cgroup_processes", group);
+        appendf(out, "%lu\n", group.processCount);
+    }
+
+    family(out, "meumonitor_scheduler_missed_deadlines_total", "counter", "Ticks que passaram do prazo.");
+    sample(out, "meumonitor_scheduler_missed_deadlines_total", info.scheduler.missedDeadlines);
+    family(out, "meumonitor_self_cpu_percent", "gauge", "CPU do proprio monitor (100 = um nucleo).");
+    sample(out, "meumonitor_self_cpu_percent", info.diagnostics.selfCpuPercent);
+    family(out, "meumonitor_self_rss_bytes", "gauge", "Memoria residente do proprio monitor.");
+    sample(out, "meumonitor_self_rss_bytes", info.diagnostics.selfRssBytes);
+}
+
+// Um encoder novo nao tem estado anterior: o frame traz a lista inteira.
+void formatMetricsBinary(const SystemInfo& info, std::string& out) {
+    std::vector<uint8_t> bytes;
+    stream_format::writeHeader(bytes);
+    StreamEncoder encoder;
+    encoder.encodeTick(info, bytes);
+    out.assign(bytes.begin(), bytes.end());
+}
+
+std::shared_ptr<const std::string> MetricsCache::body(const SystemInfo& info, MetricsFormat format) {
+    Entry& entry = m_entries[format];
+    if (entry.body && entry.version == info.version) return entry.body;
+
+    // O corpo anterior vira reserva; se algum cliente ainda o envia, a
+    // reserva e descartada e um buffer novo e alocado.
+    std::shared_ptr<std::string> target = entry.spare && entry.spare.use_count() == 1 ?
+        entry.spare : std::make_shared<std::string>();
+    entry.spare = entry.body;
+    if (format == METRICS_PROMETHEUS) {
+        formatPrometheus(info, m_processLimit, *target);
+    }
+    else {
+        formatMetricsBinary(info, *target);
+    }
+    entry.body = target;
+    entry.version = info.version;
+    ++m_serializations;
+    return entry.body;
+}
@@ -0,0 +1,87 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "system_info.h"
+
+class SystemMonitor;
+
+enum MetricsFormat {
+    // Formato de exposicao em texto do Prometheus (0.0.4).
+    METRICS_PROMETHEUS,
+    // Cabecalho do stream_format seguido de um unico frame completo; o
+    // MeuMonitorDecode le do mesmo jeito que um arquivo do daemon.
+    METRICS_BINARY,
+    METRICS_FORMAT_COUNT
+};
+
+struct MetricsServerOptions {
+    std::string socketPath;
+    // Conexoes abertas ao mesmo tempo; acima disso sao fechadas no accept.
+    size_t maxClients = 256;
+    // Processos com series proprias no texto (os de mais memoria); 0 = todos.
+    size_t processLimit = 0;
+    // Conexao que nao termina o pedido ou nao le a resposta nesse tempo e
+    // fechada.
+    unsigned clientTimeoutMs = 5000;
+};
+
+struct MetricsServerStats {
+    unsigned long long requests = 0;
+    // Corpos serializados; menor que requests quando o cache e aproveitado.
+    unsigned long long serializations = 0;
+    // Conexoes recusadas (limite), pedidos invalidos e tempos esgotados.
+    unsigned long long rejected = 0;
+    unsigned long long bytesSent = 0;
+    size_t clients = 0;
+    std::string error;
+};
+
+void formatPrometheus(const SystemInfo& info, size_t processLimit, std::string& out);
+void formatMetricsBinary(const SystemInfo& info, std::string& out);
+
+// Corpo de cada formato serializado no maximo uma vez por versao de
+// snapshot. Os corpos sao imutaveis depois de prontos: cada cliente segura
+// o seu shared_ptr ate terminar de enviar, sem copia, e um buffer so e
+// reaproveitado quando nenhum cliente o segura mais. So a thread do
+// servidor usa.
+class MetricsCache {
+public:
+    explicit MetricsCache(size_t processLimit = 0) : m_processLimit(processLimit) {}
+
+    std::shared_ptr<const std::string> body(const SystemInfo& info, MetricsFormat format);
+    unsigned long long serializations() const { return m_serializations; }
+
+private:
+    struct Entry {
+        unsigned long long version = 0;
+        std::shared_ptr<std::string> body;
+        std::shared_ptr<std::string> spare;
+    };
+
+    size_t m_processLimit;
+    Entry m_entries[METRICS_FORMAT_COUNT];
+    unsigned long long m_serializations = 0;
+};
+
+// Servidor local das metricas do ultimo snapshot publicado. Atende HTTP/1.0
+// num socket Unix (ex.: curl --unix-socket): GET /metrics devolve o texto
+// do Prometheus e GET /metrics.bin o formato binario. Roda numa thread
+// propria e so le snapshots ja publicados, entao um cliente lento ou
+// parado nunca atrasa o coletor.
+class MetricsServer {
+public:
+    virtual ~MetricsServer() = default;
+
+    virtual bool start(const MetricsServerOptions& options) = 0;
+    virtual void stop() = 0;
+    virtual MetricsServerStats stats() const = 0;
+};
+
+std::unique_ptr<MetricsServer> createPlatformMetricsServer(SystemMonitor& monitor);
+
+#endif
@@ -0,0 +1,326 @@
+#include "metrics_server_linux.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "backend.h"
+
+// Pedidos maiores que isso nao sao de um scraper; a conexao e recusada.
+static const size_t MAX_REQUEST_BYTES = 8192;
+static const int EPOLL_BATCH = 64;
+// Intervalo maximo entre verificacoes dos tempos esgotados.
+static const int SWEEP_MS = 250;
+
+static const std::shared_ptr<const std::string>& emptyBody() {
+    static const std::shared_ptr<const std::string> body = std::make_shared<std::string>();
+    return body;
+}
+
+LinuxMetricsServer::LinuxMetricsServer(SystemMonitor& monitor) :
+    m_monitor(monitor)
+{
+}
+
+LinuxMetricsServer::~LinuxMetricsServer() {
+    stop();
+}
+
+void LinuxMetricsServer::fail(const std::string& error) {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.error = error + ": " + strerror(errno);
+}
+
+bool LinuxMetricsServer::start(const MetricsServerOptions& options) {
+    stop();
+    m_options = options;
+    m_cache = MetricsCache(options.processLimit);
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats = MetricsServerStats();
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (options.socketPath.empty() || options.socketPath.size() >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        fail("caminho do socket invalido");
+        return false;
+    }
+    memcpy(addr.sun_path, options.socketPath.c_str(), options.socketPath.size());
+
+    // Um socket deixado por uma execucao anterior impediria o bind; outros
+    // tipos de arquivo nao sao apagados.
+    struct stat st;
+    if (lstat(options.socketPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(options.socketPath.c_str());
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        fail("socket");
+        return false;
+    }
+    if (bind(m_listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listenFd, 128) != 0) {
+        fail("bind " + options.socketPath);
+        stop();
+        return false;
+    }
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        fail("epoll");
+        stop();
+        return false;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_listenFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_listenFd, &event);
+    event.data.fd = m_wakeFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &event);
+
+    m_thread = std::thread(&LinuxMetricsServer::serveLoop, this);
+    return true;
+}
+
+void LinuxMetricsServer::stop() {
+    if (m_thread.joinable()) {
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // Sem o eventfd a thread nao tem como sair; nao acontece na pratica.
+        }
+        m_thread.join();
+    }
+    while (!m_clients.empty()) {
+        closeClient(m_clients.begin()->first);
+    }
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_options.socketPath.c_str());
+    }
+    if (m_epollFd >= 0) close(m_epollFd);
+    if (m_wakeFd >= 0) close(m_wakeFd);
+    m_listenFd = m_epollFd = m_wakeFd = -1;
+}
+
+MetricsServerStats LinuxMetricsServer::stats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+void LinuxMetricsServer::serveLoop() {
+    struct epoll_event events[EPOLL_BATCH];
+    for (;;) {
+        int n = epoll_wait(m_epollFd, events, EPOLL_BATCH, SWEEP_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fail("epoll_wait");
+            return;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == m_wakeFd) return;
+            if (fd == m_listenFd) {
+                acceptClients();
+                continue;
+            }
+            auto it = m_clients.find(fd);
+            if (it == m_clients.end()) continue;
+            Client& client = it->second;
+            if (!client.responding) {
+                readRequest(fd, client);
+            }
+            else if (!writeResponse(fd, client)) {
+                closeClient(fd);
+            }
+        }
+        expireClients();
+    }
+}
+
+void LinuxMetricsServer::acceptClients() {
+    for (;;) {
+        int fd = accept4(m_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            // EAGAIN: fila vazia. EMFILE e afins: tenta de novo no proximo evento.
+            return;
+        }
+        if (m_clients.size() >= m_options.maxClients) {
+            close(fd);
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.rejected++;
+            continue;
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            continue;
+        }
+        Client& client = m_clients[fd];
+        client.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_options.clientTimeoutMs);
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.clients = m_clients.size();
+    }
+}
+
+void LinuxMetricsServer::readRequest(int fd, Client& client) {
+    char buffer[2048];
+    for (;;) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            client.request.append(buffer, (size_t)n);
+            if (client.request.size() > MAX_REQUEST_BYTES) break;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Pedido ainda incompleto: espera mais dados.
+            if (client.request.find("\r\n\r\n") == std::string::npos &&
+                client.request.find("\n\n") == std::string::npos) return;
+            respond(fd, client);
+            return;
+        }
+        break;
+    }
+    if (client.request.size() > MAX_REQUEST_BYTES || client.request.empty()) {
+        if (!client.request.empty()) {
+            std::lock_guard<std::mutex> lock(m_statsMutex);
+            m_stats.rejected++;
+        }
+        closeClient(fd);
+        return;
+    }
+    // O cliente fechou a escrita depois do pedido (ex.: shutdown(SHUT_WR)).
+    respond(fd, client);
+}
+
+// So a primeira linha importa: metodo e caminho.
+void LinuxMetricsServer::respond(int fd, Client& client) {
+    size_t lineEnd = client.request.find('\n');
+    std::string line = client.request.substr(0, lineEnd);
+    size_t methodEnd = line.find(' ');
+    std::string method = line.substr(0, methodEnd);
+    std::string path;
+    if (methodEnd != std::string::npos) {
+        size_t pathEnd = line.find_first_of(" ?\r", methodEnd + 1);
+        path = line.substr(methodEnd + 1, pathEnd == std::string::npos ? std::string::npos : pathEnd - methodEnd - 1);
+    }
+
+    const char* status = "200 OK";
+    const char* contentType = "text/plain; charset=utf-8";
+    bool headOnly = method == "HEAD";
+    client.body = emptyBody();
+    if (method != "GET" && !headOnly) {
+        status = "405 Method Not Allowed";
+    }
+    else if (path == "/metrics" || path == "/metrics.bin") {
+        bool binary = path == "/metrics.bin";
+        std::shared_ptr<const SystemInfo> snapshot = m_monitor.getLatestSnapshot();
+        client.body = m_cache.body(*snapshot, binary ? METRICS_BINARY : METRICS_PROMETHEUS);
+        contentType = binary ? "application/octet-stream" : "text/plain; version=0.0.4; charset=utf-8";
+    }
+    else {
+        status = "404 Not Found";
+    }
+
+    char header[256];
+    snprintf(header, sizeof(header), "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+        status, contentType, client.body->size());
+    client.header = header;
+    if (headOnly) client.body = emptyBody();
+    client.responding = true;
+    client.sent = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.requests++;
+        m_stats.serializations = m_cache.serializations();
+    }
+
+    if (!writeResponse(fd, client)) {
+        closeClient(fd);
+        return;
+    }
+    // O socket encheu: o resto vai quando o cliente ler.
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLOUT;
+    event.data.fd = fd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+bool LinuxMetricsServer::writeResponse(int fd, Client& client) {
+    size_t total = client.header.size() + client.body->size();
+    while (client.sent < total) {
+        struct iovec iov[2];
+        int count = 0;
+        if (client.sent < client.header.size()) {
+            iov[count].iov_base = (void*)(client.header.data() + client.sent);
+            iov[count].iov_len = client.header.size() - client.sent;
+            ++count;
+        }
+        size_t bodyOffset = client.sent > client.header.size() ? client.sent - client.header.size() : 0;
+        if (bodyOffset < client.body->size()) {
+            iov[count].iov_base = (void*)(client.body->data() + bodyOffset);
+            iov[count].iov_len = client.body->size() - bodyOffset;
+            ++count;
+        }
+        // sendmsg em vez de writev so para o MSG_NOSIGNAL: um cliente que
+        // fecha cedo nao pode derrubar o processo com SIGPIPE.
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        client.sent += (size_t)n;
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.bytesSent += (unsigned long long)n;
+    }
+    return false;
+}
+
+void LinuxMetricsServer::closeClient(int fd) {
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    m_clients.erase(fd);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.clients = m_clients.size();
+}
+
+void LinuxMetricsServer::expireClients() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::vector<int> expired;
+    for (const auto& entry : m_clients) {
+        if (entry.second.deadline <= now) expired.push_back(entry.first);
+    }
+    for (int fd : expired) {
+        closeClient(fd);
+    }
+    if (!expired.empty()) {
+        std::lock_guard<std::mutex> lock(m_statsMutex);
+        m_stats.rejected += expired.size();
+    }
+}
+
+std::unique_ptr<MetricsServer> createPlatformMetricsServer(SystemMonitor& monitor) {
+    return std::unique_ptr<MetricsServer>(new LinuxMetricsServer(monitor));
+}
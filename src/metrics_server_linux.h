@@ -0,0 +1,59 @@
+#ifndef METRICS_SERVER_LINUX_H
+#define METRICS_SERVER_LINUX_H
+
+#include "metrics_server.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// Uma thread com epoll atende todos os clientes, sem uma thread por
+// conexao. Os sockets sao nao bloqueantes: cada cliente le o pedido, recebe
+// o cabecalho e o corpo em cache por sendmsg (o corpo vai direto do buffer
+// compartilhado, sem copia para o cliente) e a conexao e fechada.
+class LinuxMetricsServer : public MetricsServer {
+public:
+    explicit LinuxMetricsServer(SystemMonitor& monitor);
+    ~LinuxMetricsServer() override;
+
+    bool start(const MetricsServerOptions& options) override;
+    void stop() override;
+    MetricsServerStats stats() const override;
+
+private:
+    struct Client {
+        std::string request;
+        bool responding = false;
+        std::string header;
+        std::shared_ptr<const std::string> body;
+        size_t sent = 0;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    void serveLoop();
+    void acceptClients();
+    void readRequest(int fd, Client& client);
+    void respond(int fd, Client& client);
+    // Devolve false quando a conexao terminou (enviada ou com erro).
+    bool writeResponse(int fd, Client& client);
+    void closeClient(int fd);
+    void expireClients();
+    void fail(const std::string& error);
+
+    SystemMonitor& m_monitor;
+    MetricsServerOptions m_options;
+    MetricsCache m_cache;
+    int m_listenFd = -1;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+    std::unordered_map<int, Client> m_clients;
+
+    mutable std::mutex m_statsMutex;
+    MetricsServerStats m_stats;
+};
+
+#endif
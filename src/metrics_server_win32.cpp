@@ -0,0 +1,21 @@
+#include "metrics_server.h"
+
+// Sem servidor de metricas no Windows por enquanto: o laco usa epoll e
+// sockets Unix com semantica do Linux.
+class UnsupportedMetricsServer : public MetricsServer {
+public:
+    bool start(const MetricsServerOptions&) override {
+        m_stats = MetricsServerStats();
+        m_stats.error = "servidor de metricas disponivel apenas no Linux";
+        return false;
+    }
+    void stop() override {}
+    MetricsServerStats stats() const override { return m_stats; }
+
+private:
+    MetricsServerStats m_stats;
+};
+
+std::unique_ptr<MetricsServer> createPlatformMetricsServer(SystemMonitor&) {
+    return std::unique_ptr<MetricsServer>(new UnsupportedMetricsServer());
+}
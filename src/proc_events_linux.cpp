@@ -0,0 +1,181 @@
+#include "proc_events_linux.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "instrumentation.h"
+#include "util.h"
+
+// Acima disso a fila descarta eventos e pede uma varredura completa: o
+// coletor parado (ou lento) nao faz a memoria crescer sem limite.
+static const size_t MAX_QUEUED_EVENTS = 1 << 16;
+
+ProcEventListener::~ProcEventListener() {
+    stop();
+}
+
+bool ProcEventListener::start() {
+    m_socket = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (m_socket < 0) return false;
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = CN_IDX_PROC;
+    if (bind(m_socket, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        stop();
+        return false;
+    }
+
+    // Uma mensagem netlink com um cn_msg pedindo PROC_CN_MCAST_LISTEN.
+    alignas(struct nlmsghdr) char buffer[NLMSG_SPACE(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op))];
+    memset(buffer, 0, sizeof(buffer));
+    struct nlmsghdr* header = (struct nlmsghdr*)buffer;
+    header->nlmsg_len = NLMSG_LENGTH(sizeof(struct cn_msg) + sizeof(enum proc_cn_mcast_op));
+    header->nlmsg_type = NLMSG_DONE;
+    header->nlmsg_pid = 0;
+    struct cn_msg* message = (struct cn_msg*)NLMSG_DATA(header);
+    message->id.idx = CN_IDX_PROC;
+    message->id.val = CN_VAL_PROC;
+    message->len = sizeof(enum proc_cn_mcast_op);
+    enum proc_cn_mcast_op op = PROC_CN_MCAST_LISTEN;
+    memcpy(message->data, &op, sizeof(op));
+    if (send(m_socket, header, header->nlmsg_len, 0) < 0) {
+        stop();
+        return false;
+    }
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        stop();
+        return false;
+    }
+    m_thread = std::thread(&ProcEventListener::readLoop, this);
+    return true;
+}
+
+void ProcEventListener::stop() {
+    if (m_thread.joinable()) {
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // A thread ainda sai quando o socket for fechado.
+        }
+        m_thread.join();
+    }
+    if (m_wakeFd >= 0) close(m_wakeFd);
+    if (m_socket >= 0) close(m_socket);
+    m_wakeFd = -1;
+    m_socket = -1;
+}
+
+bool ProcEventListener::drain(std::vector<ProcEvent>& out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.swap(m_queue);
+    bool complete = !m_lost;
+    m_lost = false;
+    return complete;
+}
+
+void ProcEventListener::readLoop() {
+    alignas(struct nlmsghdr) char buffer[16384];
+    struct pollfd fds[2];
+    fds[0].fd = m_socket;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeFd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        if (fds[1].revents != 0) return;
+
+        ssize_t n = recv(m_socket, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == ENOBUFS) {
+                // O kernel descartou mensagens: o conjunto de processos do
+                // coletor pode estar incompleto.
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_lost = true;
+                continue;
+            }
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return;
+        }
+        handleMessage(buffer, (size_t)n);
+    }
+}
+
+void ProcEventListener::handleMessage(const char* data, size_t length) {
+    int remaining = (int)length;
+    for (const struct nlmsghdr* header = (const struct nlmsghdr*)data; NLMSG_OK(header, remaining);
+        header = NLMSG_NEXT(header, remaining)) {
+        if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP) continue;
+
+        const struct cn_msg* message = (const struct cn_msg*)NLMSG_DATA(header);
+        if (message->id.idx != CN_IDX_PROC || message->id.val != CN_VAL_PROC) continue;
+        const struct proc_event* raw = (const struct proc_event*)message->data;
+
+        ProcEvent event;
+        event.timestampMs = wallClockMs();
+        switch (raw->what) {
+        case proc_event::PROC_EVENT_FORK:
+            if (raw->event_data.fork.child_pid != raw->event_data.fork.child_tgid) continue;
+            event.type = ProcEvent::FORK;
+            event.pid = (unsigned long)raw->event_data.fork.child_tgid;
+            event.parentPid = (unsigned long)raw->event_data.fork.parent_tgid;
+            break;
+        case proc_event::PROC_EVENT_EXEC:
+            event.type = ProcEvent::EXEC;
+            event.pid = (unsigned long)raw->event_data.exec.process_tgid;
+            break;
+        case proc_event::PROC_EVENT_EXIT: {
+            if (raw->event_data.exit.process_pid != raw->event_data.exit.process_tgid) continue;
+            event.type = ProcEvent::EXIT;
+            event.pid = (unsigned long)raw->event_data.exit.process_tgid;
+            event.parentPid = (unsigned long)raw->event_data.exit.parent_tgid;
+            event.exitStatus = (int)raw->event_data.exit.exit_code;
+
+            // O evento sai depois de o processo virar zumbi; se o pai ainda
+            // nao o recolheu, os tempos finais ainda podem ser lidos.
+            char path[64];
+            snprintf(path, sizeof(path), "/proc/%lu/stat", event.pid);
+            instrumentation::countSyscalls(3);
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                char stat[1024];
+                ssize_t n = read(fd, stat, sizeof(stat) - 1);
+                if (n > 0) {
+                    event.finalStat.assign(stat, (size_t)n);
+                }
+                close(fd);
+            }
+            break;
+        }
+        default:
+            continue;
+        }
+        push(event);
+    }
+}
+
+void ProcEventListener::push(ProcEvent& event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_queue.size() >= MAX_QUEUED_EVENTS) {
+        m_lost = true;
+        return;
+    }
+    m_queue.push_back(std::move(event));
+}
@@ -0,0 +1,63 @@
+#ifndef PROC_EVENTS_LINUX_H
+#define PROC_EVENTS_LINUX_H
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Evento de ciclo de vida de um processo (so processos; eventos de threads
+// sao descartados).
+struct ProcEvent {
+    enum Type {
+        FORK,
+        EXEC,
+        EXIT
+    };
+
+    Type type = FORK;
+    unsigned long pid = 0;
+    unsigned long parentPid = 0;
+    // Status no formato do wait(2); so em EXIT.
+    int exitStatus = 0;
+    unsigned long long timestampMs = 0;
+    // /proc/<pid>/stat lido assim que o EXIT chegou, enquanto o processo
+    // ainda e zumbi; vazio se o pai ja o tinha recolhido.
+    std::string finalStat;
+};
+
+// Escuta o proc connector do kernel (netlink) numa thread propria e
+// enfileira os eventos ate o coletor busca-los. Exige CAP_NET_ADMIN e so
+// funciona no namespace de rede inicial; sem isso start() falha e o coletor
+// continua varrendo /proc.
+class ProcEventListener {
+public:
+    ProcEventListener() = default;
+    ~ProcEventListener();
+
+    ProcEventListener(const ProcEventListener&) = delete;
+    ProcEventListener& operator=(const ProcEventListener&) = delete;
+
+    bool start();
+    void stop();
+
+    // Move os eventos pendentes para out (em ordem de chegada). Devolve false
+    // se algum evento foi perdido desde a ultima chamada (buffer do socket
+    // ou fila cheios); nesse caso o chamador deve varrer /proc de novo.
+    bool drain(std::vector<ProcEvent>& out);
+
+private:
+    void readLoop();
+    void handleMessage(const char* data, size_t length);
+    void push(ProcEvent& event);
+
+    int m_socket = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+
+    std::mutex m_mutex;
+    std::vector<ProcEvent> m_queue;
+    bool m_lost = false;
+};
+
+#endif
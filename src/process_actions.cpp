@@ -0,0 +1,353 @@
+#include "process_actions.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "instrumentation.h"
+#include "util.h"
+
+ProcessActionQueue::ProcessActionQueue(Collector& collector) :
+    m_collector(collector)
+{
+}
+
+ProcessActionQueue::~ProcessActionQueue() {
+    stop();
+}
+
+uint64_t ProcessActionQueue::submit(const ProcessActionRequest& request, std::shared_ptr<const SystemInfo> snapshot) {
+    Pending pending;
+    pending.request = request;
+    pending.snapshot = std::move(snapshot);
+    pending.requestedMs = wallClockMs();
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable()) {
+            m_stopping = false;
+            m_tokens = m_options.maxSignalsPerSecond;
+            m_tokensTime = std::chrono::steady_clock::now();
+            m_thread = std::thread(&ProcessActionQueue::run, this);
+        }
+        id = m_nextId++;
+        pending.id = id;
+        m_incoming.push_back(std::move(pending));
+    }
+    m_cv.notify_one();
+    return id;
+}
+
+std::shared_ptr<const ProcessActionStatus> ProcessActionQueue::status() const {
+    return std::atomic_load(&m_status);
+}
+
+void ProcessActionQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_incoming.clear();
+    m_jobs.clear();
+}
+
+void ProcessActionQueue::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_batch.swap(m_incoming);
+        lock.unlock();
+
+        for (const Pending& pending : m_batch) {
+            m_jobs.emplace_back();
+            resolve(pending, m_jobs.back());
+            m_dirty = true;
+        }
+        // Solta os snapshots: os buffers voltam para o SystemMonitor.
+        m_batch.clear();
+        std::chrono::steady_clock::time_point wake = step(std::chrono::steady_clock::now());
+        if (m_dirty) publish();
+
+        lock.lock();
+        auto ready = [&] { return !m_incoming.empty() || m_stopping; };
+        if (m_jobs.empty()) {
+            m_cv.wait(lock, ready);
+        }
+        else {
+            m_cv.wait_until(lock, wake, ready);
+        }
+    }
+}
+
+void ProcessActionQueue::resolve(const Pending& pending, Job& job) {
+    const ProcessActionRequest& request = pending.request;
+    const SystemInfo& info = *pending.snapshot;
+    job.result.id = pending.id;
+    job.result.kind = request.kind;
+    job.result.tree = request.tree;
+    job.result.requestedMs = pending.requestedMs;
+    job.gracePeriod = request.gracePeriod;
+    m_seen.clear();
+    // PID -> indice no snapshot, para os PIDs pedidos e para os ancestrais.
+    m_index.clear();
+    for (size_t i = 0; i < info.processes.size(); ++i) {
+        m_index.emplace(info.processes[i].pid, (uint32_t)i);
+    }
+    findProtected(info);
+
+    char label[96];
+    if (request.useQuery && !request.query.selective()) {
+        job.result.label = "consulta sem filtro";
+        job.result.refused = true;
+    }
+    else if (request.useQuery) {
+        std::shared_ptr<const ProcessQueryResult> result = m_queries.run(info, request.query);
+        for (const ProcessInfo& p : result->processes) {
+            addTarget(p, job);
+        }
+        snprintf(label, sizeof(label), "consulta: %zu processos", job.targets.size());
+        job.result.label = label;
+    }
+    else {
+        // PID fora do snapshot (mais novo que ele): o startTime lido agora
+        // prende os sinais a este processo, ate o SIGKILL do fim do prazo. Se
+        // nao da para ler, o processo ja saiu e nenhum sinal vai sem conferir.
+        ProcessInfo unknown;
+        for (unsigned long pid : request.pids) {
+            auto it = m_index.find(pid);
+            if (it != m_index.end()) {
+                addTarget(info.processes[it->second], job);
+                continue;
+            }
+            unknown.pid = pid;
+            unknown.startTime = m_collector.readStartTime(pid);
+            if (addTarget(unknown, job) && unknown.startTime == 0) {
+                job.targets.back().phase = TARGET_DONE;
+                ++job.result.gone;
+            }
+        }
+        if (request.pids.size() == 1) {
+            auto it = m_index.find(request.pids[0]);
+            snprintf(label, sizeof(label), "PID %lu (%s)", request.pids[0],
+                it != m_index.end() ? info.processes[it->second].name.c_str() : "?");
+        }
+        else {
+            snprintf(label, sizeof(label), "%zu processos", job.targets.size());
+        }
+        job.result.label = label;
+    }
+    if (request.tree) {
+        size_t roots = job.targets.size();
+        addTree(info, job);
+        snprintf(label, sizeof(label), " e %zu descendentes", job.targets.size() - roots);
+        job.result.label += label;
+    }
+
+    job.result.targets = (unsigned)job.targets.size();
+    job.nextProbe = std::chrono::steady_clock::now();
+}
+
+// Uma consulta larga (mincpu=0) ou a arvore do shell que abriu o monitor
+// incluiriam o proprio monitor, que morreria no meio de uma acao em lote.
+void ProcessActionQueue::findProtected(const SystemInfo& info) {
+    m_protected.clear();
+    m_protected.push_back(1);
+    unsigned long pid = instrumentation::selfPid();
+    while (pid > 1 && std::find(m_protected.begin(), m_protected.end(), pid) == m_protected.end()) {
+        m_protected.push_back(pid);
+        auto it = m_index.find(pid);
+        if (it == m_index.end()) break;
+        const ProcessInfo& process = info.processes[it->second];
+        if (!process.metadata) break;
+        pid = process.metadata->parentPid;
+    }
+}
+
+bool ProcessActionQueue::addTarget(const ProcessInfo& process, Job& job) {
+    if (process.pid == 0 || !m_seen.insert(process.pid).second) return false;
+    // Marcado em m_seen: a arvore tambem nao passa por ele.
+    if (std::find(m_protected.begin(), m_protected.end(), process.pid) != m_protected.end()) {
+        ++job.result.skipped;
+        return false;
+    }
+    Target target;
+    target.pid = process.pid;
+    target.startTime = process.startTime;
+    target.phase = job.result.kind == ACTION_KILL ? TARGET_KILL : TARGET_TERMINATE;
+    job.targets.push_back(target);
+    return true;
+}
+
+// Em largura a partir dos alvos ja escolhidos: o pai recebe o sinal antes
+// dos filhos, entao um supervisor para de repor os filhos antes de eles
+// sairem. Os PIDs ficam presos ao startTime do snapshot, entao um filho
+// reparentado no meio do caminho ainda e encontrado.
+void ProcessActionQueue::addTree(const SystemInfo& info, Job& job) {
+    m_children.clear();
+    for (size_t i = 0; i < info.processes.size(); ++i) {
+        const ProcessInfo& p = info.processes[i];
+        if (p.metadata && p.metadata->parentPid != p.pid) {
+            m_children.emplace_back(p.metadata->parentPid, (uint32_t)i);
+        }
+    }
+    std::sort(m_children.begin(), m_children.end());
+    for (size_t t = 0; t < job.targets.size(); ++t) {
+        unsigned long parent = job.targets[t].pid;
+        auto it = std::lower_bound(m_children.begin(), m_children.end(), std::make_pair(parent, (uint32_t)0));
+        for (; it != m_children.end() && it->first == parent; ++it) {
+            addTarget(info.processes[it->second], job);
+        }
+    }
+}
+
+bool ProcessActionQueue::haveToken(std::chrono::steady_clock::time_point now) {
+    if (m_options.maxSignalsPerSecond == 0) return true;
+    double rate = m_options.maxSignalsPerSecond;
+    m_tokens = std::min(rate, m_tokens + std::chrono::duration<double>(now - m_tokensTime).count() * rate);
+    m_tokensTime = now;
+    return m_tokens >= 1.0;
+}
+
+SignalResult ProcessActionQueue::send(const Target& target, ProcessSignal signal) {
+    SignalResult result = m_collector.signalProcess(target.pid, target.startTime, signal);
+    if (result == SIGNAL_SENT && signal != SIGNAL_PROBE) {
+        ++m_signalsSent;
+        if (m_options.maxSignalsPerSecond != 0) m_tokens -= 1.0;
+    }
+    m_dirty = true;
+    return result;
+}
+
+void ProcessActionQueue::advance(Job& job, Target& target, std::chrono::steady_clock::time_point now, bool probe) {
+    ProcessActionResult& result = job.result;
+    switch (target.phase) {
+    case TARGET_TERMINATE: {
+        SignalResult sent = send(target, SIGNAL_TERMINATE);
+        if (sent == SIGNAL_SENT) {
+            target.phase = TARGET_WAITING;
+            target.terminateSent = true;
+            target.deadline = now + job.gracePeriod;
+            ++job.waiting;
+            return;
+        }
+        if (sent == SIGNAL_UNSUPPORTED) {
+            target.phase = TARGET_KILL;
+            // O KILL sai ainda neste passo, se houver cota.
+            if (haveToken(now)) advance(job, target, now, probe);
+            return;
+        }
+        finish(job, target, sent);
+        return;
+    }
+    case TARGET_WAITING:
+        if (!probe) return;
+        if (send(target, SIGNAL_PROBE) == SIGNAL_GONE) {
+            --job.waiting;
+            ++result.terminated;
+            target.phase = TARGET_DONE;
+        }
+        else if (now >= target.deadline) {
+            --job.waiting;
+            target.phase = TARGET_KILL;
+        }
+        return;
+    case TARGET_KILL:
+        finish(job, target, send(target, SIGNAL_KILL));
+        return;
+    case TARGET_DONE:
+        return;
+    }
+}
+
+void ProcessActionQueue::finish(Job& job, Target& target, SignalResult sent) {
+    ProcessActionResult& result = job.result;
+    switch (sent) {
+    case SIGNAL_SENT: ++result.killed; break;
+    // Saiu entre a ultima conferencia e o KILL: conta como saida pelo TERM.
+    case SIGNAL_GONE: ++(target.terminateSent ? result.terminated : result.gone); break;
+    case SIGNAL_DENIED: ++result.denied; break;
+    default: ++result.failed; break;
+    }
+    target.phase = TARGET_DONE;
+}
+
+std::chrono::steady_clock::time_point ProcessActionQueue::step(std::chrono::steady_clock::time_point now) {
+    std::chrono::steady_clock::time_point wake = now + std::chrono::hours(1);
+    bool throttled = false;
+    for (Job& job : m_jobs) {
+        bool probe = job.waiting > 0 && now >= job.nextProbe;
+
+        // Quem ja recebeu o primeiro sinal: conferencias e KILLs vencidos.
+        // Sem cota so os KILLs esperam; as conferencias nao enviam sinal e
+        // seguem ate o fim, para nenhum prazo atrasar uma rodada.
+        for (size_t i = 0; i < job.nextTarget; ++i) {
+            Target& target = job.targets[i];
+            if (target.phase == TARGET_KILL && !haveToken(now)) {
+                throttled = true;
+                continue;
+            }
+            TargetPhase before = target.phase;
+            advance(job, target, now, probe);
+            // Prazo vencido nesta conferencia: o KILL sai ja, se houver cota.
+            if (before == TARGET_WAITING && target.phase == TARGET_KILL) {
+                if (!haveToken(now)) {
+                    throttled = true;
+                    continue;
+                }
+                advance(job, target, now, probe);
+            }
+        }
+        if (probe) job.nextProbe = now + m_options.probeInterval;
+        // Primeiro sinal dos demais, ate acabar a cota.
+        while (job.nextTarget < job.targets.size()) {
+            if (!haveToken(now)) {
+                throttled = true;
+                break;
+            }
+            advance(job, job.targets[job.nextTarget++], now, false);
+        }
+
+        if (job.result.pending() == 0) {
+            job.result.state = ACTION_DONE;
+            job.result.finishedMs = wallClockMs();
+            m_dirty = true;
+        }
+        else if (job.waiting > 0) {
+            wake = std::min(wake, job.nextProbe);
+        }
+    }
+    if (throttled) {
+        ++m_throttled;
+        double seconds = std::max(0.0, 1.0 - m_tokens) / m_options.maxSignalsPerSecond;
+        wake = std::min(wake, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(seconds)));
+    }
+
+    for (size_t i = 0; i < m_jobs.size();) {
+        if (m_jobs[i].result.state != ACTION_DONE) {
+            ++i;
+            continue;
+        }
+        m_finished.push_back(m_jobs[i].result);
+        if (m_finished.size() > m_options.history) m_finished.pop_front();
+        m_jobs.erase(m_jobs.begin() + i);
+    }
+    return wake;
+}
+
+// Um status novo por mudanca: quem segura o anterior (um snapshot) continua
+// com ele intacto.
+void ProcessActionQueue::publish() {
+    std::shared_ptr<ProcessActionStatus> status = std::make_shared<ProcessActionStatus>();
+    status->actions.reserve(m_finished.size() + m_jobs.size());
+    status->actions.assign(m_finished.begin(), m_finished.end());
+    for (const Job& job : m_jobs) {
+        status->actions.push_back(job.result);
+    }
+    status->signalsSent = m_signalsSent;
+    status->throttled = m_throttled;
+    std::atomic_store(&m_status, std::shared_ptr<const ProcessActionStatus>(status));
+    m_dirty = false;
+}
@@ -0,0 +1,197 @@
+#ifndef PROCESS_ACTIONS_H
+#define PROCESS_ACTIONS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "collector.h"
+#include "process_query.h"
+#include "system_info.h"
+
+enum ProcessActionKind : uint8_t {
+    // SIGTERM e, se o processo nao sair em gracePeriod, SIGKILL.
+    ACTION_TERMINATE,
+    // SIGKILL direto.
+    ACTION_KILL
+};
+
+enum ProcessActionState : uint8_t {
+    ACTION_RUNNING,
+    ACTION_DONE
+};
+
+struct ProcessActionRequest {
+    ProcessActionKind kind = ACTION_TERMINATE;
+    // Alvos: estes PIDs ou, com useQuery, os processos que a consulta
+    // devolve (filtro e limite) no snapshot do pedido. Uma consulta que nao
+    // filtra nada (ProcessQuery::selective) e recusada.
+    std::vector<unsigned long> pids;
+    bool useQuery = false;
+    ProcessQuery query;
+    // Inclui os descendentes de cada alvo, pelos parentPid do snapshot.
+    bool tree = false;
+    std::chrono::milliseconds gracePeriod{ 5000 };
+};
+
+// Andamento de uma acao. Cada alvo termina em exatamente um dos contadores
+// terminated..failed; os que faltam ainda esperam o sinal ou a saida.
+struct ProcessActionResult {
+    uint64_t id = 0;
+    ProcessActionKind kind = ACTION_TERMINATE;
+    bool tree = false;
+    ProcessActionState state = ACTION_RUNNING;
+    // "PID 123 (nginx)", "consulta: 12 processos"...
+    std::string label;
+    unsigned targets = 0;
+    // Sairam depois do SIGTERM, dentro do prazo.
+    unsigned terminated = 0;
+    // Receberam SIGKILL (prazo esgotado, KILL direto ou sem SIGTERM na
+    // plataforma).
+    unsigned killed = 0;
+    // Ja nao existiam no primeiro sinal.
+    unsigned gone = 0;
+    unsigned denied = 0;
+    unsigned failed = 0;
+    // Em ms desde a epoch.
+    unsigned long long requestedMs = 0;
+    unsigned long long finishedMs = 0;
+    // Escolhidos mas deixados de fora (fora de targets): o proprio monitor,
+    // o PID 1 e os ancestrais do monitor. Com tree, os descendentes deles so
+    // entram se escolhidos por outro caminho.
+    unsigned skipped = 0;
+    // Consulta sem filtro: nenhum alvo, nenhum sinal.
+    bool refused = false;
+
+    unsigned pending() const { return targets - terminated - killed - gone - denied - failed; }
+};
+
+// Publicado a cada mudanca; os snapshots apontam para o mais recente.
+struct ProcessActionStatus {
+    // Em andamento e as ultimas concluidas, mais novas por ultimo.
+    std::vector<ProcessActionResult> actions;
+    unsigned long long signalsSent = 0;
+    // Vezes que o limite de sinais por segundo segurou um envio.
+    unsigned long long throttled = 0;
+};
+
+struct ProcessActionOptions {
+    // Sinais (TERM ou KILL) por segundo somando todas as acoes, com rajada
+    // do mesmo tamanho; 0 = sem limite. Uma acao em lote sobre milhares de
+    // processos se espalha em vez de disparar tudo de uma vez.
+    unsigned maxSignalsPerSecond = 200;
+    // Intervalo entre as conferencias de quem ja recebeu SIGTERM.
+    std::chrono::milliseconds probeInterval{ 100 };
+    // Acoes concluidas mantidas no status.
+    size_t history = 32;
+};
+
+// Fila de acoes de controle de processo, executada numa thread propria:
+// submit() so enfileira, entao a interface nunca espera por um sinal, por um
+// prazo de SIGTERM ou por um processo que demora a sair. Os alvos sao
+// resolvidos contra o snapshot do pedido (ou, para um PID mais novo que ele,
+// contra o processo vivo) e cada sinal confere o startTime, para nao atingir
+// um PID reaproveitado.
+class ProcessActionQueue {
+public:
+    explicit ProcessActionQueue(Collector& collector);
+    ~ProcessActionQueue();
+
+    // Antes do primeiro submit().
+    void setOptions(const ProcessActionOptions& options) { m_options = options; }
+    // Devolve o id da acao. A thread e criada no primeiro pedido.
+    uint64_t submit(const ProcessActionRequest& request, std::shared_ptr<const SystemInfo> snapshot);
+    // Nulo antes do primeiro pedido.
+    std::shared_ptr<const ProcessActionStatus> status() const;
+    // Abandona as acoes em andamento (os sinais ja enviados valem).
+    void stop();
+
+private:
+    enum TargetPhase : uint8_t {
+        TARGET_TERMINATE,
+        // SIGTERM enviado; esperando a saida ate deadline.
+        TARGET_WAITING,
+        TARGET_KILL,
+        TARGET_DONE
+    };
+
+    struct Target {
+        unsigned long pid = 0;
+        unsigned long long startTime = 0;
+        TargetPhase phase = TARGET_TERMINATE;
+        bool terminateSent = false;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    struct Pending {
+        uint64_t id = 0;
+        ProcessActionRequest request;
+        std::shared_ptr<const SystemInfo> snapshot;
+        unsigned long long requestedMs = 0;
+    };
+
+    struct Job {
+        ProcessActionResult result;
+        std::chrono::milliseconds gracePeriod{ 0 };
+        std::vector<Target> targets;
+        // Alvos antes deste ja receberam o primeiro sinal.
+        size_t nextTarget = 0;
+        size_t waiting = 0;
+        std::chrono::steady_clock::time_point nextProbe;
+    };
+
+    void run();
+    void resolve(const Pending& pending, Job& job);
+    // Monitor, PID 1 e os ancestrais do monitor no snapshot.
+    void findProtected(const SystemInfo& info);
+    // False se o processo ja era alvo ou e protegido.
+    bool addTarget(const ProcessInfo& process, Job& job);
+    void addTree(const SystemInfo& info, Job& job);
+    // Avanca as acoes; devolve quando precisa rodar de novo.
+    std::chrono::steady_clock::time_point step(std::chrono::steady_clock::time_point now);
+    void advance(Job& job, Target& target, std::chrono::steady_clock::time_point now, bool probe);
+    void finish(Job& job, Target& target, SignalResult sent);
+    SignalResult send(const Target& target, ProcessSignal signal);
+    // Repoe a cota de sinais pelo tempo passado; true se ha um disponivel.
+    bool haveToken(std::chrono::steady_clock::time_point now);
+    void publish();
+
+    Collector& m_collector;
+    ProcessActionOptions m_options;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::vector<Pending> m_incoming;
+    uint64_t m_nextId = 1;
+    bool m_stopping = false;
+    std::thread m_thread;
+
+    // So a thread de acoes usa.
+    std::vector<Pending> m_batch;
+    std::vector<Job> m_jobs;
+    std::deque<ProcessActionResult> m_finished;
+    ProcessQueryCache m_queries;
+    std::unordered_map<unsigned long, uint32_t> m_index;
+    // (parentPid, indice no snapshot), ordenado, para achar os filhos.
+    std::vector<std::pair<unsigned long, uint32_t>> m_children;
+    std::unordered_set<unsigned long> m_seen;
+    std::vector<unsigned long> m_protected;
+    double m_tokens = 0.0;
+    std::chrono::steady_clock::time_point m_tokensTime;
+    unsigned long long m_signalsSent = 0;
+    unsigned long long m_throttled = 0;
+    bool m_dirty = false;
+
+    // Acessado apenas via std::atomic_load/atomic_store.
+    std::shared_ptr<const ProcessActionStatus> m_status;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#include "process_metadata.h"
+
+InternedName NameInterner::intern(const std::string& value) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_names.find(value);
+    if (it != m_names.end()) {
+        return it->second;
+    }
+    InternedName name(value);
+    m_names.emplace(value, name);
+    return name;
+}
+
+void NameInterner::purge() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_names.begin(); it != m_names.end();) {
+        if (it->second.m_value.use_count() == 1) {
+            it = m_names.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+size_t NameInterner::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names.size();
+}
@@ -0,0 +1,69 @@
+#ifndef PROCESS_METADATA_H
+#define PROCESS_METADATA_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Handle para uma string imutavel compartilhada. Copiar um InternedName so
+// incrementa um contador de referencias; nenhuma string e alocada.
+class InternedName {
+public:
+    InternedName() = default;
+    explicit InternedName(std::string value) :
+        m_value(std::make_shared<const std::string>(std::move(value)))
+    {
+    }
+
+    const std::string& str() const {
+        static const std::string empty;
+        return m_value ? *m_value : empty;
+    }
+    const char* c_str() const { return str().c_str(); }
+    bool empty() const { return str().empty(); }
+    operator const std::string&() const { return str(); }
+
+    friend bool operator==(const InternedName& a, const InternedName& b) {
+        return a.m_value == b.m_value || a.str() == b.str();
+    }
+    friend bool operator!=(const InternedName& a, const InternedName& b) {
+        return !(a == b);
+    }
+
+private:
+    friend class NameInterner;
+    std::shared_ptr<const std::string> m_value;
+};
+
+// Tabela de nomes compartilhados: processos com o mesmo nome (ou o mesmo
+// usuario) apontam para a mesma string. Pode ser usada por varias threads.
+class NameInterner {
+public:
+    InternedName intern(const std::string& value);
+    // Descarta os nomes que so a tabela ainda referencia.
+    void purge();
+    size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, InternedName> m_names;
+};
+
+// Atributos que nao mudam durante a vida de um processo. Os coletores leem
+// uma vez por (PID, inicio do processo) e compartilham o mesmo objeto entre
+// ticks e snapshots.
+struct ProcessMetadata {
+    InternedName name;
+    std::string executablePath;
+    std::string commandLine;
+    InternedName user;
+    unsigned long parentPid = 0;
+    // Caminho do cgroup v2 ("/system.slice/nginx.service"); vazio onde nao ha
+    // cgroups, e entao o processo conta na raiz.
+    InternedName cgroup;
+};
+
+using ProcessMetadataRef = std::shared_ptr<const ProcessMetadata>;
+
+#endif
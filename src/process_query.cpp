@@ -0,0 +1,170 @@
+#include "process_query.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include "util.h"
+
+// Consultas diferentes guardadas para a mesma lista; acima disso a mais
+// antiga e substituida.
+static const size_t MAX_CACHED_QUERIES = 8;
+
+static bool parseBytes(const std::string& text, unsigned long long& bytes) {
+    double value;
+    if (!parseScaledNumber(text, value) || value < 0.0) return false;
+    bytes = (unsigned long long)value;
+    return true;
+}
+
+bool parseProcessQuery(const std::string& text, ProcessQuery& query) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t comma = text.find(',', pos);
+        std::string item = text.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t equals = item.find('=');
+        std::string key = item.substr(0, equals);
+        std::string value = equals == std::string::npos ? std::string() : item.substr(equals + 1);
+
+        if (key == "regex") {
+            query.namePattern = text.substr(pos + equals + 1);
+            return true;
+        }
+        if (key == "top") {
+            char* end;
+            unsigned long limit = strtoul(value.c_str(), &end, 10);
+            if (value.empty() || value[0] == '-' || *end != '\0') return false;
+            query.limit = limit;
+        }
+        else if (key == "sort") {
+            if (value == "pid") query.sortKey = SORT_PID;
+            else if (value == "name") query.sortKey = SORT_NAME;
+            else if (value == "cpu") query.sortKey = SORT_CPU;
+            else if (value == "mem") query.sortKey = SORT_MEMORY;
+            else if (value == "read") query.sortKey = SORT_IO_READ;
+            else if (value == "write") query.sortKey = SORT_IO_WRITE;
+            else if (value == "faults") query.sortKey = SORT_FAULTS;
+            else if (value == "switches") query.sortKey = SORT_SWITCHES;
+            else return false;
+        }
+        else if (key == "asc") {
+            query.descending = false;
+        }
+        else if (key == "name") {
+            query.nameContains = value;
+        }
+        else if (key == "user") {
+            query.user = value;
+        }
+        else if (key == "mincpu") {
+            char* end;
+            query.minCpuPercentage = strtod(value.c_str(), &end);
+            if (end == value.c_str() || *end != '\0') return false;
+        }
+        else if (key == "minmem") {
+            if (!parseBytes(value, query.minMemoryBytes)) return false;
+        }
+        else if (!key.empty()) {
+            return false;
+        }
+
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
+    }
+    return true;
+}
+
+std::shared_ptr<const ProcessQueryResult> ProcessQueryCache::run(const SystemInfo& info, const ProcessQuery& query) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (info.processListVersion != m_listVersion) {
+        m_listVersion = info.processListVersion;
+        m_entries.clear();
+        m_nextEntry = 0;
+    }
+    for (const Entry& entry : m_entries) {
+        if (entry.query == query) {
+            m_hits++;
+            return entry.result;
+        }
+    }
+
+    m_misses++;
+    Entry entry;
+    entry.query = query;
+    entry.result = evaluate(info, query);
+    if (m_entries.size() < MAX_CACHED_QUERIES) {
+        m_entries.push_back(std::move(entry));
+        return m_entries.back().result;
+    }
+    m_entries[m_nextEntry] = std::move(entry);
+    std::shared_ptr<const ProcessQueryResult> result = m_entries[m_nextEntry].result;
+    m_nextEntry = (m_nextEntry + 1) % MAX_CACHED_QUERIES;
+    return result;
+}
+
+const std::regex* ProcessQueryCache::compile(const std::string& pattern) {
+    if (pattern != m_pattern) {
+        m_pattern = pattern;
+        try {
+            m_regex.assign(pattern, std::regex::ECMAScript | std::regex::optimize);
+            m_patternValid = true;
+        }
+        catch (const std::regex_error&) {
+            m_patternValid = false;
+        }
+    }
+    return m_patternValid ? &m_regex : nullptr;
+}
+
+// Filtra em O(n) e seleciona os `limit` primeiros com nth_element, em O(n)
+// em media; so eles sao ordenados, em O(k log k).
+std::shared_ptr<const ProcessQueryResult> ProcessQueryCache::evaluate(const SystemInfo& info, const ProcessQuery& query) {
+    std::shared_ptr<ProcessQueryResult> result = std::make_shared<ProcessQueryResult>();
+    result->processListVersion = info.processListVersion;
+
+    const std::regex* pattern = nullptr;
+    if (!query.namePattern.empty()) {
+        pattern = compile(query.namePattern);
+        if (pattern == nullptr) {
+            result->valid = false;
+            return result;
+        }
+    }
+
+    m_selected.clear();
+    for (uint32_t i = 0; i < (uint32_t)info.processes.size(); ++i) {
+        const ProcessInfo& p = info.processes[i];
+        if (p.cpuUsagePercentage < query.minCpuPercentage) continue;
+        if (p.memoryUsedBytes < query.minMemoryBytes) continue;
+        if (!query.user.empty() && (!p.metadata || p.metadata->user.str() != query.user)) continue;
+        if (!query.nameContains.empty() && !containsIgnoringCase(p.name.str(), query.nameContains)) continue;
+        if (pattern != nullptr && !std::regex_search(p.name.str(), *pattern)) continue;
+        m_selected.push_back(i);
+    }
+    result->matched = m_selected.size();
+
+    auto less = [&](uint32_t a, uint32_t b) { return processBefore(info.processes[a], info.processes[b], query.sortKey, query.descending); };
+    size_t count = m_selected.size();
+    if (query.limit != 0 && query.limit < count) {
+        count = query.limit;
+        std::nth_element(m_selected.begin(), m_selected.begin() + count, m_selected.end(), less);
+    }
+    std::sort(m_selected.begin(), m_selected.begin() + count, less);
+
+    result->processes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        result->processes.push_back(info.processes[m_selected[i]]);
+    }
+    return result;
+}
+
+unsigned long long ProcessQueryCache::hits() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_hits;
+}
+
+unsigned long long ProcessQueryCache::misses() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_misses;
+}
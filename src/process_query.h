@@ -0,0 +1,98 @@
+#ifndef PROCESS_QUERY_H
+#define PROCESS_QUERY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "process_sort.h"
+#include "system_info.h"
+
+// Consulta sobre a lista de processos de um snapshot: filtro, chave de
+// ordenacao e limite. Para quem so quer os N primeiros ou os que casam com
+// um nome, sem receber (nem ordenar) a lista inteira.
+struct ProcessQuery {
+    // Filtros; vazio/zero = nao filtra.
+    std::string nameContains;
+    // Expressao regular (ECMAScript) procurada no nome.
+    std::string namePattern;
+    std::string user;
+    double minCpuPercentage = 0.0;
+    unsigned long long minMemoryBytes = 0;
+
+    ProcessSortKey sortKey = SORT_CPU;
+    bool descending = true;
+    // 0 = todos os que passam no filtro.
+    size_t limit = 0;
+
+    // False se nenhum filtro nem o limite restringe a consulta, que entao
+    // devolve a lista inteira (como "", "sort=cpu" ou "mincpu=0").
+    bool selective() const {
+        return !nameContains.empty() || !namePattern.empty() || !user.empty() ||
+            minCpuPercentage > 0.0 || minMemoryBytes > 0 || limit > 0;
+    }
+
+    friend bool operator==(const ProcessQuery& a, const ProcessQuery& b) {
+        return a.nameContains == b.nameContains && a.namePattern == b.namePattern && a.user == b.user &&
+            a.minCpuPercentage == b.minCpuPercentage && a.minMemoryBytes == b.minMemoryBytes &&
+            a.sortKey == b.sortKey && a.descending == b.descending && a.limit == b.limit;
+    }
+};
+
+// Le uma consulta no formato "chave=valor,..." usado pela linha de comando:
+// top=N, sort=pid|name|cpu|mem|read|write|faults|switches, asc, name=texto, regex=expr, user=nome,
+// mincpu=%, minmem=bytes (aceita sufixo K, M ou G). A regex vai ate o fim,
+// entao pode conter virgulas. Devolve false se algo nao for reconhecido,
+// inclusive um numero que nao e numero (top=abc).
+bool parseProcessQuery(const std::string& text, ProcessQuery& query);
+
+struct ProcessQueryResult {
+    // Lista (processListVersion) sobre a qual a consulta rodou.
+    unsigned long long processListVersion = 0;
+    // False se namePattern nao e uma expressao valida.
+    bool valid = true;
+    // Quantos passaram no filtro, antes do limite.
+    size_t matched = 0;
+    std::vector<ProcessInfo> processes;
+};
+
+// Avalia consultas e guarda os resultados da lista atual. Uma consulta
+// repetida sobre a mesma lista devolve o mesmo resultado sem recalcular;
+// o cache inteiro cai quando chega uma lista nova. Pode ser usado por varias
+// threads.
+class ProcessQueryCache {
+public:
+    std::shared_ptr<const ProcessQueryResult> run(const SystemInfo& info, const ProcessQuery& query);
+
+    unsigned long long hits() const;
+    unsigned long long misses() const;
+
+private:
+    struct Entry {
+        ProcessQuery query;
+        std::shared_ptr<const ProcessQueryResult> result;
+    };
+
+    // Expressao compilada da consulta mais recente com regex; compilar e a
+    // parte cara de uma consulta por nome.
+    const std::regex* compile(const std::string& pattern);
+    std::shared_ptr<const ProcessQueryResult> evaluate(const SystemInfo& info, const ProcessQuery& query);
+
+    mutable std::mutex m_mutex;
+    unsigned long long m_listVersion = 0;
+    std::vector<Entry> m_entries;
+    size_t m_nextEntry = 0;
+    std::string m_pattern;
+    std::regex m_regex;
+    bool m_patternValid = false;
+    // Indices dos processos que passam no filtro, reaproveitado.
+    std::vector<uint32_t> m_selected;
+    unsigned long long m_hits = 0;
+    unsigned long long m_misses = 0;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PROCESS_SORT_H
+#define PROCESS_SORT_H
+
+#include "system_info.h"
+
+// Chaves de ordenacao da lista de processos, comuns a tabela da interface
+// (ProcessTableView) e as consultas (ProcessQuery).
+enum ProcessSortKey {
+    SORT_PID,
+    SORT_NAME,
+    SORT_CPU,
+    SORT_MEMORY,
+    // Taxas por segundo (ver ProcessInfo::rate).
+    SORT_IO_READ,
+    SORT_IO_WRITE,
+    SORT_FAULTS,
+    SORT_SWITCHES
+};
+
+inline int compareValues(double a, double b) {
+    return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+// Ordem total: empates sao desfeitos pelo PID, entao uma ordenacao parcial
+// ou incremental chega ao mesmo resultado que a completa.
+inline bool processBefore(const ProcessInfo& pa, const ProcessInfo& pb, ProcessSortKey key, bool descending) {
+    int cmp = 0;
+    switch (key) {
+    case SORT_PID:
+        break;
+    case SORT_NAME:
+        cmp = pa.name.str().compare(pb.name.str());
+        break;
+    case SORT_CPU:
+        cmp = compareValues(pa.cpuUsagePercentage, pb.cpuUsagePercentage);
+        break;
+    case SORT_MEMORY:
+        cmp = pa.memoryUsedBytes < pb.memoryUsedBytes ? -1 : (pa.memoryUsedBytes > pb.memoryUsedBytes ? 1 : 0);
+        break;
+    case SORT_IO_READ:
+        cmp = compareValues(pa.rate(COUNTER_IO_READ_BYTES), pb.rate(COUNTER_IO_READ_BYTES));
+        break;
+    case SORT_IO_WRITE:
+        cmp = compareValues(pa.rate(COUNTER_IO_WRITE_BYTES), pb.rate(COUNTER_IO_WRITE_BYTES));
+        break;
+    case SORT_FAULTS:
+        cmp = compareValues(pa.faultRate(), pb.faultRate());
+        break;
+    case SORT_SWITCHES:
+        cmp = compareValues(pa.switchRate(), pb.switchRate());
+        break;
+    }
+    if (cmp == 0) {
+        cmp = pa.pid < pb.pid ? -1 : (pa.pid > pb.pid ? 1 : 0);
+    }
+    return descending ? cmp > 0 : cmp < 0;
+}
+
+#endif
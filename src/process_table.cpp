@@ -0,0 +1,221 @@
+#include "process_table.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "snapshot_diff.h"
+
+// Se mais de 1/N das linhas mudou de chave, a lista e ordenada inteira.
+static const size_t MAX_CHANGED_FRACTION = 4;
+
+void ProcessTableView::setSort(ProcessSortKey column, bool descending) {
+    if (column == m_column && descending == m_descending) return;
+    m_column = column;
+    m_descending = descending;
+    m_sortChanged = true;
+}
+
+static unsigned long long doubleBits(double value) {
+    unsigned long long bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+bool ProcessTableView::before(const SystemInfo& info, uint32_t a, uint32_t b) const {
+    return processBefore(info.processes[a], info.processes[b], m_column, m_descending);
+}
+
+void ProcessTableView::update(const SystemInfo& info) {
+    bool newList = info.processListVersion != m_listVersion || info.processes.size() != m_order.size();
+    if (!newList && !m_sortChanged) return;
+    unsigned long long previousList = m_listVersion;
+
+    if (newList) {
+        m_listVersion = info.processListVersion;
+        rebuildIndex(info);
+        m_text.resize(info.processes.size());
+        m_textValid.assign(info.processes.size(), false);
+    }
+
+    if (m_sortChanged || m_orderPids.empty()) {
+        sortAll(info);
+    }
+    else {
+        const SnapshotDiff* diff = info.processDiff.get();
+        bool contiguous = diff != nullptr && diff->fromListVersion != 0 &&
+            diff->fromListVersion == previousList && diff->toListVersion == info.processListVersion;
+        mergeChanged(info, contiguous ? diff : nullptr);
+    }
+    m_sortChanged = false;
+    rememberKeys(info);
+}
+
+void ProcessTableView::rebuildIndex(const SystemInfo& info) {
+    size_t capacity = 16;
+    unsigned shift = 60;
+    while (capacity < info.processes.size() * 2) {
+        capacity *= 2;
+        --shift;
+    }
+    m_slotShift = shift;
+    m_slotPids.resize(capacity);
+    m_slotIndexes.assign(capacity, 0);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < info.processes.size(); ++i) {
+        unsigned long pid = info.processes[i].pid;
+        size_t slot = (size_t)(((uint64_t)pid * 0x9E3779B97F4A7C15ULL) >> m_slotShift);
+        while (m_slotIndexes[slot] != 0 && m_slotPids[slot] != pid) {
+            slot = (slot + 1) & mask;
+        }
+        if (m_slotIndexes[slot] == 0) {
+            m_slotPids[slot] = pid;
+            m_slotIndexes[slot] = (uint32_t)i + 1;
+        }
+    }
+}
+
+uint32_t ProcessTableView::lookup(unsigned long pid) const {
+    if (m_slotIndexes.empty()) return NOT_FOUND;
+    size_t mask = m_slotIndexes.size() - 1;
+    size_t slot = (size_t)(((uint64_t)pid * 0x9E3779B97F4A7C15ULL) >> m_slotShift);
+    while (m_slotIndexes[slot] != 0) {
+        if (m_slotPids[slot] == pid) return m_slotIndexes[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
+    return NOT_FOUND;
+}
+
+unsigned long long ProcessTableView::numericKey(const ProcessInfo& p) const {
+    switch (m_column) {
+    case SORT_CPU:
+        return doubleBits(p.cpuUsagePercentage);
+    case SORT_MEMORY:
+        return p.memoryUsedBytes;
+    case SORT_IO_READ:
+        return doubleBits(p.rate(COUNTER_IO_READ_BYTES));
+    case SORT_IO_WRITE:
+        return doubleBits(p.rate(COUNTER_IO_WRITE_BYTES));
+    case SORT_FAULTS:
+        return doubleBits(p.faultRate());
+    case SORT_SWITCHES:
+        return doubleBits(p.switchRate());
+    default:
+        return 0;
+    }
+}
+
+bool ProcessTableView::sameKey(const SystemInfo& info, uint32_t index, size_t previousRow) const {
+    const ProcessInfo& p = info.processes[index];
+    if (m_column == SORT_NAME) {
+        return p.name == m_orderNames[previousRow];
+    }
+    return numericKey(p) == m_orderKeys[previousRow];
+}
+
+uint8_t ProcessTableView::keyFields() const {
+    switch (m_column) {
+    case SORT_NAME:
+        return CHANGE_NAME;
+    case SORT_CPU:
+        return CHANGE_CPU;
+    case SORT_MEMORY:
+        return CHANGE_MEMORY;
+    case SORT_PID:
+        return CHANGE_ADDED;
+    default:
+        return CHANGE_RATES;
+    }
+}
+
+// Os processos com a mesma chave da lista anterior ja estao em ordem entre
+// si (a ordem e total, com o PID desempatando). So os demais sao ordenados,
+// em O(k log k), e intercalados em O(n). Se quase tudo mudou, ordenar a
+// lista inteira sai mais barato. Com o diff, quem nao aparece nele tem os
+// mesmos valores da lista anterior e as chaves nem sao comparadas.
+void ProcessTableView::mergeChanged(const SystemInfo& info, const SnapshotDiff* diff) {
+    auto less = [&](uint32_t a, uint32_t b) { return before(info, a, b); };
+    m_kept.clear();
+    m_changed.clear();
+    m_placed.assign(info.processes.size(), false);
+
+    if (diff != nullptr) {
+        uint8_t fields = keyFields();
+        for (const ProcessChange& change : diff->changes) {
+            if (!(change.fields & fields)) continue;
+            uint32_t index = lookup(change.process.pid);
+            if (index == NOT_FOUND || m_placed[index]) continue;
+            m_placed[index] = true;
+            m_changed.push_back(index);
+        }
+    }
+
+    for (size_t row = 0; row < m_orderPids.size(); ++row) {
+        uint32_t index = lookup(m_orderPids[row]);
+        if (index == NOT_FOUND || m_placed[index]) continue;
+        m_placed[index] = true;
+        if (diff != nullptr || sameKey(info, index, row)) {
+            m_kept.push_back(index);
+        }
+        else {
+            m_changed.push_back(index);
+        }
+    }
+    for (uint32_t i = 0; i < (uint32_t)info.processes.size(); ++i) {
+        if (!m_placed[i]) {
+            m_changed.push_back(i);
+        }
+    }
+
+    if (m_changed.size() > info.processes.size() / MAX_CHANGED_FRACTION) {
+        sortAll(info);
+        return;
+    }
+    m_lastMoves = m_changed.size();
+    std::sort(m_changed.begin(), m_changed.end(), less);
+    m_order.resize(info.processes.size());
+    std::merge(m_kept.begin(), m_kept.end(), m_changed.begin(), m_changed.end(), m_order.begin(), less);
+}
+
+void ProcessTableView::sortAll(const SystemInfo& info) {
+    m_order.resize(info.processes.size());
+    for (uint32_t i = 0; i < (uint32_t)m_order.size(); ++i) {
+        m_order[i] = i;
+    }
+    std::sort(m_order.begin(), m_order.end(), [&](uint32_t a, uint32_t b) { return before(info, a, b); });
+    m_lastMoves = m_order.size();
+    m_fullSorts++;
+}
+
+void ProcessTableView::rememberKeys(const SystemInfo& info) {
+    m_orderPids.resize(m_order.size());
+    m_orderKeys.resize(m_order.size());
+    if (m_column == SORT_NAME) {
+        m_orderNames.resize(m_order.size());
+    }
+    else {
+        m_orderNames.clear();
+    }
+    for (size_t row = 0; row < m_order.size(); ++row) {
+        const ProcessInfo& p = info.processes[m_order[row]];
+        m_orderPids[row] = p.pid;
+        m_orderKeys[row] = numericKey(p);
+        if (m_column == SORT_NAME) {
+            m_orderNames[row] = p.name;
+        }
+    }
+}
+
+const ProcessRowText& ProcessTableView::text(const SystemInfo& info, size_t row) {
+    uint32_t index = m_order[row];
+    if (!m_textValid[index]) {
+        formatProcessRow(info.processes[index], m_text[index]);
+        m_textValid[index] = true;
+    }
+    return m_text[index];
+}
+
+const ProcessInfo* ProcessTableView::find(const SystemInfo& info, unsigned long pid) const {
+    uint32_t index = lookup(pid);
+    if (index == NOT_FOUND || index >= info.processes.size()) return nullptr;
+    return &info.processes[index];
+}
@@ -0,0 +1,85 @@
+#ifndef PROCESS_TABLE_H
+#define PROCESS_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "process_sort.h"
+#include "system_info.h"
+#include "ui_format.h"
+
+// Ordem e texto da tabela de processos da interface, sem depender do ImGui.
+// A ordem e uma permutacao de indices de info.processes que sobrevive entre
+// listas: numa lista nova os processos cuja chave de ordenacao nao mudou
+// continuam na mesma ordem relativa, e so os que mudaram (ou sao novos) sao
+// ordenados e intercalados com eles. O texto de cada linha e formatado
+// quando a linha aparece pela primeira vez na tela e vale ate a proxima lista.
+class ProcessTableView {
+public:
+    void setSort(ProcessSortKey column, bool descending);
+    ProcessSortKey sortColumn() const { return m_column; }
+    bool sortDescending() const { return m_descending; }
+
+    // Atualiza a permutacao se a lista (processListVersion) ou a ordenacao
+    // mudou; caso contrario nao faz nada. Se info.processDiff parte da lista
+    // anterior, as linhas que mudaram de chave vem dele.
+    void update(const SystemInfo& info);
+
+    size_t size() const { return m_order.size(); }
+    // info deve ter o mesmo processListVersion do ultimo update().
+    const ProcessInfo& process(const SystemInfo& info, size_t row) const {
+        return info.processes[m_order[row]];
+    }
+    const ProcessRowText& text(const SystemInfo& info, size_t row);
+    // Processo com este PID na lista atual, ou nulo.
+    const ProcessInfo* find(const SystemInfo& info, unsigned long pid) const;
+
+    // Linhas reposicionadas pelo ultimo update() e quantas vezes foi preciso
+    // ordenar a lista inteira (ordenacao trocada ou mudancas demais).
+    size_t lastMoves() const { return m_lastMoves; }
+    unsigned long long fullSorts() const { return m_fullSorts; }
+
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+private:
+    bool before(const SystemInfo& info, uint32_t a, uint32_t b) const;
+    void rebuildIndex(const SystemInfo& info);
+    // Indice em info.processes, ou NOT_FOUND.
+    uint32_t lookup(unsigned long pid) const;
+    // Chave numerica da coluna atual; o nome e comparado a parte.
+    unsigned long long numericKey(const ProcessInfo& p) const;
+    bool sameKey(const SystemInfo& info, uint32_t index, size_t previousRow) const;
+    // Campos do diff (ProcessChangeField) que mexem na chave da coluna atual.
+    uint8_t keyFields() const;
+    // diff: da lista anterior para esta, ou nulo para comparar as chaves.
+    void mergeChanged(const SystemInfo& info, const SnapshotDiff* diff);
+    void sortAll(const SystemInfo& info);
+    void rememberKeys(const SystemInfo& info);
+
+    ProcessSortKey m_column = SORT_MEMORY;
+    bool m_descending = true;
+    bool m_sortChanged = true;
+    unsigned long long m_listVersion = 0;
+
+    std::vector<uint32_t> m_order;
+    // PID e chave de cada linha da ordem atual, para a proxima lista.
+    std::vector<unsigned long> m_orderPids;
+    std::vector<unsigned long long> m_orderKeys;
+    std::vector<InternedName> m_orderNames;
+    // PID -> indice, enderecamento aberto reconstruido a cada lista sem
+    // alocar (slot vazio = indice 0; os indices sao guardados + 1).
+    std::vector<unsigned long> m_slotPids;
+    std::vector<uint32_t> m_slotIndexes;
+    unsigned m_slotShift = 60;
+    std::vector<uint32_t> m_kept;
+    std::vector<uint32_t> m_changed;
+    std::vector<bool> m_placed;
+
+    std::vector<ProcessRowText> m_text;
+    std::vector<bool> m_textValid;
+
+    size_t m_lastMoves = 0;
+    unsigned long long m_fullSorts = 0;
+};
+
+#endif
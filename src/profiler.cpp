@@ -0,0 +1,159 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+void FlameGraph::clear() {
+    m_nodes.clear();
+    m_nodes.emplace_back();
+    m_nodes[0].name = "todas";
+    m_maxDepth = 0;
+}
+
+void FlameGraph::add(const std::vector<const std::string*>& frames, unsigned long long count) {
+    uint32_t node = 0;
+    m_nodes[0].total += count;
+    for (const std::string* frame : frames) {
+        uint32_t child = 0;
+        for (uint32_t candidate : m_nodes[node].children) {
+            if (m_nodes[candidate].name == *frame) {
+                child = candidate;
+                break;
+            }
+        }
+        if (child == 0) {
+            child = (uint32_t)m_nodes.size();
+            FlameNode created;
+            created.name = *frame;
+            created.parent = node;
+            created.depth = m_nodes[node].depth + 1;
+            m_maxDepth = std::max(m_maxDepth, created.depth);
+            m_nodes.push_back(std::move(created));
+            m_nodes[node].children.push_back(child);
+        }
+        node = child;
+        m_nodes[node].total += count;
+    }
+    m_nodes[node].self += count;
+}
+
+void FlameGraph::finish() {
+    for (FlameNode& node : m_nodes) {
+        std::sort(node.children.begin(), node.children.end(), [this](uint32_t a, uint32_t b) {
+            return m_nodes[a].total > m_nodes[b].total;
+            });
+    }
+}
+
+std::vector<HotFunction> FlameGraph::hottest(size_t limit) const {
+    std::unordered_map<std::string, HotFunction> byName;
+    for (size_t i = 1; i < m_nodes.size(); ++i) {
+        const FlameNode& node = m_nodes[i];
+        HotFunction& function = byName[node.name];
+        function.name = node.name;
+        function.self += node.self;
+        // Recursao: so o quadro mais externo com este nome conta no total.
+        bool nested = false;
+        for (uint32_t parent = node.parent; parent != 0; parent = m_nodes[parent].parent) {
+            if (m_nodes[parent].name == node.name) {
+                nested = true;
+                break;
+            }
+        }
+        if (!nested) {
+            function.total += node.total;
+        }
+    }
+
+    std::vector<HotFunction> hot;
+    hot.reserve(byName.size());
+    for (auto& entry : byName) {
+        hot.push_back(std::move(entry.second));
+    }
+    limit = std::min(limit, hot.size());
+    std::partial_sort(hot.begin(), hot.begin() + limit, hot.end(), [](const HotFunction& a, const HotFunction& b) {
+        return a.self > b.self || (a.self == b.self && a.name < b.name);
+        });
+    hot.resize(limit);
+    return hot;
+}
+
+void FlameGraph::writeFolded(FILE* out) const {
+    std::string path;
+    std::vector<uint32_t> chain;
+    for (uint32_t i = 1; i < (uint32_t)m_nodes.size(); ++i) {
+        if (m_nodes[i].self == 0) continue;
+        chain.clear();
+        for (uint32_t node = i; node != 0; node = m_nodes[node].parent) {
+            chain.push_back(node);
+        }
+        path.clear();
+        for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if (!path.empty()) path += ';';
+            // ';' separa quadros no formato; a contagem vem depois do ultimo espaco.
+            for (char c : m_nodes[*it].name) {
+                path += c == ';' ? ':' : c;
+            }
+        }
+        fprintf(out, "%s %llu\n", path.c_str(), m_nodes[i].self);
+    }
+}
+
+bool FlameGraph::writeFolded(const std::string& path) const {
+    FILE* out = fopen(path.c_str(), "w");
+    if (out == nullptr) return false;
+    writeFolded(out);
+    return fclose(out) == 0;
+}
+
+FlameGraphBuilder::~FlameGraphBuilder() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void FlameGraphBuilder::request() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requested = true;
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&FlameGraphBuilder::run, this);
+        }
+    }
+    m_cv.notify_one();
+}
+
+std::shared_ptr<const FlameGraph> FlameGraphBuilder::latest() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_latest;
+}
+
+void FlameGraphBuilder::reset() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latest.reset();
+    m_generation++;
+}
+
+void FlameGraphBuilder::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_cv.wait(lock, [&] { return m_requested || m_stopping; });
+        if (m_stopping) break;
+        m_requested = false;
+        uint64_t generation = m_generation;
+        lock.unlock();
+
+        std::shared_ptr<FlameGraph> graph = std::make_shared<FlameGraph>();
+        m_profiler.buildFlameGraph(*graph);
+
+        lock.lock();
+        if (generation == m_generation) {
+            m_latest = graph;
+        }
+    }
+}
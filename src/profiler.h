@@ -0,0 +1,137 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ProfileOptions {
+    enum Method {
+        // perf_event_open, e ptrace se perf nao for permitido.
+        METHOD_AUTO,
+        METHOD_PERF_EVENT,
+        METHOD_PTRACE
+    };
+
+    Method method = METHOD_AUTO;
+    // Amostras por segundo de CPU de cada thread.
+    unsigned frequencyHz = 99;
+    // Quadros guardados por pilha, a partir do mais interno.
+    unsigned maxDepth = 128;
+};
+
+// No da arvore de pilhas: total inclui os filhos, self e so o proprio quadro
+// no topo da pilha. O no 0 e a raiz (todas as amostras).
+struct FlameNode {
+    std::string name;
+    unsigned long long total = 0;
+    unsigned long long self = 0;
+    uint32_t parent = 0;
+    uint32_t depth = 0;
+    // Ordenados por total, do maior para o menor.
+    std::vector<uint32_t> children;
+};
+
+struct HotFunction {
+    std::string name;
+    unsigned long long self = 0;
+    unsigned long long total = 0;
+};
+
+// Pilhas agregadas por prefixo, da funcao mais externa para a mais interna.
+class FlameGraph {
+public:
+    FlameGraph() { clear(); }
+
+    void clear();
+    // frames vai do quadro mais externo (ex.: main) ao mais interno.
+    void add(const std::vector<const std::string*>& frames, unsigned long long count);
+    // Ordena os filhos de cada no; chamar depois do ultimo add().
+    void finish();
+
+    const std::vector<FlameNode>& nodes() const { return m_nodes; }
+    unsigned long long totalSamples() const { return m_nodes[0].total; }
+    uint32_t maxDepth() const { return m_maxDepth; }
+
+    // Funcoes com mais tempo no topo da pilha (somando todos os caminhos).
+    std::vector<HotFunction> hottest(size_t limit) const;
+
+    // Formato "folded" (uma linha por caminho: a;b;c contagem), aceito pelo
+    // flamegraph.pl, speedscope e afins.
+    void writeFolded(FILE* out) const;
+    bool writeFolded(const std::string& path) const;
+
+private:
+    std::vector<FlameNode> m_nodes;
+    uint32_t m_maxDepth = 0;
+};
+
+struct ProfileStatus {
+    unsigned long pid = 0;
+    bool running = false;
+    // "perf_event", "ptrace" ou vazio quando parado.
+    std::string method;
+    unsigned long long samples = 0;
+    // Amostras que o kernel (ou o limite de pilhas distintas) descartou.
+    unsigned long long lostSamples = 0;
+    unsigned long threads = 0;
+    double seconds = 0.0;
+    // Motivo da ultima falha de start(), se houve.
+    std::string error;
+};
+
+// Amostrador de pilhas de um processo. As amostras sao guardadas como
+// enderecos e so viram nomes em buildFlameGraph(), com cache de simbolos.
+class Profiler {
+public:
+    virtual ~Profiler() = default;
+
+    // Para uma sessao anterior e descarta as amostras dela.
+    virtual bool start(unsigned long pid, const ProfileOptions& options) = 0;
+    // As amostras continuam disponiveis ate o proximo start().
+    virtual void stop() = 0;
+    virtual ProfileStatus status() const = 0;
+    // Arvore com todas as amostras desde start(). Pode ser chamado com a
+    // sessao rodando.
+    virtual void buildFlameGraph(FlameGraph& out) = 0;
+};
+
+std::unique_ptr<Profiler> createPlatformProfiler();
+
+// Chama buildFlameGraph numa thread propria e guarda a arvore pronta. A
+// simbolizacao abre e le binarios ELF e o /proc/<pid>/maps; na thread da
+// interface isso travaria quadros com binarios grandes.
+class FlameGraphBuilder {
+public:
+    explicit FlameGraphBuilder(Profiler& profiler) : m_profiler(profiler) {}
+    ~FlameGraphBuilder();
+
+    // Pede uma arvore com as amostras de agora. Com uma montagem em
+    // andamento, o pedido vale para a proxima. A thread e criada no primeiro.
+    void request();
+    // Ultima arvore pronta; nula antes da primeira e depois de reset().
+    std::shared_ptr<const FlameGraph> latest() const;
+    // Descarta a arvore pronta e a que estiver sendo montada (nova sessao).
+    void reset();
+
+private:
+    void run();
+
+    Profiler& m_profiler;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::thread m_thread;
+    bool m_requested = false;
+    bool m_stopping = false;
+    // Muda a cada reset(); uma montagem iniciada antes nao e publicada.
+    uint64_t m_generation = 0;
+    std::shared_ptr<const FlameGraph> m_latest;
+};
+
+#endif
@@ -0,0 +1,625 @@
+#include "profiler_linux.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <dirent.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/user.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "instrumentation.h"
+
+// Paginas de dados do anel de cada thread (potencia de 2), mais a de controle.
+static const size_t PERF_DATA_PAGES = 8;
+// Pilhas distintas guardadas; acima disso amostras novas contam como perdidas.
+static const size_t MAX_DISTINCT_STACKS = 200000;
+// Intervalo para procurar threads novas do processo.
+static const std::chrono::milliseconds TASK_REFRESH(1000);
+
+static bool isPidName(const char* name) {
+    if (*name == '\0') return false;
+    for (const char* p = name; *p; ++p) {
+        if (*p < '0' || *p > '9') return false;
+    }
+    return true;
+}
+
+size_t LinuxProfiler::StackHash::operator()(const std::vector<uint64_t>& stack) const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint64_t ip : stack) {
+        hash = (hash ^ ip) * 0x100000001b3ULL;
+    }
+    return (size_t)hash;
+}
+
+LinuxProfiler::LinuxProfiler() {
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize > 0) {
+        m_pageSize = (size_t)pageSize;
+    }
+}
+
+LinuxProfiler::~LinuxProfiler() {
+    stop();
+}
+
+void LinuxProfiler::listTasks(std::vector<unsigned long>& tids) const {
+    tids.clear();
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%lu/task", m_pid);
+    DIR* dir = opendir(path);
+    if (dir == nullptr) return;
+    while (dirent* ent = readdir(dir)) {
+        if (isPidName(ent->d_name)) {
+            tids.push_back(strtoul(ent->d_name, nullptr, 10));
+        }
+    }
+    closedir(dir);
+}
+
+bool LinuxProfiler::start(unsigned long pid, const ProfileOptions& options) {
+    stop();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stacks.clear();
+        m_status = ProfileStatus();
+        m_status.pid = pid;
+        m_startTime = m_stopTime = std::chrono::steady_clock::now();
+    }
+    m_pid = pid;
+    m_options = options;
+    m_options.frequencyHz = std::max(1u, std::min(options.frequencyHz, 10000u));
+    m_options.maxDepth = std::max(1u, std::min(options.maxDepth, 1024u));
+    {
+        // Mapas lidos agora: o processo ainda existe, e a arvore continua
+        // simbolizavel depois que ele sair.
+        std::lock_guard<std::mutex> lock(m_buildMutex);
+        m_symbolizer.reset(new ProcessSymbolizer(pid, m_symbolCache));
+    }
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (m_wakeFd < 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.error = "eventfd falhou";
+        return false;
+    }
+
+    std::string perfError = "desativado";
+    m_running = true;
+    if (m_options.method != ProfileOptions::METHOD_PTRACE && startPerf(perfError)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.method = "perf_event";
+        m_status.running = true;
+        m_status.threads = (unsigned long)m_perfThreads.size();
+        m_thread = std::thread(&LinuxProfiler::perfLoop, this);
+        return true;
+    }
+
+    if (m_options.method == ProfileOptions::METHOD_PERF_EVENT) {
+        m_running = false;
+        close(m_wakeFd);
+        m_wakeFd = -1;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.error = "perf_event: " + perfError;
+        return false;
+    }
+
+    // ptrace so pode ser usado pela thread que se anexou, entao tudo acontece
+    // na thread de amostragem; start() espera o resultado do primeiro attach.
+    std::shared_ptr<std::string> ptraceError = std::make_shared<std::string>();
+    std::shared_ptr<std::atomic<int>> ready = std::make_shared<std::atomic<int>>(0);
+    m_thread = std::thread(&LinuxProfiler::ptraceLoop, this, ptraceError, ready);
+    while (ready->load() == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (ready->load() < 0) {
+        m_thread.join();
+        m_running = false;
+        close(m_wakeFd);
+        m_wakeFd = -1;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.error = "perf_event: " + perfError + "; ptrace: " + *ptraceError;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_status.method = "ptrace";
+    m_status.running = true;
+    return true;
+}
+
+void LinuxProfiler::stop() {
+    if (m_thread.joinable()) {
+        m_running = false;
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            // A thread tambem confere m_running a cada volta.
+        }
+        m_thread.join();
+    }
+    for (PerfThread& thread : m_perfThreads) {
+        closePerfThread(thread);
+    }
+    m_perfThreads.clear();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_status.running) {
+        m_status.running = false;
+        m_stopTime = std::chrono::steady_clock::now();
+    }
+}
+
+ProfileStatus LinuxProfiler::status() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ProfileStatus status = m_status;
+    std::chrono::steady_clock::time_point end = status.running ? std::chrono::steady_clock::now() : m_stopTime;
+    status.seconds = std::chrono::duration<double>(end - m_startTime).count();
+    return status;
+}
+
+bool LinuxProfiler::startPerf(std::string& error) {
+    std::vector<unsigned long> tids;
+    listTasks(tids);
+    if (tids.empty()) {
+        error = "processo nao encontrado";
+        return false;
+    }
+    for (unsigned long tid : tids) {
+        // Threads que sairam no meio do caminho nao contam como falha.
+        openPerfThread(tid, error);
+    }
+    if (m_perfThreads.empty()) return false;
+    error.clear();
+    return true;
+}
+
+bool LinuxProfiler::openPerfThread(unsigned long tid, std::string& error) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    // Relogio de CPU da propria thread: so ha amostras enquanto ela roda.
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.freq = 1;
+    attr.sample_freq = m_options.frequencyHz;
+    attr.sample_type = PERF_SAMPLE_TID | PERF_SAMPLE_CALLCHAIN;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.exclude_callchain_kernel = 1;
+    attr.sample_max_stack = (uint16_t)m_options.maxDepth;
+    attr.watermark = 1;
+    attr.wakeup_watermark = (uint32_t)(PERF_DATA_PAGES * m_pageSize / 4);
+
+    instrumentation::countSyscalls();
+    int fd = (int)syscall(SYS_perf_event_open, &attr, (pid_t)tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (fd < 0 && (errno == EINVAL || errno == EOVERFLOW)) {
+        // Kernels antes do 4.8 nao conhecem sample_max_stack, e acima de
+        // kernel.perf_event_max_stack ele e recusado: fica o limite do kernel.
+        attr.sample_max_stack = 0;
+        fd = (int)syscall(SYS_perf_event_open, &attr, (pid_t)tid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    }
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+
+    size_t ringBytes = (PERF_DATA_PAGES + 1) * m_pageSize;
+    void* ring = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        error = strerror(errno);
+        close(fd);
+        return false;
+    }
+
+    PerfThread thread;
+    thread.tid = tid;
+    thread.fd = fd;
+    thread.ring = ring;
+    m_perfThreads.push_back(thread);
+    return true;
+}
+
+void LinuxProfiler::closePerfThread(PerfThread& thread) {
+    if (thread.ring != nullptr) {
+        munmap(thread.ring, (PERF_DATA_PAGES + 1) * m_pageSize);
+        thread.ring = nullptr;
+    }
+    if (thread.fd >= 0) {
+        close(thread.fd);
+        thread.fd = -1;
+    }
+}
+
+void LinuxProfiler::perfLoop() {
+    std::vector<struct pollfd> fds;
+    std::vector<unsigned long> tids;
+    std::chrono::steady_clock::time_point lastRefresh = std::chrono::steady_clock::now();
+    bool rebuild = true;
+
+    while (m_running) {
+        if (rebuild) {
+            fds.resize(m_perfThreads.size() + 1);
+            fds[0].fd = m_wakeFd;
+            fds[0].events = POLLIN;
+            for (size_t i = 0; i < m_perfThreads.size(); ++i) {
+                fds[i + 1].fd = m_perfThreads[i].fd;
+                fds[i + 1].events = POLLIN;
+            }
+            rebuild = false;
+        }
+
+        instrumentation::countSyscalls();
+        if (poll(fds.data(), fds.size(), 250) < 0 && errno != EINTR) break;
+        if (fds[0].revents != 0) break;
+
+        for (size_t i = 0; i < m_perfThreads.size(); ++i) {
+            drainRing(m_perfThreads[i]);
+            if (fds[i + 1].revents & (POLLHUP | POLLERR)) {
+                m_perfThreads[i].hungUp = true;
+            }
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - lastRefresh < TASK_REFRESH) continue;
+        lastRefresh = now;
+
+        // Threads que sairam sao fechadas; as novas ganham um evento.
+        for (PerfThread& thread : m_perfThreads) {
+            if (thread.hungUp) {
+                closePerfThread(thread);
+                rebuild = true;
+            }
+        }
+        m_perfThreads.erase(std::remove_if(m_perfThreads.begin(), m_perfThreads.end(), [](const PerfThread& thread) {
+            return thread.fd < 0;
+            }), m_perfThreads.end());
+        listTasks(tids);
+        std::string error;
+        for (unsigned long tid : tids) {
+            bool known = std::any_of(m_perfThreads.begin(), m_perfThreads.end(), [tid](const PerfThread& thread) {
+                return thread.tid == tid;
+                });
+            if (!known && openPerfThread(tid, error)) {
+                rebuild = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.threads = (unsigned long)m_perfThreads.size();
+        if (m_perfThreads.empty()) {
+            // O processo saiu.
+            m_status.running = false;
+            m_stopTime = now;
+            break;
+        }
+    }
+
+    for (PerfThread& thread : m_perfThreads) {
+        drainRing(thread);
+    }
+}
+
+// Le os registros entre data_tail e data_head. Um registro pode dar a volta
+// no fim do anel; nesse caso e copiado para m_record antes de ser lido.
+void LinuxProfiler::drainRing(PerfThread& thread) {
+    if (thread.ring == nullptr) return;
+    struct perf_event_mmap_page* meta = (struct perf_event_mmap_page*)thread.ring;
+    const char* data = (const char*)thread.ring + m_pageSize;
+    const uint64_t size = PERF_DATA_PAGES * m_pageSize;
+
+    uint64_t head = __atomic_load_n(&meta->data_head, __ATOMIC_ACQUIRE);
+    uint64_t tail = meta->data_tail;
+    while (tail + sizeof(struct perf_event_header) <= head) {
+        struct perf_event_header header;
+        for (size_t i = 0; i < sizeof(header); ++i) {
+            ((char*)&header)[i] = data[(tail + i) % size];
+        }
+        if (header.size < sizeof(header) || tail + header.size > head) break;
+
+        const char* entry = data + (tail % size);
+        if ((tail % size) + header.size > size) {
+            m_record.resize(header.size);
+            for (size_t i = 0; i < header.size; ++i) {
+                m_record[i] = data[(tail + i) % size];
+            }
+            entry = m_record.data();
+        }
+
+        if (header.type == PERF_RECORD_SAMPLE) {
+            // PERF_SAMPLE_TID: pid, tid (u32 cada); PERF_SAMPLE_CALLCHAIN: nr e os ips.
+            const char* p = entry + sizeof(header) + 2 * sizeof(uint32_t);
+            uint64_t count;
+            memcpy(&count, p, sizeof(count));
+            p += sizeof(count);
+            size_t available = (header.size - (size_t)(p - entry)) / sizeof(uint64_t);
+            count = std::min<uint64_t>(count, available);
+
+            uint64_t ips[1024];
+            size_t depth = 0;
+            for (uint64_t i = 0; i < count && depth < m_options.maxDepth && depth < 1024; ++i) {
+                uint64_t ip;
+                memcpy(&ip, p + i * sizeof(uint64_t), sizeof(ip));
+                // Marcadores de contexto (PERF_CONTEXT_USER etc.), nao enderecos.
+                if (ip >= (uint64_t)PERF_CONTEXT_MAX) continue;
+                ips[depth++] = ip;
+            }
+            if (depth > 0) {
+                record(ips, depth);
+            }
+        }
+        else if (header.type == PERF_RECORD_LOST) {
+            // id (u64) e quantidade perdida (u64).
+            uint64_t lost;
+            memcpy(&lost, entry + sizeof(header) + sizeof(uint64_t), sizeof(lost));
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_status.lostSamples += lost;
+        }
+        tail += header.size;
+    }
+    __atomic_store_n(&meta->data_tail, tail, __ATOMIC_RELEASE);
+}
+
+void LinuxProfiler::record(const uint64_t* ips, size_t count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_status.samples++;
+    m_scratch.assign(ips, ips + count);
+    auto it = m_stacks.find(m_scratch);
+    if (it != m_stacks.end()) {
+        it->second++;
+    }
+    else if (m_stacks.size() < MAX_DISTINCT_STACKS) {
+        m_stacks.emplace(m_scratch, 1);
+    }
+    else {
+        m_status.lostSamples++;
+    }
+}
+
+void LinuxProfiler::ptraceLoop(std::shared_ptr<std::string> error, std::shared_ptr<std::atomic<int>> ready) {
+#if !defined(__x86_64__) && !defined(__aarch64__)
+    *error = "arquitetura sem suporte";
+    ready->store(-1);
+    return;
+#else
+    std::vector<unsigned long> tids;
+    listTasks(tids);
+    m_traced.clear();
+    for (unsigned long tid : tids) {
+        if (attachTraced(tid)) {
+            m_traced.push_back(tid);
+        }
+        else if (m_traced.empty() && error->empty()) {
+            *error = strerror(errno);
+        }
+    }
+    if (m_traced.empty()) {
+        if (error->empty()) {
+            *error = "processo nao encontrado";
+        }
+        ready->store(-1);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_status.threads = (unsigned long)m_traced.size();
+    }
+    ready->store(1);
+
+    std::chrono::nanoseconds interval(1000000000ULL / m_options.frequencyHz);
+    std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point lastRefresh = next;
+    struct pollfd wake;
+    wake.fd = m_wakeFd;
+    wake.events = POLLIN;
+
+    while (m_running) {
+        for (size_t i = 0; i < m_traced.size();) {
+            if (sampleTraced(m_traced[i])) {
+                ++i;
+            }
+            else {
+                m_traced.erase(m_traced.begin() + i);
+            }
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now - lastRefresh >= TASK_REFRESH) {
+            lastRefresh = now;
+            listTasks(tids);
+            for (unsigned long tid : tids) {
+                if (std::find(m_traced.begin(), m_traced.end(), tid) == m_traced.end() && attachTraced(tid)) {
+                    m_traced.push_back(tid);
+                }
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_status.threads = (unsigned long)m_traced.size();
+            if (m_traced.empty()) {
+                // O processo saiu.
+                m_status.running = false;
+                m_stopTime = now;
+                break;
+            }
+        }
+
+        next += interval;
+        now = std::chrono::steady_clock::now();
+        if (next < now) {
+            // Atrasou (muitas threads ou maquina carregada): nao tenta compensar.
+            next = now;
+        }
+        int timeoutMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+        poll(&wake, 1, timeoutMs);
+    }
+
+    for (unsigned long tid : m_traced) {
+        detachTraced(tid);
+    }
+    m_traced.clear();
+#endif
+}
+
+bool LinuxProfiler::attachTraced(unsigned long tid) {
+    instrumentation::countSyscalls();
+    // SEIZE nao para a thread; ela so para em cada PTRACE_INTERRUPT.
+    return ptrace(PTRACE_SEIZE, (pid_t)tid, nullptr, nullptr) == 0;
+}
+
+// So amostra quem esta rodando ou pronto para rodar (estado R), para o perfil
+// ser de CPU como no modo perf.
+static bool isRunning(unsigned long pid, unsigned long tid) {
+    char path[80];
+    snprintf(path, sizeof(path), "/proc/%lu/task/%lu/stat", pid, tid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    char buffer[512];
+    ssize_t n = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (n <= 0) return false;
+    buffer[n] = '\0';
+    const char* end = strrchr(buffer, ')');
+    return end != nullptr && end[1] == ' ' && end[2] == 'R';
+}
+
+bool LinuxProfiler::sampleTraced(unsigned long tid) {
+    instrumentation::countSyscalls(3);
+    if (!isRunning(m_pid, tid)) {
+        return kill((pid_t)tid, 0) == 0 || errno != ESRCH;
+    }
+
+    instrumentation::countSyscalls(2);
+    if (ptrace(PTRACE_INTERRUPT, (pid_t)tid, nullptr, nullptr) != 0) return errno != ESRCH;
+
+    for (;;) {
+        int status = 0;
+        if (waitpid((pid_t)tid, &status, __WALL) < 0) return false;
+        if (WIFEXITED(status) || WIFSIGNALED(status)) return false;
+        if (!WIFSTOPPED(status)) continue;
+
+        if ((status >> 16) != PTRACE_EVENT_STOP) {
+            // Um sinal chegou antes da interrupcao: entrega e espera a parada.
+            instrumentation::countSyscalls(2);
+            ptrace(PTRACE_CONT, (pid_t)tid, nullptr, (void*)(long)WSTOPSIG(status));
+            continue;
+        }
+        if (WSTOPSIG(status) != SIGTRAP) {
+            // Parada de grupo (SIGSTOP etc.): a thread continua parada.
+            instrumentation::countSyscalls();
+            ptrace(PTRACE_LISTEN, (pid_t)tid, nullptr, nullptr);
+            return true;
+        }
+        break;
+    }
+
+    uint64_t pc = 0, fp = 0;
+#if defined(__x86_64__)
+    struct user_regs_struct regs;
+    memset(&regs, 0, sizeof(regs));
+    bool haveRegs = ptrace(PTRACE_GETREGS, (pid_t)tid, nullptr, &regs) == 0;
+    pc = regs.rip;
+    fp = regs.rbp;
+#elif defined(__aarch64__)
+    struct user_pt_regs regs;
+    memset(&regs, 0, sizeof(regs));
+    struct iovec registers = { &regs, sizeof(regs) };
+    bool haveRegs = ptrace(PTRACE_GETREGSET, (pid_t)tid, (void*)NT_PRSTATUS, &registers) == 0;
+    pc = regs.pc;
+    fp = regs.regs[29];
+#else
+    bool haveRegs = false;
+#endif
+
+    // Cadeia de frame pointers: [fp] = fp anterior, [fp + 8] = retorno.
+    m_walk.clear();
+    if (haveRegs) {
+        m_walk.push_back(pc);
+        while (m_walk.size() < m_options.maxDepth && fp != 0) {
+            uint64_t frame[2];
+            struct iovec local = { frame, sizeof(frame) };
+            struct iovec remote = { (void*)fp, sizeof(frame) };
+            instrumentation::countSyscalls();
+            if (process_vm_readv((pid_t)m_pid, &local, 1, &remote, 1, 0) != (ssize_t)sizeof(frame)) break;
+            if (frame[1] == 0) break;
+            m_walk.push_back(frame[1]);
+            if (frame[0] <= fp) break;
+            fp = frame[0];
+        }
+    }
+
+    instrumentation::countSyscalls();
+    ptrace(PTRACE_CONT, (pid_t)tid, nullptr, nullptr);
+    if (!m_walk.empty()) {
+        record(m_walk.data(), m_walk.size());
+    }
+    return true;
+}
+
+void LinuxProfiler::detachTraced(unsigned long tid) {
+    // PTRACE_DETACH exige a thread parada.
+    instrumentation::countSyscalls(3);
+    if (ptrace(PTRACE_INTERRUPT, (pid_t)tid, nullptr, nullptr) != 0) return;
+    for (;;) {
+        int status = 0;
+        if (waitpid((pid_t)tid, &status, __WALL) < 0) return;
+        if (WIFEXITED(status) || WIFSIGNALED(status)) return;
+        if (WIFSTOPPED(status) && (status >> 16) != PTRACE_EVENT_STOP) {
+            // Sinal pendente: solta a thread entregando o sinal.
+            ptrace(PTRACE_DETACH, (pid_t)tid, nullptr, (void*)(long)WSTOPSIG(status));
+            return;
+        }
+        if (WIFSTOPPED(status)) break;
+    }
+    ptrace(PTRACE_DETACH, (pid_t)tid, nullptr, nullptr);
+}
+
+void LinuxProfiler::buildFlameGraph(FlameGraph& out) {
+    std::vector<std::pair<std::vector<uint64_t>, unsigned long long>> stacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stacks.reserve(m_stacks.size());
+        for (const auto& entry : m_stacks) {
+            stacks.push_back(entry);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    out.clear();
+    if (!m_symbolizer) return;
+    m_symbolizer->begin();
+    std::vector<const std::string*> frames;
+    for (const auto& stack : stacks) {
+        frames.clear();
+        for (size_t i = stack.first.size(); i-- > 0;) {
+            // Quadros acima do primeiro sao enderecos de retorno: o -1 cai
+            // dentro da instrucao de chamada, que e da funcao certa.
+            uint64_t address = i == 0 ? stack.first[i] : stack.first[i] - 1;
+            frames.push_back(&m_symbolizer->symbolize(address));
+        }
+        out.add(frames, stack.second);
+    }
+    out.finish();
+}
+
+std::unique_ptr<Profiler> createPlatformProfiler() {
+    return std::unique_ptr<Profiler>(new LinuxProfiler());
+}
@@ -0,0 +1,88 @@
+#ifndef PROFILER_LINUX_H
+#define PROFILER_LINUX_H
+
+#include "profiler.h"
+#include "symbols_linux.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Amostrador de pilhas do espaco de usuario de um processo. Preferencia:
+// perf_event_open com o relogio de CPU de cada thread (so amostra quem esta
+// na CPU, custo quase todo no kernel). Sem permissao para perf (ex.:
+// perf_event_paranoid > 2 ou seccomp), cai para ptrace: cada thread em
+// execucao e interrompida por alguns microssegundos e a pilha e percorrida
+// pelos frame pointers. Nos dois casos, binarios sem frame pointer dao
+// pilhas curtas.
+class LinuxProfiler : public Profiler {
+public:
+    LinuxProfiler();
+    ~LinuxProfiler() override;
+
+    bool start(unsigned long pid, const ProfileOptions& options) override;
+    void stop() override;
+    ProfileStatus status() const override;
+    void buildFlameGraph(FlameGraph& out) override;
+
+private:
+    struct PerfThread {
+        unsigned long tid = 0;
+        int fd = -1;
+        void* ring = nullptr;
+        bool hungUp = false;
+    };
+
+    struct StackHash {
+        size_t operator()(const std::vector<uint64_t>& stack) const;
+    };
+
+    bool startPerf(std::string& error);
+    bool openPerfThread(unsigned long tid, std::string& error);
+    void closePerfThread(PerfThread& thread);
+    void perfLoop();
+    void drainRing(PerfThread& thread);
+
+    void ptraceLoop(std::shared_ptr<std::string> error, std::shared_ptr<std::atomic<int>> ready);
+    bool attachTraced(unsigned long tid);
+    // Interrompe a thread, le a pilha e a solta. False se a thread saiu.
+    bool sampleTraced(unsigned long tid);
+    void detachTraced(unsigned long tid);
+
+    void listTasks(std::vector<unsigned long>& tids) const;
+    // ips do quadro mais interno para o mais externo.
+    void record(const uint64_t* ips, size_t count);
+
+    unsigned long m_pid = 0;
+    ProfileOptions m_options;
+    std::thread m_thread;
+    std::atomic<bool> m_running{ false };
+    int m_wakeFd = -1;
+    size_t m_pageSize = 4096;
+
+    // Usados so pela thread de amostragem.
+    std::vector<PerfThread> m_perfThreads;
+    std::vector<unsigned long> m_traced;
+    std::vector<char> m_record;
+    std::vector<uint64_t> m_walk;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::vector<uint64_t>, unsigned long long, StackHash> m_stacks;
+    std::vector<uint64_t> m_scratch;
+    ProfileStatus m_status;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::chrono::steady_clock::time_point m_stopTime;
+
+    // So buildFlameGraph usa; os simbolos sobrevivem entre sessoes.
+    std::mutex m_buildMutex;
+    SymbolCache m_symbolCache;
+    std::unique_ptr<ProcessSymbolizer> m_symbolizer;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#include "profiler.h"
+
+// Sem amostrador de pilhas no Windows por enquanto (o equivalente seria ETW
+// com stack walking, que exige sessao de kernel e privilegios de admin).
+class UnsupportedProfiler : public Profiler {
+public:
+    bool start(unsigned long pid, const ProfileOptions&) override {
+        m_status = ProfileStatus();
+        m_status.pid = pid;
+        m_status.error = "perfil de pilhas disponivel apenas no Linux";
+        return false;
+    }
+    void stop() override {}
+    ProfileStatus status() const override { return m_status; }
+    void buildFlameGraph(FlameGraph& out) override { out.clear(); }
+
+private:
+    ProfileStatus m_status;
+};
+
+std::unique_ptr<Profiler> createPlatformProfiler() {
+    return std::unique_ptr<Profiler>(new UnsupportedProfiler());
+}
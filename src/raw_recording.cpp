@@ -0,0 +1,564 @@
+#include "raw_recording.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "scheduler.h"
+#include "varint.h"
+
+static const char MAGIC[4] = { 'P', 'C', 'R', 'R' };
+
+static void putDouble(std::vector<uint8_t>& out, double value) {
+    uint8_t bytes[sizeof(value)];
+    memcpy(bytes, &value, sizeof(value));
+    out.insert(out.end(), bytes, bytes + sizeof(bytes));
+}
+
+static double readDouble(VarintReader& in) {
+    double value = 0.0;
+    if ((size_t)(in.end - in.p) < sizeof(value)) {
+        in.ok = false;
+        return 0.0;
+    }
+    memcpy(&value, in.p, sizeof(value));
+    in.p += sizeof(value);
+    return value;
+}
+
+// Delta de um contador que pode voltar (PID reaproveitado, nucleo trocado).
+static void putDelta(std::vector<uint8_t>& out, unsigned long long value, unsigned long long& base) {
+    putSigned(out, (int64_t)(value - base));
+    base = value;
+}
+
+static unsigned long long readDelta(VarintReader& in, unsigned long long& base) {
+    base += (unsigned long long)in.signedVarint();
+    return base;
+}
+
+RawRecordBase::Process& RawRecordBase::process(unsigned long pid) {
+    // Um PID gravado aparece em quase todos os ticks; so os novos inserem.
+    auto it = processes.find(pid);
+    if (it == processes.end()) {
+        it = processes.emplace(pid, Process()).first;
+    }
+    it->second.generation = generation;
+    return it->second;
+}
+
+void RawRecordBase::prune() {
+    for (auto it = processes.begin(); it != processes.end();) {
+        if (it->second.generation != generation) {
+            it = processes.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+// Gravacao
+
+RecordingCollector::RecordingCollector(std::unique_ptr<Collector> inner) :
+    m_inner(std::move(inner)),
+    m_start(std::chrono::steady_clock::now()),
+    m_now(m_start)
+{
+}
+
+RecordingCollector::~RecordingCollector() {
+    if (m_file != nullptr) fclose(m_file);
+}
+
+bool RecordingCollector::open(const std::string& path) {
+    if (m_file != nullptr) fclose(m_file);
+    m_file = fopen(path.c_str(), "wb");
+    if (m_file == nullptr) return false;
+    fwrite(MAGIC, 1, sizeof(MAGIC), m_file);
+    fputc(raw_recording::FORMAT_VERSION, m_file);
+    m_bytesWritten = sizeof(MAGIC) + 1;
+    return true;
+}
+
+void RecordingCollector::stamp() {
+    m_now = m_inner->now();
+    long long timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(m_now - m_start).count();
+    putSigned(m_body, timeNs - m_base.timeNs);
+    m_base.timeNs = timeNs;
+}
+
+void RecordingCollector::writeRecord(raw_recording::RecordType type) {
+    if (m_file == nullptr) return;
+    m_record.clear();
+    m_record.push_back(type);
+    putVarint(m_record, m_body.size());
+    fwrite(m_record.data(), 1, m_record.size(), m_file);
+    fwrite(m_body.data(), 1, m_body.size(), m_file);
+    m_bytesWritten += m_record.size() + m_body.size();
+}
+
+void RecordingCollector::encodeString(const std::string& value) {
+    putVarint(m_body, value.size());
+    m_body.insert(m_body.end(), value.begin(), value.end());
+}
+
+// 0 = sem metadados; um id novo vem seguido dos campos.
+void RecordingCollector::encodeMetadata(const ProcessMetadataRef& metadata) {
+    if (!metadata) {
+        putVarint(m_body, 0);
+        return;
+    }
+    auto it = m_metadata.find(metadata.get());
+    if (it != m_metadata.end()) {
+        putVarint(m_body, it->second.id);
+        return;
+    }
+    Metadata& entry = m_metadata[metadata.get()];
+    entry.id = m_nextMetadataId++;
+    entry.ref = metadata;
+    putVarint(m_body, entry.id);
+    encodeString(metadata->name);
+    encodeString(metadata->executablePath);
+    encodeString(metadata->commandLine);
+    encodeString(metadata->user);
+    putVarint(m_body, metadata->parentPid);
+    encodeString(metadata->cgroup);
+}
+
+bool RecordingCollector::readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) {
+    bool valid = m_inner->readCpuTimes(totalTime, idleTime);
+    m_body.clear();
+    m_body.push_back(valid ? 1 : 0);
+    putVarint(m_body, totalTime);
+    putVarint(m_body, idleTime);
+    writeRecord(raw_recording::RECORD_CPU_TIMES);
+    return valid;
+}
+
+void RecordingCollector::sampleSystem(RawSample& out) {
+    m_inner->sampleSystem(out);
+    m_body.clear();
+    stamp();
+
+    m_body.push_back((uint8_t)((out.memoryValid ? 1 : 0) | (out.cpuValid ? 2 : 0)));
+    putVarint(m_body, out.ramTotalBytes);
+    putVarint(m_body, out.ramUsedBytes);
+    putDouble(m_body, out.ramUsagePercentage);
+    putDelta(m_body, out.cpuTotalTime, m_base.cpuTotalTime);
+    putDelta(m_body, out.cpuIdleTime, m_base.cpuIdleTime);
+    for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+        putDelta(m_body, out.cpuStateTimes[field], m_base.cpuStateTimes[field]);
+    }
+
+    const RawCpuCores& cores = out.cores;
+    putVarint(m_body, cores.count);
+    putVarint(m_body, cores.online);
+    for (unsigned core = 0; core < cores.count; ++core) {
+        putVarint(m_body, cores.id[core]);
+        for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+            putDelta(m_body, cores.times[field][core], m_base.cores.times[field][core]);
+        }
+    }
+
+    for (const RawPressure& pressure : out.pressure) {
+        m_body.push_back((uint8_t)((pressure.valid ? 1 : 0) | (pressure.hasFull ? 2 : 0)));
+        if (pressure.valid) {
+            for (double avg : pressure.someAvg) putDouble(m_body, avg);
+            putVarint(m_body, pressure.someTotalUsec);
+        }
+        if (pressure.hasFull) {
+            for (double avg : pressure.fullAvg) putDouble(m_body, avg);
+            putVarint(m_body, pressure.fullTotalUsec);
+        }
+    }
+    writeRecord(raw_recording::RECORD_SYSTEM);
+}
+
+void RecordingCollector::sampleProcesses(RawSample& out) {
+    m_inner->sampleProcesses(out);
+    m_body.clear();
+    stamp();
+
+    // Metadados que so a gravacao ainda segura: o coletor ja os esqueceu, e o
+    // reprodutor pode esquecer tambem.
+    m_releasedMetadata.clear();
+    for (auto it = m_metadata.begin(); it != m_metadata.end();) {
+        if (it->second.ref.use_count() == 1) {
+            m_releasedMetadata.push_back(it->second.id);
+            it = m_metadata.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    putVarint(m_body, m_releasedMetadata.size());
+    for (uint32_t id : m_releasedMetadata) {
+        putVarint(m_body, id);
+    }
+
+    ++m_base.generation;
+    putVarint(m_body, out.processes.size());
+    for (const RawProcessSample& raw : out.processes) {
+        RawRecordBase::Process& base = m_base.process(raw.pid);
+        putVarint(m_body, raw.pid);
+        m_body.push_back((uint8_t)((raw.accessible ? 1 : 0) | (raw.timesValid ? 2 : 0)));
+        putDelta(m_body, raw.startTime, base.startTime);
+        encodeMetadata(raw.metadata);
+        putDelta(m_body, raw.memoryUsedBytes, base.memoryUsedBytes);
+        putDelta(m_body, raw.kernelTime, base.kernelTime);
+        putDelta(m_body, raw.userTime, base.userTime);
+        putVarint(m_body, raw.threadCount);
+        putVarint(m_body, raw.countersValid);
+        for (unsigned c = 0; c < PROCESS_COUNTER_COUNT; ++c) {
+            if (raw.countersValid & (1u << c)) putDelta(m_body, raw.counters[c], base.counters[c]);
+        }
+    }
+    m_base.prune();
+
+    putVarint(m_body, out.exits.size());
+    for (const ProcessExit& exit : out.exits) {
+        putVarint(m_body, exit.pid);
+        encodeString(exit.name);
+        putVarint(m_body, exit.parentPid);
+        putDouble(m_body, exit.cpuSeconds);
+        putVarint(m_body, exit.peakRssBytes);
+        putSigned(m_body, exit.exitCode);
+        m_body.push_back(exit.shortLived ? 1 : 0);
+        putVarint(m_body, exit.timestampMs);
+    }
+
+    putVarint(m_body, out.cgroups.size());
+    for (const RawCgroupSample& group : out.cgroups) {
+        auto it = m_cgroupIds.find(group.path.str());
+        if (it != m_cgroupIds.end()) {
+            putVarint(m_body, it->second);
+        }
+        else {
+            uint32_t id = (uint32_t)m_cgroupIds.size();
+            m_cgroupIds.emplace(group.path.str(), id);
+            putVarint(m_body, id);
+            encodeString(group.path);
+        }
+        m_body.push_back((uint8_t)((group.cpuValid ? 1 : 0) | (group.memoryValid ? 2 : 0) | (group.ioValid ? 4 : 0)));
+        putVarint(m_body, group.cpuUsageUsec);
+        putVarint(m_body, group.cpuUserUsec);
+        putVarint(m_body, group.cpuSystemUsec);
+        putVarint(m_body, group.throttledUsec);
+        putVarint(m_body, group.memoryCurrentBytes);
+        putVarint(m_body, group.memoryMaxBytes);
+        putVarint(m_body, group.ioReadBytes);
+        putVarint(m_body, group.ioWriteBytes);
+    }
+
+    const CollectorStats& stats = out.stats;
+    putVarint(m_body, stats.cachedHandles);
+    putVarint(m_body, stats.handlesOpened);
+    putVarint(m_body, stats.handlesEvicted);
+    putVarint(m_body, stats.syscallsSaved);
+    putVarint(m_body, stats.metadataLoads);
+    m_body.push_back(stats.eventDriven ? 1 : 0);
+    putVarint(m_body, stats.lifecycleEvents);
+    putVarint(m_body, stats.rescans);
+    writeRecord(raw_recording::RECORD_PROCESSES);
+}
+
+void RecordingCollector::sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) {
+    m_inner->sampleThreads(out, pids);
+    m_body.clear();
+    putVarint(m_body, out.focused.size());
+    for (const RawFocusedProcess& focused : out.focused) {
+        putVarint(m_body, focused.pid);
+        putVarint(m_body, focused.threads.size());
+        for (const RawThreadSample& thread : focused.threads) {
+            putVarint(m_body, thread.tid);
+            m_body.push_back(thread.timesValid ? 1 : 0);
+            putVarint(m_body, thread.kernelTime);
+            putVarint(m_body, thread.userTime);
+        }
+    }
+    writeRecord(raw_recording::RECORD_THREADS);
+}
+
+// Reproducao
+
+ReplayCollector::ReplayCollector() {
+}
+
+bool ReplayCollector::open(const std::string& path) {
+    m_data.clear();
+    m_records.clear();
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    uint8_t chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        m_data.insert(m_data.end(), chunk, chunk + n);
+    }
+    fclose(file);
+
+    if (m_data.size() < sizeof(MAGIC) + 1 || memcmp(m_data.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+        m_data[sizeof(MAGIC)] != raw_recording::FORMAT_VERSION) {
+        m_data.clear();
+        return false;
+    }
+
+    // Um registro truncado no fim (gravacao interrompida) e ignorado.
+    VarintReader in{ m_data.data() + sizeof(MAGIC) + 1, m_data.data() + m_data.size() };
+    while (in.p < in.end) {
+        uint8_t type = *in.p++;
+        uint64_t size = in.varint();
+        if (!in.ok || size > (uint64_t)(in.end - in.p)) break;
+        if (type >= raw_recording::RECORD_CPU_TIMES && type <= raw_recording::RECORD_THREADS) {
+            m_records.push_back(Record{ (raw_recording::RecordType)type, (size_t)(in.p - m_data.data()), (size_t)size });
+        }
+        in.p += size;
+    }
+    rewind();
+    return true;
+}
+
+void ReplayCollector::rewind() {
+    m_cursor = 0;
+    m_mismatches = 0;
+    m_base.timeNs = 0;
+    m_base.cpuTotalTime = m_base.cpuIdleTime = 0;
+    std::fill(m_base.cpuStateTimes, m_base.cpuStateTimes + RAW_CPU_FIELDS, 0ULL);
+    for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+        std::fill(m_base.cores.times[field], m_base.cores.times[field] + MAX_CPU_CORES, 0ULL);
+    }
+    m_base.processes.clear();
+    m_base.generation = 0;
+    m_metadata.clear();
+    m_cgroupPaths.clear();
+}
+
+// Um tick roda as camadas na ordem sistema, processos, threads, cada uma no
+// maximo uma vez; a primeira que se repetiria comeca o tick seguinte.
+// readCpuTimes vem antes de processos e de threads.
+unsigned ReplayCollector::nextTiers() const {
+    unsigned tiers = 0;
+    for (size_t i = m_cursor; i < m_records.size(); ++i) {
+        raw_recording::RecordType type = m_records[i].type;
+        if (type == raw_recording::RECORD_CPU_TIMES) {
+            if (i + 1 >= m_records.size()) break;
+            type = m_records[i + 1].type;
+            if (type == raw_recording::RECORD_CPU_TIMES || type == raw_recording::RECORD_SYSTEM) break;
+            ++i;
+        }
+        unsigned tier = type == raw_recording::RECORD_SYSTEM ? TickScheduler::TIER_SYSTEM :
+            type == raw_recording::RECORD_PROCESSES ? TickScheduler::TIER_PROCESSES : TickScheduler::TIER_THREADS;
+        if (tiers >= tier) break;
+        tiers |= tier;
+    }
+    return tiers;
+}
+
+const ReplayCollector::Record* ReplayCollector::take(raw_recording::RecordType type) {
+    if (m_cursor < m_records.size() && m_records[m_cursor].type == type) {
+        return &m_records[m_cursor++];
+    }
+    ++m_mismatches;
+    return nullptr;
+}
+
+std::string ReplayCollector::decodeString(VarintReader& in) {
+    uint64_t size = in.varint();
+    if (size > (uint64_t)(in.end - in.p)) {
+        in.ok = false;
+        return std::string();
+    }
+    std::string value((const char*)in.p, (size_t)size);
+    in.p += size;
+    return value;
+}
+
+std::chrono::steady_clock::time_point ReplayCollector::now() {
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(m_base.timeNs));
+}
+
+bool ReplayCollector::readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) {
+    const Record* record = take(raw_recording::RECORD_CPU_TIMES);
+    if (record == nullptr) return false;
+    VarintReader in{ m_data.data() + record->offset, m_data.data() + record->offset + record->size };
+    bool valid = in.p < in.end && *in.p++ != 0;
+    totalTime = in.varint();
+    idleTime = in.varint();
+    return valid && in.ok;
+}
+
+void ReplayCollector::sampleSystem(RawSample& out) {
+    const Record* record = take(raw_recording::RECORD_SYSTEM);
+    if (record == nullptr) return;
+    VarintReader in{ m_data.data() + record->offset, m_data.data() + record->offset + record->size };
+    m_base.timeNs += in.signedVarint();
+
+    uint8_t flags = in.p < in.end ? *in.p++ : 0;
+    out.memoryValid = (flags & 1) != 0;
+    out.cpuValid = (flags & 2) != 0;
+    out.ramTotalBytes = in.varint();
+    out.ramUsedBytes = in.varint();
+    out.ramUsagePercentage = readDouble(in);
+    out.cpuTotalTime = readDelta(in, m_base.cpuTotalTime);
+    out.cpuIdleTime = readDelta(in, m_base.cpuIdleTime);
+    for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+        out.cpuStateTimes[field] = readDelta(in, m_base.cpuStateTimes[field]);
+    }
+
+    RawCpuCores& cores = out.cores;
+    cores.count = std::min<unsigned>((unsigned)in.varint(), MAX_CPU_CORES);
+    cores.online = (unsigned)in.varint();
+    for (unsigned core = 0; core < cores.count; ++core) {
+        cores.id[core] = (uint16_t)in.varint();
+        for (unsigned field = 0; field < RAW_CPU_FIELDS; ++field) {
+            cores.times[field][core] = readDelta(in, m_base.cores.times[field][core]);
+        }
+    }
+
+    for (RawPressure& pressure : out.pressure) {
+        uint8_t pressureFlags = in.p < in.end ? *in.p++ : 0;
+        pressure.valid = (pressureFlags & 1) != 0;
+        pressure.hasFull = (pressureFlags & 2) != 0;
+        if (pressure.valid) {
+            for (double& avg : pressure.someAvg) avg = readDouble(in);
+            pressure.someTotalUsec = in.varint();
+        }
+        if (pressure.hasFull) {
+            for (double& avg : pressure.fullAvg) avg = readDouble(in);
+            pressure.fullTotalUsec = in.varint();
+        }
+    }
+    if (!in.ok) ++m_mismatches;
+}
+
+void ReplayCollector::sampleProcesses(RawSample& out) {
+    const Record* record = take(raw_recording::RECORD_PROCESSES);
+    if (record == nullptr) return;
+    VarintReader in{ m_data.data() + record->offset, m_data.data() + record->offset + record->size };
+    m_base.timeNs += in.signedVarint();
+
+    uint64_t released = in.varint();
+    for (uint64_t i = 0; i < released && in.ok; ++i) {
+        m_metadata.erase((uint32_t)in.varint());
+    }
+
+    ++m_base.generation;
+    uint64_t count = in.varint();
+    if (!in.ok || count > (uint64_t)(in.end - in.p)) {
+        ++m_mismatches;
+        return;
+    }
+    out.processes.resize((size_t)count);
+    for (RawProcessSample& raw : out.processes) {
+        raw.pid = (unsigned long)in.varint();
+        RawRecordBase::Process& base = m_base.process(raw.pid);
+        uint8_t flags = in.p < in.end ? *in.p++ : 0;
+        raw.accessible = (flags & 1) != 0;
+        raw.timesValid = (flags & 2) != 0;
+        raw.startTime = readDelta(in, base.startTime);
+
+        uint32_t id = (uint32_t)in.varint();
+        if (id == 0) {
+            raw.metadata.reset();
+        }
+        else {
+            auto it = m_metadata.find(id);
+            if (it == m_metadata.end()) {
+                std::shared_ptr<ProcessMetadata> metadata = std::make_shared<ProcessMetadata>();
+                metadata->name = m_names.intern(decodeString(in));
+                metadata->executablePath = decodeString(in);
+                metadata->commandLine = decodeString(in);
+                metadata->user = m_names.intern(decodeString(in));
+                metadata->parentPid = (unsigned long)in.varint();
+                metadata->cgroup = m_names.intern(decodeString(in));
+                it = m_metadata.emplace(id, metadata).first;
+            }
+            raw.metadata = it->second;
+        }
+
+        raw.memoryUsedBytes = readDelta(in, base.memoryUsedBytes);
+        raw.kernelTime = readDelta(in, base.kernelTime);
+        raw.userTime = readDelta(in, base.userTime);
+        raw.threadCount = (unsigned long)in.varint();
+        raw.countersValid = (unsigned)in.varint();
+        for (unsigned c = 0; c < PROCESS_COUNTER_COUNT; ++c) {
+            raw.counters[c] = raw.countersValid & (1u << c) ? readDelta(in, base.counters[c]) : 0;
+        }
+        if (!in.ok) break;
+    }
+    m_base.prune();
+
+    uint64_t exits = in.varint();
+    out.exits.clear();
+    for (uint64_t i = 0; i < exits && in.ok; ++i) {
+        ProcessExit exit;
+        exit.pid = (unsigned long)in.varint();
+        exit.name = m_names.intern(decodeString(in));
+        exit.parentPid = (unsigned long)in.varint();
+        exit.cpuSeconds = readDouble(in);
+        exit.peakRssBytes = in.varint();
+        exit.exitCode = (int)in.signedVarint();
+        exit.shortLived = in.p < in.end && *in.p++ != 0;
+        exit.timestampMs = in.varint();
+        out.exits.push_back(exit);
+    }
+
+    uint64_t cgroups = in.varint();
+    out.cgroups.resize(in.ok ? (size_t)std::min<uint64_t>(cgroups, (uint64_t)(in.end - in.p)) : 0);
+    for (RawCgroupSample& group : out.cgroups) {
+        uint32_t id = (uint32_t)in.varint();
+        if (id == m_cgroupPaths.size()) {
+            m_cgroupPaths.push_back(m_names.intern(decodeString(in)));
+        }
+        if (id >= m_cgroupPaths.size()) {
+            in.ok = false;
+            break;
+        }
+        group.path = m_cgroupPaths[id];
+        uint8_t flags = in.p < in.end ? *in.p++ : 0;
+        group.cpuValid = (flags & 1) != 0;
+        group.memoryValid = (flags & 2) != 0;
+        group.ioValid = (flags & 4) != 0;
+        group.cpuUsageUsec = in.varint();
+        group.cpuUserUsec = in.varint();
+        group.cpuSystemUsec = in.varint();
+        group.throttledUsec = in.varint();
+        group.memoryCurrentBytes = in.varint();
+        group.memoryMaxBytes = in.varint();
+        group.ioReadBytes = in.varint();
+        group.ioWriteBytes = in.varint();
+    }
+
+    CollectorStats& stats = out.stats;
+    stats.cachedHandles = (unsigned long)in.varint();
+    stats.handlesOpened = (unsigned long)in.varint();
+    stats.handlesEvicted = (unsigned long)in.varint();
+    stats.syscallsSaved = in.varint();
+    stats.metadataLoads = (unsigned long)in.varint();
+    stats.eventDriven = in.p < in.end && *in.p++ != 0;
+    stats.lifecycleEvents = (unsigned long)in.varint();
+    stats.rescans = (unsigned long)in.varint();
+    out.shards.clear();
+    m_names.purge();
+    if (!in.ok) ++m_mismatches;
+}
+
+void ReplayCollector::sampleThreads(RawSample& out, const std::vector<unsigned long>&) {
+    const Record* record = take(raw_recording::RECORD_THREADS);
+    if (record == nullptr) return;
+    VarintReader in{ m_data.data() + record->offset, m_data.data() + record->offset + record->size };
+
+    uint64_t count = in.varint();
+    out.focused.resize(in.ok ? (size_t)std::min<uint64_t>(count, (uint64_t)(in.end - in.p)) : 0);
+    for (RawFocusedProcess& focused : out.focused) {
+        focused.pid = (unsigned long)in.varint();
+        uint64_t threads = in.varint();
+        focused.threads.resize(in.ok ? (size_t)std::min<uint64_t>(threads, (uint64_t)(in.end - in.p)) : 0);
+        for (RawThreadSample& thread : focused.threads) {
+            thread.tid = (unsigned long)in.varint();
+            thread.timesValid = in.p < in.end && *in.p++ != 0;
+            thread.kernelTime = in.varint();
+            thread.userTime = in.varint();
+        }
+    }
+    if (!in.ok) ++m_mismatches;
+}
@@ -0,0 +1,157 @@
+#ifndef RAW_RECORDING_H
+#define RAW_RECORDING_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "collector.h"
+
+// Gravacao das leituras brutas de um coletor, para reproduzir depois as
+// mesmas contas do SystemMonitor sem o sistema por baixo.
+//
+// Arquivo: "PCRR" + byte de versao, seguido de registros, um por chamada ao
+// coletor e na mesma ordem: tipo (1 byte), tamanho (varint) e corpo. Os
+// corpos usam varints; tempos de CPU, memoria e contadores vao como delta
+// da leitura anterior do mesmo PID (ou nucleo), e metadados e caminhos de
+// cgroup so na primeira vez que aparecem.
+namespace raw_recording {
+
+const uint8_t FORMAT_VERSION = 1;
+
+enum RecordType : uint8_t {
+    RECORD_CPU_TIMES = 1,
+    RECORD_SYSTEM,
+    RECORD_PROCESSES,
+    RECORD_THREADS
+};
+
+}
+
+struct VarintReader;
+
+// Valores da leitura anterior, base dos deltas. O gravador e o reprodutor
+// mantem o mesmo estado, registro a registro.
+struct RawRecordBase {
+    struct Process {
+        unsigned long long startTime = 0;
+        unsigned long long memoryUsedBytes = 0;
+        unsigned long long kernelTime = 0;
+        unsigned long long userTime = 0;
+        unsigned long long counters[PROCESS_COUNTER_COUNT] = {};
+        uint32_t generation = 0;
+    };
+
+    long long timeNs = 0;
+    unsigned long long cpuTotalTime = 0;
+    unsigned long long cpuIdleTime = 0;
+    unsigned long long cpuStateTimes[RAW_CPU_FIELDS] = {};
+    RawCpuCores cores;
+    std::unordered_map<unsigned long, Process> processes;
+    uint32_t generation = 0;
+
+    Process& process(unsigned long pid);
+    // Esquece os PIDs que nao apareceram no ultimo registro de processos.
+    void prune();
+};
+
+// Repassa tudo para o coletor de verdade e grava cada leitura.
+class RecordingCollector : public Collector {
+public:
+    explicit RecordingCollector(std::unique_ptr<Collector> inner);
+    ~RecordingCollector() override;
+
+    bool open(const std::string& path);
+    unsigned long long bytesWritten() const { return m_bytesWritten; }
+
+    bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) override;
+    void sampleSystem(RawSample& out) override;
+    void sampleProcesses(RawSample& out) override;
+    void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) override;
+    bool enableLifecycleEvents() override { return m_inner->enableLifecycleEvents(); }
+    ExtraProcessInfo readExtraProcessInfo(unsigned long pid) override { return m_inner->readExtraProcessInfo(pid); }
+    SignalResult signalProcess(unsigned long pid, unsigned long long startTime, ProcessSignal signal) override {
+        return m_inner->signalProcess(pid, startTime, signal);
+    }
+    unsigned long long readStartTime(unsigned long pid) override { return m_inner->readStartTime(pid); }
+    std::chrono::steady_clock::time_point now() override { return m_now; }
+
+private:
+    struct Metadata {
+        uint32_t id = 0;
+        // Segura o objeto: enquanto esta aqui, o endereco nao e reaproveitado.
+        ProcessMetadataRef ref;
+    };
+
+    void stamp();
+    void writeRecord(raw_recording::RecordType type);
+    void encodeMetadata(const ProcessMetadataRef& metadata);
+    void encodeString(const std::string& value);
+
+    std::unique_ptr<Collector> m_inner;
+    FILE* m_file = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_now;
+    RawRecordBase m_base;
+    std::unordered_map<const ProcessMetadata*, Metadata> m_metadata;
+    uint32_t m_nextMetadataId = 1;
+    std::vector<uint32_t> m_releasedMetadata;
+    std::unordered_map<std::string, uint32_t> m_cgroupIds;
+    std::vector<uint8_t> m_body;
+    std::vector<uint8_t> m_record;
+    unsigned long long m_bytesWritten = 0;
+};
+
+// Devolve as leituras de uma gravacao, na ordem em que foram feitas, o mais
+// rapido possivel: o arquivo inteiro e carregado em open(). Rodar o
+// SystemMonitor com collectNow(nextTiers()) ate finished() refaz as mesmas
+// contas da execucao gravada.
+class ReplayCollector : public Collector {
+public:
+    ReplayCollector();
+
+    bool open(const std::string& path);
+    // Camadas (TickScheduler::TIER_*) do proximo tick gravado; 0 no fim.
+    unsigned nextTiers() const;
+    bool finished() const { return m_cursor >= m_records.size(); }
+    // Volta ao primeiro registro, para repetir a gravacao num monitor novo.
+    void rewind();
+    size_t recordCount() const { return m_records.size(); }
+    // Chamadas que nao bateram com o proximo registro gravado, e registros
+    // corrompidos.
+    unsigned long long mismatches() const { return m_mismatches; }
+
+    bool readCpuTimes(unsigned long long& totalTime, unsigned long long& idleTime) override;
+    void sampleSystem(RawSample& out) override;
+    void sampleProcesses(RawSample& out) override;
+    void sampleThreads(RawSample& out, const std::vector<unsigned long>& pids) override;
+    ExtraProcessInfo readExtraProcessInfo(unsigned long) override { return ExtraProcessInfo(); }
+    SignalResult signalProcess(unsigned long, unsigned long long, ProcessSignal) override { return SIGNAL_UNSUPPORTED; }
+    unsigned long long readStartTime(unsigned long) override { return 0; }
+    std::chrono::steady_clock::time_point now() override;
+
+private:
+    struct Record {
+        raw_recording::RecordType type;
+        size_t offset;
+        size_t size;
+    };
+
+    // O proximo registro, se for do tipo pedido; senao conta a divergencia.
+    const Record* take(raw_recording::RecordType type);
+    std::string decodeString(VarintReader& in);
+
+    std::vector<uint8_t> m_data;
+    std::vector<Record> m_records;
+    size_t m_cursor = 0;
+    unsigned long long m_mismatches = 0;
+    RawRecordBase m_base;
+    std::unordered_map<uint32_t, ProcessMetadataRef> m_metadata;
+    std::vector<InternedName> m_cgroupPaths;
+    NameInterner m_names;
+};
+
+#endif
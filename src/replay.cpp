@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "backend.h"
+#include "raw_recording.h"
+#include "stream_format.h"
+
+// Reproduz uma gravacao do MeuMonitorHeadless -w num SystemMonitor, sem
+// agendador e sem esperas: mede quantos ticks por segundo o processamento
+// (deltas, diff, cgroups, ordenacao, publicacao) aguenta, com as mesmas
+// entradas a cada execucao.
+static void printUsage(const char* argv0) {
+    fprintf(stderr,
+        "Uso: %s arquivo [-n repeticoes] [-o stream]\n"
+        "  -n repeticoes  reproduz a gravacao N vezes, cada uma num monitor novo (padrao: 1)\n"
+        "  -o stream      grava o stream binario da ultima repeticao, um frame por tick\n",
+        argv0);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    const char* recordingPath = argv[1];
+    unsigned long repetitions = 1;
+    const char* outputPath = nullptr;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            repetitions = std::max(1UL, strtoul(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        }
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> buffer;
+    unsigned long long ticks = 0, mismatches = 0;
+    double seconds = 0.0;
+    MonitorDiagnostics diagnostics;
+    for (unsigned long repetition = 0; repetition < repetitions; ++repetition) {
+        std::unique_ptr<ReplayCollector> replay(new ReplayCollector());
+        if (!replay->open(recordingPath)) {
+            fprintf(stderr, "Gravacao invalida ou ausente: %s\n", recordingPath);
+            return 1;
+        }
+        ReplayCollector& collector = *replay;
+        bool encode = outputPath != nullptr && repetition + 1 == repetitions;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        SystemMonitor monitor(std::move(replay));
+        StreamEncoder encoder;
+        if (encode) stream_format::writeHeader(buffer);
+        while (!collector.finished()) {
+            unsigned tiers = collector.nextTiers();
+            if (tiers == 0) {
+                // Registro fora de ordem: pula para nao ficar parado nele.
+                unsigned long long dummyTotal, dummyIdle;
+                collector.readCpuTimes(dummyTotal, dummyIdle);
+                continue;
+            }
+            monitor.collectNow(tiers);
+            ++ticks;
+            if (encode) encoder.encodeTick(*monitor.getLatestSnapshot(), buffer);
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        mismatches += collector.mismatches();
+        diagnostics = monitor.getLatestSnapshot()->diagnostics;
+    }
+
+    if (outputPath != nullptr) {
+        FILE* out = fopen(outputPath, "wb");
+        if (out == nullptr || fwrite(buffer.data(), 1, buffer.size(), out) != buffer.size()) {
+            fprintf(stderr, "Falha ao gravar %s\n", outputPath);
+            if (out != nullptr) fclose(out);
+            return 1;
+        }
+        fclose(out);
+    }
+
+    fprintf(stderr, "%llu ticks em %.3f s (%.0f ticks/s), %lu repeticoes, %llu divergencias\n",
+        ticks, seconds, seconds > 0.0 ? ticks / seconds : 0.0, repetitions, mismatches);
+    for (unsigned phase = 0; phase < PHASE_COUNT; ++phase) {
+        const PhaseHistogram& histogram = diagnostics.phases[phase];
+        if (histogram.samples == 0) continue;
+        fprintf(stderr, "  %-22s %8llu x  media %8.3f  p50 %8.3f  p99 %8.3f  max %8.3f ms\n",
+            phaseName((TickPhase)phase), histogram.samples, histogram.meanMs(),
+            histogram.percentileMs(0.50), histogram.percentileMs(0.99), histogram.maxMs);
+    }
+    return mismatches == 0 ? 0 : 2;
+}
@@ -0,0 +1,87 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+static const unsigned FAST_TICKS_TO_RECOVER = 5;
+
+TickScheduler::TickScheduler(const SchedulerConfig& config) :
+    m_config(config)
+{
+    const std::chrono::milliseconds periods[TIER_COUNT] = {
+        config.systemPeriod, config.processPeriod, config.threadPeriod
+    };
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        Clock::duration period = std::max<Clock::duration>(periods[i], std::chrono::milliseconds(1));
+        m_tiers[i].configured = period;
+        m_tiers[i].effective = period;
+    }
+    m_config.maxBackoff = std::max(m_config.maxBackoff, 1u);
+    updateStats();
+}
+
+void TickScheduler::start(Clock::time_point now) {
+    for (TierState& tier : m_tiers) {
+        tier.deadline = now;
+    }
+}
+
+TickScheduler::Clock::time_point TickScheduler::nextDeadline() const {
+    Clock::time_point next = m_tiers[0].deadline;
+    for (const TierState& tier : m_tiers) {
+        next = std::min(next, tier.deadline);
+    }
+    return next;
+}
+
+unsigned TickScheduler::dueTiers(Clock::time_point now) const {
+    unsigned due = 0;
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        if (m_tiers[i].deadline <= now) {
+            due |= 1u << i;
+        }
+    }
+    return due;
+}
+
+void TickScheduler::complete(unsigned tiers, const Clock::duration (&tierWork)[TIER_COUNT],
+    Clock::time_point tickStart, Clock::time_point tickEnd) {
+    for (int i = 0; i < TIER_COUNT; ++i) {
+        if ((tiers & (1u << i)) == 0) continue;
+        TierState& tier = m_tiers[i];
+
+        if (m_config.adaptive) {
+            Clock::duration work = tierWork[i];
+            if (work > tier.effective) {
+                tier.effective = std::min(tier.effective * 2, tier.configured * m_config.maxBackoff);
+                tier.fastTicks = 0;
+            }
+            else if (work * 4 < tier.effective && tier.effective > tier.configured) {
+                if (++tier.fastTicks >= FAST_TICKS_TO_RECOVER) {
+                    tier.effective = std::max(tier.effective / 2, tier.configured);
+                    tier.fastTicks = 0;
+                }
+            }
+            else {
+                tier.fastTicks = 0;
+            }
+        }
+
+        tier.deadline += tier.effective;
+        if (tier.deadline <= tickEnd) {
+            Clock::duration late = tickEnd - tier.deadline;
+            unsigned long long missed = (unsigned long long)(late / tier.effective) + 1;
+            tier.deadline += tier.effective * (Clock::duration::rep)missed;
+            m_stats.missedDeadlines += missed;
+        }
+    }
+
+    m_stats.ticks++;
+    m_stats.lastTickMs = std::chrono::duration<double, std::milli>(tickEnd - tickStart).count();
+    updateStats();
+}
+
+void TickScheduler::updateStats() {
+    m_stats.systemPeriodMs = std::chrono::duration<double, std::milli>(m_tiers[0].effective).count();
+    m_stats.processPeriodMs = std::chrono::duration<double, std::milli>(m_tiers[1].effective).count();
+    m_stats.threadPeriodMs = std::chrono::duration<double, std::milli>(m_tiers[2].effective).count();
+}
@@ -0,0 +1,61 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+
+#include "system_info.h"
+
+struct SchedulerConfig {
+    std::chrono::milliseconds systemPeriod{ 1000 };
+    std::chrono::milliseconds processPeriod{ 1000 };
+    std::chrono::milliseconds threadPeriod{ 1000 };
+    // Se a coleta de uma camada passa do periodo dela, o periodo dobra (ate
+    // maxBackoff vezes o configurado) e volta aos poucos quando sobra folga.
+    bool adaptive = false;
+    unsigned maxBackoff = 8;
+};
+
+// Agenda as camadas de coleta por prazos absolutos: o proximo prazo e o
+// anterior mais um periodo, e nao "agora + periodo", entao o tempo gasto na
+// coleta nao se acumula como deriva. Prazos perdidos sao pulados e contados.
+class TickScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum Tier : unsigned {
+        TIER_SYSTEM = 1,
+        TIER_PROCESSES = 2,
+        TIER_THREADS = 4
+    };
+    static const int TIER_COUNT = 3;
+
+    explicit TickScheduler(const SchedulerConfig& config);
+
+    // Todas as camadas vencem imediatamente em `now`.
+    void start(Clock::time_point now);
+    Clock::time_point nextDeadline() const;
+    unsigned dueTiers(Clock::time_point now) const;
+    // Registra um tick que rodou as camadas `tiers` entre tickStart e tickEnd;
+    // tierWork[i] e o tempo gasto so na camada 1 << i. Cada camada recua
+    // pelo proprio custo, nao pelo das outras que cairam no mesmo tick.
+    void complete(unsigned tiers, const Clock::duration (&tierWork)[TIER_COUNT],
+        Clock::time_point tickStart, Clock::time_point tickEnd);
+
+    const SchedulerStats& stats() const { return m_stats; }
+
+private:
+    struct TierState {
+        Clock::duration configured;
+        Clock::duration effective;
+        Clock::time_point deadline;
+        unsigned fastTicks = 0;
+    };
+
+    void updateStats();
+
+    SchedulerConfig m_config;
+    TierState m_tiers[TIER_COUNT];
+    SchedulerStats m_stats;
+};
+
+#endif
@@ -0,0 +1,131 @@
+#include "snapshot_diff.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const uint8_t ALL_FIELDS = CHANGE_ADDED | CHANGE_NAME | CHANGE_CPU | CHANGE_MEMORY | CHANGE_THREADS | CHANGE_RATES;
+
+bool SnapshotDiffer::rateChanged(double current, double published) const {
+    double limit = std::max(m_thresholds.rateAbsolute, m_thresholds.rateRatio * std::max(current, published));
+    return std::fabs(current - published) > limit;
+}
+
+uint8_t SnapshotDiffer::compare(const ProcessInfo& current, const ProcessInfo& published) const {
+    uint8_t fields = 0;
+    if (current.metadata != published.metadata || !(current.name == published.name)) {
+        fields |= CHANGE_NAME;
+    }
+    if (std::fabs(current.cpuUsagePercentage - published.cpuUsagePercentage) > m_thresholds.cpuPercent) {
+        fields |= CHANGE_CPU;
+    }
+    unsigned long long memoryDelta = current.memoryUsedBytes > published.memoryUsedBytes ?
+        current.memoryUsedBytes - published.memoryUsedBytes : published.memoryUsedBytes - current.memoryUsedBytes;
+    double memoryLimit = std::max((double)m_thresholds.memoryBytes, m_thresholds.memoryRatio * published.memoryUsedBytes);
+    if ((double)memoryDelta > memoryLimit) {
+        fields |= CHANGE_MEMORY;
+    }
+    if (current.threadCount != published.threadCount) {
+        fields |= CHANGE_THREADS;
+    }
+    if (current.ratesValid != published.ratesValid) {
+        fields |= CHANGE_RATES;
+    }
+    else {
+        for (unsigned c = 0; c < PROCESS_COUNTER_COUNT; ++c) {
+            if ((current.ratesValid & (1u << c)) && rateChanged(current.rates[c], published.rates[c])) {
+                fields |= CHANGE_RATES;
+                break;
+            }
+        }
+    }
+    return fields;
+}
+
+void SnapshotDiffer::update(std::vector<ProcessInfo>& processes, unsigned long long fromListVersion,
+    unsigned long long toListVersion, SnapshotDiff& diff) {
+    ++m_generation;
+    diff.fromListVersion = fromListVersion;
+    diff.toListVersion = toListVersion;
+    diff.changes.clear();
+    diff.removed.clear();
+    diff.added = 0;
+    diff.unchanged = 0;
+
+    for (ProcessInfo& p : processes) {
+        // isNew decide entre CHANGE_ADDED e a comparacao com o publicado.
+        auto it = m_published.find(p.pid);
+        bool isNew = it == m_published.end();
+        if (isNew) {
+            it = m_published.emplace(p.pid, Published()).first;
+        }
+        Published& published = it->second;
+        published.generation = m_generation;
+
+        // PID reaproveitado: sai o processo antigo e entra um novo, sem herdar
+        // os valores publicados do anterior.
+        if (!isNew && published.process.startTime != p.startTime) {
+            diff.removed.push_back(p.pid);
+            isNew = true;
+        }
+
+        uint8_t fields = ALL_FIELDS;
+        if (!isNew) {
+            fields = compare(p, published.process);
+            // Dentro da zona morta o valor publicado continua valendo.
+            if (!(fields & CHANGE_CPU)) {
+                p.cpuUsagePercentage = published.process.cpuUsagePercentage;
+                p.cpuCorePercentage = published.process.cpuCorePercentage;
+            }
+            if (!(fields & CHANGE_MEMORY)) {
+                p.memoryUsedBytes = published.process.memoryUsedBytes;
+            }
+            if (!(fields & CHANGE_RATES)) {
+                std::copy(published.process.rates, published.process.rates + PROCESS_COUNTER_COUNT, p.rates);
+            }
+        }
+        if (fields == 0) {
+            ++diff.unchanged;
+            continue;
+        }
+
+        published.process = p;
+        diff.changes.emplace_back();
+        ProcessChange& change = diff.changes.back();
+        change.fields = fields;
+        change.process = p;
+        if (isNew) ++diff.added;
+    }
+
+    for (auto it = m_published.begin(); it != m_published.end();) {
+        if (it->second.generation != m_generation) {
+            diff.removed.push_back(it->first);
+            it = m_published.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    std::sort(diff.changes.begin(), diff.changes.end(), [](const ProcessChange& a, const ProcessChange& b) {
+        return a.process.pid < b.process.pid;
+        });
+    std::sort(diff.removed.begin(), diff.removed.end());
+}
+
+bool DiffSubscription::take(std::vector<std::shared_ptr<const SnapshotDiff>>& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.insert(out.end(), m_pending.begin(), m_pending.end());
+    m_pending.clear();
+    bool complete = !m_overflowed;
+    m_overflowed = false;
+    return complete;
+}
+
+void DiffSubscription::push(const std::shared_ptr<const SnapshotDiff>& diff) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending.size() >= m_capacity) {
+        m_pending.clear();
+        m_overflowed = true;
+    }
+    m_pending.push_back(diff);
+}
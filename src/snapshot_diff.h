@@ -0,0 +1,122 @@
+#ifndef SNAPSHOT_DIFF_H
+#define SNAPSHOT_DIFF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "system_info.h"
+
+// Campos que mudaram num processo entre duas listas.
+enum ProcessChangeField : uint8_t {
+    CHANGE_ADDED = 1,
+    // Nome ou metadados (exec).
+    CHANGE_NAME = 2,
+    CHANGE_CPU = 4,
+    CHANGE_MEMORY = 8,
+    CHANGE_THREADS = 16,
+    CHANGE_RATES = 32
+};
+
+// Zona morta de cada campo: variacoes menores que o limiar nao contam como
+// mudanca e o valor publicado fica o anterior. Tudo zero = qualquer variacao.
+struct DiffThresholds {
+    // Pontos percentuais da maquina (cpuUsagePercentage).
+    double cpuPercent = 0.1;
+    // A memoria muda se variar mais que o maior dos dois.
+    unsigned long long memoryBytes = 256 * 1024;
+    double memoryRatio = 0.001;
+    // Taxas por segundo: o maior entre rateAbsolute e rateRatio do valor.
+    double rateAbsolute = 1.0;
+    double rateRatio = 0.05;
+
+    static DiffThresholds exact() {
+        DiffThresholds thresholds;
+        thresholds.cpuPercent = 0.0;
+        thresholds.memoryBytes = 0;
+        thresholds.memoryRatio = 0.0;
+        thresholds.rateAbsolute = 0.0;
+        thresholds.rateRatio = 0.0;
+        return thresholds;
+    }
+};
+
+struct ProcessChange {
+    // Mascara de ProcessChangeField; processos novos tem todos os bits.
+    uint8_t fields = 0;
+    // Valores publicados na lista nova.
+    ProcessInfo process;
+};
+
+// O que mudou na lista de processos de fromListVersion para toListVersion.
+// fromListVersion == 0 marca um diff sem base (primeira lista): quem o
+// recebe deve montar o estado a partir do snapshot, nao do diff.
+struct SnapshotDiff {
+    unsigned long long fromListVersion = 0;
+    unsigned long long toListVersion = 0;
+    // Ordenados por PID. changes inclui os adicionados (CHANGE_ADDED). Um
+    // PID reaproveitado (outro startTime) aparece nos dois: o processo antigo
+    // em removed e o novo como adicionado; removed vale antes de changes.
+    std::vector<ProcessChange> changes;
+    std::vector<unsigned long> removed;
+    // Saidas percebidas entre as duas listas (o exitedProcesses da nova). Quem
+    // segue os diffs recebe todas, mesmo pulando snapshots.
+    std::vector<ProcessExit> exits;
+    size_t added = 0;
+    size_t unchanged = 0;
+
+    bool empty() const { return changes.empty() && removed.empty(); }
+};
+
+// Compara cada lista nova com os valores publicados na anterior. Os campos
+// que variaram menos que o limiar voltam ao valor publicado, entao o
+// snapshot e o diff concordam: um processo fora de changes tem exatamente os
+// mesmos valores da lista anterior. So a thread de coleta usa.
+class SnapshotDiffer {
+public:
+    void setThresholds(const DiffThresholds& thresholds) { m_thresholds = thresholds; }
+    const DiffThresholds& thresholds() const { return m_thresholds; }
+
+    // processes: a lista nova, ajustada no lugar; diff e reescrito.
+    void update(std::vector<ProcessInfo>& processes, unsigned long long fromListVersion,
+        unsigned long long toListVersion, SnapshotDiff& diff);
+
+private:
+    struct Published {
+        ProcessInfo process;
+        uint32_t generation = 0;
+    };
+
+    uint8_t compare(const ProcessInfo& current, const ProcessInfo& published) const;
+    bool rateChanged(double current, double published) const;
+
+    DiffThresholds m_thresholds;
+    std::unordered_map<unsigned long, Published> m_published;
+    uint32_t m_generation = 0;
+};
+
+// Fila de diffs de um consumidor. O coletor nunca espera: se a fila enche,
+// os diffs pendentes sao descartados e take() avisa, e o consumidor
+// recomeca de um snapshot (getLatestSnapshot) e ignora os diffs com
+// toListVersion ate a lista desse snapshot.
+class DiffSubscription {
+public:
+    explicit DiffSubscription(size_t capacity) : m_capacity(capacity ? capacity : 1) {}
+
+    // Anexa a out os diffs pendentes, em ordem. Devolve false se algum foi
+    // descartado desde a ultima chamada.
+    bool take(std::vector<std::shared_ptr<const SnapshotDiff>>& out);
+    void push(const std::shared_ptr<const SnapshotDiff>& diff);
+
+private:
+    std::mutex m_mutex;
+    std::deque<std::shared_ptr<const SnapshotDiff>> m_pending;
+    size_t m_capacity;
+    bool m_overflowed = false;
+};
+
+#endif
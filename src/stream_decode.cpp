@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "stream_format.h"
+
+// Converte o stream do MeuMonitorHeadless de volta para texto.
+int main(int argc, char** argv) {
+    bool summaryOnly = false;
+    const char* inputPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-r") == 0) {
+            summaryOnly = true;
+        }
+        else if (inputPath == nullptr && argv[i][0] != '-') {
+            inputPath = argv[i];
+        }
+        else {
+            fprintf(stderr, "Uso: %s [-r] [arquivo]\n  -r  apenas o resumo de cada tick\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* in = stdin;
+    if (inputPath != nullptr) {
+        in = fopen(inputPath, "rb");
+        if (in == nullptr) {
+            fprintf(stderr, "Falha ao abrir %s\n", inputPath);
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    else {
+        _setmode(_fileno(stdin), _O_BINARY);
+    }
+#endif
+
+    if (!stream_format::readHeader(in)) {
+        fprintf(stderr, "Cabecalho invalido\n");
+        return 1;
+    }
+
+    StreamDecoder decoder;
+    std::vector<uint8_t> frame;
+    SystemInfo info;
+    int status = 0;
+
+    while (stream_format::readFrame(in, frame)) {
+        if (!decoder.decodeTick(frame, info)) {
+            fprintf(stderr, "Frame invalido apos a versao %llu\n", info.version);
+            status = 1;
+            break;
+        }
+
+        printf("tick %llu t=%llu ram=%llu/%llu (%.2f%%) cpu=%.2f%% processos=%zu frame=%zu bytes\n",
+            info.version, info.timestampMs, info.ramUsedBytes, info.ramTotalBytes,
+            info.ramUsagePercentage, info.cpuLoadPercentage, info.processes.size(), frame.size());
+        if (summaryOnly) continue;
+
+        for (const ProcessInfo& p : info.processes) {
+            printf("  %8lu %-24s %6.2f%% %14llu\n", p.pid, p.name.c_str(), p.cpuUsagePercentage, p.memoryUsedBytes);
+        }
+        for (const FocusedProcessInfo& focused : info.focusedProcesses) {
+            printf("  foco %8lu: %zu threads\n", focused.pid, focused.threads.size());
+            for (const ThreadInfo& t : focused.threads) {
+                printf("    thread %8lu %6.2f%%\n", t.tid, t.cpuUsagePercentage);
+            }
+        }
+    }
+
+    // readFrame parou antes do fim: tamanho de frame impossivel.
+    if (status == 0 && !feof(in)) {
+        fprintf(stderr, "Frame com tamanho invalido apos a versao %llu\n", info.version);
+        status = 1;
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+    return status;
+}
@@ -0,0 +1,309 @@
+#include "stream_format.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "varint.h"
+
+static const char MAGIC[4] = { 'P', 'C', 'H', 'K' };
+// Bem acima de um frame completo com 100k processos; um tamanho maior so vem
+// de um stream corrompido.
+static const uint64_t MAX_FRAME_SIZE = 64ull << 20;
+
+static int64_t toCenti(double value) {
+    return (int64_t)std::llround(value * 100.0);
+}
+
+namespace stream_format {
+
+void writeHeader(std::vector<uint8_t>& out) {
+    out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    out.push_back(FORMAT_VERSION);
+}
+
+bool readHeader(FILE* in) {
+    uint8_t header[sizeof(MAGIC) + 1];
+    if (fread(header, 1, sizeof(header), in) != sizeof(header)) return false;
+    return std::equal(MAGIC, MAGIC + sizeof(MAGIC), (const char*)header) &&
+        header[sizeof(MAGIC)] == FORMAT_VERSION;
+}
+
+bool readFrame(FILE* in, std::vector<uint8_t>& frame) {
+    uint64_t size = 0;
+    for (int shift = 0;; shift += 7) {
+        int c = fgetc(in);
+        if (c == EOF || shift >= 64) return false;
+        size |= (uint64_t)(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) break;
+    }
+    if (size > MAX_FRAME_SIZE) return false;
+    frame.resize((size_t)size);
+    return fread(frame.data(), 1, frame.size(), in) == frame.size();
+}
+
+}
+
+uint32_t StreamEncoder::internName(const std::string& name) {
+    auto it = m_nameIds.find(name);
+    if (it != m_nameIds.end()) return it->second;
+    uint32_t id = (uint32_t)m_nameIds.size();
+    m_nameIds.emplace(name, id);
+    m_newNames.push_back(name);
+    return id;
+}
+
+bool StreamEncoder::encodeProcess(const ProcessInfo& p, EncodedProcess& state, bool isNew, unsigned long& lastPid) {
+    uint32_t nameId = internName(p.name);
+    int64_t cpuCenti = toCenti(p.cpuUsagePercentage);
+
+    uint8_t mask = 0;
+    if (isNew || nameId != state.nameId) mask |= stream_format::FIELD_NAME;
+    if (isNew || p.memoryUsedBytes != state.memoryUsedBytes) mask |= stream_format::FIELD_MEMORY;
+    if (isNew || cpuCenti != state.cpuCenti) mask |= stream_format::FIELD_CPU;
+    if (mask == 0) return false;
+
+    std::vector<uint8_t>& changes = m_changes;
+    putVarint(changes, p.pid - lastPid);
+    lastPid = p.pid;
+    changes.push_back(mask);
+    if (mask & stream_format::FIELD_NAME) putVarint(changes, nameId);
+    if (mask & stream_format::FIELD_MEMORY) putSigned(changes, (int64_t)(p.memoryUsedBytes - state.memoryUsedBytes));
+    if (mask & stream_format::FIELD_CPU) putSigned(changes, cpuCenti - state.cpuCenti);
+
+    state.nameId = nameId;
+    state.memoryUsedBytes = p.memoryUsedBytes;
+    state.cpuCenti = cpuCenti;
+    return true;
+}
+
+void StreamEncoder::encodeTick(const SystemInfo& info, std::vector<uint8_t>& out) {
+    ++m_tick;
+    m_newNames.clear();
+    m_removed.clear();
+
+    m_sorted.clear();
+    for (const ProcessInfo& p : info.processes) {
+        m_sorted.push_back(&p);
+    }
+    std::sort(m_sorted.begin(), m_sorted.end(), [](const ProcessInfo* a, const ProcessInfo* b) {
+        return a->pid < b->pid;
+        });
+
+    // Os processos alterados vao para um buffer a parte porque a secao de
+    // nomes novos, que vem antes no frame, so e conhecida depois desta passada.
+    m_changes.clear();
+    uint64_t changedCount = 0;
+    unsigned long lastPid = 0;
+
+    for (const ProcessInfo* p : m_sorted) {
+        // Sem entrada anterior o processo vai inteiro para o frame.
+        auto it = m_processes.find(p->pid);
+        bool isNew = it == m_processes.end();
+        if (isNew) {
+            it = m_processes.emplace(p->pid, EncodedProcess()).first;
+        }
+        it->second.tick = m_tick;
+        if (encodeProcess(*p, it->second, isNew, lastPid)) ++changedCount;
+    }
+
+    for (auto it = m_processes.begin(); it != m_processes.end();) {
+        if (it->second.tick != m_tick) {
+            m_removed.push_back(it->first);
+            it = m_processes.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    std::sort(m_removed.begin(), m_removed.end());
+
+    finishFrame(info, changedCount, out);
+}
+
+// Cada diff ja vem ordenado por PID, mas um PID pode aparecer em varios
+// (mudou, saiu, voltou); so a ultima mencao vale para o frame.
+void StreamEncoder::encodeTick(const SystemInfo& info, const std::vector<std::shared_ptr<const SnapshotDiff>>& diffs,
+    std::vector<uint8_t>& out) {
+    ++m_tick;
+    m_newNames.clear();
+    m_removed.clear();
+
+    m_dirty.clear();
+    for (size_t sequence = 0; sequence < diffs.size(); ++sequence) {
+        const SnapshotDiff& diff = *diffs[sequence];
+        for (unsigned long pid : diff.removed) {
+            m_dirty.push_back(DirtyProcess{ pid, sequence, nullptr });
+        }
+        for (const ProcessChange& change : diff.changes) {
+            m_dirty.push_back(DirtyProcess{ change.process.pid, sequence, &change.process });
+        }
+    }
+    if (diffs.size() > 1) {
+        std::sort(m_dirty.begin(), m_dirty.end(), [](const DirtyProcess& a, const DirtyProcess& b) {
+            if (a.pid != b.pid) return a.pid < b.pid;
+            if (a.sequence != b.sequence) return a.sequence < b.sequence;
+            // PID reaproveitado no mesmo diff: a saida antes da entrada.
+            return a.process == nullptr && b.process != nullptr;
+            });
+    }
+    else {
+        // Um diff so: removidos e alterados ja estao em ordem; basta
+        // intercalar. O merge e estavel, entao um PID reaproveitado fica com a
+        // mencao de changes por ultimo.
+        std::inplace_merge(m_dirty.begin(), m_dirty.begin() + (diffs.empty() ? 0 : diffs[0]->removed.size()),
+            m_dirty.end(), [](const DirtyProcess& a, const DirtyProcess& b) { return a.pid < b.pid; });
+    }
+
+    m_changes.clear();
+    uint64_t changedCount = 0;
+    unsigned long lastPid = 0;
+
+    for (size_t i = 0; i < m_dirty.size(); ++i) {
+        const DirtyProcess& dirty = m_dirty[i];
+        if (i + 1 < m_dirty.size() && m_dirty[i + 1].pid == dirty.pid) continue;
+
+        if (dirty.process == nullptr) {
+            // Pode ter entrado e saido entre dois frames sem nunca ser enviado.
+            if (m_processes.erase(dirty.pid) != 0) m_removed.push_back(dirty.pid);
+            continue;
+        }
+        auto it = m_processes.find(dirty.pid);
+        bool isNew = it == m_processes.end();
+        if (isNew) {
+            it = m_processes.emplace(dirty.pid, EncodedProcess()).first;
+        }
+        if (encodeProcess(*dirty.process, it->second, isNew, lastPid)) ++changedCount;
+    }
+
+    finishFrame(info, changedCount, out);
+}
+
+void StreamEncoder::finishFrame(const SystemInfo& info, uint64_t changedCount, std::vector<uint8_t>& out) {
+    int64_t ramCenti = toCenti(info.ramUsagePercentage);
+    int64_t cpuCenti = toCenti(info.cpuLoadPercentage);
+
+    std::vector<uint8_t>& header = m_header;
+    header.clear();
+    putSigned(header, (int64_t)(info.timestampMs - m_last.timestampMs));
+    putSigned(header, (int64_t)(info.version - m_last.version));
+    putSigned(header, (int64_t)(info.ramTotalBytes - m_last.ramTotalBytes));
+    putSigned(header, (int64_t)(info.ramUsedBytes - m_last.ramUsedBytes));
+    putSigned(header, ramCenti - m_lastRamCenti);
+    putSigned(header, cpuCenti - m_lastCpuCenti);
+
+    putVarint(header, m_newNames.size());
+    for (const std::string& name : m_newNames) {
+        putVarint(header, name.size());
+        header.insert(header.end(), name.begin(), name.end());
+    }
+
+    putVarint(header, m_removed.size());
+    unsigned long lastRemoved = 0;
+    for (unsigned long pid : m_removed) {
+        putVarint(header, pid - lastRemoved);
+        lastRemoved = pid;
+    }
+
+    putVarint(header, changedCount);
+
+    std::vector<uint8_t>& threads = m_threads;
+    threads.clear();
+    putVarint(threads, info.focusedProcesses.size());
+    for (const FocusedProcessInfo& focused : info.focusedProcesses) {
+        putVarint(threads, focused.pid);
+        putVarint(threads, focused.threads.size());
+        for (const ThreadInfo& t : focused.threads) {
+            putVarint(threads, t.tid);
+            putVarint(threads, (uint64_t)toCenti(t.cpuUsagePercentage));
+        }
+    }
+
+    putVarint(out, header.size() + m_changes.size() + threads.size());
+    out.insert(out.end(), header.begin(), header.end());
+    out.insert(out.end(), m_changes.begin(), m_changes.end());
+    out.insert(out.end(), threads.begin(), threads.end());
+
+    m_last.timestampMs = info.timestampMs;
+    m_last.version = info.version;
+    m_last.ramTotalBytes = info.ramTotalBytes;
+    m_last.ramUsedBytes = info.ramUsedBytes;
+    m_lastRamCenti = ramCenti;
+    m_lastCpuCenti = cpuCenti;
+}
+
+bool StreamDecoder::decodeTick(const std::vector<uint8_t>& frame, SystemInfo& out) {
+    VarintReader in{ frame.data(), frame.data() + frame.size() };
+
+    m_last.timestampMs += (unsigned long long)in.signedVarint();
+    m_last.version += (unsigned long long)in.signedVarint();
+    m_last.ramTotalBytes += (unsigned long long)in.signedVarint();
+    m_last.ramUsedBytes += (unsigned long long)in.signedVarint();
+    m_lastRamCenti += in.signedVarint();
+    m_lastCpuCenti += in.signedVarint();
+
+    uint64_t newNames = in.varint();
+    for (uint64_t i = 0; i < newNames && in.ok; ++i) {
+        uint64_t size = in.varint();
+        if (size > (uint64_t)(in.end - in.p)) return false;
+        m_names.emplace_back(std::string((const char*)in.p, (size_t)size));
+        in.p += size;
+    }
+
+    uint64_t removed = in.varint();
+    unsigned long pid = 0;
+    for (uint64_t i = 0; i < removed && in.ok; ++i) {
+        pid += (unsigned long)in.varint();
+        m_processes.erase(pid);
+    }
+
+    uint64_t changed = in.varint();
+    pid = 0;
+    for (uint64_t i = 0; i < changed && in.ok; ++i) {
+        pid += (unsigned long)in.varint();
+        if (in.p == in.end) return false;
+        uint8_t mask = *in.p++;
+        DecodedProcess& state = m_processes[pid];
+        if (mask & stream_format::FIELD_NAME) state.nameId = (uint32_t)in.varint();
+        if (mask & stream_format::FIELD_MEMORY) state.memoryUsedBytes += (unsigned long long)in.signedVarint();
+        if (mask & stream_format::FIELD_CPU) state.cpuCenti += in.signedVarint();
+        if (state.nameId >= m_names.size()) return false;
+    }
+
+    out.focusedProcesses.clear();
+    uint64_t focusedCount = in.varint();
+    for (uint64_t i = 0; i < focusedCount && in.ok; ++i) {
+        FocusedProcessInfo focused;
+        focused.pid = (unsigned long)in.varint();
+        uint64_t threads = in.varint();
+        for (uint64_t j = 0; j < threads && in.ok; ++j) {
+            ThreadInfo t;
+            t.tid = (unsigned long)in.varint();
+            t.cpuUsagePercentage = in.varint() / 100.0;
+            focused.threads.push_back(t);
+        }
+        out.focusedProcesses.push_back(focused);
+    }
+    if (!in.ok) return false;
+
+    out.timestampMs = m_last.timestampMs;
+    out.version = m_last.version;
+    out.ramTotalBytes = m_last.ramTotalBytes;
+    out.ramUsedBytes = m_last.ramUsedBytes;
+    out.ramUsagePercentage = m_lastRamCenti / 100.0;
+    out.cpuLoadPercentage = m_lastCpuCenti / 100.0;
+
+    out.processes.clear();
+    for (const auto& entry : m_processes) {
+        ProcessInfo p;
+        p.pid = entry.first;
+        p.name = m_names[entry.second.nameId];
+        p.memoryUsedBytes = entry.second.memoryUsedBytes;
+        p.cpuUsagePercentage = entry.second.cpuCenti / 100.0;
+        out.processes.push_back(p);
+    }
+    std::sort(out.processes.begin(), out.processes.end(), [](const ProcessInfo& a, const ProcessInfo& b) {
+        if (a.memoryUsedBytes != b.memoryUsedBytes) return a.memoryUsedBytes > b.memoryUsedBytes;
+        return a.pid < b.pid;
+        });
+    return true;
+}
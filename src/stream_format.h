@@ -0,0 +1,114 @@
+#ifndef STREAM_FORMAT_H
+#define STREAM_FORMAT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "snapshot_diff.h"
+#include "system_info.h"
+
+// Formato binario do modo headless.
+//
+// Arquivo: "PCHK" + byte de versao, seguido de frames. Cada frame e um varint
+// com o tamanho e o corpo do tick. Todos os inteiros sao varints (LEB128) e os
+// que podem diminuir vao em zigzag, como delta do tick anterior:
+//
+//   timestamp, version, ramTotal, ramUsed, ram% x100, cpu% x100
+//   nomes novos:       n, n x (tamanho, bytes)  -> ids sequenciais
+//   PIDs removidos:    n, n x delta do PID anterior da lista
+//   PIDs alterados:    n, n x (delta do PID, mascara, campos da mascara)
+//   processos em foco: n, n x (pid, m, m x (tid, cpu% x100))
+//
+// Processos sem mudanca nao aparecem no frame; o decoder mantem o estado.
+namespace stream_format {
+
+// 2: threads agrupadas por processo em foco (varios ao mesmo tempo).
+const uint8_t FORMAT_VERSION = 2;
+
+enum ProcessField : uint8_t {
+    FIELD_NAME = 1,
+    FIELD_MEMORY = 2,
+    FIELD_CPU = 4
+};
+
+void writeHeader(std::vector<uint8_t>& out);
+bool readHeader(FILE* in);
+
+// Le um frame (sem o prefixo de tamanho) para frame. Retorna false no fim do
+// arquivo ou se o frame estiver truncado ou declarar mais de 64 MiB.
+bool readFrame(FILE* in, std::vector<uint8_t>& frame);
+
+}
+
+class StreamEncoder {
+public:
+    // Anexa a out o frame do tick, ja com o prefixo de tamanho. Compara a
+    // lista inteira com o estado do encoder.
+    void encodeTick(const SystemInfo& info, std::vector<uint8_t>& out);
+    // O mesmo frame, mas so olha os processos citados em diffs: os diffs
+    // contiguos que levam da lista do ultimo frame ate a de info. Quem nao
+    // tem essa sequencia completa usa a versao acima.
+    void encodeTick(const SystemInfo& info, const std::vector<std::shared_ptr<const SnapshotDiff>>& diffs,
+        std::vector<uint8_t>& out);
+
+private:
+    struct EncodedProcess {
+        uint32_t nameId = 0;
+        unsigned long long memoryUsedBytes = 0;
+        int64_t cpuCenti = 0;
+        unsigned long long tick = 0;
+    };
+
+    // Um PID citado por algum diff; process == nullptr se foi removido.
+    struct DirtyProcess {
+        unsigned long pid;
+        size_t sequence;
+        const ProcessInfo* process;
+    };
+
+    uint32_t internName(const std::string& name);
+    // Escreve p em m_changes se mudou desde state. Retorna se escreveu.
+    bool encodeProcess(const ProcessInfo& p, EncodedProcess& state, bool isNew, unsigned long& lastPid);
+    // Monta o frame com m_newNames, m_removed e m_changes ja preenchidos.
+    void finishFrame(const SystemInfo& info, uint64_t changedCount, std::vector<uint8_t>& out);
+
+    std::unordered_map<std::string, uint32_t> m_nameIds;
+    std::unordered_map<unsigned long, EncodedProcess> m_processes;
+    unsigned long long m_tick = 0;
+    SystemInfo m_last;
+    int64_t m_lastRamCenti = 0;
+    int64_t m_lastCpuCenti = 0;
+
+    std::vector<uint8_t> m_header;
+    std::vector<uint8_t> m_changes;
+    std::vector<uint8_t> m_threads;
+    std::vector<std::string> m_newNames;
+    std::vector<unsigned long> m_removed;
+    std::vector<const ProcessInfo*> m_sorted;
+    std::vector<DirtyProcess> m_dirty;
+};
+
+class StreamDecoder {
+public:
+    // Aplica um frame ao estado e reconstroi out. Retorna false se o frame
+    // for invalido.
+    bool decodeTick(const std::vector<uint8_t>& frame, SystemInfo& out);
+
+private:
+    struct DecodedProcess {
+        uint32_t nameId = 0;
+        unsigned long long memoryUsedBytes = 0;
+        int64_t cpuCenti = 0;
+    };
+
+    std::vector<InternedName> m_names;
+    std::unordered_map<unsigned long, DecodedProcess> m_processes;
+    SystemInfo m_last;
+    int64_t m_lastRamCenti = 0;
+    int64_t m_lastCpuCenti = 0;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "symbols_linux.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <cxxabi.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Acima disso a secao de simbolos e ignorada (arquivo corrompido ou nao e o
+// que parece).
+static const uint64_t MAX_SECTION_BYTES = 256ull * 1024 * 1024;
+
+static bool readAt(int fd, void* out, size_t size, uint64_t offset) {
+    char* p = (char*)out;
+    while (size > 0) {
+        ssize_t n = pread(fd, p, size, (off_t)offset);
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+bool ElfSymbols::load(const std::string& path) {
+    m_symbols.clear();
+    m_segments.clear();
+    m_strings.clear();
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    Elf64_Ehdr header;
+    bool ok = readAt(fd, &header, sizeof(header), 0) && memcmp(header.e_ident, ELFMAG, SELFMAG) == 0 &&
+        header.e_ident[EI_CLASS] == ELFCLASS64 && header.e_shentsize == sizeof(Elf64_Shdr) &&
+        header.e_phentsize == sizeof(Elf64_Phdr);
+    if (!ok) {
+        close(fd);
+        return false;
+    }
+
+    std::vector<Elf64_Phdr> programHeaders(header.e_phnum);
+    if (!programHeaders.empty() &&
+        readAt(fd, programHeaders.data(), programHeaders.size() * sizeof(Elf64_Phdr), header.e_phoff)) {
+        for (const Elf64_Phdr& ph : programHeaders) {
+            if (ph.p_type != PT_LOAD) continue;
+            m_segments.push_back(Segment{ ph.p_offset, ph.p_filesz, ph.p_vaddr });
+        }
+    }
+
+    std::vector<Elf64_Shdr> sections(header.e_shnum);
+    if (sections.empty() || !readAt(fd, sections.data(), sections.size() * sizeof(Elf64_Shdr), header.e_shoff)) {
+        close(fd);
+        return !m_segments.empty();
+    }
+
+    // .symtab tem tudo; sem ela, .dynsym tem so o que e exportado.
+    const Elf64_Shdr* symbolSection = nullptr;
+    for (unsigned type : { (unsigned)SHT_SYMTAB, (unsigned)SHT_DYNSYM }) {
+        for (const Elf64_Shdr& section : sections) {
+            if (section.sh_type == type && section.sh_link < sections.size() && section.sh_entsize == sizeof(Elf64_Sym)) {
+                symbolSection = &section;
+                break;
+            }
+        }
+        if (symbolSection != nullptr) break;
+    }
+
+    if (symbolSection != nullptr) {
+        const Elf64_Shdr& stringSection = sections[symbolSection->sh_link];
+        if (symbolSection->sh_size <= MAX_SECTION_BYTES && stringSection.sh_size <= MAX_SECTION_BYTES) {
+            std::vector<Elf64_Sym> symbols(symbolSection->sh_size / sizeof(Elf64_Sym));
+            m_strings.resize(stringSection.sh_size);
+            if (readAt(fd, symbols.data(), symbols.size() * sizeof(Elf64_Sym), symbolSection->sh_offset) &&
+                readAt(fd, &m_strings[0], m_strings.size(), stringSection.sh_offset)) {
+                for (const Elf64_Sym& symbol : symbols) {
+                    if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC || symbol.st_value == 0 ||
+                        symbol.st_name >= m_strings.size()) continue;
+                    m_symbols.push_back(Symbol{ symbol.st_value, symbol.st_size, symbol.st_name });
+                }
+            }
+            else {
+                m_strings.clear();
+            }
+        }
+    }
+    close(fd);
+
+    std::sort(m_symbols.begin(), m_symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.address < b.address || (a.address == b.address && a.size > b.size);
+        });
+    return true;
+}
+
+bool ElfSymbols::fileOffsetToAddress(uint64_t offset, uint64_t& address) const {
+    for (const Segment& segment : m_segments) {
+        if (offset >= segment.offset && offset < segment.offset + segment.fileSize) {
+            address = offset - segment.offset + segment.address;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* ElfSymbols::lookup(uint64_t address) const {
+    auto it = std::upper_bound(m_symbols.begin(), m_symbols.end(), address, [](uint64_t value, const Symbol& symbol) {
+        return value < symbol.address;
+        });
+    if (it == m_symbols.begin()) return nullptr;
+    --it;
+    // Simbolos sem tamanho (alguns em assembly) valem ate o proximo.
+    if (it->size != 0 && address >= it->address + it->size) return nullptr;
+    return m_strings.c_str() + it->name;
+}
+
+std::shared_ptr<const ElfSymbols> SymbolCache::get(const std::string& openPath, const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_files.find(key);
+    if (it != m_files.end()) return it->second;
+
+    std::shared_ptr<ElfSymbols> symbols = std::make_shared<ElfSymbols>();
+    if (!symbols->load(openPath)) {
+        symbols.reset();
+    }
+    m_files[key] = symbols;
+    return symbols;
+}
+
+size_t SymbolCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_files.size();
+}
+
+ProcessSymbolizer::ProcessSymbolizer(unsigned long pid, SymbolCache& cache) :
+    m_pid(pid),
+    m_cache(cache)
+{
+    loadMaps();
+}
+
+// Formato de cada linha: inicio-fim perms offset dev inode caminho
+bool ProcessSymbolizer::loadMaps() {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%lu/maps", m_pid);
+    FILE* file = fopen(path, "r");
+    if (file == nullptr) return false;
+
+    std::vector<Mapping> mappings;
+    char line[4096];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        uint64_t start, end, offset;
+        char perms[8], dev[16];
+        unsigned long inode;
+        int consumed = 0;
+        if (sscanf(line, "%" SCNx64 "-%" SCNx64 " %7s %" SCNx64 " %15s %lu %n",
+            &start, &end, perms, &offset, dev, &inode, &consumed) < 6) continue;
+        if (strchr(perms, 'x') == nullptr) continue;
+
+        Mapping mapping;
+        mapping.start = start;
+        mapping.end = end;
+        mapping.offset = offset;
+        mapping.path = line + consumed;
+        while (!mapping.path.empty() && (mapping.path.back() == '\n' || mapping.path.back() == ' ')) {
+            mapping.path.pop_back();
+        }
+        if (inode != 0) {
+            mapping.key = std::string(dev) + ":" + std::to_string(inode) + ":" + mapping.path;
+        }
+
+        // Reaproveita os simbolos ja carregados na leitura anterior.
+        for (const Mapping& previous : m_mappings) {
+            if (previous.start == mapping.start && previous.key == mapping.key && previous.loaded) {
+                mapping.symbols = previous.symbols;
+                mapping.loaded = true;
+                break;
+            }
+        }
+        mappings.push_back(std::move(mapping));
+    }
+    fclose(file);
+    m_mappings.swap(mappings);
+    return true;
+}
+
+ProcessSymbolizer::Mapping* ProcessSymbolizer::findMapping(uint64_t address) {
+    auto it = std::upper_bound(m_mappings.begin(), m_mappings.end(), address, [](uint64_t value, const Mapping& mapping) {
+        return value < mapping.start;
+        });
+    if (it == m_mappings.begin()) return nullptr;
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+const std::string& ProcessSymbolizer::symbolize(uint64_t address) {
+    auto it = m_names.find(address);
+    if (it != m_names.end()) return it->second;
+    return m_names.emplace(address, resolve(address)).first->second;
+}
+
+static std::string baseName(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static std::string demangle(const char* name) {
+    if (name[0] != '_' || name[1] != 'Z') return name;
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status != 0 || demangled == nullptr) return name;
+    std::string result(demangled);
+    free(demangled);
+    return result;
+}
+
+std::string ProcessSymbolizer::resolve(uint64_t address) {
+    Mapping* mapping = findMapping(address);
+    if (mapping == nullptr && !m_mapsReloaded) {
+        // Biblioteca carregada (ou codigo gerado) depois da ultima leitura.
+        m_mapsReloaded = true;
+        loadMaps();
+        mapping = findMapping(address);
+    }
+
+    char fallback[64];
+    if (mapping == nullptr) {
+        snprintf(fallback, sizeof(fallback), "0x%" PRIx64, address);
+        return fallback;
+    }
+    if (mapping->key.empty()) {
+        // Anonimo: [vdso], JIT, etc.
+        snprintf(fallback, sizeof(fallback), "+0x%" PRIx64, address - mapping->start);
+        return (mapping->path.empty() ? std::string("[anonimo]") : mapping->path) + fallback;
+    }
+
+    if (!mapping->loaded) {
+        mapping->loaded = true;
+        // O caminho e o do namespace de montagem do processo (containers).
+        std::string openPath = "/proc/" + std::to_string(m_pid) + "/root" + mapping->path;
+        mapping->symbols = m_cache.get(openPath, mapping->key);
+        if (!mapping->symbols) {
+            mapping->symbols = m_cache.get(mapping->path, mapping->key + ":direto");
+        }
+    }
+
+    uint64_t fileOffset = address - mapping->start + mapping->offset;
+    uint64_t elfAddress = 0;
+    if (mapping->symbols && mapping->symbols->fileOffsetToAddress(fileOffset, elfAddress)) {
+        if (const char* name = mapping->symbols->lookup(elfAddress)) {
+            return demangle(name);
+        }
+    }
+    snprintf(fallback, sizeof(fallback), "+0x%" PRIx64, fileOffset);
+    return baseName(mapping->path) + fallback;
+}
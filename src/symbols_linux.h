@@ -0,0 +1,87 @@
+#ifndef SYMBOLS_LINUX_H
+#define SYMBOLS_LINUX_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tabela de funcoes de um arquivo ELF (.symtab, ou .dynsym se o binario foi
+// "stripado"), ordenada por endereco. Sem dependencias: le os cabecalhos
+// direto do arquivo.
+class ElfSymbols {
+public:
+    bool load(const std::string& path);
+
+    // Endereco virtual do ELF correspondente a um offset no arquivo, pelos
+    // segmentos PT_LOAD. False se o offset nao esta em nenhum.
+    bool fileOffsetToAddress(uint64_t offset, uint64_t& address) const;
+    // Nome da funcao que contem o endereco, ou nulo.
+    const char* lookup(uint64_t address) const;
+    size_t size() const { return m_symbols.size(); }
+
+private:
+    struct Symbol {
+        uint64_t address;
+        uint64_t size;
+        uint32_t name;
+    };
+    struct Segment {
+        uint64_t offset;
+        uint64_t fileSize;
+        uint64_t address;
+    };
+
+    std::vector<Symbol> m_symbols;
+    std::vector<Segment> m_segments;
+    std::string m_strings;
+};
+
+// Arquivos ELF ja lidos, por caminho e inode; compartilhados entre processos
+// e sessoes de perfil.
+class SymbolCache {
+public:
+    std::shared_ptr<const ElfSymbols> get(const std::string& openPath, const std::string& key);
+    size_t size() const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const ElfSymbols>> m_files;
+};
+
+// Traduz enderecos de um processo em nomes, via /proc/<pid>/maps. Cada
+// endereco e resolvido uma vez; um endereco fora dos mapeamentos conhecidos
+// faz os mapas serem relidos (no maximo uma vez por chamada de begin()).
+class ProcessSymbolizer {
+public:
+    ProcessSymbolizer(unsigned long pid, SymbolCache& cache);
+
+    // Inicio de um lote de simbolizacao.
+    void begin() { m_mapsReloaded = false; }
+    const std::string& symbolize(uint64_t address);
+
+private:
+    struct Mapping {
+        uint64_t start;
+        uint64_t end;
+        uint64_t offset;
+        std::string path;
+        std::string key;
+        std::shared_ptr<const ElfSymbols> symbols;
+        bool loaded = false;
+    };
+
+    bool loadMaps();
+    Mapping* findMapping(uint64_t address);
+    std::string resolve(uint64_t address);
+
+    unsigned long m_pid;
+    SymbolCache& m_cache;
+    std::vector<Mapping> m_mappings;
+    bool m_mapsReloaded = false;
+    std::unordered_map<uint64_t, std::string> m_names;
+};
+
+#endif
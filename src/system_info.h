@@ -0,0 +1,281 @@
+#ifndef SYSTEM_INFO_H
+#define SYSTEM_INFO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "instrumentation.h"
+#include "process_metadata.h"
+
+// Contadores cumulativos de atividade de um processo, lidos na mesma passada
+// dos tempos de CPU; o SystemMonitor transforma em taxas por segundo.
+enum ProcessCounter {
+    COUNTER_IO_READ_BYTES,
+    COUNTER_IO_WRITE_BYTES,
+    COUNTER_MINOR_FAULTS,
+    COUNTER_MAJOR_FAULTS,
+    COUNTER_VOLUNTARY_SWITCHES,
+    COUNTER_INVOLUNTARY_SWITCHES,
+    PROCESS_COUNTER_COUNT
+};
+
+inline unsigned processCounterBit(ProcessCounter counter) {
+    return 1u << counter;
+}
+
+// Estados em que o tempo de um nucleo e dividido (fora o ocioso). user inclui
+// nice; irq inclui softirq; steal e o tempo que o hipervisor deu a outra VM.
+enum CpuState {
+    CPU_STATE_USER,
+    CPU_STATE_SYSTEM,
+    CPU_STATE_IOWAIT,
+    CPU_STATE_IRQ,
+    CPU_STATE_STEAL,
+    CPU_STATE_COUNT
+};
+
+// Capacidade fixa do uso por nucleo; nucleos alem disso so entram no total.
+const unsigned MAX_CPU_CORES = 1024;
+
+// Uso de cada nucleo no ultimo intervalo da camada do sistema, em % do tempo
+// do nucleo. Layout SoA de tamanho fixo: o snapshot copia sem alocar e a
+// interface percorre uma coluna inteira (ex.: busy para o mapa de calor).
+struct CpuCoreUsage {
+    unsigned count = 0;
+    // Numero do nucleo no sistema (cpuN), que pode pular nucleos offline.
+    uint16_t id[MAX_CPU_CORES] = {};
+    // 100 - ocioso - iowait, como cpuLoadPercentage.
+    float busy[MAX_CPU_CORES] = {};
+    float states[CPU_STATE_COUNT][MAX_CPU_CORES] = {};
+};
+
+// Pressure stall information (/proc/pressure/<recurso>): fracao do tempo em
+// que tarefas ficaram paradas esperando o recurso. "some" = ao menos uma
+// tarefa; "full" = todas as tarefas nao ociosas ao mesmo tempo.
+enum PressureResource {
+    PRESSURE_CPU,
+    PRESSURE_MEMORY,
+    PRESSURE_IO,
+    PRESSURE_RESOURCE_COUNT
+};
+
+struct PressureLine {
+    // Medias moveis do kernel, em %.
+    double avg10 = 0.0;
+    double avg60 = 0.0;
+    double avg300 = 0.0;
+    // % do ultimo intervalo da camada do sistema, a partir do total
+    // acumulado; -1 ate haver duas leituras.
+    double lastInterval = -1.0;
+};
+
+struct PressureInfo {
+    bool valid = false;
+    // Sem a linha full (kernels antigos para cpu) hasFull fica falso.
+    bool hasFull = false;
+    PressureLine some;
+    PressureLine full;
+};
+
+struct ProcessInfo {
+    unsigned long pid = 0;
+    InternedName name;
+    // Inicio do processo na unidade do coletor (RawProcessSample::startTime);
+    // com o PID, identifica o processo. 0 = desconhecido.
+    unsigned long long startTime = 0;
+    unsigned long long memoryUsedBytes = 0;
+    // % da maquina: 100 = todos os nucleos ocupados pelo processo.
+    double cpuUsagePercentage = 0.0;
+    // % de um nucleo: 100 = um nucleo inteiro (pode passar de 100 com varias
+    // threads). Comparavel entre maquinas de tamanhos diferentes.
+    double cpuCorePercentage = 0.0;
+    // 0 quando a plataforma nao informa na lista de processos.
+    unsigned long threadCount = 0;
+    // Taxa por segundo de cada ProcessCounter desde a lista anterior. So vale
+    // para os bits de ratesValid: um contador pode nao ser legivel (ex.:
+    // /proc/<pid>/io de outro usuario) e um processo novo ainda nao tem base.
+    double rates[PROCESS_COUNTER_COUNT] = {};
+    unsigned ratesValid = 0;
+
+    // Taxa do contador, ou -1 se nao foi medida (fica abaixo de qualquer
+    // taxa real numa ordenacao).
+    double rate(ProcessCounter counter) const {
+        return ratesValid & (1u << counter) ? rates[counter] : -1.0;
+    }
+    // Faltas de pagina e trocas de contexto somando os dois tipos.
+    double faultRate() const { return sumRates(COUNTER_MINOR_FAULTS, COUNTER_MAJOR_FAULTS); }
+    double switchRate() const { return sumRates(COUNTER_VOLUNTARY_SWITCHES, COUNTER_INVOLUNTARY_SWITCHES); }
+    double sumRates(ProcessCounter a, ProcessCounter b) const {
+        if (!(ratesValid & ((1u << a) | (1u << b)))) return -1.0;
+        return std::max(rate(a), 0.0) + std::max(rate(b), 0.0);
+    }
+    // Nulo quando o processo nao veio de um coletor (ex.: stream decodificado).
+    ProcessMetadataRef metadata;
+};
+
+struct ExtraProcessInfo {
+    unsigned long threadCount = 0;
+    unsigned long long ioReadBytes = 0;
+    unsigned long long ioWriteBytes = 0;
+    unsigned long handleCount = 0;
+    std::string priorityClass;
+};
+
+struct ThreadInfo {
+    unsigned long tid = 0;
+    double cpuUsagePercentage = 0.0;
+};
+
+// Threads de um processo em foco. A lista vem de uma unica passada que so
+// olha esse processo, entao threads.size() e tambem a contagem de threads.
+struct FocusedProcessInfo {
+    unsigned long pid = 0;
+    std::vector<ThreadInfo> threads;
+};
+
+// Processo que saiu. cpuSeconds e o tempo total de CPU (usuario + kernel)
+// no fim, ou na ultima leitura quando o fim ja nao pode ser lido;
+// peakRssBytes e o maior RSS observado nas amostragens.
+struct ProcessExit {
+    unsigned long pid = 0;
+    InternedName name;
+    unsigned long parentPid = 0;
+    double cpuSeconds = 0.0;
+    unsigned long long peakRssBytes = 0;
+    // -1 = desconhecido (no Linux, saida percebida por varredura e nao por
+    // evento).
+    int exitCode = -1;
+    // Saiu antes de aparecer em alguma lista de processos; so os eventos de
+    // ciclo de vida enxergam esses.
+    bool shortLived = false;
+    // Quando a saida foi percebida, em ms desde a epoch.
+    unsigned long long timestampMs = 0;
+};
+
+// No da arvore de cgroups: grupo -> processos (pids) -> threads (as dos
+// processos em foco, em SystemInfo::focusedProcesses). O indice 0 e a raiz.
+struct CgroupInfo {
+    InternedName path;
+    // Nome exibido: o ultimo componente do caminho.
+    std::string name;
+    uint32_t parent = 0;
+    uint32_t depth = 0;
+    std::vector<uint32_t> children;
+    // Processos diretamente neste grupo.
+    std::vector<unsigned long> pids;
+
+    // Somas dos processos do grupo e de todos os subgrupos.
+    unsigned long processCount = 0;
+    unsigned long threadCount = 0;
+    double cpuUsagePercentage = 0.0;
+    unsigned long long memoryUsedBytes = 0;
+    double ioReadBytesPerSec = 0.0;
+    double ioWriteBytesPerSec = 0.0;
+
+    // Lidos do proprio cgroup (cpu.stat, memory.current/max, io.stat); -1 ou
+    // 0 quando o arquivo nao existe (ex.: memory.current na raiz).
+    double cgroupCpuCores = -1.0;
+    double cgroupThrottledPercentage = -1.0;
+    unsigned long long cgroupMemoryBytes = 0;
+    unsigned long long cgroupMemoryMaxBytes = 0;
+    double cgroupIoReadBytesPerSec = -1.0;
+    double cgroupIoWriteBytesPerSec = -1.0;
+};
+
+struct CollectorStats {
+    unsigned long cachedHandles = 0;
+    unsigned long handlesOpened = 0;
+    unsigned long handlesEvicted = 0;
+    unsigned long long syscallsSaved = 0;
+    // Processos cujos metadados (nome, caminho, linha de comando, usuario)
+    // tiveram que ser lidos; os demais vieram do cache.
+    unsigned long metadataLoads = 0;
+    // Com eventos de ciclo de vida ativos, a lista de processos e mantida
+    // pelos eventos e so e varrida de tempos em tempos (rescans).
+    bool eventDriven = false;
+    unsigned long lifecycleEvents = 0;
+    unsigned long rescans = 0;
+};
+
+// Trabalho feito por um worker do pool de amostragem no ultimo tick.
+struct ShardStats {
+    unsigned long items = 0;
+    unsigned long stolen = 0;
+    double busyMs = 0.0;
+};
+
+// Estado do agendador da coleta. Os periodos sao os efetivos, que no modo
+// adaptativo podem estar acima dos configurados.
+struct SchedulerStats {
+    unsigned long long ticks = 0;
+    unsigned long long missedDeadlines = 0;
+    double lastTickMs = 0.0;
+    double systemPeriodMs = 0.0;
+    double processPeriodMs = 0.0;
+    double threadPeriodMs = 0.0;
+};
+
+// Contadores das regras de alerta (AlertEngine).
+struct AlertStats {
+    unsigned rules = 0;
+    // Pares regra/processo cujas condicoes valem agora, disparados ou ainda
+    // cumprindo a duracao.
+    unsigned long states = 0;
+    // Totais desde o inicio.
+    unsigned long long evaluations = 0;
+    unsigned long long fired = 0;
+    unsigned long long resolved = 0;
+};
+
+// Definidos em snapshot_diff.h, process_actions.h e alert_rules.h.
+struct SnapshotDiff;
+struct ProcessActionStatus;
+struct AlertStatus;
+
+struct SystemInfo {
+    // Incrementada a cada snapshot publicado; 0 = nenhuma coleta ainda.
+    unsigned long long version = 0;
+    // Momento da publicacao, em ms desde a epoch.
+    unsigned long long timestampMs = 0;
+    double ramUsagePercentage = 0.0;
+    unsigned long long ramUsedBytes = 0;
+    unsigned long long ramTotalBytes = 0;
+    double cpuLoadPercentage = 0.0;
+    // Divisao do tempo de todos os nucleos, em % da maquina.
+    double cpuStatePercentages[CPU_STATE_COUNT] = {};
+    // Nucleos online (os que aparecem na leitura do sistema).
+    unsigned cpuCoreCount = 0;
+    CpuCoreUsage cpuCores;
+    PressureInfo pressure[PRESSURE_RESOURCE_COUNT];
+    // Incrementada so quando a lista de processos foi amostrada de novo; com
+    // camadas em ritmos diferentes, varios snapshots seguidos podem ter a
+    // mesma lista.
+    unsigned long long processListVersion = 0;
+    std::vector<ProcessInfo> processes;
+    // O que mudou da lista anterior para esta (mesmo processListVersion).
+    std::shared_ptr<const SnapshotDiff> processDiff;
+    // Processos que sairam entre a lista anterior e esta; acompanha
+    // processListVersion (snapshots com a mesma lista repetem as mesmas saidas).
+    std::vector<ProcessExit> exitedProcesses;
+    // Arvore de cgroups com os agregados da lista atual (so a raiz onde nao
+    // ha cgroups). Nos sem processos ficam com processCount == 0 ate serem
+    // compactados. Compartilhada entre snapshots enquanto nao muda; nula
+    // antes da primeira lista.
+    std::shared_ptr<const std::vector<CgroupInfo>> cgroups;
+    std::vector<FocusedProcessInfo> focusedProcesses;
+    // Acoes de controle de processo (encerrar, arvore, em lote) em andamento
+    // e as ultimas concluidas; nulo antes da primeira acao.
+    std::shared_ptr<const ProcessActionStatus> processActions;
+    // Alertas ativos e os ultimos eventos; nulo enquanto nao ha regras.
+    std::shared_ptr<const AlertStatus> alerts;
+    AlertStats alertStats;
+    CollectorStats collectorStats;
+    std::vector<ShardStats> samplingShards;
+    SchedulerStats scheduler;
+    MonitorDiagnostics diagnostics;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "ui_format.h"
+
+#include <cstdio>
+
+void formatBytes(unsigned long long bytes, char* out, size_t size) {
+    if (bytes > (1024 * 1024 * 1024)) { // GB
+        snprintf(out, size, "%.2f GB", bytes / (1024.0 * 1024.0 * 1024.0));
+    }
+    else if (bytes > (1024 * 1024)) { // MB
+        snprintf(out, size, "%.2f MB", bytes / (1024.0 * 1024.0));
+    }
+    else if (bytes > 1024) { // KB
+        snprintf(out, size, "%.2f KB", bytes / 1024.0);
+    }
+    else {
+        snprintf(out, size, "%llu B", bytes);
+    }
+}
+
+std::string formatBytes(unsigned long long bytes) {
+    char text[32];
+    formatBytes(bytes, text, sizeof(text));
+    return text;
+}
+
+void formatByteRate(double bytesPerSecond, char* out, size_t size) {
+    if (bytesPerSecond < 0.0) {
+        snprintf(out, size, "-");
+        return;
+    }
+    char bytes[24];
+    formatBytes((unsigned long long)(bytesPerSecond + 0.5), bytes, sizeof(bytes));
+    snprintf(out, size, "%s/s", bytes);
+}
+
+void formatEventRate(double perSecond, char* out, size_t size) {
+    if (perSecond < 0.0) {
+        snprintf(out, size, "-");
+    }
+    else if (perSecond >= 10000.0) {
+        snprintf(out, size, "%.1fk/s", perSecond / 1000.0);
+    }
+    else {
+        snprintf(out, size, "%.0f/s", perSecond);
+    }
+}
+
+void formatProcessRow(const ProcessInfo& p, ProcessRowText& row) {
+    snprintf(row.pid, sizeof(row.pid), "%lu", p.pid);
+    snprintf(row.cpu, sizeof(row.cpu), "%.1f %%", p.cpuUsagePercentage);
+    snprintf(row.cpuCore, sizeof(row.cpuCore), "%.1f %%", p.cpuCorePercentage);
+    formatBytes(p.memoryUsedBytes, row.memory, sizeof(row.memory));
+    formatByteRate(p.rate(COUNTER_IO_READ_BYTES), row.ioRead, sizeof(row.ioRead));
+    formatByteRate(p.rate(COUNTER_IO_WRITE_BYTES), row.ioWrite, sizeof(row.ioWrite));
+    formatEventRate(p.faultRate(), row.faults, sizeof(row.faults));
+    formatEventRate(p.switchRate(), row.switches, sizeof(row.switches));
+}
+
+const char* cpuStateName(CpuState state) {
+    static const char* const names[CPU_STATE_COUNT] = { "user", "system", "iowait", "irq", "steal" };
+    return state < CPU_STATE_COUNT ? names[state] : "?";
+}
+
+const char* pressureResourceName(PressureResource resource) {
+    static const char* const names[PRESSURE_RESOURCE_COUNT] = { "CPU", "Memoria", "I/O" };
+    return resource < PRESSURE_RESOURCE_COUNT ? names[resource] : "?";
+}
+
+void formatCgroupRow(const CgroupInfo& group, CgroupRowText& row) {
+    snprintf(row.processes, sizeof(row.processes), "%lu/%lu", group.processCount, group.threadCount);
+    snprintf(row.cpu, sizeof(row.cpu), "%.1f %%", group.cpuUsagePercentage);
+    if (group.cgroupCpuCores < 0.0) snprintf(row.groupCpu, sizeof(row.groupCpu), "-");
+    else snprintf(row.groupCpu, sizeof(row.groupCpu), "%.2f", group.cgroupCpuCores);
+    if (group.cgroupThrottledPercentage < 0.0) snprintf(row.throttled, sizeof(row.throttled), "-");
+    else snprintf(row.throttled, sizeof(row.throttled), "%.1f %%", group.cgroupThrottledPercentage);
+    formatBytes(group.memoryUsedBytes, row.memory, sizeof(row.memory));
+    if (group.cgroupMemoryBytes == 0) {
+        snprintf(row.groupMemory, sizeof(row.groupMemory), "-");
+    }
+    else {
+        char current[24], limit[24];
+        formatBytes(group.cgroupMemoryBytes, current, sizeof(current));
+        if (group.cgroupMemoryMaxBytes == 0) snprintf(limit, sizeof(limit), "sem limite");
+        else formatBytes(group.cgroupMemoryMaxBytes, limit, sizeof(limit));
+        snprintf(row.groupMemory, sizeof(row.groupMemory), "%s / %s", current, limit);
+    }
+    formatByteRate(group.cgroupIoReadBytesPerSec >= 0.0 ? group.cgroupIoReadBytesPerSec : group.ioReadBytesPerSec,
+        row.ioRead, sizeof(row.ioRead));
+    formatByteRate(group.cgroupIoWriteBytesPerSec >= 0.0 ? group.cgroupIoWriteBytesPerSec : group.ioWriteBytesPerSec,
+        row.ioWrite, sizeof(row.ioWrite));
+}
+
+void formatActionResult(const ProcessActionResult& result, char* out, size_t size) {
+    if (result.refused) {
+        snprintf(out, size, "%s: recusada, encerraria todos os processos", result.label.c_str());
+        return;
+    }
+    int n = snprintf(out, size, "%s: %u com SIGTERM, %u com SIGKILL", result.label.c_str(), result.terminated, result.killed);
+    const struct {
+        unsigned count;
+        const char* text;
+    } extras[] = {
+        { result.gone, "ja tinham saido" },
+        { result.denied, "sem permissao" },
+        { result.failed, "com erro" },
+        { result.skipped, "protegidos (o monitor, o PID 1 e seus ancestrais)" },
+        { result.pending(), "aguardando" },
+    };
+    for (const auto& extra : extras) {
+        if (extra.count == 0 || n < 0 || (size_t)n >= size) continue;
+        n += snprintf(out + n, size - n, ", %u %s", extra.count, extra.text);
+    }
+}
+
+void formatAlertValue(AlertMetric metric, bool rate, double value, char* out, size_t size) {
+    char text[32];
+    double magnitude = value < 0.0 ? -value : value;
+    bool perSecond = rate || metric == METRIC_IO_READ || metric == METRIC_IO_WRITE ||
+        metric == METRIC_FAULTS || metric == METRIC_SWITCHES;
+    if (alertMetricIsBytes(metric)) {
+        formatBytes((unsigned long long)magnitude, text, sizeof(text));
+    }
+    else if (metric == METRIC_THREADS || metric == METRIC_FAULTS || metric == METRIC_SWITCHES) {
+        snprintf(text, sizeof(text), perSecond && metric == METRIC_THREADS ? "%.2f" : "%.0f", magnitude);
+    }
+    else {
+        snprintf(text, sizeof(text), "%.1f%%", magnitude);
+    }
+    snprintf(out, size, "%s%s%s", value < 0.0 ? "-" : "", text, perSecond ? "/s" : "");
+}
+
+void formatAlertEvent(const AlertEvent& event, char* out, size_t size) {
+    char value[48];
+    formatAlertValue(event.metric, event.rate, event.value, value, sizeof(value));
+    const char* metric = alertMetricName(event.metric);
+    if (event.system) {
+        snprintf(out, size, "%s: sistema, %s%s%s %s", event.rule.c_str(),
+            event.rate ? "rate(" : "", metric, event.rate ? ")" : "", value);
+    }
+    else {
+        snprintf(out, size, "%s: %s (PID %lu), %s%s%s %s", event.rule.c_str(), event.name.c_str(), event.pid,
+            event.rate ? "rate(" : "", metric, event.rate ? ")" : "", value);
+    }
+}
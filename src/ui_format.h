@@ -0,0 +1,65 @@
+#ifndef UI_FORMAT_H
+#define UI_FORMAT_H
+
+#include <cstddef>
+#include <string>
+
+#include "alert_rules.h"
+#include "process_actions.h"
+#include "system_info.h"
+
+// Texto exibido na tabela de processos. Fica fora do main.cpp para nao
+// depender do ImGui: o benchmark da coleta mede a mesma formatacao.
+std::string formatBytes(unsigned long long bytes);
+// Mesma formatacao num buffer do chamador, sem alocar.
+void formatBytes(unsigned long long bytes, char* out, size_t size);
+
+struct ProcessRowText {
+    char pid[32];
+    // % da maquina e % de um nucleo.
+    char cpu[32];
+    char cpuCore[32];
+    char memory[32];
+    // Taxas por segundo; "-" quando nao medidas.
+    char ioRead[32];
+    char ioWrite[32];
+    char faults[32];
+    char switches[32];
+};
+
+// Bytes ou eventos por segundo; taxa negativa (nao medida) vira "-".
+void formatByteRate(double bytesPerSecond, char* out, size_t size);
+void formatEventRate(double perSecond, char* out, size_t size);
+
+void formatProcessRow(const ProcessInfo& p, ProcessRowText& row);
+
+// Rotulos curtos dos CpuState e dos PressureResource.
+const char* cpuStateName(CpuState state);
+const char* pressureResourceName(PressureResource resource);
+
+// Linha de um cgroup: a soma dos processos e, quando o kernel informa, os
+// contadores do proprio grupo ("-" quando ausentes).
+struct CgroupRowText {
+    char processes[32];
+    char cpu[32];
+    char groupCpu[32];
+    char throttled[32];
+    char memory[32];
+    char groupMemory[64];
+    char ioRead[32];
+    char ioWrite[32];
+};
+
+void formatCgroupRow(const CgroupInfo& group, CgroupRowText& row);
+
+// "PID 123 (nginx): 1 com SIGTERM, 0 com SIGKILL", com os demais
+// contadores so quando diferentes de zero.
+void formatActionResult(const ProcessActionResult& result, char* out, size_t size);
+
+// Valor de uma metrica de alerta na unidade dela ("4.20 GB", "93.1%"); rate
+// acrescenta "/s".
+void formatAlertValue(AlertMetric metric, bool rate, double value, char* out, size_t size);
+// "cpu_alta: sistema, cpu 93.1%" ou "mem_grande: java (PID 123), mem 4.20 GB".
+void formatAlertEvent(const AlertEvent& event, char* out, size_t size);
+
+#endif
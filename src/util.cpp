@@ -0,0 +1,37 @@
+#include "util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+unsigned long long wallClockMs() {
+    return (unsigned long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool containsIgnoringCase(const std::string& text, const std::string& needle) {
+    return std::search(text.begin(), text.end(), needle.begin(), needle.end(), [](char a, char b) {
+        return tolower((unsigned char)a) == tolower((unsigned char)b);
+        }) != text.end();
+}
+
+bool parseScaledNumber(const std::string& text, double& value, char extraSuffix) {
+    char* end;
+    value = strtod(text.c_str(), &end);
+    if (end == text.c_str()) return false;
+    const char* units = "KMG";
+    if (extraSuffix != '\0' && *end == extraSuffix) {
+        ++end;
+    }
+    else if (*end != '\0') {
+        const char* unit = strchr(units, toupper((unsigned char)*end));
+        if (unit == nullptr) return false;
+        for (const char* u = units; u <= unit; ++u) {
+            value *= 1024.0;
+        }
+        ++end;
+    }
+    return *end == '\0';
+}
@@ -0,0 +1,16 @@
+#ifndef UTIL_H
+#define UTIL_H
+
+#include <string>
+
+// Ms desde a epoch no relogio de parede, o dos timestamps publicados.
+unsigned long long wallClockMs();
+
+bool containsIgnoringCase(const std::string& text, const std::string& needle);
+
+// Numero com sufixo opcional K, M ou G (potencias de 1024), como nas
+// consultas (minmem=512M) e nas regras de alerta. extraSuffix, se diferente
+// de '\0', e aceito no lugar da unidade e ignorado (o '%' das regras).
+bool parseScaledNumber(const std::string& text, double& value, char extraSuffix = '\0');
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstdint>
+#include <vector>
+
+// Inteiros em LEB128 (7 bits por byte) e, para os que podem ser negativos,
+// zigzag antes do LEB128. Usados pelo stream do modo headless e pelas
+// gravacoes de leituras brutas.
+inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+inline void putSigned(std::vector<uint8_t>& out, int64_t value) {
+    putVarint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+// Le de [p, end). Um varint truncado ou longo demais zera ok e devolve 0;
+// quem le confere ok no fim.
+struct VarintReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p == end) break;
+            uint8_t byte = *p++;
+            value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        uint64_t value = varint();
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }
+};
+
+#endif
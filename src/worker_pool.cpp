@@ -0,0 +1,145 @@
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <chrono>
+
+static const unsigned MAX_DEFAULT_WORKERS = 8;
+
+WorkerPool::WorkerPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_DEFAULT_WORKERS);
+    }
+    m_workerCount = threads;
+    m_shards.reset(new Shard[m_workerCount]);
+    for (unsigned i = 1; i < m_workerCount; ++i) {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_startCv.notify_all();
+    for (std::thread& t : m_threads) {
+        t.join();
+    }
+}
+
+bool WorkerPool::popFront(Shard& shard, uint32_t& chunk) {
+    uint64_t range = shard.range.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin >= end) return false;
+        uint64_t next = ((uint64_t)(begin + 1) << 32) | end;
+        if (shard.range.compare_exchange_weak(range, next, std::memory_order_acq_rel)) {
+            chunk = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::stealBack(Shard& shard, uint32_t& chunk) {
+    uint64_t range = shard.range.load(std::memory_order_relaxed);
+    for (;;) {
+        uint32_t begin = (uint32_t)(range >> 32), end = (uint32_t)range;
+        if (begin >= end) return false;
+        uint64_t next = ((uint64_t)begin << 32) | (end - 1);
+        if (shard.range.compare_exchange_weak(range, next, std::memory_order_acq_rel)) {
+            chunk = end - 1;
+            return true;
+        }
+    }
+}
+
+void WorkerPool::runChunk(unsigned worker, uint32_t chunk) {
+    size_t begin = (size_t)chunk * m_chunkSize;
+    size_t end = std::min(begin + m_chunkSize, m_count);
+    (*m_task)(worker, begin, end);
+    m_shards[worker].items += (unsigned long)(end - begin);
+}
+
+void WorkerPool::work(unsigned worker) {
+    auto start = std::chrono::steady_clock::now();
+    Shard& own = m_shards[worker];
+    uint32_t chunk;
+
+    while (popFront(own, chunk)) {
+        runChunk(worker, chunk);
+    }
+    for (unsigned offset = 1; offset < m_workerCount; ++offset) {
+        Shard& victim = m_shards[(worker + offset) % m_workerCount];
+        while (stealBack(victim, chunk)) {
+            own.stolen++;
+            runChunk(worker, chunk);
+        }
+    }
+
+    own.busyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void WorkerPool::workerLoop(unsigned worker) {
+    unsigned long long seenEpoch = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_startCv.wait(lock, [&] { return m_stopping || m_epoch != seenEpoch; });
+            if (m_stopping) return;
+            seenEpoch = m_epoch;
+        }
+
+        work(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0) {
+                m_doneCv.notify_one();
+            }
+        }
+    }
+}
+
+void WorkerPool::run(size_t count, size_t chunkSize, const Task& task, std::vector<ShardStats>* shards) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    size_t chunks = (count + chunkSize - 1) / chunkSize;
+
+    m_task = &task;
+    m_count = count;
+    m_chunkSize = chunkSize;
+    for (unsigned i = 0; i < m_workerCount; ++i) {
+        uint64_t begin = chunks * i / m_workerCount;
+        uint64_t end = chunks * (i + 1) / m_workerCount;
+        m_shards[i].range.store((begin << 32) | end, std::memory_order_relaxed);
+        m_shards[i].items = 0;
+        m_shards[i].stolen = 0;
+        m_shards[i].busyMs = 0.0;
+    }
+
+    if (m_workerCount == 1 || chunks <= 1) {
+        work(0);
+    }
+    else {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending = m_workerCount - 1;
+            ++m_epoch;
+        }
+        m_startCv.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_doneCv.wait(lock, [&] { return m_pending == 0; });
+    }
+
+    m_task = nullptr;
+    if (shards != nullptr) {
+        shards->resize(m_workerCount);
+        for (unsigned i = 0; i < m_workerCount; ++i) {
+            (*shards)[i].items = m_shards[i].items;
+            (*shards)[i].stolen = m_shards[i].stolen;
+            (*shards)[i].busyMs = m_shards[i].busyMs;
+        }
+    }
+}
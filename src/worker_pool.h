@@ -0,0 +1,68 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "system_info.h"
+
+// Pool fixo de threads para dividir a amostragem de processos. Os itens
+// [0, count) sao agrupados em blocos e cada worker recebe uma faixa continua
+// de blocos; quem termina a propria faixa rouba blocos do fim da faixa dos
+// outros. A thread que chama run() tambem trabalha (worker 0).
+class WorkerPool {
+public:
+    // 0 = escolhe pelo numero de nucleos, limitado a um pool pequeno.
+    explicit WorkerPool(unsigned threads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    unsigned size() const { return m_workerCount; }
+
+    using Task = std::function<void(unsigned worker, size_t begin, size_t end)>;
+
+    // Executa task sobre todos os itens e so retorna quando todos terminaram.
+    // Se shards nao for nulo, recebe uma entrada por worker.
+    void run(size_t count, size_t chunkSize, const Task& task, std::vector<ShardStats>* shards = nullptr);
+
+private:
+    struct alignas(64) Shard {
+        // Faixa de blocos ainda nao iniciados: (inicio << 32) | fim.
+        std::atomic<uint64_t> range{ 0 };
+        unsigned long items = 0;
+        unsigned long stolen = 0;
+        double busyMs = 0.0;
+    };
+
+    void workerLoop(unsigned worker);
+    void work(unsigned worker);
+    bool popFront(Shard& shard, uint32_t& chunk);
+    bool stealBack(Shard& shard, uint32_t& chunk);
+    void runChunk(unsigned worker, uint32_t chunk);
+
+    unsigned m_workerCount = 1;
+    std::unique_ptr<Shard[]> m_shards;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_startCv;
+    std::condition_variable m_doneCv;
+    unsigned long long m_epoch = 0;
+    unsigned m_pending = 0;
+    bool m_stopping = false;
+
+    const Task* m_task = nullptr;
+    size_t m_count = 0;
+    size_t m_chunkSize = 1;
+};
+
+#endif